@@ -0,0 +1,1401 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Measure the overhead of the Server Wrapper over the In-Process C-API. The
+// same workload is run against a model through a client written directly
+// against 'TRITONSERVER_ServerInferAsync' and through
+// 'TritonServer::AsyncInfer' and 'TritonServer::Infer', with the same inputs
+// and the same number of requests in flight. Each run reports the latency
+// percentiles, the CPU time of the process per request and the heap
+// allocations per request, and the difference between a wrapper run and the
+// raw run is the wrapper tax.
+//
+// The raw client is what a careful user of the C-API would write: each slot
+// reuses one inference request with its inputs attached once, and the output
+// buffers are owned by the slot and reused across responses. The wrapper
+// client uses the wrapper as documented and fills a reset 'InferRequest' for
+// each inference.
+//
+// The runs are broken down by the number of requested outputs, from one to
+// all the outputs of the model, and by whether the model has BYTES tensors.
+// Decoupled models are not supported.
+//
+// With '--phase-counters' the wrapper runs also report the hardware counters
+// of each wrapper phase per call, see 'ServerOptions::phase_counters_'.
+//
+// With '--densify' the expansion of a sparse FP32 input of the given rows,
+// columns and density by 'InferRequest::AddSparseInput' is also measured, in
+// both formats, on the calling thread and on the shared executor. The
+// bandwidth is the bytes of the indices, the values and the dense tensor
+// over the time of a call.
+//
+// Usage: tds_wrapper_bench --model-repository=<dir> [--models=<a,b,...>]
+//            [--concurrency=<n,m,...>] [--requests=<n>]
+//            [--warmup-requests=<n>] [--variable-dim=<n>] [--output=<file>]
+//            [--phase-counters] [--densify=<rows>,<cols>,<density>]
+
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "model_config.h"
+#include "triton/core/tritonserver.h"
+#include "triton/developer_tools/server_wrapper.h"
+
+namespace {
+
+namespace tds = triton::developer_tools::server;
+using namespace triton::developer_tools::tools;
+
+// The number of 'operator new' calls in the process, which includes the
+// allocations of the server itself. Those are the same for both clients, so
+// the difference between two runs is the difference between the clients.
+std::atomic<uint64_t> allocation_count(0);
+
+void*
+CountedAllocate(size_t size)
+{
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = std::malloc((size == 0) ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+}  // namespace
+
+void*
+operator new(size_t size)
+{
+  return CountedAllocate(size);
+}
+
+void*
+operator new[](size_t size)
+{
+  return CountedAllocate(size);
+}
+
+void*
+operator new(size_t size, const std::nothrow_t&) noexcept
+{
+  try {
+    return CountedAllocate(size);
+  }
+  catch (...) {
+    return nullptr;
+  }
+}
+
+void*
+operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+  try {
+    return CountedAllocate(size);
+  }
+  catch (...) {
+    return nullptr;
+  }
+}
+
+void
+operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void
+operator delete[](void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void
+operator delete(void* ptr, size_t) noexcept
+{
+  std::free(ptr);
+}
+
+void
+operator delete[](void* ptr, size_t) noexcept
+{
+  std::free(ptr);
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+//==============================================================================
+/// Command line settings.
+///
+struct Settings {
+  Settings()
+      : models_({"add_sub", "add_sub_str"}), concurrencies_({1, 8}),
+        requests_(20000), warmup_requests_(1000), variable_dim_(16),
+        phase_counters_(false), densify_rows_(0), densify_cols_(0),
+        densify_density_(0)
+  {
+  }
+
+  std::string model_repository_;
+  std::vector<std::string> models_;
+  std::vector<int64_t> concurrencies_;
+  int64_t requests_;
+  int64_t warmup_requests_;
+  // The size of the variable dimensions of the inputs.
+  int64_t variable_dim_;
+  std::string output_;
+  bool phase_counters_;
+  // The sparse input measured with '--densify', not measured if 0 rows.
+  int64_t densify_rows_;
+  int64_t densify_cols_;
+  double densify_density_;
+};
+
+void
+ThrowIfError(TRITONSERVER_Error* err)
+{
+  if (err != nullptr) {
+    const std::string message = TRITONSERVER_ErrorMessage(err);
+    TRITONSERVER_ErrorDelete(err);
+    throw std::runtime_error(message);
+  }
+}
+
+//==============================================================================
+/// Workload of a run.
+///
+struct BenchInput {
+  std::string name_;
+  tds::DataType data_type_;
+  TRITONSERVER_DataType raw_data_type_;
+  std::vector<int64_t> shape_;
+  std::vector<char> data_;
+};
+
+struct Workload {
+  std::string model_;
+  std::vector<BenchInput> inputs_;
+  std::vector<std::string> outputs_;
+  bool has_bytes_;
+};
+
+// Map the data type name used by 'ModelConfig' to the data types of the
+// wrapper and of the C-API, and return the byte size of an element, which is
+// 0 for BYTES.
+size_t
+ParseBenchDataType(
+    const std::string& name, tds::DataType* data_type,
+    TRITONSERVER_DataType* raw_data_type)
+{
+  struct Entry {
+    const char* name_;
+    tds::DataType data_type_;
+    TRITONSERVER_DataType raw_data_type_;
+    size_t byte_size_;
+  };
+  static const Entry entries[] = {
+      {"BOOL", tds::DataType::BOOL, TRITONSERVER_TYPE_BOOL, 1},
+      {"UINT8", tds::DataType::UINT8, TRITONSERVER_TYPE_UINT8, 1},
+      {"UINT16", tds::DataType::UINT16, TRITONSERVER_TYPE_UINT16, 2},
+      {"UINT32", tds::DataType::UINT32, TRITONSERVER_TYPE_UINT32, 4},
+      {"UINT64", tds::DataType::UINT64, TRITONSERVER_TYPE_UINT64, 8},
+      {"INT8", tds::DataType::INT8, TRITONSERVER_TYPE_INT8, 1},
+      {"INT16", tds::DataType::INT16, TRITONSERVER_TYPE_INT16, 2},
+      {"INT32", tds::DataType::INT32, TRITONSERVER_TYPE_INT32, 4},
+      {"INT64", tds::DataType::INT64, TRITONSERVER_TYPE_INT64, 8},
+      {"FP16", tds::DataType::FP16, TRITONSERVER_TYPE_FP16, 2},
+      {"FP32", tds::DataType::FP32, TRITONSERVER_TYPE_FP32, 4},
+      {"FP64", tds::DataType::FP64, TRITONSERVER_TYPE_FP64, 8},
+      {"BYTES", tds::DataType::BYTES, TRITONSERVER_TYPE_BYTES, 0},
+      {"BF16", tds::DataType::BF16, TRITONSERVER_TYPE_BF16, 2}};
+  for (const auto& entry : entries) {
+    if (name == entry.name_) {
+      *data_type = entry.data_type_;
+      *raw_data_type = entry.raw_data_type_;
+      return entry.byte_size_;
+    }
+  }
+  throw std::runtime_error("unsupported data type '" + name + "'");
+}
+
+// Build the workloads of 'model', one for each count of requested outputs.
+// The fixed-width inputs are zeros and the BYTES inputs are "1", which all
+// the data types of the test models accept.
+std::vector<Workload>
+ModelWorkloads(const Settings& settings, const std::string& model)
+{
+  const ModelConfig config = ReadModelConfig(
+      settings.model_repository_ + "/" + model + "/config.pbtxt");
+
+  Workload workload;
+  workload.model_ = model;
+  workload.has_bytes_ = false;
+  for (const auto& input : config.inputs_) {
+    if (input.optional_) {
+      continue;
+    }
+    BenchInput bench_input;
+    bench_input.name_ = input.name_;
+    const size_t element_byte_size = ParseBenchDataType(
+        input.data_type_, &bench_input.data_type_, &bench_input.raw_data_type_);
+    if (config.max_batch_size_ > 0) {
+      bench_input.shape_.push_back(1);
+    }
+    int64_t element_count = 1;
+    for (const auto dim : input.dims_) {
+      bench_input.shape_.push_back((dim < 0) ? settings.variable_dim_ : dim);
+      element_count *= bench_input.shape_.back();
+    }
+    if (element_byte_size == 0) {
+      const uint32_t len = 1;
+      for (int64_t i = 0; i < element_count; ++i) {
+        const char* len_bytes = reinterpret_cast<const char*>(&len);
+        bench_input.data_.insert(
+            bench_input.data_.end(), len_bytes, len_bytes + sizeof(len));
+        bench_input.data_.push_back('1');
+      }
+      workload.has_bytes_ = true;
+    } else {
+      bench_input.data_.resize(element_count * element_byte_size, 0);
+    }
+    workload.inputs_.push_back(std::move(bench_input));
+  }
+  for (const auto& output : config.outputs_) {
+    workload.has_bytes_ |= (output.data_type_ == "BYTES");
+  }
+
+  std::vector<Workload> workloads;
+  for (const auto& output : config.outputs_) {
+    workload.outputs_.push_back(output.name_);
+    workloads.push_back(workload);
+  }
+  if (workloads.empty()) {
+    throw std::runtime_error("model '" + model + "' has no output");
+  }
+  return workloads;
+}
+
+//==============================================================================
+/// Closed loop shared by the clients.
+///
+// Slots whose inference is complete, pushed by the completion callbacks and
+// popped by the thread driving the load.
+class CompletionQueue {
+ public:
+  void Push(const size_t slot)
+  {
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      slots_.push_back(slot);
+    }
+    cv_.notify_one();
+  }
+
+  size_t Pop()
+  {
+    std::unique_lock<std::mutex> lk(mu_);
+    cv_.wait(lk, [this] { return !slots_.empty(); });
+    const size_t slot = slots_.front();
+    slots_.pop_front();
+    return slot;
+  }
+
+ private:
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<size_t> slots_;
+};
+
+// Keep 'concurrency' inferences in flight until 'request_count' inferences
+// are complete. 'submit(slot)' starts an inference in a slot and
+// 'finish(slot)' reads its outputs once the slot is popped from 'queue'. The
+// latency of an inference is from the submission to its outputs being read.
+template <typename Submit, typename Finish>
+void
+RunClosedLoop(
+    const int64_t concurrency, const int64_t request_count,
+    CompletionQueue& queue, Submit submit, Finish finish,
+    std::vector<double>* latencies_us)
+{
+  std::vector<Clock::time_point> start_times(concurrency);
+  int64_t submitted = 0;
+  for (int64_t slot = 0; (slot < concurrency) && (submitted < request_count);
+       ++slot, ++submitted) {
+    start_times[slot] = Clock::now();
+    submit(slot);
+  }
+  for (int64_t completed = 0; completed < request_count; ++completed) {
+    const size_t slot = queue.Pop();
+    finish(slot);
+    const auto now = Clock::now();
+    if (latencies_us != nullptr) {
+      latencies_us->push_back(
+          std::chrono::duration<double, std::micro>(now - start_times[slot])
+              .count());
+    }
+    if (submitted < request_count) {
+      start_times[slot] = now;
+      submit(slot);
+      submitted++;
+    }
+  }
+}
+
+//==============================================================================
+/// Client written directly against the C-API.
+///
+class RawClient {
+ public:
+  RawClient(
+      TRITONSERVER_Server* server, const Workload& workload,
+      const int64_t concurrency)
+      : server_(server), workload_(workload), allocator_(nullptr)
+  {
+    ThrowIfError(TRITONSERVER_ResponseAllocatorNew(
+        &allocator_, ResponseAlloc, ResponseRelease, nullptr /* start_fn */));
+    for (int64_t i = 0; i < concurrency; ++i) {
+      std::unique_ptr<Slot> slot(new Slot());
+      slot->client_ = this;
+      slot->index_ = i;
+      slot->output_buffers_.resize(workload_.outputs_.size());
+      ThrowIfError(TRITONSERVER_InferenceRequestNew(
+          &slot->request_, server_, workload_.model_.c_str(),
+          -1 /* model_version */));
+      slots_.push_back(std::move(slot));
+      TRITONSERVER_InferenceRequest* request = slots_.back()->request_;
+      // The inputs, the requested outputs and the callbacks stay attached to
+      // the request when it is released, so they are only set once.
+      for (const auto& input : workload_.inputs_) {
+        ThrowIfError(TRITONSERVER_InferenceRequestAddInput(
+            request, input.name_.c_str(), input.raw_data_type_,
+            input.shape_.data(), input.shape_.size()));
+        ThrowIfError(TRITONSERVER_InferenceRequestAppendInputData(
+            request, input.name_.c_str(), input.data_.data(),
+            input.data_.size(), TRITONSERVER_MEMORY_CPU, 0));
+      }
+      for (const auto& output : workload_.outputs_) {
+        ThrowIfError(TRITONSERVER_InferenceRequestAddRequestedOutput(
+            request, output.c_str()));
+      }
+      ThrowIfError(TRITONSERVER_InferenceRequestSetReleaseCallback(
+          request, RequestRelease, slots_.back().get()));
+      ThrowIfError(TRITONSERVER_InferenceRequestSetResponseCallback(
+          request, allocator_, slots_.back().get(), ResponseComplete,
+          slots_.back().get()));
+    }
+  }
+
+  ~RawClient()
+  {
+    for (auto& slot : slots_) {
+      TRITONSERVER_InferenceRequestDelete(slot->request_);
+    }
+    TRITONSERVER_ResponseAllocatorDelete(allocator_);
+  }
+
+  CompletionQueue& Queue() { return queue_; }
+
+  void Submit(const size_t index)
+  {
+    Slot& slot = *slots_[index];
+    // The slot is complete once the response is delivered and the request is
+    // released, which may happen in either order.
+    slot.pending_.store(2, std::memory_order_relaxed);
+    slot.response_ = nullptr;
+    ThrowIfError(
+        TRITONSERVER_ServerInferAsync(server_, slot.request_, nullptr));
+  }
+
+  void Finish(const size_t index)
+  {
+    Slot& slot = *slots_[index];
+    if (slot.response_ == nullptr) {
+      throw std::runtime_error(
+          "no response from model '" + workload_.model_ + "'");
+    }
+    std::unique_ptr<
+        TRITONSERVER_InferenceResponse, decltype(&DeleteResponse)>
+        response(slot.response_, DeleteResponse);
+    slot.response_ = nullptr;
+    ThrowIfError(TRITONSERVER_InferenceResponseError(response.get()));
+    uint32_t output_count = 0;
+    ThrowIfError(TRITONSERVER_InferenceResponseOutputCount(
+        response.get(), &output_count));
+    for (uint32_t i = 0; i < output_count; ++i) {
+      const char* name;
+      TRITONSERVER_DataType data_type;
+      const int64_t* shape;
+      uint64_t dim_count;
+      const void* base;
+      size_t byte_size;
+      TRITONSERVER_MemoryType memory_type;
+      int64_t memory_type_id;
+      void* userp;
+      ThrowIfError(TRITONSERVER_InferenceResponseOutput(
+          response.get(), i, &name, &data_type, &shape, &dim_count, &base,
+          &byte_size, &memory_type, &memory_type_id, &userp));
+      if (byte_size > 0) {
+        checksum_ += *reinterpret_cast<const unsigned char*>(base);
+      }
+    }
+  }
+
+  uint64_t Checksum() const { return checksum_; }
+
+ private:
+  struct Slot {
+    RawClient* client_;
+    size_t index_;
+    TRITONSERVER_InferenceRequest* request_;
+    TRITONSERVER_InferenceResponse* response_;
+    std::atomic<int> pending_;
+    // The output buffers, in the order of the requested outputs.
+    std::vector<std::vector<char>> output_buffers_;
+  };
+
+  static void DeleteResponse(TRITONSERVER_InferenceResponse* response)
+  {
+    TRITONSERVER_InferenceResponseDelete(response);
+  }
+
+  static TRITONSERVER_Error* ResponseAlloc(
+      TRITONSERVER_ResponseAllocator* allocator, const char* tensor_name,
+      size_t byte_size, TRITONSERVER_MemoryType preferred_memory_type,
+      int64_t preferred_memory_type_id, void* userp, void** buffer,
+      void** buffer_userp, TRITONSERVER_MemoryType* actual_memory_type,
+      int64_t* actual_memory_type_id)
+  {
+    Slot* slot = reinterpret_cast<Slot*>(userp);
+    const auto& outputs = slot->client_->workload_.outputs_;
+    *buffer = nullptr;
+    *buffer_userp = nullptr;
+    *actual_memory_type = TRITONSERVER_MEMORY_CPU;
+    *actual_memory_type_id = 0;
+    for (size_t i = 0; i < outputs.size(); ++i) {
+      if (outputs[i] == tensor_name) {
+        std::vector<char>& output_buffer = slot->output_buffers_[i];
+        if (output_buffer.size() < byte_size) {
+          output_buffer.resize(byte_size);
+        }
+        if (byte_size > 0) {
+          *buffer = output_buffer.data();
+        }
+        return nullptr;
+      }
+    }
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        (std::string("unexpected output '") + tensor_name + "'").c_str());
+  }
+
+  static TRITONSERVER_Error* ResponseRelease(
+      TRITONSERVER_ResponseAllocator* allocator, void* buffer,
+      void* buffer_userp, size_t byte_size, TRITONSERVER_MemoryType memory_type,
+      int64_t memory_type_id)
+  {
+    // The buffers are owned by the slot.
+    return nullptr;
+  }
+
+  static void RequestRelease(
+      TRITONSERVER_InferenceRequest* request, const uint32_t flags, void* userp)
+  {
+    if ((flags & TRITONSERVER_REQUEST_RELEASE_ALL) != 0) {
+      Slot* slot = reinterpret_cast<Slot*>(userp);
+      slot->client_->Done(slot);
+    }
+  }
+
+  static void ResponseComplete(
+      TRITONSERVER_InferenceResponse* response, const uint32_t flags,
+      void* userp)
+  {
+    Slot* slot = reinterpret_cast<Slot*>(userp);
+    if (response != nullptr) {
+      slot->response_ = response;
+    }
+    if ((flags & TRITONSERVER_RESPONSE_COMPLETE_FINAL) != 0) {
+      slot->client_->Done(slot);
+    }
+  }
+
+  void Done(Slot* slot)
+  {
+    if (slot->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      queue_.Push(slot->index_);
+    }
+  }
+
+  TRITONSERVER_Server* server_;
+  const Workload& workload_;
+  TRITONSERVER_ResponseAllocator* allocator_;
+  std::vector<std::unique_ptr<Slot>> slots_;
+  CompletionQueue queue_;
+  uint64_t checksum_ = 0;
+};
+
+//==============================================================================
+/// Client using the wrapper.
+///
+class WrapperClient {
+ public:
+  WrapperClient(
+      tds::TritonServer& server, const Workload& workload,
+      const int64_t concurrency)
+      : server_(server), workload_(workload), results_(concurrency),
+        errors_(concurrency)
+  {
+    for (int64_t i = 0; i < concurrency; ++i) {
+      requests_.push_back(
+          tds::InferRequest::Create(tds::InferOptions(workload_.model_)));
+    }
+  }
+
+  CompletionQueue& Queue() { return queue_; }
+
+  void Prepare(const size_t slot)
+  {
+    tds::InferRequest& request = *requests_[slot];
+    request.Reset();
+    for (const auto& input : workload_.inputs_) {
+      request.AddInput(
+          input.name_, tds::Tensor(
+                           const_cast<char*>(input.data_.data()),
+                           input.data_.size(), input.data_type_, input.shape_,
+                           tds::MemoryType::CPU, 0));
+    }
+    for (const auto& output : workload_.outputs_) {
+      request.AddRequestedOutput(output);
+    }
+  }
+
+  void SubmitAsync(const size_t slot)
+  {
+    Prepare(slot);
+    server_.AsyncInfer(*requests_[slot])
+        .then([this, slot](tds::InferFuture ready) {
+          try {
+            results_[slot] = ready.get();
+          }
+          catch (...) {
+            errors_[slot] = std::current_exception();
+          }
+          queue_.Push(slot);
+        });
+  }
+
+  void FinishAsync(const size_t slot)
+  {
+    if (errors_[slot] != nullptr) {
+      std::exception_ptr error = errors_[slot];
+      errors_[slot] = nullptr;
+      std::rethrow_exception(error);
+    }
+    std::unique_ptr<tds::InferResult> result = std::move(results_[slot]);
+    Read(*result);
+  }
+
+  // Run 'request_count' synchronous inferences, one at a time.
+  void RunSync(const int64_t request_count, std::vector<double>* latencies_us)
+  {
+    for (int64_t i = 0; i < request_count; ++i) {
+      const auto start = Clock::now();
+      Prepare(0);
+      std::unique_ptr<tds::InferResult> result = server_.Infer(*requests_[0]);
+      Read(*result);
+      if (latencies_us != nullptr) {
+        latencies_us->push_back(
+            std::chrono::duration<double, std::micro>(Clock::now() - start)
+                .count());
+      }
+    }
+  }
+
+  uint64_t Checksum() const { return checksum_; }
+
+ private:
+  void Read(tds::InferResult& result)
+  {
+    if (result.HasError()) {
+      throw std::runtime_error(result.ErrorMsg());
+    }
+    for (const auto& output : workload_.outputs_) {
+      std::shared_ptr<tds::Tensor> tensor = result.Output(output);
+      if (tensor->byte_size_ > 0) {
+        checksum_ += static_cast<unsigned char>(tensor->buffer_[0]);
+      }
+    }
+  }
+
+  tds::TritonServer& server_;
+  const Workload& workload_;
+  std::vector<std::unique_ptr<tds::InferRequest>> requests_;
+  std::vector<std::unique_ptr<tds::InferResult>> results_;
+  std::vector<std::exception_ptr> errors_;
+  CompletionQueue queue_;
+  uint64_t checksum_ = 0;
+};
+
+//==============================================================================
+/// Measurement.
+///
+struct Summary {
+  Summary()
+      : p50_us_(0), p90_us_(0), p99_us_(0), p999_us_(0),
+        cpu_us_per_request_(0), allocations_per_request_(0)
+  {
+  }
+
+  double p50_us_;
+  double p90_us_;
+  double p99_us_;
+  double p999_us_;
+  // The CPU time of the whole process, server threads included.
+  double cpu_us_per_request_;
+  double allocations_per_request_;
+};
+
+struct Run {
+  std::string model_;
+  size_t output_count_;
+  bool has_bytes_;
+  int64_t concurrency_;
+  // "raw", "AsyncInfer" or "Infer".
+  std::string api_;
+  Summary summary_;
+  // The phase counters of the measured requests of a wrapper run, keyed by
+  // phase. Only set with '--phase-counters'.
+  std::map<std::string, tds::PhaseCounterStats> phases_;
+};
+
+double
+ProcessCpuSecs()
+{
+  timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double
+Percentile(const std::vector<double>& sorted, const double percentile)
+{
+  const size_t index = std::min<size_t>(
+      sorted.size() - 1,
+      std::max<size_t>(1, size_t(std::ceil(percentile / 100 * sorted.size()))) -
+          1);
+  return sorted[index];
+}
+
+// Warm up with 'run(warmup_requests, nullptr)', then measure
+// 'run(requests, &latencies_us)'. 'measure_start' is called between the two
+// if set.
+template <typename F>
+Summary
+Measure(
+    const Settings& settings, F run,
+    const std::function<void()>& measure_start = nullptr)
+{
+  run(settings.warmup_requests_, nullptr);
+  if (measure_start) {
+    measure_start();
+  }
+
+  std::vector<double> latencies_us;
+  latencies_us.reserve(settings.requests_);
+  const double cpu_start = ProcessCpuSecs();
+  const uint64_t allocation_start =
+      allocation_count.load(std::memory_order_relaxed);
+  run(settings.requests_, &latencies_us);
+  const uint64_t allocations =
+      allocation_count.load(std::memory_order_relaxed) - allocation_start;
+  const double cpu_secs = ProcessCpuSecs() - cpu_start;
+
+  Summary summary;
+  std::sort(latencies_us.begin(), latencies_us.end());
+  summary.p50_us_ = Percentile(latencies_us, 50);
+  summary.p90_us_ = Percentile(latencies_us, 90);
+  summary.p99_us_ = Percentile(latencies_us, 99);
+  summary.p999_us_ = Percentile(latencies_us, 99.9);
+  summary.cpu_us_per_request_ = cpu_secs * 1e6 / settings.requests_;
+  summary.allocations_per_request_ = double(allocations) / settings.requests_;
+  return summary;
+}
+
+// Return the counters accumulated between 'start' and 'end'.
+std::map<std::string, tds::PhaseCounterStats>
+PhaseDelta(
+    const std::map<std::string, tds::PhaseCounterStats>& end,
+    const std::map<std::string, tds::PhaseCounterStats>& start)
+{
+  std::map<std::string, tds::PhaseCounterStats> delta;
+  for (const auto& phase : end) {
+    tds::PhaseCounterStats stats = phase.second;
+    const auto it = start.find(phase.first);
+    if (it != start.end()) {
+      stats.count_ -= it->second.count_;
+      stats.cycles_ -= it->second.cycles_;
+      stats.instructions_ -= it->second.instructions_;
+      stats.cache_misses_ -= it->second.cache_misses_;
+      stats.context_switches_ -= it->second.context_switches_;
+    }
+    delta[phase.first] = stats;
+  }
+  return delta;
+}
+
+Run
+NewRun(
+    const Workload& workload, const int64_t concurrency, const std::string& api)
+{
+  Run run;
+  run.model_ = workload.model_;
+  run.output_count_ = workload.outputs_.size();
+  run.has_bytes_ = workload.has_bytes_;
+  run.concurrency_ = concurrency;
+  run.api_ = api;
+  return run;
+}
+
+tds::ServerOptions
+BenchServerOptions(const Settings& settings)
+{
+  tds::ServerOptions options({settings.model_repository_});
+  options.logging_ = tds::LoggingOptions(
+      tds::LoggingOptions::VerboseLevel(0), false, true, true,
+      tds::LoggingOptions::LogFormat::DEFAULT, "");
+  options.model_control_mode_ = tds::ModelControlMode::EXPLICIT;
+  options.startup_models_.insert(
+      settings.models_.begin(), settings.models_.end());
+  options.phase_counters_ = settings.phase_counters_;
+  return options;
+}
+
+// Start a server through the C-API with the settings of 'BenchServerOptions'
+// that matter for inference, the others keep the defaults of the C-API.
+std::shared_ptr<TRITONSERVER_Server>
+CreateRawServer(const Settings& settings)
+{
+  const tds::ServerOptions bench_options = BenchServerOptions(settings);
+  TRITONSERVER_ServerOptions* options = nullptr;
+  ThrowIfError(TRITONSERVER_ServerOptionsNew(&options));
+  std::unique_ptr<
+      TRITONSERVER_ServerOptions, void (*)(TRITONSERVER_ServerOptions*)>
+      options_guard(options, [](TRITONSERVER_ServerOptions* options) {
+        TRITONSERVER_ServerOptionsDelete(options);
+      });
+  ThrowIfError(TRITONSERVER_ServerOptionsSetModelRepositoryPath(
+      options, settings.model_repository_.c_str()));
+  ThrowIfError(TRITONSERVER_ServerOptionsSetLogVerbose(options, 0));
+  ThrowIfError(TRITONSERVER_ServerOptionsSetLogInfo(options, false));
+  ThrowIfError(TRITONSERVER_ServerOptionsSetBackendDirectory(
+      options, bench_options.backend_dir_.c_str()));
+  ThrowIfError(TRITONSERVER_ServerOptionsSetRepoAgentDirectory(
+      options, bench_options.repo_agent_dir_.c_str()));
+  ThrowIfError(TRITONSERVER_ServerOptionsSetModelControlMode(
+      options, TRITONSERVER_MODEL_CONTROL_EXPLICIT));
+  ThrowIfError(TRITONSERVER_ServerOptionsSetPinnedMemoryPoolByteSize(
+      options, bench_options.pinned_memory_pool_byte_size_));
+  ThrowIfError(TRITONSERVER_ServerOptionsSetBufferManagerThreadCount(
+      options, std::max(0, bench_options.buffer_manager_thread_count_)));
+  for (const auto& model : settings.models_) {
+    ThrowIfError(
+        TRITONSERVER_ServerOptionsSetStartupModel(options, model.c_str()));
+  }
+
+  TRITONSERVER_Server* server = nullptr;
+  ThrowIfError(TRITONSERVER_ServerNew(&server, options));
+  return std::shared_ptr<TRITONSERVER_Server>(
+      server, [](TRITONSERVER_Server* server) {
+        TRITONSERVER_Error* err = TRITONSERVER_ServerStop(server);
+        if (err != nullptr) {
+          TRITONSERVER_ErrorDelete(err);
+        }
+        TRITONSERVER_ServerDelete(server);
+      });
+}
+
+//==============================================================================
+/// Reporting.
+///
+std::string
+RunType(const Run& run)
+{
+  return run.has_bytes_ ? "BYTES" : "fixed";
+}
+
+void
+PrintRuns(const std::vector<Run>& runs)
+{
+  std::cout << std::endl
+            << std::left << std::setw(16) << "model" << std::right
+            << std::setw(8) << "outputs" << std::setw(7) << "type"
+            << std::setw(6) << "conc" << std::setw(12) << "api"
+            << std::setw(10) << "p50_us" << std::setw(10) << "p90_us"
+            << std::setw(10) << "p99_us" << std::setw(10) << "p99.9_us"
+            << std::setw(12) << "cpu_us/req" << std::setw(12) << "allocs/req"
+            << std::endl;
+  for (const auto& run : runs) {
+    const Summary& s = run.summary_;
+    std::cout << std::left << std::setw(16) << run.model_ << std::right
+              << std::setw(8) << run.output_count_ << std::setw(7)
+              << RunType(run) << std::setw(6) << run.concurrency_
+              << std::setw(12) << run.api_ << std::fixed
+              << std::setprecision(1) << std::setw(10) << s.p50_us_
+              << std::setw(10) << s.p90_us_ << std::setw(10) << s.p99_us_
+              << std::setw(10) << s.p999_us_ << std::setw(12)
+              << s.cpu_us_per_request_ << std::setw(12)
+              << s.allocations_per_request_ << std::endl;
+  }
+}
+
+// Return the run that 'wrapper' is compared to: the raw run of the same
+// workload and concurrency.
+const Run&
+BaselineRun(const std::vector<Run>& runs, const Run& wrapper)
+{
+  for (const auto& run : runs) {
+    if ((run.api_ == "raw") && (run.model_ == wrapper.model_) &&
+        (run.output_count_ == wrapper.output_count_) &&
+        (run.concurrency_ == wrapper.concurrency_)) {
+      return run;
+    }
+  }
+  throw std::runtime_error("no raw run to compare to");
+}
+
+Summary
+Tax(const Summary& wrapper, const Summary& raw)
+{
+  Summary tax;
+  tax.p50_us_ = wrapper.p50_us_ - raw.p50_us_;
+  tax.p90_us_ = wrapper.p90_us_ - raw.p90_us_;
+  tax.p99_us_ = wrapper.p99_us_ - raw.p99_us_;
+  tax.p999_us_ = wrapper.p999_us_ - raw.p999_us_;
+  tax.cpu_us_per_request_ =
+      wrapper.cpu_us_per_request_ - raw.cpu_us_per_request_;
+  tax.allocations_per_request_ =
+      wrapper.allocations_per_request_ - raw.allocations_per_request_;
+  return tax;
+}
+
+void
+PrintTax(const std::vector<Run>& runs)
+{
+  std::cout << std::endl << "Wrapper tax (wrapper - raw):" << std::endl;
+  std::vector<Run> taxes;
+  for (const auto& run : runs) {
+    if (run.api_ != "raw") {
+      Run tax = run;
+      tax.summary_ = Tax(run.summary_, BaselineRun(runs, run).summary_);
+      taxes.push_back(tax);
+    }
+  }
+  PrintRuns(taxes);
+}
+
+double
+PerCall(const uint64_t value, const uint64_t count)
+{
+  return (count == 0) ? 0 : double(value) / count;
+}
+
+void
+PrintPhases(const std::vector<Run>& runs, const int64_t requests)
+{
+  std::cout << std::endl
+            << "Wrapper phases (per call, 0 if the counters can't be read):"
+            << std::endl
+            << std::left << std::setw(16) << "model" << std::right
+            << std::setw(8) << "outputs" << std::setw(6) << "conc"
+            << std::setw(12) << "api" << std::setw(16) << "phase"
+            << std::setw(11) << "calls/req" << std::setw(12) << "cycles"
+            << std::setw(12) << "instr" << std::setw(7) << "IPC"
+            << std::setw(10) << "llc_miss" << std::setw(10) << "ctx_sw"
+            << std::endl;
+  for (const auto& run : runs) {
+    for (const auto& phase : run.phases_) {
+      const tds::PhaseCounterStats& p = phase.second;
+      std::cout << std::left << std::setw(16) << run.model_ << std::right
+                << std::setw(8) << run.output_count_ << std::setw(6)
+                << run.concurrency_ << std::setw(12) << run.api_
+                << std::setw(16) << phase.first << std::fixed
+                << std::setprecision(2) << std::setw(11)
+                << PerCall(p.count_, requests) << std::setprecision(0)
+                << std::setw(12) << PerCall(p.cycles_, p.count_)
+                << std::setw(12) << PerCall(p.instructions_, p.count_)
+                << std::setprecision(2) << std::setw(7)
+                << PerCall(p.instructions_, p.cycles_) << std::setw(10)
+                << PerCall(p.cache_misses_, p.count_) << std::setw(10)
+                << PerCall(p.context_switches_, p.count_) << std::endl;
+    }
+  }
+}
+
+//==============================================================================
+/// Densification of a sparse input.
+///
+struct DensifyRun {
+  std::string format_;
+  // "caller" or "executor".
+  std::string thread_;
+  size_t value_count_;
+  double us_per_call_;
+  double gb_per_sec_;
+};
+
+// Measure 'AddSparseInput' on a sparse FP32 input of 'rows' x 'cols' whose
+// rows have the same number of values, spread evenly over the columns.
+std::vector<DensifyRun>
+MeasureDensify(const Settings& settings, tds::TritonServer& server)
+{
+  const int64_t rows = settings.densify_rows_;
+  const int64_t cols = settings.densify_cols_;
+  const int64_t row_value_count = std::max<int64_t>(
+      1, std::llround(cols * std::min(settings.densify_density_, 1.0)));
+  const size_t value_count = rows * row_value_count;
+
+  std::vector<int64_t> coo;
+  std::vector<int64_t> csr;
+  coo.reserve(value_count * 2);
+  csr.reserve(rows + 1 + value_count);
+  csr.push_back(0);
+  for (int64_t row = 0; row < rows; ++row) {
+    csr.push_back((row + 1) * row_value_count);
+  }
+  for (int64_t row = 0; row < rows; ++row) {
+    for (int64_t i = 0; i < row_value_count; ++i) {
+      const int64_t col = i * cols / row_value_count;
+      coo.push_back(row);
+      coo.push_back(col);
+      csr.push_back(col);
+    }
+  }
+  std::vector<float> values(value_count, 1.0f);
+  const tds::Tensor values_tensor(
+      reinterpret_cast<char*>(values.data()), values.size() * sizeof(float),
+      tds::DataType::FP32, {static_cast<int64_t>(value_count)},
+      tds::MemoryType::CPU, 0);
+
+  std::vector<DensifyRun> runs;
+  auto request = tds::InferRequest::Create(tds::InferOptions("densify"));
+  for (const auto format : {tds::SparseFormat::COO, tds::SparseFormat::CSR}) {
+    std::vector<int64_t>& indices =
+        (format == tds::SparseFormat::COO) ? coo : csr;
+    const tds::Tensor indices_tensor(
+        reinterpret_cast<char*>(indices.data()),
+        indices.size() * sizeof(int64_t), tds::DataType::INT64,
+        {static_cast<int64_t>(indices.size())}, tds::MemoryType::CPU, 0);
+    for (tds::WorkExecutor* executor :
+         std::vector<tds::WorkExecutor*>{nullptr, &server.SharedExecutor()}) {
+      auto densify = [&]() {
+        request->Reset();
+        request->AddSparseInput(
+            "INPUT", indices_tensor, values_tensor, {rows, cols}, format,
+            executor);
+      };
+      // The first call allocates the dense buffer and faults its pages in.
+      densify();
+      int64_t call_count = 0;
+      const Clock::time_point start = Clock::now();
+      double elapsed_secs = 0;
+      while ((call_count < 5) || (elapsed_secs < 0.5)) {
+        densify();
+        ++call_count;
+        elapsed_secs =
+            std::chrono::duration<double>(Clock::now() - start).count();
+      }
+
+      DensifyRun run;
+      run.format_ = (format == tds::SparseFormat::COO) ? "COO" : "CSR";
+      run.thread_ = (executor == nullptr) ? "caller" : "executor";
+      run.value_count_ = value_count;
+      run.us_per_call_ = elapsed_secs * 1e6 / call_count;
+      const double byte_size = indices_tensor.byte_size_ +
+                               values_tensor.byte_size_ +
+                               double(rows) * cols * sizeof(float);
+      run.gb_per_sec_ = byte_size * call_count / elapsed_secs / 1e9;
+      runs.push_back(run);
+    }
+  }
+  return runs;
+}
+
+void
+PrintDensify(const std::vector<DensifyRun>& runs, const Settings& settings)
+{
+  std::cout << std::endl
+            << "Densify " << settings.densify_rows_ << " x "
+            << settings.densify_cols_ << " FP32:" << std::endl
+            << std::left << std::setw(8) << "format" << std::setw(10)
+            << "thread" << std::right << std::setw(12) << "values"
+            << std::setw(12) << "us/call" << std::setw(10) << "GB/s"
+            << std::endl;
+  for (const auto& run : runs) {
+    std::cout << std::left << std::setw(8) << run.format_ << std::setw(10)
+              << run.thread_ << std::right << std::setw(12)
+              << run.value_count_ << std::fixed << std::setprecision(1)
+              << std::setw(12) << run.us_per_call_ << std::setprecision(2)
+              << std::setw(10) << run.gb_per_sec_ << std::endl;
+  }
+}
+
+void
+WriteSummaryJson(const Summary& summary, std::ostream& out)
+{
+  out << "{\"p50_us\": " << summary.p50_us_
+      << ", \"p90_us\": " << summary.p90_us_
+      << ", \"p99_us\": " << summary.p99_us_
+      << ", \"p99.9_us\": " << summary.p999_us_
+      << ", \"cpu_us_per_request\": " << summary.cpu_us_per_request_
+      << ", \"allocations_per_request\": " << summary.allocations_per_request_
+      << "}";
+}
+
+void
+WriteJson(
+    const std::vector<Run>& runs, const std::vector<DensifyRun>& densify_runs,
+    std::ostream& out)
+{
+  out << std::fixed << std::setprecision(3) << "{\n  \"runs\": [";
+  bool first = true;
+  for (const auto& run : runs) {
+    if (run.api_ == "raw") {
+      continue;
+    }
+    const Run& raw = BaselineRun(runs, run);
+    out << (first ? "" : ",") << "\n    {\"model\": \"" << run.model_
+        << "\", \"outputs\": " << run.output_count_ << ", \"type\": \""
+        << RunType(run) << "\", \"concurrency\": " << run.concurrency_
+        << ", \"api\": \"" << run.api_ << "\",\n     \"raw\": ";
+    WriteSummaryJson(raw.summary_, out);
+    out << ",\n     \"wrapper\": ";
+    WriteSummaryJson(run.summary_, out);
+    out << ",\n     \"tax\": ";
+    WriteSummaryJson(Tax(run.summary_, raw.summary_), out);
+    if (!run.phases_.empty()) {
+      out << ",\n     \"phases\": {";
+      bool first_phase = true;
+      for (const auto& phase : run.phases_) {
+        const tds::PhaseCounterStats& p = phase.second;
+        out << (first_phase ? "" : ", ") << "\"" << phase.first
+            << "\": {\"count\": " << p.count_ << ", \"cycles\": " << p.cycles_
+            << ", \"instructions\": " << p.instructions_
+            << ", \"cache_misses\": " << p.cache_misses_
+            << ", \"context_switches\": " << p.context_switches_ << "}";
+        first_phase = false;
+      }
+      out << "}";
+    }
+    out << "}";
+    first = false;
+  }
+  out << "\n  ]";
+  if (!densify_runs.empty()) {
+    out << ",\n  \"densify\": [";
+    first = true;
+    for (const auto& run : densify_runs) {
+      out << (first ? "" : ",") << "\n    {\"format\": \"" << run.format_
+          << "\", \"thread\": \"" << run.thread_
+          << "\", \"values\": " << run.value_count_
+          << ", \"us_per_call\": " << run.us_per_call_
+          << ", \"gb_per_sec\": " << run.gb_per_sec_ << "}";
+      first = false;
+    }
+    out << "\n  ]";
+  }
+  out << "\n}\n";
+}
+
+void
+Usage(const char* program)
+{
+  std::cerr
+      << "Usage: " << program << " --model-repository=<dir> [options]"
+      << std::endl
+      << "  --models=<a,b,...>        models to run, default "
+         "add_sub,add_sub_str"
+      << std::endl
+      << "  --concurrency=<n,m,...>   requests in flight, default 1,8"
+      << std::endl
+      << "  --requests=<n>            measured requests of each run, default "
+         "20000"
+      << std::endl
+      << "  --warmup-requests=<n>     requests before each run, default 1000"
+      << std::endl
+      << "  --variable-dim=<n>        size of the variable input dimensions, "
+         "default 16"
+      << std::endl
+      << "  --output=<file>           file of the results in JSON" << std::endl
+      << "  --phase-counters          report the hardware counters of the "
+         "wrapper phases"
+      << std::endl
+      << "  --densify=<r>,<c>,<d>     measure the expansion of a sparse input "
+         "of r rows,"
+      << std::endl
+      << "                            c columns and density d" << std::endl;
+}
+
+std::vector<std::string>
+SplitList(const std::string& value)
+{
+  std::vector<std::string> items;
+  std::stringstream ss(value);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+bool
+ParseArgs(int argc, char** argv, Settings* settings)
+{
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--phase-counters") {
+      settings->phase_counters_ = true;
+      continue;
+    }
+    const auto eq = arg.find('=');
+    if ((arg.compare(0, 2, "--") != 0) || (eq == std::string::npos)) {
+      return false;
+    }
+    const std::string name = arg.substr(2, eq - 2);
+    const std::string value = arg.substr(eq + 1);
+    if (name == "model-repository") {
+      settings->model_repository_ = value;
+    } else if (name == "models") {
+      settings->models_ = SplitList(value);
+    } else if (name == "concurrency") {
+      settings->concurrencies_.clear();
+      for (const auto& item : SplitList(value)) {
+        settings->concurrencies_.push_back(std::stoll(item));
+      }
+    } else if (name == "requests") {
+      settings->requests_ = std::stoll(value);
+    } else if (name == "warmup-requests") {
+      settings->warmup_requests_ = std::stoll(value);
+    } else if (name == "variable-dim") {
+      settings->variable_dim_ = std::stoll(value);
+    } else if (name == "output") {
+      settings->output_ = value;
+    } else if (name == "densify") {
+      const std::vector<std::string> items = SplitList(value);
+      if (items.size() != 3) {
+        return false;
+      }
+      settings->densify_rows_ = std::stoll(items[0]);
+      settings->densify_cols_ = std::stoll(items[1]);
+      settings->densify_density_ = std::stod(items[2]);
+      if ((settings->densify_rows_ <= 0) || (settings->densify_cols_ <= 0) ||
+          (settings->densify_density_ <= 0)) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  for (const auto concurrency : settings->concurrencies_) {
+    if (concurrency <= 0) {
+      return false;
+    }
+  }
+  return !settings->model_repository_.empty() && !settings->models_.empty() &&
+         !settings->concurrencies_.empty() && (settings->requests_ > 0) &&
+         (settings->warmup_requests_ >= 0) && (settings->variable_dim_ > 0);
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+  Settings settings;
+  try {
+    if (!ParseArgs(argc, argv, &settings)) {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  catch (...) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  try {
+    std::vector<Workload> workloads;
+    for (const auto& model : settings.models_) {
+      for (auto& workload : ModelWorkloads(settings, model)) {
+        workloads.push_back(std::move(workload));
+      }
+    }
+
+    // Only one server runs at a time so that the clients don't compete for
+    // the CPUs, the raw runs are done first.
+    std::vector<Run> runs;
+    uint64_t raw_checksum = 0;
+    {
+      std::shared_ptr<TRITONSERVER_Server> server = CreateRawServer(settings);
+      for (const auto& workload : workloads) {
+        for (const auto concurrency : settings.concurrencies_) {
+          std::cerr << "Measuring raw " << workload.model_ << " with "
+                    << workload.outputs_.size() << " outputs at concurrency "
+                    << concurrency << std::endl;
+          RawClient client(server.get(), workload, concurrency);
+          Run run = NewRun(workload, concurrency, "raw");
+          run.summary_ = Measure(
+              settings, [&](const int64_t request_count,
+                            std::vector<double>* latencies_us) {
+                RunClosedLoop(
+                    concurrency, request_count, client.Queue(),
+                    [&](const size_t slot) { client.Submit(slot); },
+                    [&](const size_t slot) { client.Finish(slot); },
+                    latencies_us);
+              });
+          raw_checksum += client.Checksum();
+          runs.push_back(run);
+        }
+      }
+    }
+
+    uint64_t wrapper_checksum = 0;
+    std::vector<DensifyRun> densify_runs;
+    {
+      auto server = tds::TritonServer::Create(BenchServerOptions(settings));
+      for (const auto& workload : workloads) {
+        for (const auto concurrency : settings.concurrencies_) {
+          std::cerr << "Measuring wrapper " << workload.model_ << " with "
+                    << workload.outputs_.size() << " outputs at concurrency "
+                    << concurrency << std::endl;
+          WrapperClient client(*server, workload, concurrency);
+          // Snapshot the phase counters once the warmup is done.
+          std::map<std::string, tds::PhaseCounterStats> phase_start;
+          std::function<void()> measure_start = nullptr;
+          if (settings.phase_counters_) {
+            measure_start = [&]() {
+              phase_start = server->PhaseCounterStatistics(workload.model_);
+            };
+          }
+          auto measured_phases = [&]() {
+            return settings.phase_counters_
+                       ? PhaseDelta(
+                             server->PhaseCounterStatistics(workload.model_),
+                             phase_start)
+                       : std::map<std::string, tds::PhaseCounterStats>();
+          };
+
+          Run run = NewRun(workload, concurrency, "AsyncInfer");
+          run.summary_ = Measure(
+              settings,
+              [&](const int64_t request_count,
+                  std::vector<double>* latencies_us) {
+                RunClosedLoop(
+                    concurrency, request_count, client.Queue(),
+                    [&](const size_t slot) { client.SubmitAsync(slot); },
+                    [&](const size_t slot) { client.FinishAsync(slot); },
+                    latencies_us);
+              },
+              measure_start);
+          run.phases_ = measured_phases();
+          runs.push_back(run);
+
+          // 'Infer' blocks, so it only runs one request at a time.
+          if (concurrency == 1) {
+            Run sync_run = NewRun(workload, concurrency, "Infer");
+            sync_run.summary_ = Measure(
+                settings,
+                [&](const int64_t request_count,
+                    std::vector<double>* latencies_us) {
+                  client.RunSync(request_count, latencies_us);
+                },
+                measure_start);
+            sync_run.phases_ = measured_phases();
+            runs.push_back(sync_run);
+          }
+          wrapper_checksum += client.Checksum();
+        }
+      }
+      if (settings.densify_rows_ > 0) {
+        std::cerr << "Measuring densify" << std::endl;
+        densify_runs = MeasureDensify(settings, *server);
+      }
+    }
+
+    PrintRuns(runs);
+    PrintTax(runs);
+    if (settings.phase_counters_) {
+      PrintPhases(runs, settings.requests_);
+    }
+    if (!densify_runs.empty()) {
+      PrintDensify(densify_runs, settings);
+    }
+    // The outputs are read by both clients, the checksums keep the reads
+    // from being optimized away.
+    std::cerr << std::endl
+              << "checksums: raw " << raw_checksum << ", wrapper "
+              << wrapper_checksum << std::endl;
+
+    if (!settings.output_.empty()) {
+      std::ofstream file(settings.output_);
+      if (!file) {
+        throw std::runtime_error("failed to open '" + settings.output_ + "'");
+      }
+      WriteJson(runs, densify_runs, file);
+    }
+  }
+  catch (const std::exception& ex) {
+    std::cerr << "error: " << ex.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -25,6 +25,8 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 #include <climits>
+#include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -54,6 +56,8 @@ enum class DataType {
   BF16
 };
 enum class ModelReadyState { UNKNOWN, READY, UNAVAILABLE, LOADING, UNLOADING };
+enum class TaskPriority { LATENCY, BACKGROUND };
+enum class SparseFormat { COO, CSR };
 
 //==============================================================================
 // TritonException
@@ -261,6 +265,48 @@ struct BackendConfig {
   std::string value_;
 };
 
+//==============================================================================
+/// Structure to hold a NUMA node of the host. See 'NumaTopology' in
+/// 'server_wrapper.h' for more information.
+///
+struct NumaNode {
+  NumaNode(const int32_t id, const std::string& cpus);
+
+  // The id of the NUMA node.
+  int32_t id_;
+  // The CPUs of the NUMA node as a CPU list, e.g. "0-7,16-23", in the format
+  // accepted by the 'CPU_CORES' host policy setting.
+  std::string cpus_;
+};
+
+//==============================================================================
+/// Structure to hold the resource limits of the container the process runs in,
+/// as detected from the cgroup (v1 or v2) of the process. The defaults of
+/// 'ServerOptions' and the sizes of the thread pools owned by the wrapper are
+/// derived from these limits. See 'DetectContainerLimits' in
+/// 'server_wrapper.h' for more information.
+///
+struct ContainerLimits {
+  ContainerLimits();
+
+  // The version of the cgroup the limits are read from, 1 or 2. 0 if the
+  // process is not in a cgroup with resource controllers, e.g. on non-Linux
+  // hosts.
+  int32_t cgroup_version_;
+  // The number of CPUs allowed by the CPU bandwidth quota, e.g. 0.5 if the
+  // cgroup may use half of a CPU in each period. 0 if there is no quota.
+  double cpu_quota_;
+  // The number of CPUs the process may run on, which is the smaller of the
+  // number of CPUs in the cpuset of the cgroup and in the CPU affinity of the
+  // process.
+  uint32_t cpuset_cpu_count_;
+  // The number of CPUs the process can effectively use, which is the smaller
+  // of 'cpuset_cpu_count_' and 'cpu_quota_' rounded up. At least 1.
+  uint32_t effective_cpu_count_;
+  // The memory limit of the cgroup in bytes. 0 if there is no limit.
+  uint64_t memory_limit_byte_size_;
+};
+
 //==============================================================================
 /// Structure to hold CUDA memory pool byte size for setting 'ServerOptions'.
 /// If GPU support is enabled, the server will allocate CUDA memory to minimize
@@ -339,6 +385,160 @@ struct Trace {
   uint32_t log_frequency_;
 };
 
+//==============================================================================
+/// Structure to hold the setting of the watchdog that flags inference requests
+/// in flight for too long for 'ServerOptions'. Each request submitted through
+/// 'AsyncInfer' or 'Infer' is tracked until its final response is received. A
+/// request older than the threshold of its model is logged with its request
+/// id, model and elapsed time once, and counted in the 'tds_stuck_requests'
+/// metric. See 'TritonServer::WatchdogStatistics' for the statistics.
+///
+struct Watchdog {
+  // The action taken on a request that exceeds its threshold, in addition to
+  // logging it. CANCEL cancels the request in the server so that its future
+  // is completed with a cancellation error, if the backend supports it.
+  enum class Action { LOG, CANCEL };
+
+  Watchdog(const uint64_t threshold_ms, const Action& action = Action::LOG);
+
+  // The threshold in milliseconds of the models that are not in
+  // 'model_threshold_ms_'. 0 means these models are not watched.
+  uint64_t threshold_ms_;
+  // The threshold in milliseconds of specific models, which overrides
+  // 'threshold_ms_'.
+  std::map<std::string, uint64_t> model_threshold_ms_;
+  // The action taken on the requests that exceed the threshold. Default is
+  // LOG.
+  Action action_;
+};
+
+//==============================================================================
+/// Structure to hold the setting of the memory pressure monitor for
+/// 'ServerOptions'. The monitor reads the memory pressure stall information
+/// (PSI) from 'psi_path_' and the events of the cgroup memory controller from
+/// 'memory_events_path_', and degrades the service in stages as the pressure
+/// rises, so that the process sheds load before it is killed for running out
+/// of memory:
+///   - TRIM: the memory cached by the wrapper is released to the system and
+///     shadow mirroring is paused.
+///   - LIMIT: in addition, at most 'max_in_flight_' requests may be in flight
+///     through the wrapper, other requests are rejected.
+///   - SHED: in addition, the requests with a priority lower than
+///     'shed_priority_' are rejected.
+/// A rejected request fails in 'AsyncInfer' or 'Infer' without being sent to
+/// the server. The level is raised as soon as the pressure is detected and
+/// lowered one stage per 'interval_ms_' once the pressure falls. The level and
+/// the actions taken are reported in the 'tds_memory_pressure_level',
+/// 'tds_memory_pressure_avg10' and 'tds_memory_pressure_actions' metrics. See
+/// 'TritonServer::MemoryPressureStatistics' for the statistics.
+///
+struct MemoryPressure {
+  enum class Level { NONE, TRIM, LIMIT, SHED };
+
+  MemoryPressure();
+
+  // The PSI file of the memory. The cgroup v2 file 'memory.pressure' of a
+  // cgroup can be set to monitor the pressure of the cgroup only. If the file
+  // supports PSI triggers, the monitor is woken up as soon as the tasks stall
+  // on memory for 'trim_threshold_' percent of a 2 second window. Default is
+  // "/proc/pressure/memory".
+  std::string psi_path_;
+  // The 'memory.events' file of the cgroup v2 memory controller. A 'high'
+  // event raises the level to at least TRIM, a 'max' event to at least LIMIT
+  // and an 'oom' or 'oom_kill' event to SHED. Default is empty, meaning the
+  // file of the cgroup the process runs in, if any.
+  std::string memory_events_path_;
+  // The percentage of time in the last 10 seconds at least one task stalled on
+  // memory ('some avg10' in the PSI file) from which each level is entered.
+  // Default is 10, 25 and 50.
+  double trim_threshold_;
+  double limit_threshold_;
+  double shed_threshold_;
+  // The maximum number of requests in flight at LIMIT and SHED levels.
+  // Default is 16.
+  uint32_t max_in_flight_;
+  // The lowest priority level that is still accepted at SHED level. Priority
+  // values larger than 'shed_priority_' and 0, the default priority of the
+  // model, are rejected. Default is 1, meaning only the requests with the
+  // highest priority are accepted.
+  uint64_t shed_priority_;
+  // The interval in milliseconds at which the pressure is read when no PSI
+  // trigger fires. Default is 1000.
+  uint32_t interval_ms_;
+};
+
+//==============================================================================
+/// Structure to hold the setting of the predictive model preloading for
+/// 'ServerOptions'. The requests of each model are counted in buckets of
+/// 'bucket_secs_' of a cycle of 'period_secs_', a day in UTC by default, and
+/// the rate of each bucket is blended into a history that is kept in
+/// 'history_path_' across restarts. A few times per bucket:
+///   - The models whose rate in the history reaches 'load_rate_' in a bucket
+///     within the next 'lead_secs_' are loaded, the highest rates first, as
+///     long as fewer than 'max_loaded_models_' models are loaded.
+///   - The models loaded this way that received no request for 'idle_secs_'
+///     and whose rate doesn't reach 'load_rate_' within the next 'lead_secs_'
+///     are unloaded. The models loaded by the application are not unloaded.
+/// Only the requests to the models of the model repositories are counted.
+/// A model is warmed up as it loads if its configuration has 'model_warmup'
+/// samples, so that its first requests don't pay for the warmup either. Only
+/// supported in EXPLICIT model control mode. See
+/// 'TritonServer::ModelPreloadingStatistics' for the statistics.
+///
+struct ModelPreloading {
+  ModelPreloading(const std::string& history_path = "");
+
+  // The file the history is read from when the server is created, and
+  // written to each time a bucket closes and when the server is destroyed.
+  // If empty, the history is only kept in memory. Default is empty.
+  std::string history_path_;
+  // The duration in seconds of the cycle and of its buckets. A history
+  // recorded with another cycle is discarded. Default is 86400 and 900.
+  uint32_t period_secs_;
+  uint32_t bucket_secs_;
+  // How long in seconds before the expected traffic a model is loaded.
+  // Default is 600.
+  uint32_t lead_secs_;
+  // The request rate in requests per second from which a model is expected
+  // to be used, greater than 0. Default is 0.01.
+  double load_rate_;
+  // How long in seconds a preloaded model stays loaded without requests.
+  // Default is 1800.
+  uint32_t idle_secs_;
+  // The maximum number of models loaded at once, including the models loaded
+  // by the application, beyond which no model is preloaded. Default is 0,
+  // meaning no limit.
+  uint32_t max_loaded_models_;
+  // The weight of the last cycle in the history, between 0 and 1. Default is
+  // 0.3.
+  double smoothing_;
+};
+
+//==============================================================================
+/// Structure to hold the setting of the executor shared by the parallel work
+/// of the wrapper for 'ServerOptions'. See 'TritonServer::SharedExecutor' for
+/// more information.
+///
+struct WorkExecutorOptions {
+  // WRAPPER pins the workers like the other threads owned by the wrapper, to
+  // the CPUs of the NUMA node the server is created on if
+  // 'pin_wrapper_threads_' is set and not at all otherwise. CPU pins each
+  // worker to a single CPU, taken in turn from the CPUs of the wrapper
+  // threads if they are pinned and from the CPU affinity of the process
+  // otherwise.
+  enum class Affinity { WRAPPER, CPU };
+
+  WorkExecutorOptions();
+
+  // The number of workers. Default is 0, meaning the number of CPUs the
+  // container can use, see 'ContainerLimits::effective_cpu_count_', so that
+  // the workers don't oversubscribe a CPU quota together with the threads of
+  // the backends.
+  uint32_t thread_count_;
+  // The CPU affinity of the workers. Default is WRAPPER.
+  Affinity affinity_;
+};
+
 //==============================================================================
 /// Server options that are used to initialize Triton Server.
 ///
@@ -403,6 +603,17 @@ struct ServerOptions {
   // changes. Valid only when 'model_control_mode_' is set to "POLL". Default
   // is 15.
   int32_t repository_poll_secs_;
+  // If set, the model directories of the local model repositories are
+  // fingerprinted before each poll, and the poll is skipped if no file was
+  // added, removed or changed in content, so that touching the files, e.g.
+  // with a copy that preserves the content but not the modification times,
+  // doesn't reload the models. A file is only read again when its size,
+  // modification time or inode changes, and the files are hashed on the
+  // shared executor. The repositories that are not local directories are
+  // always polled. See 'TritonServer::RepositoryPollStatistics' for more
+  // information. Valid only when 'model_control_mode_' is set to "POLL".
+  // Default is false.
+  bool repository_poll_fingerprint_;
   // Specify the the models to be loaded on server startup. This will only take
   // effect if 'model_control_mode_' is set to 'EXPLICIT'.
   std::set<std::string> startup_models_;
@@ -416,7 +627,9 @@ struct ServerOptions {
   // specified byte size.  If 'NUMA_NODE' is configured via 'host_policy_', the
   // pinned system memory of the pool size will be allocated on each numa node.
   // This option will not affect the allocation conducted by the backend
-  // frameworks. Default is 256 MB.
+  // frameworks. Default is 256 MB, or 1/16 of the memory limit of the container
+  // if that is smaller. See the 'ContainerLimits' structure for more
+  // information.
   int64_t pinned_memory_pool_byte_size_;
   // The total byte size that can be allocated as CUDA memory for the GPU
   // device. See the 'CUDAMemoryPoolByteSize' structure for more information.
@@ -444,7 +657,10 @@ struct ServerOptions {
   // required to manage input and output tensor contents. Default is 0.
   int32_t buffer_manager_thread_count_;
   // The number of threads used to concurrently load models in model
-  // repositories. Default is 2*<num_cpu_cores>.
+  // repositories. Default is 2*<num_cpu_cores>, where <num_cpu_cores> is the
+  // number of CPUs the process can effectively use within the CPU quota and
+  // cpuset of its container. See the 'ContainerLimits' structure for more
+  // information.
   uint32_t model_load_thread_count_;
   // The GPU limit of model loading. See the 'ModelLoadGPULimit' structure for
   // more information.
@@ -452,9 +668,358 @@ struct ServerOptions {
   // The host policy setting. See the 'HostPolicy' structure for more
   // information.
   std::vector<HostPolicy> host_policy_;
+  // If set and 'host_policy_' is empty, the host policies are generated from
+  // the NUMA topology of the host when the host has more than one NUMA node.
+  // See 'GenerateHostPolicies' in 'server_wrapper.h' for the generated
+  // policies. Default is false.
+  bool auto_host_policy_;
+  // If set, the threads owned by the wrapper are pinned to the CPUs of the
+  // NUMA node the server is created on. Default is false.
+  bool pin_wrapper_threads_;
+  // Interval in milliseconds at which the liveness and readiness of the server
+  // and the readiness of the queried models are refreshed in the background.
+  // 'IsServerLive', 'IsServerReady' and 'IsModelReady' return the refreshed
+  // values without querying the server, so a check may see a value up to one
+  // interval old. The values are also refreshed when models are loaded or
+  // unloaded through the wrapper. A model that is not checked for 100
+  // refreshes is no longer refreshed. If 0, each check queries the server.
+  // Default is 0.
+  int32_t health_check_refresh_ms_;
   // The global trace setting. Default is nullptr, meaning that tracing is not
   // enabled. See the 'Trace' structure for more information.
   std::shared_ptr<Trace> trace_;
+  // The setting of the in-flight request watchdog. Default is nullptr, meaning
+  // that the requests are not watched. See the 'Watchdog' structure for more
+  // information.
+  std::shared_ptr<Watchdog> watchdog_;
+  // The setting of the memory pressure monitor. Default is nullptr, meaning
+  // that the memory pressure is not monitored. See the 'MemoryPressure'
+  // structure for more information.
+  std::shared_ptr<MemoryPressure> memory_pressure_;
+  // If set, the CPU cycles, instructions, cache misses and context switches
+  // of the request preparation, the response callback, the output release and
+  // the trace callbacks are counted for each model with 'perf_event_open'. See
+  // 'TritonServer::PhaseCounterStatistics' for more information. Counting
+  // costs a few system calls per phase, so it is meant for benchmarks and
+  // debugging. Default is false.
+  bool phase_counters_;
+  // If not empty, the latency of each request from the call to 'AsyncInfer'
+  // or 'Infer' to its response is recorded in a histogram per model with
+  // these bucket upper bounds in microseconds. The histograms are appended to
+  // 'TritonServer::ServerMetrics' as 'tds_request_latency_us'. Requests of
+  // decoupled models are not recorded. Default is empty.
+  std::vector<uint64_t> latency_histogram_bounds_us_;
+  // If true, each bucket of the latency histograms is followed by the request
+  // ID and the trace ID of its slowest recent request as an OpenMetrics
+  // exemplar. The rest of 'ServerMetrics' is in the Prometheus text format
+  // 0.0.4, whose parsers reject exemplars, so only enable this for consumers
+  // that accept them. Default is false.
+  bool latency_histogram_exemplars_;
+  // If not empty, the live counters of the wrapper are published every
+  // 'stats_segment_interval_ms_' to the POSIX shared memory object of this
+  // name, for example "/tds_stats", with the layout of 'StatsSegment' in
+  // stats_segment.h. The counters are the in-flight requests, the throughput
+  // and the latency histogram of each model, the pool and heap usage and the
+  // dropped traces. Other processes such as 'tds_top' read them by mapping
+  // the object, without any call into the server. The object is removed when
+  // the server is destroyed. Creating the server fails if the object is in
+  // use by a live process, an object left by a process that exited is
+  // replaced. Only supported on Linux. Default is empty.
+  std::string stats_segment_name_;
+  // The interval in milliseconds at which the stats segment is updated.
+  // Default is 100.
+  uint32_t stats_segment_interval_ms_;
+  // The setting of the executor shared by the parallel work of the wrapper.
+  // See the 'WorkExecutorOptions' structure for more information.
+  WorkExecutorOptions executor_;
+  // The setting of the predictive model preloading. Default is nullptr,
+  // meaning that the models are only loaded by the application. See the
+  // 'ModelPreloading' structure for more information.
+  std::shared_ptr<ModelPreloading> model_preloading_;
+};
+
+//==============================================================================
+/// Structure to hold the statistics of the adaptive output pruning of a model.
+/// See 'TritonServer::EnableOutputPruning' for more information.
+///
+struct OutputPruningStats {
+  OutputPruningStats();
+
+  // Whether the outputs are being pruned. False if the model is still in the
+  // learning window.
+  bool pruning_;
+  // The outputs requested for each inference request while pruning. Empty
+  // while learning, in which case all outputs are returned.
+  std::set<std::string> requested_outputs_;
+  // The number of inference requests that were sent with the pruned outputs.
+  uint64_t pruned_request_count_;
+  // The estimated number of output bytes that were not computed and allocated
+  // because of pruning. The estimation is based on the average byte size of
+  // each output observed during learning.
+  uint64_t skipped_byte_size_;
+  // The number of times the pruning fell back to returning all outputs
+  // because an output that was not requested was accessed.
+  uint64_t fallback_count_;
+};
+
+//==============================================================================
+/// Structure to hold the statistics of the in-flight request watchdog. See
+/// 'TritonServer::WatchdogStatistics' for more information.
+///
+struct WatchdogStats {
+  WatchdogStats();
+
+  // The number of requests in flight.
+  uint64_t in_flight_count_;
+  // The time in milliseconds the oldest request in flight has been in flight.
+  uint64_t oldest_in_flight_ms_;
+  // The number of requests that exceeded the threshold of their model.
+  uint64_t stuck_count_;
+  // The number of stuck requests that were cancelled.
+  uint64_t cancelled_count_;
+};
+
+//==============================================================================
+/// Structure to hold the statistics of the memory pressure monitor. See
+/// 'TritonServer::MemoryPressureStatistics' for more information.
+///
+struct MemoryPressureStats {
+  MemoryPressureStats();
+
+  // The current level.
+  MemoryPressure::Level level_;
+  // The percentage of time in the last 10 seconds at least one task ('some')
+  // and all tasks ('full') stalled on memory, as last read.
+  double some_avg10_;
+  double full_avg10_;
+  // The number of 'high', 'max' and 'oom' or 'oom_kill' events of the cgroup
+  // since the monitor started.
+  uint64_t high_event_count_;
+  uint64_t max_event_count_;
+  uint64_t oom_event_count_;
+  // The number of times the PSI trigger fired.
+  uint64_t trigger_count_;
+  // The number of times the memory cached by the wrapper was released.
+  uint64_t trim_count_;
+  // The number of requests rejected because of the in-flight limit and
+  // because of their priority.
+  uint64_t limited_count_;
+  uint64_t shed_count_;
+  // The number of requests in flight through the wrapper.
+  uint64_t in_flight_count_;
+};
+
+//==============================================================================
+/// Structure to hold the hardware performance counters of a phase of the
+/// wrapper for a model. See 'TritonServer::PhaseCounterStatistics' for more
+/// information.
+///
+struct PhaseCounterStats {
+  PhaseCounterStats();
+
+  // The number of times the phase ran.
+  uint64_t count_;
+  // The totals over all measurements of the CPU cycles, the instructions
+  // retired, the cache misses and the context switches of the thread running
+  // the phase. A counter that the host doesn't expose stays 0.
+  uint64_t cycles_;
+  uint64_t instructions_;
+  uint64_t cache_misses_;
+  uint64_t context_switches_;
+};
+
+//==============================================================================
+/// Structure to hold the statistics of the executor shared by the parallel
+/// work of the wrapper. See 'TritonServer::SharedExecutor' for more
+/// information.
+///
+struct WorkExecutorStats {
+  WorkExecutorStats();
+
+  // The number of workers, which are started with the first task.
+  uint32_t thread_count_;
+  // The number of tasks queued in the latency and in the background lanes.
+  uint64_t latency_queue_depth_;
+  uint64_t background_queue_depth_;
+  // The number of tasks submitted and run.
+  uint64_t submitted_count_;
+  uint64_t executed_count_;
+  // The number of tasks a worker took from the deque of another worker.
+  uint64_t steal_count_;
+  // The number of calls to 'ParallelFor' that were split across workers.
+  uint64_t parallel_for_count_;
+};
+
+//==============================================================================
+/// Structure to hold the statistics of the predictive model preloading. See
+/// 'TritonServer::ModelPreloadingStatistics' for more information.
+///
+struct ModelPreloadingStats {
+  ModelPreloadingStats();
+
+  // The number of models loaded ahead of their traffic, and of preloaded
+  // models unloaded once idle.
+  uint64_t preload_count_;
+  uint64_t unload_count_;
+  // The number of preloaded models that received a request while loaded,
+  // i.e. the cold starts avoided, and of preloaded models unloaded without
+  // receiving any.
+  uint64_t avoided_cold_start_count_;
+  uint64_t wasted_preload_count_;
+  // The number of times a model received a request while it wasn't loaded
+  // at the last check, i.e. the cold starts that were not avoided. A model is
+  // counted once until it is loaded.
+  uint64_t cold_start_count_;
+  // The number of times a model wasn't preloaded in a bucket because
+  // 'max_loaded_models_' models were loaded.
+  uint64_t budget_skipped_count_;
+  // The accuracy of the history over the closed buckets. A model is
+  // predicted to be used in a bucket if its rate in the history reaches
+  // 'load_rate_', and is used if its observed rate does. The buckets a model
+  // has no history for are not counted.
+  uint64_t true_positive_count_;
+  uint64_t false_positive_count_;
+  uint64_t false_negative_count_;
+  // The mean absolute difference in requests per second between the rates in
+  // the history and the observed rates.
+  double mean_absolute_error_;
+};
+
+//==============================================================================
+/// Structure to hold the statistics of the fingerprinted polls of the model
+/// repositories. See 'TritonServer::RepositoryPollStatistics' for more
+/// information.
+///
+struct RepositoryPollStats {
+  RepositoryPollStats();
+
+  // The number of polls of the model repositories sent to the server.
+  uint64_t poll_count_;
+  // The number of polls skipped because the content of the model directories
+  // didn't change.
+  uint64_t skipped_poll_count_;
+  // The number of files and bytes read to compute the fingerprints.
+  uint64_t hashed_file_count_;
+  uint64_t hashed_byte_size_;
+  // The models that were added, removed or changed in content at the last
+  // poll, all the models at the first poll.
+  std::vector<std::string> changed_models_;
+};
+
+//==============================================================================
+/// Options of the shadow mirroring of a model. A sample of the inference
+/// requests of the model is also sent to the shadow model with the same inputs,
+/// and the outputs and latencies of both models are compared without affecting
+/// the result returned to the user. See 'TritonServer::EnableShadowMirroring'
+/// for more information.
+///
+struct ShadowMirroring {
+  ShadowMirroring(
+      const std::string& shadow_model_name, const double sample_rate = 0.01,
+      const uint32_t max_in_flight = 4);
+
+  // The name of the shadow model.
+  std::string shadow_model_name_;
+  // The version of the shadow model. Default is -1, the latest version.
+  int64_t shadow_model_version_;
+  // The fraction of the requests that are mirrored, between 0 and 1.
+  double sample_rate_;
+  // The maximum number of shadow requests in flight. A sampled request is not
+  // mirrored if the budget is exhausted so that mirroring never queues behind
+  // a slow shadow model.
+  uint32_t max_in_flight_;
+  // The absolute difference above which numeric output elements are
+  // considered divergent. Non-numeric outputs are compared byte by byte.
+  // Default is 1e-5.
+  double tolerance_;
+};
+
+//==============================================================================
+/// Structure to hold the statistics of the shadow mirroring of a model. See
+/// 'TritonServer::ShadowMirroringStatistics' for more information.
+///
+struct ShadowMirroringStats {
+  ShadowMirroringStats();
+
+  // The number of requests sent to the shadow model.
+  uint64_t mirrored_count_;
+  // The number of sampled requests that were not mirrored because
+  // 'max_in_flight_' shadow requests were in flight.
+  uint64_t dropped_count_;
+  // The number of shadow requests whose outputs were compared with the
+  // outputs of their request.
+  uint64_t compared_count_;
+  // The number of compared requests with outputs that differ.
+  uint64_t divergent_count_;
+  // The number of shadow requests that failed while their request succeeded.
+  uint64_t shadow_error_count_;
+  // The largest absolute difference observed between numeric outputs.
+  double max_abs_diff_;
+  // The average latency in microseconds of the mirrored requests and of their
+  // shadow requests.
+  double avg_primary_latency_us_;
+  double avg_shadow_latency_us_;
+};
+
+//==============================================================================
+/// Structure to hold the service level objective (SLO) of a model. See
+/// 'TritonServer::SetServiceLevelObjective' for more information.
+///
+struct ServiceLevelObjective {
+  ServiceLevelObjective(
+      const uint64_t latency_threshold_us, const double latency_target = 0.99,
+      const double success_target = 0.999);
+
+  // The latency in microseconds within which a request should complete,
+  // measured from the call to 'AsyncInfer' or 'Infer' to its response.
+  uint64_t latency_threshold_us_;
+  // The fraction of the requests that should complete within
+  // 'latency_threshold_us_', between 0 and 1 exclusive.
+  double latency_target_;
+  // The fraction of the requests that should succeed, between 0 and 1
+  // exclusive.
+  double success_target_;
+  // The windows in seconds that the burn rates are computed over. Default is
+  // 300 and 3600, the 5 minutes and 1 hour windows of multi-window alerting.
+  std::vector<uint32_t> windows_s_;
+};
+
+//==============================================================================
+/// Structure to hold the burn rates of the error budgets of a model over a
+/// window. A burn rate of 1 consumes the budget exactly over the SLO period,
+/// a burn rate of 10 consumes it 10 times faster.
+///
+struct BurnRate {
+  BurnRate();
+
+  // The length of the window in seconds.
+  uint32_t window_s_;
+  // The number of requests completed in the window, and the number of those
+  // that were slower than the threshold or failed.
+  uint64_t request_count_;
+  uint64_t slow_count_;
+  uint64_t error_count_;
+  // The fraction of slow or failed requests over the fraction allowed by the
+  // objective. 0 if no request completed in the window.
+  double latency_burn_rate_;
+  double error_burn_rate_;
+};
+
+//==============================================================================
+/// Structure to hold the statistics of the service level objective of a
+/// model. See 'TritonServer::ServiceLevelStatistics' for more information.
+///
+struct ServiceLevelStats {
+  ServiceLevelStats();
+
+  // The number of requests evaluated since the objective was set, and the
+  // number of those that were slower than the threshold or failed.
+  uint64_t request_count_;
+  uint64_t slow_count_;
+  uint64_t error_count_;
+  // The burn rates over each window of the objective, in the order of
+  // 'windows_s_'.
+  std::vector<BurnRate> burn_rates_;
 };
 
 //==============================================================================
@@ -615,6 +1180,15 @@ struct InferOptions {
   // trace setting in 'ServerOptions' for tracing if tracing is enabled in
   // 'ServerOptions'. Default is nullptr.
   std::shared_ptr<Trace> trace_;
+  // Whether to aggregate the responses of a decoupled model into one result.
+  // If true, the outputs of each response are appended to the outputs of the
+  // first response as the responses arrive, and each response is released
+  // once its outputs are appended. The outputs are concatenated along the
+  // first dimension, so all responses must return outputs in CPU memory with
+  // matching data types and trailing dimensions. The aggregated result is
+  // returned as the only result of the request. This option is ignored for
+  // non-decoupled models. Default is false.
+  bool aggregate_decoupled_responses_;
 };
 
 }}}  // namespace triton::developer_tools::server
@@ -0,0 +1,762 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace triton { namespace developer_tools { namespace server {
+
+template <typename T>
+class Future;
+template <typename T>
+class Promise;
+
+//==============================================================================
+/// Interface of the executors that the continuations of a 'Future' can be
+/// scheduled on. See 'Future::then' for more information.
+///
+class Executor {
+ public:
+  virtual ~Executor() = default;
+
+  /// Run 'task' asynchronously. The executor must eventually run every task
+  /// submitted to it.
+  /// \param task The task to be run.
+  virtual void Submit(std::function<void()>&& task) = 0;
+};
+
+//==============================================================================
+/// A callback run once when a future state becomes ready.
+///
+class Continuation {
+ public:
+  virtual ~Continuation() = default;
+  virtual void Run() = 0;
+};
+
+template <typename F>
+class FunctionContinuation : public Continuation {
+ public:
+  explicit FunctionContinuation(F&& fn) : fn_(std::move(fn)) {}
+  void Run() override { fn_(); }
+
+ private:
+  F fn_;
+};
+
+template <typename F>
+std::unique_ptr<Continuation>
+MakeContinuation(F&& fn)
+{
+  return std::unique_ptr<Continuation>(
+      new FunctionContinuation<typename std::decay<F>::type>(
+          std::forward<F>(fn)));
+}
+
+//==============================================================================
+/// The state shared by a 'Promise' and its 'Future'. The waiters block on a
+/// futex rather than on a mutex and a condition variable, and the state is
+/// reference counted so that it is the only allocation of a future.
+///
+class FutureStateBase {
+ public:
+  virtual ~FutureStateBase() = default;
+
+  bool IsReady() const
+  {
+    return state_.load(std::memory_order_acquire) == kReady;
+  }
+
+  // Block until the state is ready.
+  void Wait();
+
+  // Block until the state is ready or 'timeout' expires. Return true if the
+  // state is ready.
+  bool WaitFor(const std::chrono::nanoseconds& timeout);
+
+  // Run 'continuation' once the state is ready, right away on the calling
+  // thread if it is already ready. The state may be released by the
+  // continuation, so it must not be used after this call unless the caller
+  // holds a reference.
+  void SetContinuation(std::unique_ptr<Continuation>&& continuation);
+
+  void Ref() { ref_count_.fetch_add(1, std::memory_order_relaxed); }
+
+  void Unref()
+  {
+    if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+
+ protected:
+  FutureStateBase() : state_(kPending), ref_count_(1) {}
+
+  // Mark the state ready, wake up the waiters and run the continuation. The
+  // caller must hold a reference.
+  void MarkReady();
+
+  std::exception_ptr exception_;
+
+ private:
+  static constexpr uint32_t kPending = 0;
+  // Pending with threads blocked on the futex.
+  static constexpr uint32_t kWaiting = 1;
+  static constexpr uint32_t kReady = 2;
+
+  // The futex word.
+  std::atomic<uint32_t> state_;
+  std::atomic<int> ref_count_;
+  std::mutex continuation_mu_;
+  std::unique_ptr<Continuation> continuation_;
+};
+
+// The generation of the future state pools, incremented to make every thread
+// release the blocks it has cached. See 'TrimFutureStatePools'.
+std::atomic<uint64_t>& FutureStatePoolGeneration();
+
+/// Release the blocks cached by the future state pools to the global
+/// allocator. The cache of each thread is released the next time the thread
+/// creates or destroys a future, since the caches are not shared.
+inline void
+TrimFutureStatePools()
+{
+  FutureStatePoolGeneration().fetch_add(1, std::memory_order_relaxed);
+}
+
+//==============================================================================
+/// Per-thread cache of the blocks of 'Size' bytes that the future states are
+/// allocated from, so that creating a future doesn't go through the global
+/// allocator in steady state.
+///
+template <size_t Size>
+class FutureStatePool {
+ public:
+  static void* Allocate()
+  {
+    auto& blocks = Cache().blocks_;
+    if (!blocks.empty()) {
+      void* block = blocks.back();
+      blocks.pop_back();
+      return block;
+    }
+    return ::operator new(Size);
+  }
+
+  static void Deallocate(void* block)
+  {
+    auto& blocks = Cache().blocks_;
+    if (blocks.size() < kMaxCachedBlocks) {
+      blocks.push_back(block);
+    } else {
+      ::operator delete(block);
+    }
+  }
+
+ private:
+  static constexpr size_t kMaxCachedBlocks = 256;
+
+  struct BlockCache {
+    ~BlockCache() { Clear(); }
+
+    void Clear()
+    {
+      for (void* block : blocks_) {
+        ::operator delete(block);
+      }
+      blocks_.clear();
+      blocks_.shrink_to_fit();
+    }
+
+    std::vector<void*> blocks_;
+    uint64_t generation_ = 0;
+  };
+
+  static BlockCache& Cache()
+  {
+    static thread_local BlockCache cache;
+    const uint64_t generation =
+        FutureStatePoolGeneration().load(std::memory_order_relaxed);
+    if (cache.generation_ != generation) {
+      cache.Clear();
+      cache.generation_ = generation;
+    }
+    return cache;
+  }
+};
+
+template <typename T>
+class FutureState : public FutureStateBase {
+ public:
+  void SetValue(T&& value)
+  {
+    value_ = std::move(value);
+    MarkReady();
+  }
+
+  void SetException(const std::exception_ptr& exception)
+  {
+    exception_ = exception;
+    MarkReady();
+  }
+
+  T TakeValue()
+  {
+    if (exception_ != nullptr) {
+      std::rethrow_exception(exception_);
+    }
+    return std::move(value_);
+  }
+
+  static void* operator new(size_t size)
+  {
+    return FutureStatePool<sizeof(FutureState)>::Allocate();
+  }
+
+  static void operator delete(void* block)
+  {
+    FutureStatePool<sizeof(FutureState)>::Deallocate(block);
+  }
+
+ private:
+  T value_;
+};
+
+template <>
+class FutureState<void> : public FutureStateBase {
+ public:
+  void SetValue() { MarkReady(); }
+
+  void SetException(const std::exception_ptr& exception)
+  {
+    exception_ = exception;
+    MarkReady();
+  }
+
+  void TakeValue()
+  {
+    if (exception_ != nullptr) {
+      std::rethrow_exception(exception_);
+    }
+  }
+
+  static void* operator new(size_t size)
+  {
+    return FutureStatePool<sizeof(FutureState)>::Allocate();
+  }
+
+  static void operator delete(void* block)
+  {
+    FutureStatePool<sizeof(FutureState)>::Deallocate(block);
+  }
+};
+
+//==============================================================================
+/// Helpers to complete a promise with the result of a continuation. A
+/// continuation returning a 'Future<U>' completes a 'Future<U>' rather than a
+/// 'Future<Future<U>>'.
+///
+template <typename R>
+struct FutureUnwrap {
+  using Type = R;
+};
+
+template <typename U>
+struct FutureUnwrap<Future<U>> {
+  using Type = U;
+};
+
+template <typename T>
+struct PromiseForwarder;
+
+template <typename R>
+struct ContinuationRunner;
+
+//==============================================================================
+/// Future with continuations, returned by 'TritonServer::AsyncInfer'. The
+/// interface follows 'std::future', and a 'Future' can be converted to a
+/// 'std::future' for compatibility. Unlike 'std::future', a function can be
+/// attached with 'then' to be run when the value is ready without a thread
+/// blocked in 'get', and futures can be combined with 'when_all' and
+/// 'when_any'. The state of the future is the only allocation and is taken
+/// from a per-thread pool.
+///
+template <typename T>
+class Future {
+ public:
+  template <typename F>
+  using ContinuationResult =
+      decltype(std::declval<F>()(std::declval<Future<T>>()));
+  template <typename F>
+  using ThenResult = typename FutureUnwrap<ContinuationResult<F>>::Type;
+
+  Future() : state_(nullptr) {}
+
+  Future(Future&& other) : state_(other.state_) { other.state_ = nullptr; }
+
+  Future& operator=(Future&& other)
+  {
+    if (this != &other) {
+      Reset();
+      state_ = other.state_;
+      other.state_ = nullptr;
+    }
+    return *this;
+  }
+
+  Future(const Future&) = delete;
+  Future& operator=(const Future&) = delete;
+
+  ~Future() { Reset(); }
+
+  /// Check if the future refers to a state. The future is no longer valid
+  /// after calling 'get', 'then' or converting it to a 'std::future'.
+  bool valid() const { return state_ != nullptr; }
+
+  /// Check if the value is ready, in which case 'get' doesn't block.
+  bool is_ready() const { return (state_ != nullptr) && state_->IsReady(); }
+
+  /// Block until the value is ready.
+  void wait() const { state_->Wait(); }
+
+  /// Block until the value is ready or 'timeout' expires.
+  /// \param timeout The maximum duration to block for.
+  /// \return Returns 'std::future_status::ready' if the value is ready,
+  /// 'std::future_status::timeout' otherwise.
+  template <typename Rep, typename Period>
+  std::future_status wait_for(
+      const std::chrono::duration<Rep, Period>& timeout) const
+  {
+    return state_->WaitFor(
+               std::chrono::duration_cast<std::chrono::nanoseconds>(timeout))
+               ? std::future_status::ready
+               : std::future_status::timeout;
+  }
+
+  /// Block until the value is ready and return it. The exception set by the
+  /// promise, if any, is rethrown.
+  /// \return Returns the value of the future.
+  T get()
+  {
+    std::unique_ptr<FutureState<T>, StateUnref> state(Release());
+    state->Wait();
+    return state->TakeValue();
+  }
+
+  /// Run 'fn' with the ready future once the value is ready, on the thread
+  /// completing the future, or right away on the calling thread if the value
+  /// is already ready. 'fn' should be cheap since it may run on a thread of
+  /// the server, use the 'Executor' overload otherwise.
+  /// \param fn The continuation, called as 'fn(Future<T>)'.
+  /// \return Returns a future of the value returned by 'fn'. If 'fn' returns
+  /// a 'Future<U>', the returned future is a 'Future<U>' completed with the
+  /// value of the future returned by 'fn'.
+  template <typename F>
+  Future<ThenResult<F>> then(F&& fn)
+  {
+    return Then(nullptr, std::forward<F>(fn));
+  }
+
+  /// Submit 'fn' to 'executor' once the value is ready.
+  /// \param executor The executor that runs 'fn'. It must outlive the future.
+  /// \param fn The continuation, called as 'fn(Future<T>)'.
+  /// \return Returns a future of the value returned by 'fn'.
+  template <typename F>
+  Future<ThenResult<F>> then(Executor& executor, F&& fn)
+  {
+    return Then(&executor, std::forward<F>(fn));
+  }
+
+  /// Convert to a 'std::future' that is set when the value is ready.
+  operator std::future<T>() &&
+  {
+    auto promise = std::make_shared<std::promise<T>>();
+    std::future<T> future = promise->get_future();
+    then([promise](Future<T> ready) { SetStdPromise(*promise, ready); });
+    return future;
+  }
+
+ private:
+  friend class Promise<T>;
+  template <typename U>
+  friend Future<std::vector<Future<U>>> when_all(std::vector<Future<U>>&&);
+  template <typename U>
+  friend Future<std::pair<size_t, std::vector<Future<U>>>> when_any(
+      std::vector<Future<U>>&&);
+
+  struct StateUnref {
+    void operator()(FutureStateBase* state) const { state->Unref(); }
+  };
+
+  explicit Future(FutureState<T>* state) : state_(state) {}
+
+  FutureState<T>* Release()
+  {
+    if (state_ == nullptr) {
+      throw std::future_error(std::future_errc::no_state);
+    }
+    FutureState<T>* state = state_;
+    state_ = nullptr;
+    return state;
+  }
+
+  void Reset()
+  {
+    if (state_ != nullptr) {
+      state_->Unref();
+      state_ = nullptr;
+    }
+  }
+
+  template <typename F>
+  Future<ThenResult<F>> Then(Executor* executor, F&& fn)
+  {
+    using R = ContinuationResult<F>;
+    Promise<ThenResult<F>> promise;
+    Future<ThenResult<F>> future = promise.get_future();
+    // The reference of this future is moved to the continuation.
+    FutureState<T>* state = Release();
+    auto run = [state, promise = std::move(promise),
+                fn = std::forward<F>(fn)]() mutable {
+      ContinuationRunner<R>::Run(promise, fn, Future<T>(state));
+    };
+    if (executor == nullptr) {
+      state->SetContinuation(MakeContinuation(std::move(run)));
+    } else {
+      // 'std::function' requires a copyable function.
+      auto shared_run = std::make_shared<decltype(run)>(std::move(run));
+      state->SetContinuation(
+          MakeContinuation([executor, shared_run]() mutable {
+            executor->Submit([shared_run]() { (*shared_run)(); });
+          }));
+    }
+    return future;
+  }
+
+  template <typename U>
+  static void SetStdPromise(std::promise<U>& promise, Future<U>& ready)
+  {
+    try {
+      promise.set_value(ready.get());
+    }
+    catch (...) {
+      promise.set_exception(std::current_exception());
+    }
+  }
+
+  static void SetStdPromise(std::promise<void>& promise, Future<void>& ready)
+  {
+    try {
+      ready.get();
+      promise.set_value();
+    }
+    catch (...) {
+      promise.set_exception(std::current_exception());
+    }
+  }
+
+  FutureState<T>* state_;
+};
+
+//==============================================================================
+/// Promise that completes a 'Future'. The future is completed with a
+/// 'std::future_errc::broken_promise' error if the promise is destroyed
+/// without being satisfied.
+///
+template <typename T>
+class Promise {
+ public:
+  Promise() : state_(new FutureState<T>()), future_retrieved_(false) {}
+
+  Promise(Promise&& other)
+      : state_(other.state_), future_retrieved_(other.future_retrieved_)
+  {
+    other.state_ = nullptr;
+  }
+
+  Promise& operator=(Promise&& other)
+  {
+    if (this != &other) {
+      Reset();
+      state_ = other.state_;
+      future_retrieved_ = other.future_retrieved_;
+      other.state_ = nullptr;
+    }
+    return *this;
+  }
+
+  Promise(const Promise&) = delete;
+  Promise& operator=(const Promise&) = delete;
+
+  ~Promise() { Reset(); }
+
+  /// Check if the promise refers to a state. The promise is no longer valid
+  /// once moved from.
+  bool valid() const { return state_ != nullptr; }
+
+  /// Get the future completed by this promise. Can only be called once.
+  Future<T> get_future()
+  {
+    CheckState();
+    if (future_retrieved_) {
+      throw std::future_error(std::future_errc::future_already_retrieved);
+    }
+    future_retrieved_ = true;
+    state_->Ref();
+    return Future<T>(state_);
+  }
+
+  template <typename U = T>
+  void set_value(
+      typename std::enable_if<!std::is_void<U>::value, U>::type value)
+  {
+    CheckUnsatisfied();
+    state_->SetValue(std::move(value));
+  }
+
+  template <typename U = T>
+  typename std::enable_if<std::is_void<U>::value>::type set_value()
+  {
+    CheckUnsatisfied();
+    state_->SetValue();
+  }
+
+  void set_exception(const std::exception_ptr& exception)
+  {
+    CheckUnsatisfied();
+    state_->SetException(exception);
+  }
+
+ private:
+  void CheckState() const
+  {
+    if (state_ == nullptr) {
+      throw std::future_error(std::future_errc::no_state);
+    }
+  }
+
+  void CheckUnsatisfied() const
+  {
+    CheckState();
+    if (state_->IsReady()) {
+      throw std::future_error(std::future_errc::promise_already_satisfied);
+    }
+  }
+
+  void Reset()
+  {
+    if (state_ != nullptr) {
+      if (!state_->IsReady()) {
+        state_->SetException(std::make_exception_ptr(
+            std::future_error(std::future_errc::broken_promise)));
+      }
+      state_->Unref();
+      state_ = nullptr;
+    }
+  }
+
+  FutureState<T>* state_;
+  bool future_retrieved_;
+};
+
+// Defined once 'Promise' is complete, see 'FutureUnwrap'.
+template <typename T>
+struct PromiseForwarder {
+  static void Forward(Promise<T>& promise, Future<T>& future)
+  {
+    try {
+      promise.set_value(future.get());
+    }
+    catch (...) {
+      promise.set_exception(std::current_exception());
+    }
+  }
+};
+
+template <>
+struct PromiseForwarder<void> {
+  static void Forward(Promise<void>& promise, Future<void>& future)
+  {
+    try {
+      future.get();
+      promise.set_value();
+    }
+    catch (...) {
+      promise.set_exception(std::current_exception());
+    }
+  }
+};
+
+template <typename R>
+struct ContinuationRunner {
+  template <typename F, typename A>
+  static void Run(Promise<R>& promise, F& fn, A&& arg)
+  {
+    try {
+      promise.set_value(fn(std::forward<A>(arg)));
+    }
+    catch (...) {
+      promise.set_exception(std::current_exception());
+    }
+  }
+};
+
+template <>
+struct ContinuationRunner<void> {
+  template <typename F, typename A>
+  static void Run(Promise<void>& promise, F& fn, A&& arg)
+  {
+    try {
+      fn(std::forward<A>(arg));
+      promise.set_value();
+    }
+    catch (...) {
+      promise.set_exception(std::current_exception());
+    }
+  }
+};
+
+template <typename U>
+struct ContinuationRunner<Future<U>> {
+  template <typename F, typename A>
+  static void Run(Promise<U>& promise, F& fn, A&& arg)
+  {
+    Future<U> inner;
+    try {
+      inner = fn(std::forward<A>(arg));
+    }
+    catch (...) {
+      promise.set_exception(std::current_exception());
+      return;
+    }
+    inner.then([promise = std::move(promise)](Future<U> future) mutable {
+      PromiseForwarder<U>::Forward(promise, future);
+    });
+  }
+};
+
+/// Combine futures into a future that is ready once all of them are ready.
+/// \param futures The futures to be combined.
+/// \return Returns a future of the combined futures, which are all ready.
+template <typename T>
+Future<std::vector<Future<T>>>
+when_all(std::vector<Future<T>>&& futures)
+{
+  struct Context {
+    std::vector<Future<T>> futures_;
+    std::atomic<size_t> remaining_;
+    Promise<std::vector<Future<T>>> promise_;
+  };
+  for (const auto& future : futures) {
+    if (!future.valid()) {
+      throw std::future_error(std::future_errc::no_state);
+    }
+  }
+  auto context = std::make_shared<Context>();
+  context->futures_ = std::move(futures);
+  context->remaining_ = context->futures_.size();
+  Future<std::vector<Future<T>>> result = context->promise_.get_future();
+  if (context->futures_.empty()) {
+    context->promise_.set_value(std::move(context->futures_));
+    return result;
+  }
+  // The futures are only moved out once all the continuations are set, so
+  // the states can be accessed through the context.
+  for (auto& future : context->futures_) {
+    future.state_->SetContinuation(MakeContinuation([context]() {
+      if (context->remaining_.fetch_sub(1) == 1) {
+        context->promise_.set_value(std::move(context->futures_));
+      }
+    }));
+  }
+  return result;
+}
+
+/// Combine futures into a future that is ready once any of them is ready.
+/// \param futures The futures to be combined.
+/// \return Returns a future of the index of the first ready future and the
+/// combined futures.
+template <typename T>
+Future<std::pair<size_t, std::vector<Future<T>>>>
+when_any(std::vector<Future<T>>&& futures)
+{
+  using Result = std::pair<size_t, std::vector<Future<T>>>;
+  struct Context {
+    std::mutex mu_;
+    std::vector<Future<T>> futures_;
+    bool done_ = false;
+    Promise<Result> promise_;
+  };
+  for (const auto& future : futures) {
+    if (!future.valid()) {
+      throw std::future_error(std::future_errc::no_state);
+    }
+  }
+  auto context = std::make_shared<Context>();
+  Future<Result> result = context->promise_.get_future();
+  if (futures.empty()) {
+    context->promise_.set_value(Result(0, std::move(futures)));
+    return result;
+  }
+  // The states are referenced while the continuations are set since the
+  // futures may be returned, and released, as soon as one of them is ready.
+  std::vector<FutureState<T>*> states;
+  for (auto& future : futures) {
+    future.state_->Ref();
+    states.push_back(future.state_);
+  }
+  context->futures_ = std::move(futures);
+  for (size_t i = 0; i < states.size(); ++i) {
+    states[i]->SetContinuation(MakeContinuation([context, i]() {
+      std::vector<Future<T>> ready;
+      {
+        std::lock_guard<std::mutex> lk(context->mu_);
+        if (context->done_) {
+          return;
+        }
+        context->done_ = true;
+        ready = std::move(context->futures_);
+      }
+      context->promise_.set_value(Result(i, std::move(ready)));
+    }));
+    states[i]->Unref();
+  }
+  return result;
+}
+
+}}}  // namespace triton::developer_tools::server
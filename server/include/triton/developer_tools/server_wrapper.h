@@ -25,15 +25,20 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <climits>
 #include <future>
 #include <iostream>
 #include <list>
+#include <map>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "generic_server_wrapper.h"
+#include "infer_future.h"
 #include "triton/core/tritonserver.h"
 
 #ifdef TRITON_ENABLE_GPU
@@ -43,10 +48,77 @@
 namespace triton { namespace developer_tools { namespace server {
 
 class Allocator;
+class BoundInputs;
+class HealthCache;
+class LatencyHistogram;
+class LiveModelStats;
 class InferResult;
 class InferRequest;
+class MemoryPressureMonitor;
+class ModelPreloader;
+class ModelStartupLoader;
+class OutputUsageTracker;
+class PhaseCounters;
+class RepositoryFingerprint;
+class RequestWatchdog;
+class ShadowMirror;
+struct ShadowSample;
+class SloTracker;
+class StatsPublisher;
+struct InFlightRequest;
 struct ResponseParameters;
 class TraceManager;
+class WorkStealingExecutor;
+
+/// The future of the result of an inference request returned by
+/// 'TritonServer::AsyncInfer'.
+using InferFuture = Future<std::unique_ptr<InferResult>>;
+using InferPromise = Promise<std::unique_ptr<InferResult>>;
+
+//==============================================================================
+/// Interface of the executor shared by the parallel work of a server, see
+/// 'TritonServer::SharedExecutor'. The tasks are run in two priority lanes:
+/// the tasks in the latency lane are always run before the tasks in the
+/// background lane.
+///
+class WorkExecutor : public Executor {
+ public:
+  virtual ~WorkExecutor() = default;
+
+  /// Run 'task' asynchronously in the latency lane.
+  /// \param task The task to be run.
+  void Submit(std::function<void()>&& task) override
+  {
+    Submit(std::move(task), TaskPriority::LATENCY);
+  }
+
+  /// Run 'task' asynchronously in the lane of 'priority'. The task is
+  /// dropped if the server is being destroyed.
+  /// \param task The task to be run.
+  /// \param priority The lane of the task.
+  virtual void Submit(
+      std::function<void()>&& task, const TaskPriority priority) = 0;
+
+  /// Run 'fn' over the range ['begin', 'end') split into contiguous chunks of
+  /// at least 'grain_size' indices, in parallel on the workers and on the
+  /// calling thread, and return once every chunk is done. The calling thread
+  /// runs the chunks no worker has taken, so it may be called from a task of
+  /// the executor. If 'fn' throws, the first exception is rethrown once every
+  /// chunk is done.
+  /// \param begin The first index of the range.
+  /// \param end The end of the range.
+  /// \param grain_size The minimum number of indices of a chunk.
+  /// \param fn The function called with the begin and the end of each chunk.
+  /// \param priority The lane the chunks are run in by the workers.
+  virtual void ParallelFor(
+      const size_t begin, const size_t end, const size_t grain_size,
+      const std::function<void(size_t, size_t)>& fn,
+      const TaskPriority priority = TaskPriority::LATENCY) = 0;
+
+  /// Get the statistics of the executor.
+  /// \return Returns the 'WorkExecutorStats' object.
+  virtual WorkExecutorStats Statistics() = 0;
+};
 
 //==============================================================================
 /// Object that encapsulates in-process C API functionalities.
@@ -56,8 +128,42 @@ class TritonServer : public GenericTritonServer {
   static std::unique_ptr<TritonServer> Create(
       const ServerOptions& server_options);
 
+  /// Create a server without waiting for the startup models to be loaded.
+  /// 'Create' returns once all the startup models are loaded, while this
+  /// function returns as soon as the server is running and loads the models
+  /// in the background, one at a time. The server can be used right away,
+  /// and a model can be inferred once its future from 'ModelStartupFuture' is
+  /// completed. The startup models are the 'startup_models_' of
+  /// 'server_options' in EXPLICIT model control mode, or all the models in
+  /// the repositories if it contains "*" or in NONE model control mode. In
+  /// NONE mode, the models still can't be loaded or unloaded once started.
+  /// POLL model control mode is not supported since the models would be
+  /// loaded by the first poll. Failing to load a startup model doesn't fail
+  /// the creation regardless of 'exit_on_error_', the error is reported by
+  /// the futures instead.
+  /// \param server_options The options of the server.
+  /// \return Returns the created server.
+  static std::unique_ptr<TritonServer> CreateAsync(
+      const ServerOptions& server_options);
+
   virtual ~TritonServer();
 
+  /// Get a future that is completed once all the startup models of a server
+  /// created by 'CreateAsync' are loaded or failed to load. The future holds
+  /// a 'TritonException' listing the models that failed to load, if any. If
+  /// the server is created by 'Create', the future is already completed.
+  /// \return Returns the future of the startup.
+  Future<void> StartupFuture();
+
+  /// Get a future that is completed once the specified startup model of a
+  /// server created by 'CreateAsync' is loaded. The future holds a
+  /// 'TritonException' if the model failed to load. If the model is not a
+  /// startup model, or the server is created by 'Create', the future is
+  /// already completed.
+  /// \param model_name The name of the model.
+  /// \return Returns the future of the model.
+  Future<void> ModelStartupFuture(const std::string& model_name);
+
   /// Load the requested model or reload the model if it is already loaded.
   /// \param model_name The name of the model.
   void LoadModel(const std::string& model_name) override;
@@ -99,23 +205,43 @@ class TritonServer : public GenericTritonServer {
   /// \param infer_request The InferRequest object contains
   /// the inputs, outputs and infer options for an inference request.
   /// \return Returns the result of inference as a future of
-  /// a unique pointer of InferResult object.
-  virtual std::future<std::unique_ptr<InferResult>> AsyncInfer(
-      InferRequest& infer_request) = 0;
+  /// a unique pointer of InferResult object. Continuations can be attached to
+  /// the returned 'InferFuture' with 'then', and it can be converted to a
+  /// 'std::future'.
+  virtual InferFuture AsyncInfer(InferRequest& infer_request) = 0;
 
-  /// Is the server live?
+  /// Is the server live? If 'health_check_refresh_ms_' is set in the
+  /// 'ServerOptions', the liveness refreshed in the background is returned
+  /// without querying the server.
   /// \return Returns true if server is live, false otherwise.
   bool IsServerLive() override;
 
-  /// Is the server ready?
+  /// Is the server live?
+  /// \param fresh If true, the server is queried and the cached liveness is
+  /// updated. Otherwise, the same as 'IsServerLive()'.
+  /// \return Returns true if server is live, false otherwise.
+  bool IsServerLive(const bool fresh);
+
+  /// Is the server ready? If 'health_check_refresh_ms_' is set in the
+  /// 'ServerOptions', the readiness refreshed in the background is returned
+  /// without querying the server.
   /// \return Returns true if server is ready, false otherwise.
   bool IsServerReady() override;
 
+  /// Is the server ready?
+  /// \param fresh If true, the server is queried and the cached readiness is
+  /// updated. Otherwise, the same as 'IsServerReady()'.
+  /// \return Returns true if server is ready, false otherwise.
+  bool IsServerReady(const bool fresh);
+
   /// Stop a server object. A server can't be restarted once it is
   /// stopped.
   void ServerStop() override;
 
-  /// Is the model ready?
+  /// Is the model ready? If 'health_check_refresh_ms_' is set in the
+  /// 'ServerOptions', the readiness refreshed in the background is returned
+  /// without querying the server. The first check of a model, and the first
+  /// check after it was not checked for a while, queries the server.
   /// \param model_name The name of the model to get readiness for.
   /// \param model_version The version of the model to get readiness
   /// for.  If -1 then the server will choose a version based on the
@@ -124,6 +250,19 @@ class TritonServer : public GenericTritonServer {
   bool IsModelReady(
       const std::string& model_name, const int64_t model_version = -1) override;
 
+  /// Is the model ready?
+  /// \param model_name The name of the model to get readiness for.
+  /// \param model_version The version of the model to get readiness
+  /// for.  If -1 then the server will choose a version based on the
+  /// model's policy.
+  /// \param fresh If true, the server is queried and the cached readiness is
+  /// updated. Otherwise, the same as 'IsModelReady(model_name,
+  /// model_version)'.
+  /// \return Returns true if server is ready, false otherwise.
+  bool IsModelReady(
+      const std::string& model_name, const int64_t model_version,
+      const bool fresh);
+
   /// Get the configuration of specified model.
   /// \param model_name The name of the model.
   /// \param model_version The version of the model to get configuration.
@@ -158,12 +297,201 @@ class TritonServer : public GenericTritonServer {
   /// \param repo_path The full path to the model repository.
   void UnregisterModelRepo(const std::string& repo_path) override;
 
+  /// Bind a constant input to the specified model. The input data is copied
+  /// once into memory owned by the server and is attached to every following
+  /// inference request of the model, so the input does not need to be added to
+  /// each 'InferRequest'. If a request adds an input with the same name, the
+  /// input of the request is used instead. Binding an input with a name that
+  /// is already bound to the model replaces the previous one. Only inputs in
+  /// CPU memory can be bound.
+  /// \param model_name The name of the model.
+  /// \param input_name The name of the input tensor.
+  /// \param input A Tensor object that describes the constant input tensor.
+  void BindConstantInput(
+      const std::string& model_name, const std::string& input_name,
+      const Tensor& input);
+
+  /// Bind a constant input of 'string' elements to the specified model. The
+  /// strings are serialized once when binding. See the 'BindConstantInput'
+  /// function above for more information.
+  /// \param model_name The name of the model.
+  /// \param input_name The name of the input tensor.
+  /// \param begin The begin iterator of the container.
+  /// \param end The end iterator of the container.
+  /// \param shape The shape of the input.
+  template <typename Iterator>
+  void BindConstantInput(
+      const std::string& model_name, const std::string& input_name,
+      const Iterator begin, const Iterator end,
+      const std::vector<int64_t>& shape);
+
+  /// Remove all constant inputs bound to the specified model. Requests that
+  /// are already in flight are not affected.
+  /// \param model_name The name of the model.
+  void UnbindConstantInputs(const std::string& model_name);
+
+  /// Enable adaptive output pruning for the specified model. The outputs
+  /// accessed through 'InferResult::Output' and 'InferResult::StringData' are
+  /// recorded for the inference requests that do not request any output
+  /// explicitly. After 'learning_window' responses are received, only the
+  /// outputs that were accessed are requested so that the other outputs are
+  /// not computed and allocated. If an output that is not requested is
+  /// accessed, the output is not available in that result and all outputs are
+  /// returned again until the next learning window is over. Enabling pruning
+  /// for a model that already has it enabled restarts the learning.
+  /// \param model_name The name of the model.
+  /// \param learning_window The number of responses to observe before pruning
+  /// the outputs.
+  void EnableOutputPruning(
+      const std::string& model_name, const uint32_t learning_window = 100);
+
+  /// Disable adaptive output pruning for the specified model.
+  /// \param model_name The name of the model.
+  void DisableOutputPruning(const std::string& model_name);
+
+  /// Get the statistics of the adaptive output pruning of the specified model.
+  /// An exception will be thrown if output pruning is not enabled for the
+  /// model.
+  /// \param model_name The name of the model.
+  /// \return Returns the 'OutputPruningStats' object of the model.
+  OutputPruningStats OutputPruningStatistics(const std::string& model_name);
+
+  /// Enable shadow mirroring for the specified model. A sample of the
+  /// inference requests sent to the model through 'AsyncInfer' or 'Infer' is
+  /// also sent to the shadow model after the request itself is submitted. The
+  /// inputs of a sampled request are copied for the shadow request, so a
+  /// mirrored 'InferRequest' can be reset or destroyed without waiting for
+  /// the shadow model. Requests with inputs in GPU memory are not mirrored.
+  /// The outputs of both models are compared in the background lane of
+  /// 'SharedExecutor' once both are received, and the result returned to the
+  /// user is not affected by the shadow request. Outputs in pre-allocated or
+  /// GPU buffers are not compared. Requests of decoupled models and requests
+  /// in a sequence are not mirrored. Enabling mirroring for a model that
+  /// already has it enabled replaces the options and restarts the statistics.
+  /// \param model_name The name of the model.
+  /// \param options The 'ShadowMirroring' options.
+  void EnableShadowMirroring(
+      const std::string& model_name, const ShadowMirroring& options);
+
+  /// Disable shadow mirroring for the specified model. Shadow requests that
+  /// are already in flight are completed.
+  /// \param model_name The name of the model.
+  void DisableShadowMirroring(const std::string& model_name);
+
+  /// Get the statistics of the shadow mirroring of the specified model. An
+  /// exception will be thrown if shadow mirroring is not enabled for the
+  /// model.
+  /// \param model_name The name of the model.
+  /// \return Returns the 'ShadowMirroringStats' object of the model.
+  ShadowMirroringStats ShadowMirroringStatistics(const std::string& model_name);
+
+  /// Set the service level objective (SLO) of the specified model. Each
+  /// request to the model completed through 'AsyncInfer' or 'Infer' is
+  /// evaluated against the latency threshold and counted as slow if it took
+  /// longer, and as failed if its result has an error. The burn rates of the
+  /// latency and success error budgets over each window of the objective are
+  /// returned by 'ServiceLevelStatistics' and appended to 'ServerMetrics' as
+  /// 'tds_slo_burn_rate', so that alerts, load shedding or autoscaling can
+  /// act on how fast the budget is consumed rather than on the raw latency.
+  /// Requests of decoupled models are not evaluated. Setting the objective of
+  /// a model that already has one replaces it and restarts the statistics.
+  /// \param model_name The name of the model.
+  /// \param objective The 'ServiceLevelObjective' of the model.
+  void SetServiceLevelObjective(
+      const std::string& model_name, const ServiceLevelObjective& objective);
+
+  /// Remove the service level objective of the specified model.
+  /// \param model_name The name of the model.
+  void RemoveServiceLevelObjective(const std::string& model_name);
+
+  /// Get the statistics of the service level objective of the specified
+  /// model. An exception will be thrown if the model has no objective.
+  /// \param model_name The name of the model.
+  /// \return Returns the 'ServiceLevelStats' object of the model.
+  ServiceLevelStats ServiceLevelStatistics(const std::string& model_name);
+
+  /// Get the host layout chosen when the server was created, which includes
+  /// the NUMA nodes, the host policies and the CPUs the wrapper threads are
+  /// pinned to. The layout is also logged when the server is created.
+  /// \return Returns a string describing the host layout.
+  std::string HostLayout() { return host_layout_; }
+
+  /// Get the report of the container limits detected when the server was
+  /// created and the effective thread counts and memory pool sizes the server
+  /// was created with. The report is also logged when the server is created.
+  /// \return Returns a string describing the effective resources.
+  std::string ResourceReport() { return resource_report_; }
+
+  /// Get the statistics of the in-flight request watchdog. The watchdog is
+  /// enabled by setting 'watchdog_' in 'ServerOptions'.
+  /// \return Returns the 'WatchdogStats' object. An exception is thrown if the
+  /// watchdog is not enabled.
+  WatchdogStats WatchdogStatistics();
+
+  /// Get the statistics of the memory pressure monitor. The monitor is
+  /// enabled by setting 'memory_pressure_' in 'ServerOptions'.
+  /// \return Returns the 'MemoryPressureStats' object. An exception is thrown
+  /// if the monitor is not enabled.
+  MemoryPressureStats MemoryPressureStatistics();
+
+  /// Get the hardware performance counters of the phases of the wrapper for a
+  /// model. The counters are enabled by setting 'phase_counters_' in
+  /// 'ServerOptions'. The phases are "prepare", the preparation of the
+  /// request in 'AsyncInfer' and 'Infer', "response", the response callback
+  /// that builds the 'InferResult', "output_release", the destruction of the
+  /// 'InferResult' and the release of its outputs, and "trace", the trace
+  /// callbacks. Each phase is measured on the thread running it, so comparing
+  /// the instructions per cycle and the cache misses with the context switches
+  /// tells a phase bound on memory apart from a phase waiting on a lock.
+  /// \param model_name The name of the model.
+  /// \return Returns the 'PhaseCounterStats' of each phase, keyed by the name
+  /// of the phase. An exception is thrown if the counters are not enabled.
+  std::map<std::string, PhaseCounterStats> PhaseCounterStatistics(
+      const std::string& model_name);
+
+  /// Get the statistics of the fingerprinted polls of the model repositories.
+  /// The fingerprints are enabled by setting 'repository_poll_fingerprint_'
+  /// in 'ServerOptions' in POLL model control mode. Before each poll, the
+  /// size and a hash of the content of each file of each model directory are
+  /// compared with the previous poll, and the poll is skipped if nothing
+  /// changed. The server reloads the models whose files have new modification
+  /// times when it polls, so a touched model is still reloaded along with a
+  /// model that changed in the same interval.
+  /// \return Returns the 'RepositoryPollStats' object. An exception is thrown
+  /// if the fingerprints are not enabled.
+  RepositoryPollStats RepositoryPollStatistics();
+
+  /// Get the statistics of the predictive model preloading. The preloading is
+  /// enabled by setting 'model_preloading_' in 'ServerOptions'. The requests
+  /// of each model are recorded in a history of request rates per time of
+  /// day, from which the models are loaded shortly before their traffic is
+  /// expected and unloaded once idle. The statistics report the cold starts
+  /// avoided and not avoided and how well the history predicted the traffic.
+  /// \return Returns the 'ModelPreloadingStats' object. An exception is thrown
+  /// if the preloading is not enabled.
+  ModelPreloadingStats ModelPreloadingStatistics();
+
+  /// Get the executor shared by the parallel work of the wrapper, such as the
+  /// comparisons of the shadow mirrors, which can also run the work of the
+  /// application so that a single set of threads sized to the CPUs of the
+  /// container runs alongside the threads of the backends. Each worker owns a
+  /// deque per lane and idle workers steal tasks from the others. The
+  /// workers are started with the first task and are configured by
+  /// 'executor_' in 'ServerOptions'. The queue depths and the steals are also
+  /// appended to 'ServerMetrics' as 'tds_executor_*'. The executor must not
+  /// be used after the server is destroyed, the tasks still queued then are
+  /// dropped.
+  /// \return Returns the executor of the server.
+  WorkExecutor& SharedExecutor();
+
  protected:
+  TritonServer();
+
   void PrepareInferenceRequest(
       TRITONSERVER_InferenceRequest** irequest, const InferRequest& request);
 
   void PrepareInferenceInput(
-      TRITONSERVER_InferenceRequest* irequest, const InferRequest& request);
+      TRITONSERVER_InferenceRequest* irequest, InferRequest& request);
 
   void PrepareInferenceOutput(
       TRITONSERVER_InferenceRequest* irequest, InferRequest& request);
@@ -172,14 +500,135 @@ class TritonServer : public GenericTritonServer {
       TRITONSERVER_InferenceRequest** irequest,
       const InferRequest& infer_request);
 
+  // Refresh the cached health and readiness, if cached.
+  void RefreshHealth();
+
+  // Return the phase counters of 'model_name', created on first use.
+  std::shared_ptr<PhaseCounters> ModelPhaseCounters(
+      const std::string& model_name);
+
+  // Return the latency histogram of 'model_name', created on first use.
+  std::shared_ptr<LatencyHistogram> ModelLatencyHistogram(
+      const std::string& model_name);
+
   // The server object.
   std::shared_ptr<TRITONSERVER_Server> server_;
   // The allocator object allocating output tensor.
   TRITONSERVER_ResponseAllocator* allocator_;
   // The trace manager.
   std::shared_ptr<TraceManager> trace_manager_;
+
+  // The constant inputs bound to each model. The inputs of a model are
+  // replaced as a whole when they change so that in-flight requests can keep
+  // a reference to the inputs they were prepared with.
+  std::mutex bound_inputs_mu_;
+  std::atomic<bool> has_bound_inputs_;
+  std::unordered_map<std::string, std::shared_ptr<const BoundInputs>>
+      bound_inputs_;
+
+  // The output usage trackers of the models with output pruning enabled.
+  std::mutex output_usage_mu_;
+  std::atomic<bool> has_output_usage_;
+  std::unordered_map<std::string, std::shared_ptr<OutputUsageTracker>>
+      output_usage_;
+
+  // The shadow mirrors of the models with shadow mirroring enabled.
+  std::mutex shadow_mirrors_mu_;
+  std::atomic<bool> has_shadow_mirrors_;
+  std::unordered_map<std::string, std::shared_ptr<ShadowMirror>>
+      shadow_mirrors_;
+
+  // The executor shared by the parallel work of the wrapper.
+  std::shared_ptr<WorkStealingExecutor> executor_;
+
+  // The trackers of the models with a service level objective. The map is
+  // immutable and replaced as a whole, so that the requests look up their
+  // tracker with an atomic load. The mutex serializes the updates.
+  std::mutex slo_trackers_mu_;
+  std::atomic<bool> has_slo_trackers_;
+  std::shared_ptr<
+      const std::unordered_map<std::string, std::shared_ptr<SloTracker>>>
+      slo_trackers_;
+
+  // The cached health and readiness. Nullptr if the checks are not cached.
+  std::shared_ptr<HealthCache> health_cache_;
+
+  // The in-flight request watchdog. Nullptr if the requests are not watched.
+  std::shared_ptr<RequestWatchdog> watchdog_;
+
+  // The memory pressure monitor. Nullptr if the memory pressure is not
+  // monitored.
+  std::shared_ptr<MemoryPressureMonitor> memory_monitor_;
+
+  // The predictive model preloader. Nullptr if 'model_preloading_' is not set
+  // in 'ServerOptions'.
+  std::shared_ptr<ModelPreloader> model_preloader_;
+
+  // The fingerprints of the model repositories checked before each poll.
+  // Nullptr if 'repository_poll_fingerprint_' is not set in 'ServerOptions'.
+  std::shared_ptr<RepositoryFingerprint> repo_fingerprint_;
+
+  // The phase counters of each model if 'phase_counters_' is set in
+  // 'ServerOptions'.
+  bool has_phase_counters_;
+  std::mutex phase_counters_mu_;
+  std::unordered_map<std::string, std::shared_ptr<PhaseCounters>>
+      phase_counters_;
+
+  // The latency histograms of each model if 'latency_histogram_bounds_us_' is
+  // set in 'ServerOptions'.
+  std::vector<uint64_t> latency_histogram_bounds_us_;
+  bool latency_histogram_exemplars_;
+  std::mutex latency_histograms_mu_;
+  std::unordered_map<std::string, std::shared_ptr<LatencyHistogram>>
+      latency_histograms_;
+
+  // The publisher of the stats segment. Nullptr if 'stats_segment_name_' is
+  // not set in 'ServerOptions'.
+  std::shared_ptr<StatsPublisher> stats_publisher_;
+
+  // The loader of the startup models of a server created by 'CreateAsync'.
+  // Nullptr if the server is created by 'Create'.
+  std::shared_ptr<ModelStartupLoader> startup_loader_;
+
+  // If true, loading and unloading models is rejected. Set if the server is
+  // created by 'CreateAsync' in NONE model control mode, which runs the
+  // server in EXPLICIT mode to load the models in the background.
+  bool model_control_disabled_;
+
+  // The host layout chosen when the server was created.
+  std::string host_layout_;
+
+  // The report of the effective resources of the server.
+  std::string resource_report_;
 };
 
+/// Discover the NUMA nodes of the host from '/sys/devices/system/node'. Only
+/// the nodes with CPUs are returned. The returned vector is empty if the
+/// topology is not available, e.g. on non-Linux hosts.
+/// \return Returns the NUMA nodes ordered by id.
+std::vector<NumaNode> NumaTopology();
+
+/// Generate host policies from the NUMA topology. A policy named
+/// "numa<id>" is generated for each node, which can be set as 'host_policy'
+/// of the instance groups in the model configuration to spread the model
+/// instances across the nodes. If GPU support is enabled, a policy named
+/// "gpu<device>" is also generated for each GPU, binding the GPU instances to
+/// the NUMA node the GPU is attached to. Each policy sets both 'NUMA_NODE' and
+/// 'CPU_CORES'.
+/// \param nodes The NUMA nodes returned by 'NumaTopology'.
+/// \return Returns the generated host policies.
+std::vector<HostPolicy> GenerateHostPolicies(
+    const std::vector<NumaNode>& nodes);
+
+/// Detect the resource limits of the container the process runs in from its
+/// cgroup. Both cgroup v1 and v2 are supported. The CPU quota ('cpu.max' or
+/// 'cpu.cfs_quota_us'), the cpuset and the memory limit ('memory.max' or
+/// 'memory.limit_in_bytes') of the cgroup and its ancestors are read. If the
+/// process is not in a container, the limits describe the whole host.
+/// \return Returns the detected limits.
+ContainerLimits DetectContainerLimits();
+
 
 //==============================================================================
 /// An interface for InferResult object to interpret the response to an
@@ -254,8 +703,53 @@ class InferResult : public GenericInferResult {
       next_result_future_;
 
   TRITONSERVER_InferenceResponse* completed_response_;
+
+  // The output usage tracker of the model if output pruning is enabled and
+  // the request did not request any output explicitly.
+  std::shared_ptr<OutputUsageTracker> output_usage_;
+
+  // The phase counters of the model the release of this result is counted
+  // to. Nullptr if the phase counters are not enabled.
+  std::shared_ptr<PhaseCounters> phase_counters_;
 };
 
+/// Gather the output of the specified name from each of the results into one
+/// contiguous tensor. The outputs are concatenated along the first dimension
+/// in the order of the results, so all outputs must be in CPU memory and have
+/// the same data type and the same dimensions except the first one. Large
+/// outputs are copied in parallel, on the workers of 'executor' if set.
+/// \param results The results to gather the output from.
+/// \param name The name of the output tensor.
+/// \param release_results If true, each result is released as soon as its
+/// output is copied and its entry in 'results' is set to nullptr.
+/// \param executor The executor the copy is split on, e.g. the one returned by
+/// 'TritonServer::SharedExecutor'. If nullptr, the outputs are copied by the
+/// calling thread.
+/// \return Returns the gathered output as a shared pointer of 'Tensor' object.
+/// The 'buffer' field of the output is owned by the returned 'Tensor' object.
+std::shared_ptr<Tensor> GatherOutputs(
+    std::vector<std::unique_ptr<InferResult>>& results,
+    const std::string& name, const bool release_results = false,
+    WorkExecutor* executor = nullptr);
+
+/// Gather the output of the specified name from each of the results into the
+/// buffer of 'output'. See the 'GatherOutputs' function above for more
+/// information. The buffer of 'output' must be in CPU memory and 'byte_size'
+/// of 'output' must not be smaller than the size of the gathered output.
+/// 'byte_size', 'data_type' and 'shape' of 'output' are set to the ones of the
+/// gathered output.
+/// \param results The results to gather the output from.
+/// \param name The name of the output tensor.
+/// \param output The tensor that describes the buffer to gather into.
+/// \param release_results If true, each result is released as soon as its
+/// output is copied and its entry in 'results' is set to nullptr.
+/// \param executor The executor the copy is split on. If nullptr, the outputs
+/// are copied by the calling thread.
+void GatherOutputs(
+    std::vector<std::unique_ptr<InferResult>>& results,
+    const std::string& name, Tensor& output,
+    const bool release_results = false, WorkExecutor* executor = nullptr);
+
 //==============================================================================
 /// Object that describes an inflight inference request.
 ///
@@ -319,6 +813,36 @@ class InferRequest : public GenericInferRequest {
       const DataType& data_type, const std::vector<int64_t>& shape,
       const MemoryType& memory_type, const int64_t memory_type_id) noexcept;
 
+  /// Add an input tensor given in a sparse format. The input is expanded into
+  /// a dense tensor of 'dense_shape' in CPU memory owned by the request, whose
+  /// elements are 0 except the ones listed in 'indices'. The formats are:
+  ///   - COO: 'indices' holds the coordinates of each value in the dense
+  ///     tensor, one row of 'dense_shape.size()' coordinates per value.
+  ///   - CSR: the first dimension of 'dense_shape' is the rows and the other
+  ///     dimensions are flattened into the columns, so 'dense_shape' must have
+  ///     at least 2 dimensions. 'indices' holds the 'rows + 1' offsets of the
+  ///     first value of each row followed by the column of each value.
+  /// If a coordinate is listed more than once, which of its values is kept is
+  /// unspecified. The dense buffers are kept when the request is reset and
+  /// reused by the following sparse inputs, so a request reused for each
+  /// batch doesn't allocate them again. Large inputs are zero-filled and
+  /// scattered in parallel on the workers of 'executor' if set. An exception
+  /// is thrown if an index is out of the bounds of 'dense_shape'.
+  /// \param name The name of the input tensor.
+  /// \param indices The indices of the values in 'INT32' or 'INT64', in CPU
+  /// memory.
+  /// \param values The values in the data type of the input, in CPU memory.
+  /// 'BYTES' is not supported.
+  /// \param dense_shape The shape of the input.
+  /// \param format The format of 'indices'.
+  /// \param executor The executor the expansion is split on, e.g. the one
+  /// returned by 'TritonServer::SharedExecutor'. If nullptr, the input is
+  /// expanded on the calling thread.
+  void AddSparseInput(
+      const std::string& name, const Tensor& indices, const Tensor& values,
+      const std::vector<int64_t>& dense_shape, const SparseFormat& format,
+      WorkExecutor* executor = nullptr);
+
   /// Add a requested output to be sent within an InferRequest object.
   /// Calling this function is optional. If no output(s) are specifically
   /// requested then all outputs defined by the model will be calculated and
@@ -341,12 +865,28 @@ class InferRequest : public GenericInferRequest {
   void Reset() override;
   friend class TritonServer;
   friend class InternalServer;
+  friend class RaggedBatchBuilder;
 
  protected:
   InferRequest();
 
+  // Allocate an uninitialized buffer whose lifetime is bound to this request.
+  // The buffer is released when the request is reset or destroyed.
+  char* AllocateInputBuffer(const size_t byte_size);
+
+  // Allocate an uninitialized buffer aligned to a cache line for a sparse
+  // input. The buffer is reused by the following sparse inputs once the
+  // request is reset, and released when the request is destroyed.
+  char* AllocateDenseBuffer(const size_t byte_size);
+
   std::unique_ptr<InferOptions> infer_options_;
   std::list<std::string> str_bufs_;
+  std::list<std::unique_ptr<char[]>> input_bufs_;
+  // The buffers of the sparse inputs and their byte sizes. The first
+  // 'dense_bufs_in_use_' hold the inputs of the request, the others are kept
+  // from before the last reset to be reused.
+  std::vector<std::pair<size_t, std::shared_ptr<char>>> dense_bufs_;
+  size_t dense_bufs_in_use_;
   std::unordered_map<std::string, std::unique_ptr<Tensor>> inputs_;
   std::vector<std::unique_ptr<InferRequestedOutput>> outputs_;
 
@@ -358,6 +898,39 @@ class InferRequest : public GenericInferRequest {
   // should be long enough until the trace associated with this request is
   // written to file.
   std::shared_ptr<TraceManager::Trace> trace_;
+  // The constant inputs bound to the requested model when this request was
+  // prepared. Holding them keeps the input buffers alive until the request
+  // is completed even if the inputs are unbound in the meantime.
+  std::shared_ptr<const BoundInputs> bound_inputs_;
+  // The output usage tracker of the requested model if the outputs of this
+  // request are selected by output pruning.
+  std::shared_ptr<OutputUsageTracker> output_usage_;
+  // The result that the responses are aggregated into if
+  // 'aggregate_decoupled_responses_' is set in 'InferOptions'.
+  std::unique_ptr<InferResult> aggregated_result_;
+  // The entry of this request in the in-flight request watchdog, nullptr if
+  // the request is not watched or has completed.
+  InFlightRequest* in_flight_;
+  // The shadow request of this request if it is mirrored, until the result of
+  // this request is received.
+  std::shared_ptr<ShadowSample> shadow_sample_;
+  // The memory pressure monitor that admitted this request, until its final
+  // response is received. Nullptr if the memory pressure is not monitored.
+  std::shared_ptr<MemoryPressureMonitor> memory_monitor_;
+  // The phase counters of the requested model. Nullptr if the phase counters
+  // are not enabled.
+  std::shared_ptr<PhaseCounters> phase_counters_;
+  // The SLO tracker of the requested model, until its response is received.
+  // Nullptr if the model has no service level objective.
+  std::shared_ptr<SloTracker> slo_tracker_;
+  // The latency histogram of the requested model, until its response is
+  // received. Nullptr if the latency is not recorded.
+  std::shared_ptr<LatencyHistogram> latency_histogram_;
+  // The live counters of the requested model, until its final response is
+  // received. Nullptr if the stats segment is not published.
+  std::shared_ptr<LiveModelStats> live_stats_;
+  // The time this request was started at if its latency is recorded.
+  std::chrono::steady_clock::time_point start_time_;
 
   // If the requested model is a decoupled model. If true, the lifetime of this
   // 'InferRequest' should be long enough until all the responses are returned
@@ -365,9 +938,107 @@ class InferRequest : public GenericInferRequest {
   bool is_decoupled_;
 
  private:
-  // The promise object used for setting value to the result future.
+  // The promise of the first result, returned by 'AsyncInfer'. Invalid once
+  // the first result is set.
+  InferPromise infer_promise_;
+  // The promise object used for setting value to the result future of the
+  // following responses of a decoupled model.
   std::unique_ptr<std::promise<std::unique_ptr<InferResult>>> prev_promise_;
 };
+
+//==============================================================================
+/// Helper object to pack variable-length items into the inputs expected by a
+/// model configured with 'allow_ragged_batch': one flat data tensor holding
+/// the elements of all items back to back, and one index tensor describing
+/// where each item ends. It can also split a ragged output into per-item
+/// views using the same item lengths.
+///
+class RaggedBatchBuilder {
+ public:
+  /// The kind of index tensor generated by 'Build'.
+  /// * LENGTHS: The element count of each item.
+  /// * OFFSETS: The accumulated element count at the end of each item, which
+  /// matches the 'BATCH_ACCUMULATED_ELEMENT_COUNT' batch input of Triton.
+  enum class IndexKind { LENGTHS, OFFSETS };
+
+  /// Create a RaggedBatchBuilder instance.
+  /// \param data_type The data type of the item elements. 'BYTES' is not
+  /// supported.
+  /// \param index_kind The kind of index tensor to generate. Default is
+  /// 'LENGTHS'.
+  /// \param index_data_type The data type of the index tensor. Must be 'INT32'
+  /// or 'INT64'. Default is 'INT32'.
+  RaggedBatchBuilder(
+      const DataType& data_type,
+      const IndexKind& index_kind = IndexKind::LENGTHS,
+      const DataType& index_data_type = DataType::INT32);
+
+  /// Add an item to the batch. The item data is not copied until 'Build' is
+  /// called, so the buffer must stay valid until then.
+  /// \param data The pointer to the first element of the item.
+  /// \param element_count The number of elements in the item.
+  template <typename T>
+  void AddItem(const T* data, const size_t element_count);
+
+  /// Add an item to the batch from a contiguous container. The container must
+  /// stay valid until 'Build' is called.
+  /// \param begin The begin iterator of the container.
+  /// \param end The end iterator of the container.
+  template <typename Iterator>
+  void AddItem(const Iterator begin, const Iterator end);
+
+  /// Pack all the added items into a single buffer owned by 'request' and add
+  /// the data and index tensors to it. The data tensor has shape
+  /// [total_element_count] and the index tensor has shape [item_count]. The
+  /// packing is done in one pass with one allocation.
+  /// \param request The request to add the packed inputs to.
+  /// \param data_name The name of the input holding the packed elements.
+  /// \param index_name The name of the input holding the index.
+  void Build(
+      InferRequest& request, const std::string& data_name,
+      const std::string& index_name);
+
+  /// Remove all the items so that the builder can be reused.
+  void Clear();
+
+  /// Get the number of items added to the builder.
+  size_t ItemCount() const { return lengths_.size(); }
+
+  /// Get the total number of elements of all items.
+  size_t ElementCount() const { return element_count_; }
+
+  /// Get the element count of each item.
+  const std::vector<int64_t>& Lengths() const { return lengths_; }
+
+  /// Split a ragged output into per-item views using the item lengths of this
+  /// builder. See the static version of 'Unpack' for more detail.
+  std::vector<Tensor> Unpack(const Tensor& output) const
+  {
+    return Unpack(output, lengths_);
+  }
+
+  /// Split a ragged output into per-item views. The first dimension of the
+  /// output is split according to 'lengths' and the remaining dimensions are
+  /// kept for each view. The returned 'Tensor' objects do not own the buffer,
+  /// so the output tensor must outlive them.
+  /// \param output The output tensor to be split.
+  /// \param lengths The size of the first dimension of each item.
+  /// \return Returns a vector of 'Tensor' objects, one per item.
+  static std::vector<Tensor> Unpack(
+      const Tensor& output, const std::vector<int64_t>& lengths);
+
+ private:
+  void AddItemBytes(const char* data, const size_t element_count);
+
+  DataType data_type_;
+  IndexKind index_kind_;
+  DataType index_data_type_;
+  size_t element_byte_size_;
+  size_t element_count_;
+  std::vector<const char*> items_;
+  std::vector<int64_t> lengths_;
+};
+
 //==============================================================================
 /// Helper functions to convert Wrapper enum to string.
 ///
@@ -428,4 +1099,52 @@ InferRequest::AddInput(
   AddInput(name, input);
 }
 
+template <typename Iterator>
+void
+TritonServer::BindConstantInput(
+    const std::string& model_name, const std::string& input_name,
+    const Iterator begin, const Iterator end,
+    const std::vector<int64_t>& shape)
+{
+  // Serialize the strings the same way as 'InferRequest::AddInput' does, the
+  // serialized buffer is then copied into the server-owned memory.
+  std::string sbuf;
+  for (Iterator it = begin; it != end; it++) {
+    uint32_t len = it->size();
+    sbuf.append(reinterpret_cast<const char*>(&len), sizeof(uint32_t));
+    sbuf.append(*it);
+  }
+  BindConstantInput(
+      model_name, input_name,
+      Tensor(
+          &sbuf[0], sbuf.size(), DataType::BYTES, shape, MemoryType::CPU, 0));
+}
+
+template <typename T>
+void
+RaggedBatchBuilder::AddItem(const T* data, const size_t element_count)
+{
+  static_assert(
+      !std::is_same<T, std::string>::value,
+      "RaggedBatchBuilder does not support 'BYTES' items");
+  if (sizeof(T) != element_byte_size_) {
+    throw TritonException(
+        "Error - RaggedBatchBuilder: element size " +
+        std::to_string(sizeof(T)) + " does not match data type " +
+        DataTypeString(data_type_));
+  }
+  AddItemBytes(reinterpret_cast<const char*>(data), element_count);
+}
+
+template <typename Iterator>
+void
+RaggedBatchBuilder::AddItem(const Iterator begin, const Iterator end)
+{
+  if (begin == end) {
+    AddItemBytes(nullptr, 0);
+  } else {
+    AddItem(&(*begin), std::distance(begin, end));
+  }
+}
+
 }}}  // namespace triton::developer_tools::server
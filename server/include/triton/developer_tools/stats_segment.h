@@ -0,0 +1,135 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+
+namespace triton { namespace developer_tools { namespace server {
+
+// The layout of the stats segment, see 'StatsSegment', changes only with the
+// version.
+constexpr uint32_t kStatsSegmentMagic = 0x53534454;  // "TDSS"
+constexpr uint32_t kStatsSegmentVersion = 1;
+constexpr size_t kStatsSegmentMaxModels = 64;
+constexpr size_t kStatsSegmentModelNameSize = 64;
+// The latency buckets are powers of two: bucket 0 counts the requests faster
+// than 1 microsecond, bucket i those from 2^(i-1) up to 2^i microseconds and
+// the last bucket those above.
+constexpr size_t kStatsSegmentLatencyBucketCount = 24;
+
+static_assert(
+    ATOMIC_LLONG_LOCK_FREE == 2,
+    "the sequence of the stats segment must be lock-free to be shared "
+    "between processes");
+
+struct StatsSegmentModel {
+  // The name of the model, truncated and NUL-terminated.
+  char name_[kStatsSegmentModelNameSize];
+  // The requests sent and not completed yet.
+  uint64_t in_flight_count_;
+  // The requests completed since the server was created, and those that
+  // failed. The throughput is the difference between two reads.
+  uint64_t request_count_;
+  uint64_t error_count_;
+  // The sum of the latency of the completed requests, from the call to
+  // 'AsyncInfer' or 'Infer' to the final response, and their distribution.
+  uint64_t latency_sum_us_;
+  uint64_t latency_buckets_[kStatsSegmentLatencyBucketCount];
+};
+
+struct StatsSegmentData {
+  // The time since epoch of the last update, in nanoseconds.
+  uint64_t update_time_ns_;
+  // The bytes of the pinned memory pool of the server, and the bytes in use
+  // in the heap of the process, 0 if unknown.
+  uint64_t pinned_memory_pool_byte_size_;
+  uint64_t heap_in_use_byte_size_;
+  // The traces that were sampled but could not be created or written.
+  uint64_t dropped_trace_count_;
+  // The models in 'models_', and the requests that were not counted because
+  // their model was not in 'models_' once it was full.
+  uint64_t model_count_;
+  uint64_t dropped_model_request_count_;
+  StatsSegmentModel models_[kStatsSegmentMaxModels];
+};
+
+//==============================================================================
+/// The layout of the shared memory segment that the wrapper publishes its
+/// live counters to if 'stats_segment_name_' is set in 'ServerOptions'. The
+/// segment is read by mapping the POSIX shared memory object read-only, see
+/// 'tds_top', so reading the counters costs nothing to the serving process.
+///
+/// The header fields are written once when the segment is created. The
+/// fields of 'data_' are updated together under 'sequence_', which is odd
+/// while the wrapper writes them, so a reader copies 'data_' with
+/// 'ReadStatsSegment' and retries if the copy raced with an update. A reader
+/// must check 'magic_' and 'version_' before anything else, the layout only
+/// changes with the version.
+///
+struct StatsSegment {
+  uint32_t magic_;
+  uint32_t version_;
+  // The size of the segment, 'sizeof(StatsSegment)' of the version.
+  uint64_t byte_size_;
+  // The process serving the models and the update interval.
+  uint64_t pid_;
+  uint64_t update_interval_ms_;
+
+  std::atomic<uint64_t> sequence_;
+  StatsSegmentData data_;
+};
+
+/// Copy a consistent snapshot of the counters of 'segment' to 'data'.
+/// \param segment The mapped segment.
+/// \param data Returns the counters.
+/// \param max_attempts The copies attempted if they race with updates.
+/// \return Returns false if every copy raced with an update.
+inline bool
+ReadStatsSegment(
+    const StatsSegment& segment, StatsSegmentData* data,
+    const int max_attempts = 16)
+{
+  for (int attempt = 0; attempt < max_attempts; ++attempt) {
+    const uint64_t sequence = segment.sequence_.load(std::memory_order_acquire);
+    if ((sequence & 1) != 0) {
+      continue;
+    }
+    memcpy(
+        static_cast<void*>(data), static_cast<const void*>(&segment.data_),
+        sizeof(StatsSegmentData));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (segment.sequence_.load(std::memory_order_relaxed) == sequence) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}}}  // namespace triton::developer_tools::server
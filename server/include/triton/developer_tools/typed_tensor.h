@@ -0,0 +1,235 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "triton/developer_tools/server_wrapper.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+//==============================================================================
+/// Map a 'DataType' to the C++ type of its elements. The elements of 'FP16'
+/// and 'BF16' are represented by their raw 16-bit value.
+///
+template <DataType D>
+struct DataTypeTraits;
+
+template <>
+struct DataTypeTraits<DataType::BOOL> {
+  using Type = bool;
+};
+template <>
+struct DataTypeTraits<DataType::UINT8> {
+  using Type = uint8_t;
+};
+template <>
+struct DataTypeTraits<DataType::UINT16> {
+  using Type = uint16_t;
+};
+template <>
+struct DataTypeTraits<DataType::UINT32> {
+  using Type = uint32_t;
+};
+template <>
+struct DataTypeTraits<DataType::UINT64> {
+  using Type = uint64_t;
+};
+template <>
+struct DataTypeTraits<DataType::INT8> {
+  using Type = int8_t;
+};
+template <>
+struct DataTypeTraits<DataType::INT16> {
+  using Type = int16_t;
+};
+template <>
+struct DataTypeTraits<DataType::INT32> {
+  using Type = int32_t;
+};
+template <>
+struct DataTypeTraits<DataType::INT64> {
+  using Type = int64_t;
+};
+template <>
+struct DataTypeTraits<DataType::FP16> {
+  using Type = uint16_t;
+};
+template <>
+struct DataTypeTraits<DataType::FP32> {
+  using Type = float;
+};
+template <>
+struct DataTypeTraits<DataType::FP64> {
+  using Type = double;
+};
+template <>
+struct DataTypeTraits<DataType::BYTES> {
+  using Type = std::string;
+};
+template <>
+struct DataTypeTraits<DataType::BF16> {
+  using Type = uint16_t;
+};
+
+//==============================================================================
+/// A view of the CPU data of an input of data type 'D'. The data is not
+/// copied, so it must stay valid until the inference request is completed.
+/// Passing data of a type that does not match 'D' fails to compile. This is
+/// used by the code generated by 'tds_codegen'.
+///
+template <DataType D>
+struct TypedInput {
+  using ValueType = typename DataTypeTraits<D>::Type;
+
+  TypedInput() : data_(nullptr), size_(0) {}
+
+  TypedInput(
+      const ValueType* data, const size_t size,
+      const std::vector<int64_t>& shape = {})
+      : data_(data), size_(size), shape_(shape)
+  {
+  }
+
+  TypedInput(
+      const std::vector<ValueType>& data,
+      const std::vector<int64_t>& shape = {})
+      : data_(data.data()), size_(data.size()), shape_(shape)
+  {
+  }
+
+  /// Add the input to 'request'. If 'shape_' is empty, 'default_shape' is used
+  /// as the shape of the input.
+  /// \param request The request to add the input to.
+  /// \param name The name of the input tensor.
+  /// \param default_shape The shape to use if 'shape_' is not set.
+  void AddTo(
+      InferRequest& request, const std::string& name,
+      const std::vector<int64_t>& default_shape) const
+  {
+    AddTo(
+        request, name, shape_.empty() ? default_shape : shape_,
+        std::integral_constant<bool, D == DataType::BYTES>());
+  }
+
+  // The elements of the input.
+  const ValueType* data_;
+  // The number of elements of the input.
+  size_t size_;
+  // The shape of the input. If empty, the shape in the model configuration is
+  // used, which requires the shape to be fully specified in the configuration.
+  std::vector<int64_t> shape_;
+
+ private:
+  void AddTo(
+      InferRequest& request, const std::string& name,
+      const std::vector<int64_t>& shape, std::false_type) const
+  {
+    request.AddInput(
+        name, Tensor(
+                  reinterpret_cast<char*>(const_cast<ValueType*>(data_)),
+                  size_ * sizeof(ValueType), D, shape, MemoryType::CPU, 0));
+  }
+
+  void AddTo(
+      InferRequest& request, const std::string& name,
+      const std::vector<int64_t>& shape, std::true_type) const
+  {
+    request.AddInput(
+        name, data_, data_ + size_, D, shape, MemoryType::CPU, 0);
+  }
+};
+
+//==============================================================================
+/// A typed view of the output of data type 'D' of an 'InferResult'. An
+/// exception is thrown if the data type of the output does not match 'D'. The
+/// view shares the ownership of the output buffer so it stays valid even if
+/// the result is released. This is used by the code generated by
+/// 'tds_codegen'.
+///
+template <DataType D>
+class TypedOutput {
+ public:
+  using ValueType = typename DataTypeTraits<D>::Type;
+
+  TypedOutput(InferResult& result, const std::string& name)
+      : output_(result.Output(name))
+  {
+    if (output_->data_type_ != D) {
+      throw TritonException(
+          "Error - TypedOutput: The data type of output '" + name +
+          "' does not match the data type in the model configuration.");
+    }
+  }
+
+  /// Get the elements of the output.
+  const ValueType* Data() const
+  {
+    return reinterpret_cast<const ValueType*>(output_->buffer_);
+  }
+
+  /// Get the number of elements of the output.
+  size_t Size() const { return output_->byte_size_ / sizeof(ValueType); }
+
+  /// Get the shape of the output.
+  const std::vector<int64_t>& Shape() const { return output_->shape_; }
+
+  /// Get the underlying output tensor.
+  const std::shared_ptr<Tensor>& Output() const { return output_; }
+
+ private:
+  std::shared_ptr<Tensor> output_;
+};
+
+/// The elements of a 'BYTES' output are copied into strings when the view is
+/// created.
+template <>
+class TypedOutput<DataType::BYTES> {
+ public:
+  using ValueType = std::string;
+
+  TypedOutput(InferResult& result, const std::string& name)
+      : data_(result.StringData(name)), shape_(result.Output(name)->shape_)
+  {
+  }
+
+  const ValueType* Data() const { return data_.data(); }
+
+  size_t Size() const { return data_.size(); }
+
+  const std::vector<int64_t>& Shape() const { return shape_; }
+
+ private:
+  std::vector<std::string> data_;
+  std::vector<int64_t> shape_;
+};
+
+}}}  // namespace triton::developer_tools::server
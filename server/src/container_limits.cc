@@ -0,0 +1,305 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "container_limits.h"
+
+#ifdef __linux__
+#include <sched.h>
+#endif  // __linux__
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "topology.h"
+#include "triton/developer_tools/server_wrapper.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+// Memory limits at or above this value mean that the memory is not limited.
+// cgroup v1 reports the largest page-aligned 64-bit value in that case.
+constexpr uint64_t kUnlimitedMemoryByteSize = 1ULL << 62;
+
+// Return the values of 'file' in the cgroup at 'cgroup_path' and in each of
+// its ancestors that exist under 'mount_dir', starting from the cgroup itself.
+// A limit of a cgroup also applies to its descendants, so the effective limit
+// is the smallest of the returned values. If the cgroup namespace of the
+// process is not private, 'cgroup_path' is not visible under 'mount_dir' and
+// only the values of the visible ancestors are returned.
+std::vector<std::string>
+ReadCgroupHierarchy(
+    const std::string& mount_dir, std::string cgroup_path,
+    const std::string& file)
+{
+  std::vector<std::string> values;
+  while (true) {
+    const std::string value =
+        ReadSysfsLine(mount_dir + cgroup_path + "/" + file);
+    if (!value.empty()) {
+      values.push_back(value);
+    }
+    if (cgroup_path.empty() || (cgroup_path == "/")) {
+      break;
+    }
+    cgroup_path = cgroup_path.substr(0, cgroup_path.find_last_of('/'));
+  }
+  return values;
+}
+
+// Return the number of CPUs in 'cpu_list', or 0 if it is empty.
+uint32_t
+CpuListCount(const std::string& cpu_list)
+{
+  try {
+    return ParseCpuList(cpu_list).size();
+  }
+  catch (...) {
+    return 0;
+  }
+}
+
+// Update the limits from cgroup v2 interface files.
+void
+DetectCgroupV2Limits(
+    const std::string& mount_dir, const std::string& cgroup_path,
+    ContainerLimits* limits)
+{
+  // 'cpu.max' is "$MAX $PERIOD", where $MAX is "max" if there is no quota.
+  for (const auto& value :
+       ReadCgroupHierarchy(mount_dir, cgroup_path, "cpu.max")) {
+    std::stringstream ss(value);
+    std::string quota;
+    double period = 0;
+    if ((ss >> quota >> period) && (quota != "max") && (period > 0)) {
+      const double cpus = std::stod(quota) / period;
+      if ((limits->cpu_quota_ == 0) || (cpus < limits->cpu_quota_)) {
+        limits->cpu_quota_ = cpus;
+      }
+    }
+  }
+
+  // 'cpuset.cpus.effective' already accounts for the ancestors.
+  const auto cpusets =
+      ReadCgroupHierarchy(mount_dir, cgroup_path, "cpuset.cpus.effective");
+  if (!cpusets.empty()) {
+    limits->cpuset_cpu_count_ = CpuListCount(cpusets.front());
+  }
+
+  for (const auto& value :
+       ReadCgroupHierarchy(mount_dir, cgroup_path, "memory.max")) {
+    if (value != "max") {
+      const uint64_t byte_size = std::stoull(value);
+      if ((limits->memory_limit_byte_size_ == 0) ||
+          (byte_size < limits->memory_limit_byte_size_)) {
+        limits->memory_limit_byte_size_ = byte_size;
+      }
+    }
+  }
+}
+
+// Update the limits from cgroup v1 interface files. 'cgroup_paths' maps each
+// controller to the cgroup of the process in its hierarchy.
+void
+DetectCgroupV1Limits(
+    const std::string& cgroup_root,
+    const std::map<std::string, std::string>& cgroup_paths,
+    ContainerLimits* limits)
+{
+  // The 'cpu' controller is usually co-mounted with 'cpuacct'.
+  auto it = cgroup_paths.find("cpu");
+  if (it != cgroup_paths.end()) {
+    for (const auto& mount : {"cpu", "cpu,cpuacct", "cpuacct,cpu"}) {
+      const std::string mount_dir = cgroup_root + "/" + mount;
+      const auto quotas =
+          ReadCgroupHierarchy(mount_dir, it->second, "cpu.cfs_quota_us");
+      const auto periods =
+          ReadCgroupHierarchy(mount_dir, it->second, "cpu.cfs_period_us");
+      for (size_t i = 0; i < std::min(quotas.size(), periods.size()); ++i) {
+        // The quota is -1 if there is no quota.
+        const double quota = std::stod(quotas[i]);
+        const double period = std::stod(periods[i]);
+        if ((quota > 0) && (period > 0)) {
+          const double cpus = quota / period;
+          if ((limits->cpu_quota_ == 0) || (cpus < limits->cpu_quota_)) {
+            limits->cpu_quota_ = cpus;
+          }
+        }
+      }
+      if (!quotas.empty()) {
+        break;
+      }
+    }
+  }
+
+  it = cgroup_paths.find("cpuset");
+  if (it != cgroup_paths.end()) {
+    const std::string mount_dir = cgroup_root + "/cpuset";
+    auto cpusets =
+        ReadCgroupHierarchy(mount_dir, it->second, "cpuset.effective_cpus");
+    if (cpusets.empty()) {
+      cpusets = ReadCgroupHierarchy(mount_dir, it->second, "cpuset.cpus");
+    }
+    if (!cpusets.empty()) {
+      limits->cpuset_cpu_count_ = CpuListCount(cpusets.front());
+    }
+  }
+
+  it = cgroup_paths.find("memory");
+  if (it != cgroup_paths.end()) {
+    for (const auto& value : ReadCgroupHierarchy(
+             cgroup_root + "/memory", it->second, "memory.limit_in_bytes")) {
+      const uint64_t byte_size = std::stoull(value);
+      if ((byte_size < kUnlimitedMemoryByteSize) &&
+          ((limits->memory_limit_byte_size_ == 0) ||
+           (byte_size < limits->memory_limit_byte_size_))) {
+        limits->memory_limit_byte_size_ = byte_size;
+      }
+    }
+  }
+}
+
+ContainerLimits
+DetectContainerLimits(
+    const std::string& proc_self_cgroup, const std::string& cgroup_root,
+    const uint32_t available_cpu_count)
+{
+  ContainerLimits limits;
+
+  // Each line of '/proc/self/cgroup' is "$ID:$CONTROLLERS:$PATH". The cgroup
+  // v2 hierarchy has ID 0 and no controllers listed.
+  std::map<std::string, std::string> v1_paths;
+  std::string v2_path;
+  bool has_v2 = false;
+  std::ifstream file(proc_self_cgroup);
+  std::string line;
+  while (std::getline(file, line)) {
+    const auto first = line.find(':');
+    const auto second = line.find(':', first + 1);
+    if ((first == std::string::npos) || (second == std::string::npos)) {
+      continue;
+    }
+    const std::string controllers = line.substr(first + 1, second - first - 1);
+    const std::string path = line.substr(second + 1);
+    if ((line.compare(0, first, "0") == 0) && controllers.empty()) {
+      has_v2 = true;
+      v2_path = path;
+      continue;
+    }
+    std::stringstream ss(controllers);
+    std::string controller;
+    while (std::getline(ss, controller, ',')) {
+      v1_paths[controller] = path;
+    }
+  }
+
+  try {
+    // In the hybrid layout, the resource controllers are attached to the v1
+    // hierarchies and the v2 hierarchy is used for process tracking only.
+    if ((v1_paths.find("cpu") != v1_paths.end()) ||
+        (v1_paths.find("cpuset") != v1_paths.end()) ||
+        (v1_paths.find("memory") != v1_paths.end())) {
+      limits.cgroup_version_ = 1;
+      DetectCgroupV1Limits(cgroup_root, v1_paths, &limits);
+    } else if (has_v2) {
+      limits.cgroup_version_ = 2;
+      DetectCgroupV2Limits(cgroup_root, v2_path, &limits);
+    }
+  }
+  catch (...) {
+    // Malformed interface files, use the limits detected so far.
+  }
+
+  limits.cpuset_cpu_count_ =
+      (limits.cpuset_cpu_count_ == 0)
+          ? available_cpu_count
+          : std::min(limits.cpuset_cpu_count_, available_cpu_count);
+  limits.effective_cpu_count_ = limits.cpuset_cpu_count_;
+  if (limits.cpu_quota_ > 0) {
+    limits.effective_cpu_count_ = std::min<uint32_t>(
+        limits.effective_cpu_count_,
+        static_cast<uint32_t>(std::ceil(limits.cpu_quota_)));
+  }
+  limits.effective_cpu_count_ = std::max(1u, limits.effective_cpu_count_);
+
+  return limits;
+}
+
+std::string
+CgroupMemoryEventsPath(
+    const std::string& proc_self_cgroup, const std::string& cgroup_root)
+{
+  std::ifstream file(proc_self_cgroup);
+  std::string line;
+  while (std::getline(file, line)) {
+    // The cgroup v2 hierarchy is listed as "0::$PATH".
+    if (line.compare(0, 3, "0::") == 0) {
+      std::string path = cgroup_root + line.substr(3);
+      if (path.back() != '/') {
+        path += '/';
+      }
+      path += "memory.events";
+      return std::ifstream(path).good() ? path : "";
+    }
+  }
+  return "";
+}
+
+const ContainerLimits&
+ProcessContainerLimits()
+{
+  static const ContainerLimits limits = DetectContainerLimits();
+  return limits;
+}
+
+ContainerLimits
+DetectContainerLimits()
+{
+  uint32_t available_cpu_count = std::thread::hardware_concurrency();
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+    available_cpu_count = CPU_COUNT(&cpu_set);
+  }
+#endif  // __linux__
+  available_cpu_count = std::max(1u, available_cpu_count);
+
+#ifdef __linux__
+  return DetectContainerLimits(
+      "/proc/self/cgroup", "/sys/fs/cgroup", available_cpu_count);
+#else
+  ContainerLimits limits;
+  limits.cpuset_cpu_count_ = available_cpu_count;
+  limits.effective_cpu_count_ = available_cpu_count;
+  return limits;
+#endif  // __linux__
+}
+
+}}}  // namespace triton::developer_tools::server
@@ -0,0 +1,54 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "triton/developer_tools/common.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+// Detect the limits of the cgroup described by 'proc_self_cgroup', in the
+// format of '/proc/self/cgroup', under the cgroup file system mounted at
+// 'cgroup_root'. 'available_cpu_count' is the number of CPUs the process may
+// run on regardless of the cgroup, e.g. from its CPU affinity.
+ContainerLimits DetectContainerLimits(
+    const std::string& proc_self_cgroup, const std::string& cgroup_root,
+    const uint32_t available_cpu_count);
+
+// Return the limits of the container the process runs in. The limits are
+// detected on the first call and cached for the lifetime of the process.
+const ContainerLimits& ProcessContainerLimits();
+
+// Return the path of the 'memory.events' file of the cgroup v2 described by
+// 'proc_self_cgroup' under the cgroup file system mounted at 'cgroup_root'.
+// Return an empty string if the process is not in a cgroup v2 hierarchy or
+// the memory controller is not enabled for its cgroup.
+std::string CgroupMemoryEventsPath(
+    const std::string& proc_self_cgroup, const std::string& cgroup_root);
+
+}}}  // namespace triton::developer_tools::server
@@ -0,0 +1,163 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "health_cache.h"
+
+#include "log.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+HealthCache::HealthCache(TRITONSERVER_Server* server)
+    : server_(server), server_live_(false), server_ready_(false),
+      refresh_count_(0), models_(std::make_shared<const ModelReadiness>())
+{
+}
+
+bool
+HealthCache::ModelReady(
+    const std::string& model_name, const int64_t model_version)
+{
+  std::shared_ptr<const ModelReadiness> models = std::atomic_load(&models_);
+  auto it = models->find(ModelKey(model_name, model_version));
+  if (it != models->end()) {
+    it->second.last_check_->store(refresh_count_, std::memory_order_relaxed);
+    return it->second.ready_;
+  }
+  return QueryModelReady(model_name, model_version);
+}
+
+bool
+HealthCache::QueryServerLive()
+{
+  bool live = false;
+  TRITONSERVER_Error* err = TRITONSERVER_ServerIsLive(server_, &live);
+  server_live_ = (err == nullptr) && live;
+  THROW_IF_TRITON_ERR(err);
+  return live;
+}
+
+bool
+HealthCache::QueryServerReady()
+{
+  bool ready = false;
+  TRITONSERVER_Error* err = TRITONSERVER_ServerIsReady(server_, &ready);
+  server_ready_ = (err == nullptr) && ready;
+  THROW_IF_TRITON_ERR(err);
+  return ready;
+}
+
+bool
+HealthCache::QueryModelReady(
+    const std::string& model_name, const int64_t model_version)
+{
+  bool ready = false;
+  TRITONSERVER_Error* err = TRITONSERVER_ServerModelIsReady(
+      server_, model_name.c_str(), model_version, &ready);
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (err == nullptr) {
+      PublishModelReady(ModelKey(model_name, model_version), ready);
+    } else {
+      EraseModelReady(ModelKey(model_name, model_version));
+    }
+  }
+  THROW_IF_TRITON_ERR(err);
+  return ready;
+}
+
+void
+HealthCache::Refresh()
+{
+  bool live = false;
+  TRITONSERVER_Error* err = TRITONSERVER_ServerIsLive(server_, &live);
+  server_live_ = (err == nullptr) && live;
+  IGNORE_ERROR(err);
+
+  bool ready = false;
+  err = TRITONSERVER_ServerIsReady(server_, &ready);
+  server_ready_ = (err == nullptr) && ready;
+  IGNORE_ERROR(err);
+
+  // Hold the lock across the queries so that a concurrent query of a new
+  // model is not lost when the refreshed map is published.
+  std::lock_guard<std::mutex> lk(mu_);
+  const uint64_t refresh_count = ++refresh_count_;
+  std::shared_ptr<ModelReadiness> models =
+      std::make_shared<ModelReadiness>(*std::atomic_load(&models_));
+  for (auto it = models->begin(); it != models->end();) {
+    if (refresh_count - *it->second.last_check_ > kModelExpiryRefreshes) {
+      it = models->erase(it);
+      continue;
+    }
+    ready = false;
+    err = TRITONSERVER_ServerModelIsReady(
+        server_, it->first.first.c_str(), it->first.second, &ready);
+    it->second.ready_ = (err == nullptr) && ready;
+    IGNORE_ERROR(err);
+    ++it;
+  }
+  std::atomic_store(
+      &models_, std::shared_ptr<const ModelReadiness>(std::move(models)));
+}
+
+void
+HealthCache::PublishModelReady(const ModelKey& key, const bool ready)
+{
+  std::shared_ptr<const ModelReadiness> models = std::atomic_load(&models_);
+  auto it = models->find(key);
+  if (it != models->end()) {
+    it->second.last_check_->store(refresh_count_, std::memory_order_relaxed);
+    if (it->second.ready_ == ready) {
+      return;
+    }
+  }
+  std::shared_ptr<ModelReadiness> updated =
+      std::make_shared<ModelReadiness>(*models);
+  ModelState& state = (*updated)[key];
+  state.ready_ = ready;
+  if (state.last_check_ == nullptr) {
+    state.last_check_ =
+        std::make_shared<std::atomic<uint64_t>>(refresh_count_.load());
+  }
+  std::atomic_store(
+      &models_, std::shared_ptr<const ModelReadiness>(std::move(updated)));
+}
+
+void
+HealthCache::EraseModelReady(const ModelKey& key)
+{
+  std::shared_ptr<const ModelReadiness> models = std::atomic_load(&models_);
+  if (models->find(key) == models->end()) {
+    return;
+  }
+  std::shared_ptr<ModelReadiness> updated =
+      std::make_shared<ModelReadiness>(*models);
+  updated->erase(key);
+  std::atomic_store(
+      &models_, std::shared_ptr<const ModelReadiness>(std::move(updated)));
+}
+
+}}}  // namespace triton::developer_tools::server
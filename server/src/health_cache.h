@@ -0,0 +1,96 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "triton/core/tritonserver.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+//==============================================================================
+/// Caches the liveness and readiness of the server and the readiness of the
+/// models that have been queried, so that health checks don't go through the
+/// server. The cached values are read without locking. The model readiness is
+/// kept in an immutable map that is replaced as a whole on each refresh. A
+/// model that is not checked for 'kModelExpiryRefreshes' refreshes is dropped
+/// from the cache, and a model whose query fails, e.g. because it is not in
+/// the repository, is not cached.
+///
+class HealthCache {
+ public:
+  HealthCache(TRITONSERVER_Server* server);
+
+  bool ServerLive() const { return server_live_; }
+  bool ServerReady() const { return server_ready_; }
+
+  // Return the cached readiness of the model. The readiness of a model that is
+  // not cached yet is queried from the server and cached from then on.
+  bool ModelReady(const std::string& model_name, const int64_t model_version);
+
+  // Query the server and update the cached value. Throw 'TritonException' if
+  // the query fails.
+  bool QueryServerLive();
+  bool QueryServerReady();
+  bool QueryModelReady(
+      const std::string& model_name, const int64_t model_version);
+
+  // Query the server for all the cached values. A value whose query fails is
+  // cached as false. The models that expired are dropped.
+  void Refresh();
+
+ private:
+  static constexpr uint64_t kModelExpiryRefreshes = 100;
+
+  using ModelKey = std::pair<std::string, int64_t>;
+  struct ModelState {
+    bool ready_;
+    // The refresh count when the model was last checked. Shared by the
+    // successive maps so that it is updated without locking.
+    std::shared_ptr<std::atomic<uint64_t>> last_check_;
+  };
+  using ModelReadiness = std::map<ModelKey, ModelState>;
+
+  // Publish 'ready' as the readiness of 'key'. 'mu_' must be held.
+  void PublishModelReady(const ModelKey& key, const bool ready);
+  // Stop caching the readiness of 'key'. 'mu_' must be held.
+  void EraseModelReady(const ModelKey& key);
+
+  TRITONSERVER_Server* server_;
+  std::atomic<bool> server_live_;
+  std::atomic<bool> server_ready_;
+  std::atomic<uint64_t> refresh_count_;
+  // Serializes the updates of 'models_', the reads use atomic loads.
+  std::mutex mu_;
+  std::shared_ptr<const ModelReadiness> models_;
+};
+
+}}}  // namespace triton::developer_tools::server
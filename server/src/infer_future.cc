@@ -0,0 +1,145 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "triton/developer_tools/infer_future.h"
+
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace triton { namespace developer_tools { namespace server {
+
+constexpr uint32_t FutureStateBase::kPending;
+constexpr uint32_t FutureStateBase::kWaiting;
+constexpr uint32_t FutureStateBase::kReady;
+
+static_assert(
+    sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+    "The futex word must be a 32-bit integer");
+
+std::atomic<uint64_t>&
+FutureStatePoolGeneration()
+{
+  static std::atomic<uint64_t> generation(0);
+  return generation;
+}
+
+// Block while '*word' is equal to 'value', until woken up or 'timeout'
+// expires if not nullptr.
+void
+FutexWait(
+    std::atomic<uint32_t>* word, const uint32_t value,
+    const struct timespec* timeout)
+{
+  syscall(
+      SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE, value,
+      timeout, nullptr, 0);
+}
+
+void
+FutexWakeAll(std::atomic<uint32_t>* word)
+{
+  syscall(
+      SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE, INT_MAX,
+      nullptr, nullptr, 0);
+}
+
+void
+FutureStateBase::Wait()
+{
+  uint32_t state = state_.load(std::memory_order_acquire);
+  while (state != kReady) {
+    // Record that there is a waiter so that 'MarkReady' only makes the wake
+    // up system call when needed.
+    if ((state == kPending) &&
+        !state_.compare_exchange_weak(
+            state, kWaiting, std::memory_order_acq_rel)) {
+      continue;
+    }
+    FutexWait(&state_, kWaiting, nullptr);
+    state = state_.load(std::memory_order_acquire);
+  }
+}
+
+bool
+FutureStateBase::WaitFor(const std::chrono::nanoseconds& timeout)
+{
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  uint32_t state = state_.load(std::memory_order_acquire);
+  while (state != kReady) {
+    const auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (remaining.count() <= 0) {
+      return false;
+    }
+    if ((state == kPending) &&
+        !state_.compare_exchange_weak(
+            state, kWaiting, std::memory_order_acq_rel)) {
+      continue;
+    }
+    struct timespec ts;
+    ts.tv_sec = remaining.count() / 1000000000;
+    ts.tv_nsec = remaining.count() % 1000000000;
+    FutexWait(&state_, kWaiting, &ts);
+    state = state_.load(std::memory_order_acquire);
+  }
+  return true;
+}
+
+void
+FutureStateBase::SetContinuation(std::unique_ptr<Continuation>&& continuation)
+{
+  {
+    std::lock_guard<std::mutex> lk(continuation_mu_);
+    if (state_.load(std::memory_order_acquire) != kReady) {
+      continuation_ = std::move(continuation);
+      return;
+    }
+  }
+  continuation->Run();
+}
+
+void
+FutureStateBase::MarkReady()
+{
+  std::unique_ptr<Continuation> continuation;
+  uint32_t prev_state;
+  {
+    std::lock_guard<std::mutex> lk(continuation_mu_);
+    prev_state = state_.exchange(kReady, std::memory_order_acq_rel);
+    continuation = std::move(continuation_);
+  }
+  if (prev_state == kWaiting) {
+    FutexWakeAll(&state_);
+  }
+  if (continuation != nullptr) {
+    continuation->Run();
+  }
+}
+
+}}}  // namespace triton::developer_tools::server
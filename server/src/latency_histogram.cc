@@ -0,0 +1,237 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+namespace triton { namespace developer_tools { namespace server {
+
+// The exemplar of a bucket is replaced by a faster request once it is older
+// than this, so that the exemplars stay recent.
+constexpr uint64_t kExemplarMaxAgeNs = 60ull * 1000 * 1000 * 1000;
+// The attempts to read an exemplar that is being written.
+constexpr int kExemplarReadAttempts = 4;
+
+std::vector<uint64_t>
+SortedLatencyBounds(std::vector<uint64_t> bounds_us)
+{
+  std::sort(bounds_us.begin(), bounds_us.end());
+  bounds_us.erase(
+      std::unique(bounds_us.begin(), bounds_us.end()), bounds_us.end());
+  return bounds_us;
+}
+
+// Return 'value' escaped as a label value of the Prometheus text format.
+std::string
+EscapeLabelValue(const std::string& value)
+{
+  std::string escaped;
+  for (const char c : value) {
+    if (c == '\\') {
+      escaped += "\\\\";
+    } else if (c == '"') {
+      escaped += "\\\"";
+    } else if (c == '\n') {
+      escaped += "\\n";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+LatencyHistogram::LatencyHistogram(const std::vector<uint64_t>& bounds_us)
+    : bounds_us_(SortedLatencyBounds(bounds_us)),
+      counts_(new std::atomic<uint64_t>[bounds_us_.size() + 1]),
+      exemplars_(new Exemplar[bounds_us_.size() + 1]), sum_us_(0), count_(0)
+{
+  for (size_t i = 0; i <= bounds_us_.size(); ++i) {
+    counts_[i] = 0;
+    Exemplar& exemplar = exemplars_[i];
+    exemplar.sequence_ = 0;
+    exemplar.latency_us_ = 0;
+    exemplar.timestamp_ns_ = 0;
+    exemplar.trace_id_ = 0;
+    exemplar.request_id_size_ = 0;
+    for (auto& word : exemplar.request_id_) {
+      word = 0;
+    }
+  }
+}
+
+void
+LatencyHistogram::Record(
+    const std::chrono::steady_clock::time_point& start_time,
+    const std::string& request_id, const uint64_t trace_id)
+{
+  const uint64_t latency_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start_time)
+          .count();
+  const size_t bucket =
+      std::lower_bound(bounds_us_.begin(), bounds_us_.end(), latency_us) -
+      bounds_us_.begin();
+  counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+  sum_us_.fetch_add(latency_us, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+
+  // Keep the slowest recent request of the bucket.
+  Exemplar& exemplar = exemplars_[bucket];
+  const uint64_t now_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+  if ((latency_us >= exemplar.latency_us_.load(std::memory_order_relaxed)) ||
+      (now_ns - exemplar.timestamp_ns_.load(std::memory_order_relaxed) >
+       kExemplarMaxAgeNs)) {
+    WriteExemplar(&exemplar, latency_us, now_ns, request_id, trace_id);
+  }
+}
+
+void
+LatencyHistogram::WriteExemplar(
+    Exemplar* exemplar, const uint64_t latency_us, const uint64_t now_ns,
+    const std::string& request_id, const uint64_t trace_id)
+{
+  uint64_t sequence = exemplar->sequence_.load(std::memory_order_relaxed);
+  if (((sequence & 1) != 0) ||
+      !exemplar->sequence_.compare_exchange_strong(
+          sequence, sequence + 1, std::memory_order_acquire)) {
+    // Another thread is writing the exemplar.
+    return;
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+
+  exemplar->latency_us_.store(latency_us, std::memory_order_relaxed);
+  exemplar->timestamp_ns_.store(now_ns, std::memory_order_relaxed);
+  exemplar->trace_id_.store(trace_id, std::memory_order_relaxed);
+  const size_t size =
+      std::min(request_id.size(), kRequestIdWords * sizeof(uint64_t));
+  exemplar->request_id_size_.store(size, std::memory_order_relaxed);
+  for (size_t i = 0; i * sizeof(uint64_t) < size; ++i) {
+    uint64_t word = 0;
+    memcpy(
+        &word, request_id.data() + i * sizeof(uint64_t),
+        std::min(sizeof(uint64_t), size - i * sizeof(uint64_t)));
+    exemplar->request_id_[i].store(word, std::memory_order_relaxed);
+  }
+
+  exemplar->sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+bool
+LatencyHistogram::ReadExemplar(
+    const Exemplar& exemplar, ExemplarSnapshot* snapshot)
+{
+  for (int attempt = 0; attempt < kExemplarReadAttempts; ++attempt) {
+    const uint64_t sequence =
+        exemplar.sequence_.load(std::memory_order_acquire);
+    if (sequence == 0) {
+      return false;
+    }
+    if ((sequence & 1) != 0) {
+      continue;
+    }
+    snapshot->latency_us_ =
+        exemplar.latency_us_.load(std::memory_order_relaxed);
+    snapshot->timestamp_ns_ =
+        exemplar.timestamp_ns_.load(std::memory_order_relaxed);
+    snapshot->trace_id_ = exemplar.trace_id_.load(std::memory_order_relaxed);
+    const size_t size = std::min<size_t>(
+        exemplar.request_id_size_.load(std::memory_order_relaxed),
+        kRequestIdWords * sizeof(uint64_t));
+    char request_id[kRequestIdWords * sizeof(uint64_t)];
+    for (size_t i = 0; i * sizeof(uint64_t) < size; ++i) {
+      const uint64_t word =
+          exemplar.request_id_[i].load(std::memory_order_relaxed);
+      memcpy(request_id + i * sizeof(uint64_t), &word, sizeof(uint64_t));
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (exemplar.sequence_.load(std::memory_order_relaxed) == sequence) {
+      snapshot->request_id_.assign(request_id, size);
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string
+LatencyHistogram::FormatMetrics(
+    const std::map<std::string, std::shared_ptr<LatencyHistogram>>& histograms,
+    const bool with_exemplars)
+{
+  std::stringstream ss;
+  ss << "# HELP tds_request_latency_us Latency of the requests to the model "
+        "from the call to AsyncInfer or Infer to the response, in "
+        "microseconds"
+     << std::endl
+     << "# TYPE tds_request_latency_us histogram" << std::endl;
+  for (const auto& model : histograms) {
+    const LatencyHistogram& histogram = *model.second;
+    const std::string model_label = EscapeLabelValue(model.first);
+    uint64_t cumulative_count = 0;
+    for (size_t i = 0; i <= histogram.bounds_us_.size(); ++i) {
+      cumulative_count +=
+          histogram.counts_[i].load(std::memory_order_relaxed);
+      ss << "tds_request_latency_us_bucket{model=\"" << model_label
+         << "\",le=\""
+         << ((i < histogram.bounds_us_.size())
+                 ? std::to_string(histogram.bounds_us_[i])
+                 : std::string("+Inf"))
+         << "\"} " << cumulative_count;
+      // Only the exemplars that link to a request are exposed.
+      ExemplarSnapshot exemplar;
+      if (with_exemplars &&
+          ReadExemplar(histogram.exemplars_[i], &exemplar) &&
+          (!exemplar.request_id_.empty() || (exemplar.trace_id_ != 0))) {
+        ss << " # {";
+        if (!exemplar.request_id_.empty()) {
+          ss << "request_id=\"" << EscapeLabelValue(exemplar.request_id_)
+             << "\"" << ((exemplar.trace_id_ != 0) ? "," : "");
+        }
+        if (exemplar.trace_id_ != 0) {
+          ss << "trace_id=\"" << exemplar.trace_id_ << "\"";
+        }
+        ss << "} " << exemplar.latency_us_ << " "
+           << exemplar.timestamp_ns_ / 1000000000 << "." << std::setfill('0')
+           << std::setw(3) << (exemplar.timestamp_ns_ / 1000000) % 1000
+           << std::setfill(' ');
+      }
+      ss << std::endl;
+    }
+    ss << "tds_request_latency_us_sum{model=\"" << model_label << "\"} "
+       << histogram.sum_us_.load(std::memory_order_relaxed) << std::endl
+       << "tds_request_latency_us_count{model=\"" << model_label << "\"} "
+       << histogram.count_.load(std::memory_order_relaxed) << std::endl;
+  }
+  return ss.str();
+}
+
+}}}  // namespace triton::developer_tools::server
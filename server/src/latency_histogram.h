@@ -0,0 +1,106 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace triton { namespace developer_tools { namespace server {
+
+//==============================================================================
+/// The histogram of the latency of the requests to a model. Each bucket keeps
+/// the slowest recent request that fell in it as an exemplar, with the request
+/// ID and the trace ID if the request was traced, so that a spike in a bucket
+/// leads to a concrete request and its trace. Recording doesn't take a lock:
+/// an exemplar is written under a sequence number and a request that finds
+/// the exemplar being written by another thread is not kept.
+///
+class LatencyHistogram {
+ public:
+  // 'bounds_us' are the upper bounds of the buckets in microseconds, a last
+  // bucket without upper bound is added.
+  LatencyHistogram(const std::vector<uint64_t>& bounds_us);
+
+  // Record a request started at 'start_time' that completed now. 'trace_id'
+  // is 0 if the request was not traced.
+  void Record(
+      const std::chrono::steady_clock::time_point& start_time,
+      const std::string& request_id, const uint64_t trace_id);
+
+  // Return the histograms of each model, keyed by model name, in the
+  // Prometheus text format. If 'with_exemplars', the exemplars are appended to
+  // the buckets in the OpenMetrics syntax.
+  static std::string FormatMetrics(
+      const std::map<std::string, std::shared_ptr<LatencyHistogram>>&
+          histograms,
+      const bool with_exemplars);
+
+ private:
+  // The request ID is truncated to the bytes of 'kRequestIdWords' words.
+  static constexpr size_t kRequestIdWords = 8;
+
+  struct Exemplar {
+    // Odd while the exemplar is written.
+    std::atomic<uint64_t> sequence_;
+    std::atomic<uint64_t> latency_us_;
+    // The time since epoch the request completed at.
+    std::atomic<uint64_t> timestamp_ns_;
+    std::atomic<uint64_t> trace_id_;
+    std::atomic<uint64_t> request_id_size_;
+    std::atomic<uint64_t> request_id_[kRequestIdWords];
+  };
+
+  struct ExemplarSnapshot {
+    uint64_t latency_us_;
+    uint64_t timestamp_ns_;
+    uint64_t trace_id_;
+    std::string request_id_;
+  };
+
+  void WriteExemplar(
+      Exemplar* exemplar, const uint64_t latency_us, const uint64_t now_ns,
+      const std::string& request_id, const uint64_t trace_id);
+
+  // Return false if the bucket has no exemplar or the exemplar kept being
+  // written while read.
+  static bool ReadExemplar(
+      const Exemplar& exemplar, ExemplarSnapshot* snapshot);
+
+  const std::vector<uint64_t> bounds_us_;
+  // The count and the exemplar of each bucket, the last bucket has no upper
+  // bound.
+  std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+  std::unique_ptr<Exemplar[]> exemplars_;
+  std::atomic<uint64_t> sum_us_;
+  std::atomic<uint64_t> count_;
+};
+
+}}}  // namespace triton::developer_tools::server
@@ -0,0 +1,104 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "log.h"
+
+#include <chrono>
+
+namespace triton { namespace developer_tools { namespace server {
+
+constexpr int64_t LogRateLimiter::kWindowNs;
+constexpr uint32_t LogRateLimiter::kMessagesPerWindow;
+
+uint32_t
+RefreshLogLevels()
+{
+  uint32_t mask = 0;
+  for (const auto level :
+       {TRITONSERVER_LOG_INFO, TRITONSERVER_LOG_WARN, TRITONSERVER_LOG_ERROR,
+        TRITONSERVER_LOG_VERBOSE}) {
+    if (TRITONSERVER_LogIsEnabled(level)) {
+      mask |= 1u << level;
+    }
+  }
+  LogLevelMask().store(mask, std::memory_order_relaxed);
+  return mask;
+}
+
+void
+LogMessage(
+    const TRITONSERVER_LogLevel level, const char* file, const int line,
+    const char* message, const uint64_t suppressed_count)
+{
+  if (suppressed_count != 0) {
+    LogMessage(level, file, line, std::string(message), suppressed_count);
+    return;
+  }
+  TRITONSERVER_Error* err = TRITONSERVER_LogMessage(level, file, line, message);
+  if (err != nullptr) {
+    TRITONSERVER_ErrorDelete(err);
+  }
+}
+
+void
+LogMessage(
+    const TRITONSERVER_LogLevel level, const char* file, const int line,
+    const std::string& message, const uint64_t suppressed_count)
+{
+  if (suppressed_count == 0) {
+    LogMessage(level, file, line, message.c_str());
+    return;
+  }
+  LogMessage(
+      level, file, line,
+      (message + " (" + std::to_string(suppressed_count) +
+       " similar messages were suppressed)")
+          .c_str());
+}
+
+bool
+LogRateLimiter::Allow(uint64_t* suppressed_count)
+{
+  const int64_t now_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+  int64_t window_start_ns = window_start_ns_.load(std::memory_order_relaxed);
+  if ((now_ns - window_start_ns >= kWindowNs) &&
+      window_start_ns_.compare_exchange_strong(
+          window_start_ns, now_ns, std::memory_order_relaxed)) {
+    // Only the thread that starts the window resets the count.
+    count_.store(0, std::memory_order_relaxed);
+  }
+  if (count_.fetch_add(1, std::memory_order_relaxed) < kMessagesPerWindow) {
+    *suppressed_count = suppressed_.exchange(0, std::memory_order_relaxed);
+    return true;
+  }
+  suppressed_.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+}}}  // namespace triton::developer_tools::server
@@ -0,0 +1,171 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+
+#include "triton/core/tritonserver.h"
+#include "triton/developer_tools/common.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+//==============================================================================
+/// Logging of the wrapper. The macros check whether the level is enabled
+/// before the message is evaluated, so a disabled log site costs one relaxed
+/// atomic load rather than the formatting of the message. Verbose log sites
+/// are compiled out unless TRITON_ENABLE_VERBOSE_LOGGING is defined. Error
+/// and warning log sites are rate limited per site, so that an error storm
+/// doesn't turn into a logging storm.
+///
+
+// The bit of each level in the cached mask of enabled levels, and the value
+// of the mask before it is first read from the server.
+constexpr uint32_t kLogLevelsUnknown = 1u << 31;
+
+inline std::atomic<uint32_t>&
+LogLevelMask()
+{
+  static std::atomic<uint32_t> mask(kLogLevelsUnknown);
+  return mask;
+}
+
+// Read the enabled levels from the server and cache them. Called whenever
+// the log settings may have changed, i.e. when a server is created, since
+// the settings are global to the process.
+uint32_t RefreshLogLevels();
+
+// Return true if 'level' is enabled.
+inline bool
+LogEnabled(const TRITONSERVER_LogLevel level)
+{
+#ifndef TRITON_ENABLE_VERBOSE_LOGGING
+  if (level == TRITONSERVER_LOG_VERBOSE) {
+    return false;
+  }
+#endif  // TRITON_ENABLE_VERBOSE_LOGGING
+  uint32_t mask = LogLevelMask().load(std::memory_order_relaxed);
+  if ((mask & kLogLevelsUnknown) != 0) {
+    mask = RefreshLogLevels();
+  }
+  return (mask & (1u << level)) != 0;
+}
+
+// Log 'message'. If 'suppressed_count' is not 0, the number of messages of
+// the same site suppressed by the rate limit is appended.
+void LogMessage(
+    const TRITONSERVER_LogLevel level, const char* file, const int line,
+    const char* message, const uint64_t suppressed_count = 0);
+void LogMessage(
+    const TRITONSERVER_LogLevel level, const char* file, const int line,
+    const std::string& message, const uint64_t suppressed_count = 0);
+
+//==============================================================================
+/// Rate limit of a log site, which allows a burst of messages per second and
+/// counts the messages suppressed beyond it. Lock-free so that a suppressed
+/// message costs a clock read and a few relaxed atomic operations.
+///
+class LogRateLimiter {
+ public:
+  constexpr LogRateLimiter() : window_start_ns_(0), count_(0), suppressed_(0)
+  {
+  }
+
+  // Return true if a message may be logged, in which case
+  // '*suppressed_count' is set to the number of messages suppressed since the
+  // last logged message.
+  bool Allow(uint64_t* suppressed_count);
+
+ private:
+  static constexpr int64_t kWindowNs = 1000000000;
+  static constexpr uint32_t kMessagesPerWindow = 10;
+
+  std::atomic<int64_t> window_start_ns_;
+  std::atomic<uint32_t> count_;
+  std::atomic<uint64_t> suppressed_;
+};
+
+// Log 'MSG', a 'const char*' or 'std::string' expression, at 'LEVEL'. 'MSG'
+// is only evaluated if the level is enabled.
+#define LOG_MESSAGE(LEVEL, MSG)                                           \
+  do {                                                                    \
+    const TRITONSERVER_LogLevel lm_level__ = (LEVEL);                     \
+    if (::triton::developer_tools::server::LogEnabled(lm_level__)) {      \
+      uint64_t lm_suppressed__ = 0;                                       \
+      if ((lm_level__ == TRITONSERVER_LOG_ERROR) ||                       \
+          (lm_level__ == TRITONSERVER_LOG_WARN)) {                        \
+        static ::triton::developer_tools::server::LogRateLimiter          \
+            lm_limiter__;                                                 \
+        if (!lm_limiter__.Allow(&lm_suppressed__)) {                      \
+          break;                                                          \
+        }                                                                 \
+      }                                                                   \
+      ::triton::developer_tools::server::LogMessage(                      \
+          lm_level__, __FILE__, __LINE__, (MSG), lm_suppressed__);        \
+    }                                                                     \
+  } while (false)
+
+// Log 'X', a 'TRITONSERVER_Error*', as an error prefixed by 'MSG' if it is not
+// nullptr, and delete it.
+#define LOG_IF_ERROR(X, MSG)                                                 \
+  do {                                                                       \
+    TRITONSERVER_Error* lie_err__ = (X);                                     \
+    if (lie_err__ != nullptr) {                                              \
+      LOG_MESSAGE(                                                           \
+          TRITONSERVER_LOG_ERROR,                                            \
+          std::string(MSG) + ": " + TRITONSERVER_ErrorCodeString(lie_err__) + \
+              " - " + TRITONSERVER_ErrorMessage(lie_err__));                 \
+      TRITONSERVER_ErrorDelete(lie_err__);                                   \
+    }                                                                        \
+  } while (false)
+
+// Delete 'X', a 'TRITONSERVER_Error*', if it is not nullptr. For the errors
+// that are expected and not worth logging.
+#define IGNORE_ERROR(X)                   \
+  do {                                    \
+    TRITONSERVER_Error* ie_err__ = (X);   \
+    if (ie_err__ != nullptr) {            \
+      TRITONSERVER_ErrorDelete(ie_err__); \
+    }                                     \
+  } while (false)
+
+// Throw 'X', a 'TRITONSERVER_Error*', as a 'TritonException' if it is not
+// nullptr.
+#define THROW_IF_TRITON_ERR(X)                                     \
+  do {                                                             \
+    TRITONSERVER_Error* err__ = (X);                               \
+    if (err__ != nullptr) {                                        \
+      ::triton::developer_tools::server::TritonException ex(       \
+          TRITONSERVER_ErrorCodeString(err__) + std::string("-") + \
+          TRITONSERVER_ErrorMessage(err__) + "\n");                \
+      TRITONSERVER_ErrorDelete(err__);                             \
+      throw ex;                                                    \
+    }                                                              \
+  } while (false)
+
+}}}  // namespace triton::developer_tools::server
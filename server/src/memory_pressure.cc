@@ -0,0 +1,468 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "memory_pressure.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/magic.h>
+#include <sys/vfs.h>
+#endif  // __linux__
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "container_limits.h"
+#include "log.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+// The window of the PSI trigger. Unprivileged processes may only create
+// triggers with a window that is a multiple of 2 seconds.
+constexpr uint64_t kPsiTriggerWindowUs = 2000000;
+
+const char*
+MemoryPressureLevelString(const MemoryPressure::Level level)
+{
+  switch (level) {
+    case MemoryPressure::Level::NONE:
+      return "NONE";
+    case MemoryPressure::Level::TRIM:
+      return "TRIM";
+    case MemoryPressure::Level::LIMIT:
+      return "LIMIT";
+    case MemoryPressure::Level::SHED:
+      return "SHED";
+  }
+  return "UNKNOWN";
+}
+
+// Create a metric of 'family' with a single label, or return nullptr if it
+// can't be created.
+TRITONSERVER_Metric*
+NewMemoryPressureMetric(
+    TRITONSERVER_MetricFamily* family, const char* key, const char* value)
+{
+  TRITONSERVER_Parameter* label =
+      TRITONSERVER_ParameterNew(key, TRITONSERVER_PARAMETER_STRING, value);
+  const TRITONSERVER_Parameter* labels[] = {label};
+  TRITONSERVER_Metric* metric = nullptr;
+  LOG_IF_ERROR(
+      TRITONSERVER_MetricNew(&metric, family, labels, 1),
+      "Failed to create memory pressure metric");
+  TRITONSERVER_ParameterDelete(label);
+  return metric;
+}
+
+MemoryPressureMonitor::MemoryPressureMonitor(
+    const MemoryPressure& options, std::function<void()> trim)
+    : options_(options), trim_(std::move(trim)),
+      memory_events_path_(options.memory_events_path_),
+      level_(MemoryPressure::Level::NONE), in_flight_count_(0),
+      limited_count_(0), shed_count_(0), some_avg10_(0), full_avg10_(0),
+      high_event_count_(0), max_event_count_(0), oom_event_count_(0),
+      trigger_count_(0), trim_count_(0), has_events_(false), last_high_(0),
+      last_max_(0), last_oom_(0), wake_fds_{-1, -1}, level_family_(nullptr),
+      level_metric_(nullptr), avg10_family_(nullptr),
+      some_avg10_metric_(nullptr), full_avg10_metric_(nullptr),
+      actions_family_(nullptr), trim_metric_(nullptr), limit_metric_(nullptr),
+      shed_metric_(nullptr)
+{
+  if (memory_events_path_.empty()) {
+    memory_events_path_ =
+        CgroupMemoryEventsPath("/proc/self/cgroup", "/sys/fs/cgroup");
+  }
+
+  // The metrics can't be created if metrics are disabled in the server, the
+  // monitor still works without them.
+  TRITONSERVER_Error* err = TRITONSERVER_MetricFamilyNew(
+      &level_family_, TRITONSERVER_METRIC_KIND_GAUGE,
+      "tds_memory_pressure_level",
+      "Memory pressure level of the wrapper: 0 (none), 1 (trim), 2 (limit) "
+      "or 3 (shed)");
+  if (err == nullptr) {
+    err = TRITONSERVER_MetricNew(
+        &level_metric_, level_family_, nullptr /* labels */, 0);
+  }
+  if (err == nullptr) {
+    err = TRITONSERVER_MetricFamilyNew(
+        &avg10_family_, TRITONSERVER_METRIC_KIND_GAUGE,
+        "tds_memory_pressure_avg10",
+        "Percentage of time in the last 10 seconds tasks stalled on memory");
+  }
+  if (err == nullptr) {
+    err = TRITONSERVER_MetricFamilyNew(
+        &actions_family_, TRITONSERVER_METRIC_KIND_COUNTER,
+        "tds_memory_pressure_actions",
+        "Number of actions taken because of memory pressure");
+  }
+  if (err != nullptr) {
+    LOG_IF_ERROR(err, "Memory pressure metrics are not available");
+    return;
+  }
+  some_avg10_metric_ = NewMemoryPressureMetric(avg10_family_, "kind", "some");
+  full_avg10_metric_ = NewMemoryPressureMetric(avg10_family_, "kind", "full");
+  trim_metric_ = NewMemoryPressureMetric(actions_family_, "action", "trim");
+  limit_metric_ = NewMemoryPressureMetric(actions_family_, "action", "limit");
+  shed_metric_ = NewMemoryPressureMetric(actions_family_, "action", "shed");
+}
+
+MemoryPressureMonitor::~MemoryPressureMonitor()
+{
+  Stop();
+  for (int fd : wake_fds_) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+  for (auto metric :
+       {level_metric_, some_avg10_metric_, full_avg10_metric_, trim_metric_,
+        limit_metric_, shed_metric_}) {
+    if (metric != nullptr) {
+      LOG_IF_ERROR(
+          TRITONSERVER_MetricDelete(metric),
+          "Failed to delete memory pressure metric");
+    }
+  }
+  for (auto family : {level_family_, avg10_family_, actions_family_}) {
+    if (family != nullptr) {
+      LOG_IF_ERROR(
+          TRITONSERVER_MetricFamilyDelete(family),
+          "Failed to delete memory pressure metric family");
+    }
+  }
+}
+
+void
+MemoryPressureMonitor::Start(std::function<void()> thread_init)
+{
+  if (pipe(wake_fds_) != 0) {
+    wake_fds_[0] = wake_fds_[1] = -1;
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_ERROR, "Failed to start the memory pressure monitor");
+    return;
+  }
+  thread_ = std::thread([this, thread_init]() {
+    thread_init();
+    int trigger_fd = ArmTrigger();
+    Update(false /* triggered */);
+    while (true) {
+      struct pollfd fds[2] = {
+          {wake_fds_[0], POLLIN, 0}, {trigger_fd, POLLPRI, 0}};
+      const int ready =
+          poll(fds, (trigger_fd >= 0) ? 2 : 1, options_.interval_ms_);
+      if (fds[0].revents != 0) {
+        break;
+      }
+      bool triggered = false;
+      if ((ready > 0) && (trigger_fd >= 0)) {
+        if ((fds[1].revents & (POLLERR | POLLNVAL)) != 0) {
+          // The monitored cgroup is gone, fall back to reading the file.
+          close(trigger_fd);
+          trigger_fd = -1;
+        } else {
+          triggered = (fds[1].revents & POLLPRI) != 0;
+        }
+      }
+      Update(triggered);
+    }
+    if (trigger_fd >= 0) {
+      close(trigger_fd);
+    }
+  });
+}
+
+void
+MemoryPressureMonitor::Stop()
+{
+  if (thread_.joinable()) {
+    const char wake = 0;
+    while ((write(wake_fds_[1], &wake, 1) < 0) && (errno == EINTR)) {
+    }
+    thread_.join();
+  }
+}
+
+void
+MemoryPressureMonitor::Admit(const uint64_t priority)
+{
+  const MemoryPressure::Level level = level_.load(std::memory_order_relaxed);
+  if ((level >= MemoryPressure::Level::SHED) &&
+      ((priority == 0) || (priority > options_.shed_priority_))) {
+    shed_count_++;
+    IncrementActionMetric(shed_metric_);
+    throw TritonException(
+        "the request is rejected under memory pressure, only the requests "
+        "with a priority between 1 and " +
+        std::to_string(options_.shed_priority_) + " are accepted");
+  }
+  const uint64_t in_flight_count = ++in_flight_count_;
+  if ((level >= MemoryPressure::Level::LIMIT) &&
+      (in_flight_count > options_.max_in_flight_)) {
+    in_flight_count_--;
+    limited_count_++;
+    IncrementActionMetric(limit_metric_);
+    throw TritonException(
+        "the request is rejected under memory pressure, " +
+        std::to_string(options_.max_in_flight_) +
+        " requests are already in flight");
+  }
+}
+
+MemoryPressureStats
+MemoryPressureMonitor::Stats()
+{
+  MemoryPressureStats stats;
+  stats.level_ = level_;
+  stats.limited_count_ = limited_count_;
+  stats.shed_count_ = shed_count_;
+  stats.in_flight_count_ = in_flight_count_;
+  std::lock_guard<std::mutex> lk(mu_);
+  stats.some_avg10_ = some_avg10_;
+  stats.full_avg10_ = full_avg10_;
+  stats.high_event_count_ = high_event_count_;
+  stats.max_event_count_ = max_event_count_;
+  stats.oom_event_count_ = oom_event_count_;
+  stats.trigger_count_ = trigger_count_;
+  stats.trim_count_ = trim_count_;
+  return stats;
+}
+
+int
+MemoryPressureMonitor::ArmTrigger()
+{
+#ifdef __linux__
+  // Only the PSI files of procfs and cgroupfs support triggers, writing the
+  // trigger to a regular file would overwrite it.
+  struct statfs fs;
+  if ((statfs(options_.psi_path_.c_str(), &fs) != 0) ||
+      ((static_cast<uint64_t>(fs.f_type) != PROC_SUPER_MAGIC) &&
+       (static_cast<uint64_t>(fs.f_type) != CGROUP2_SUPER_MAGIC))) {
+    return -1;
+  }
+  const int fd =
+      open(options_.psi_path_.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  const uint64_t stall_us = std::min<uint64_t>(
+      std::max<uint64_t>(
+          options_.trim_threshold_ / 100 * kPsiTriggerWindowUs, 1),
+      kPsiTriggerWindowUs - 1);
+  const std::string trigger = "some " + std::to_string(stall_us) + " " +
+                              std::to_string(kPsiTriggerWindowUs);
+  // The trigger is written with its terminating null character.
+  if (write(fd, trigger.c_str(), trigger.size() + 1) < 0) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_VERBOSE,
+        "PSI triggers are not available on '" + options_.psi_path_ +
+            "', the memory pressure is read every " +
+            std::to_string(options_.interval_ms_) + " ms");
+    close(fd);
+    return -1;
+  }
+  return fd;
+#else
+  return -1;
+#endif  // __linux__
+}
+
+void
+MemoryPressureMonitor::Update(const bool triggered)
+{
+  double some_avg10 = 0;
+  double full_avg10 = 0;
+  ReadPressure(&some_avg10, &full_avg10);
+
+  MemoryPressure::Level target = MemoryPressure::Level::NONE;
+  if (some_avg10 >= options_.shed_threshold_) {
+    target = MemoryPressure::Level::SHED;
+  } else if (some_avg10 >= options_.limit_threshold_) {
+    target = MemoryPressure::Level::LIMIT;
+  } else if (triggered || (some_avg10 >= options_.trim_threshold_)) {
+    // The trigger fires before 'avg10' catches up with a sudden stall.
+    target = MemoryPressure::Level::TRIM;
+  }
+
+  // The event counts only ever increase, a new event raises the level.
+  uint64_t high = 0;
+  uint64_t max = 0;
+  uint64_t oom = 0;
+  uint64_t new_high = 0;
+  uint64_t new_max = 0;
+  uint64_t new_oom = 0;
+  if (ReadEvents(&high, &max, &oom)) {
+    if (has_events_) {
+      new_high = (high > last_high_) ? high - last_high_ : 0;
+      new_max = (max > last_max_) ? max - last_max_ : 0;
+      new_oom = (oom > last_oom_) ? oom - last_oom_ : 0;
+    }
+    has_events_ = true;
+    last_high_ = high;
+    last_max_ = max;
+    last_oom_ = oom;
+  }
+  if (new_oom != 0) {
+    target = MemoryPressure::Level::SHED;
+  } else if ((new_max != 0) && (target < MemoryPressure::Level::LIMIT)) {
+    target = MemoryPressure::Level::LIMIT;
+  } else if ((new_high != 0) && (target < MemoryPressure::Level::TRIM)) {
+    target = MemoryPressure::Level::TRIM;
+  }
+
+  // The level is raised right away but lowered one stage per interval, so
+  // that the service doesn't flap while the pressure hovers at a threshold.
+  const auto now = std::chrono::steady_clock::now();
+  const MemoryPressure::Level level = level_;
+  MemoryPressure::Level next = level;
+  if (target > level) {
+    next = target;
+  } else if (
+      (target < level) && (now - last_change_ >= std::chrono::milliseconds(
+                                                     options_.interval_ms_))) {
+    next = static_cast<MemoryPressure::Level>(static_cast<int>(level) - 1);
+  }
+  if (next != level) {
+    last_change_ = now;
+    level_ = next;
+  }
+
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    some_avg10_ = some_avg10;
+    full_avg10_ = full_avg10;
+    high_event_count_ += new_high;
+    max_event_count_ += new_max;
+    oom_event_count_ += new_oom;
+    if (triggered) {
+      trigger_count_++;
+    }
+    if (next > level) {
+      trim_count_++;
+    }
+  }
+  if (some_avg10_metric_ != nullptr) {
+    IGNORE_ERROR(TRITONSERVER_MetricSet(some_avg10_metric_, some_avg10));
+  }
+  if (full_avg10_metric_ != nullptr) {
+    IGNORE_ERROR(TRITONSERVER_MetricSet(full_avg10_metric_, full_avg10));
+  }
+  if (next == level) {
+    return;
+  }
+
+  SetLevelMetric(next);
+  LOG_MESSAGE(
+      (next > level) ? TRITONSERVER_LOG_WARN : TRITONSERVER_LOG_INFO,
+      std::string("Memory pressure level changed from ") +
+          MemoryPressureLevelString(level) + " to " +
+          MemoryPressureLevelString(next) + " (some avg10 " +
+          std::to_string(some_avg10) + ", full avg10 " +
+          std::to_string(full_avg10) + ")");
+  if (next > level) {
+    // Released on each raise since the memory cached again in between is
+    // likely to be needed more urgently.
+    trim_();
+    IncrementActionMetric(trim_metric_);
+  }
+}
+
+void
+MemoryPressureMonitor::ReadPressure(double* some_avg10, double* full_avg10)
+{
+  // Each line is "$KIND avg10=$AVG10 avg60=$AVG60 avg300=$AVG300
+  // total=$TOTAL", where $KIND is "some" or "full".
+  std::ifstream file(options_.psi_path_);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::stringstream ss(line);
+    std::string kind;
+    std::string avg10;
+    if (!(ss >> kind >> avg10) || (avg10.compare(0, 6, "avg10=") != 0)) {
+      continue;
+    }
+    try {
+      const double value = std::stod(avg10.substr(6));
+      if (kind == "some") {
+        *some_avg10 = value;
+      } else if (kind == "full") {
+        *full_avg10 = value;
+      }
+    }
+    catch (...) {
+      // Malformed line, the value is left unchanged.
+    }
+  }
+}
+
+bool
+MemoryPressureMonitor::ReadEvents(
+    uint64_t* high, uint64_t* max, uint64_t* oom)
+{
+  if (memory_events_path_.empty()) {
+    return false;
+  }
+  std::ifstream file(memory_events_path_);
+  if (!file) {
+    return false;
+  }
+  // Each line is "$EVENT $COUNT".
+  std::string event;
+  uint64_t count = 0;
+  while (file >> event >> count) {
+    if (event == "high") {
+      *high = count;
+    } else if (event == "max") {
+      *max = count;
+    } else if ((event == "oom") || (event == "oom_kill")) {
+      *oom += count;
+    }
+  }
+  return true;
+}
+
+void
+MemoryPressureMonitor::SetLevelMetric(const MemoryPressure::Level level)
+{
+  if (level_metric_ != nullptr) {
+    IGNORE_ERROR(
+        TRITONSERVER_MetricSet(level_metric_, static_cast<double>(level)));
+  }
+}
+
+void
+MemoryPressureMonitor::IncrementActionMetric(TRITONSERVER_Metric* metric)
+{
+  if (metric != nullptr) {
+    IGNORE_ERROR(TRITONSERVER_MetricIncrement(metric, 1));
+  }
+}
+
+}}}  // namespace triton::developer_tools::server
@@ -0,0 +1,139 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "triton/core/tritonserver.h"
+#include "triton/developer_tools/common.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+//==============================================================================
+/// Monitors the memory pressure of the host or of the cgroup and degrades the
+/// service in stages as it rises. See the 'MemoryPressure' structure for the
+/// levels. A thread waits on the PSI trigger, or polls the PSI file if
+/// triggers are not supported, and reads the cgroup memory events each time
+/// it wakes up. The requests check the level with a single atomic load.
+///
+class MemoryPressureMonitor {
+ public:
+  // 'trim' is called by the monitor thread each time the level is raised, to
+  // release the memory cached by the wrapper.
+  MemoryPressureMonitor(
+      const MemoryPressure& options, std::function<void()> trim);
+
+  ~MemoryPressureMonitor();
+
+  // Start the monitor thread. 'thread_init' is called at the start of the
+  // thread.
+  void Start(std::function<void()> thread_init);
+
+  // Stop and join the monitor thread.
+  void Stop();
+
+  MemoryPressure::Level Level() const { return level_; }
+
+  // Admit a request with 'priority' at the current level. Throw
+  // 'TritonException' if the request is rejected, otherwise the request is
+  // counted in flight until 'Complete' is called.
+  void Admit(const uint64_t priority);
+
+  void Complete() { in_flight_count_--; }
+
+  MemoryPressureStats Stats();
+
+ private:
+  // Arm a PSI trigger on 'psi_path_' if the file supports it. Return the file
+  // descriptor to poll for the trigger, or -1.
+  int ArmTrigger();
+
+  // Read the pressure and the events and update the level. 'triggered' is
+  // true if the PSI trigger fired since the last update.
+  void Update(const bool triggered);
+
+  // Read 'some avg10' and 'full avg10' from 'psi_path_'.
+  void ReadPressure(double* some_avg10, double* full_avg10);
+
+  // Read the 'high', 'max' and 'oom' plus 'oom_kill' counts from
+  // 'memory_events_path_'. Return false if the file can't be read.
+  bool ReadEvents(uint64_t* high, uint64_t* max, uint64_t* oom);
+
+  void SetLevelMetric(const MemoryPressure::Level level);
+  void IncrementActionMetric(TRITONSERVER_Metric* metric);
+
+  const MemoryPressure options_;
+  const std::function<void()> trim_;
+  std::string memory_events_path_;
+
+  std::atomic<MemoryPressure::Level> level_;
+  std::atomic<uint64_t> in_flight_count_;
+  std::atomic<uint64_t> limited_count_;
+  std::atomic<uint64_t> shed_count_;
+
+  // Updated by the monitor thread, read by 'Stats'.
+  std::mutex mu_;
+  double some_avg10_;
+  double full_avg10_;
+  uint64_t high_event_count_;
+  uint64_t max_event_count_;
+  uint64_t oom_event_count_;
+  uint64_t trigger_count_;
+  uint64_t trim_count_;
+
+  // Only used by the monitor thread. The event counts of the cgroup when last
+  // read, which are cumulative since the cgroup was created.
+  bool has_events_;
+  uint64_t last_high_;
+  uint64_t last_max_;
+  uint64_t last_oom_;
+  // The time the level last changed.
+  std::chrono::steady_clock::time_point last_change_;
+
+  // The pipe written to wake up the monitor thread when it is stopped.
+  int wake_fds_[2];
+  std::thread thread_;
+
+  // The metrics reported with the server metrics, nullptr if metrics are not
+  // available.
+  TRITONSERVER_MetricFamily* level_family_;
+  TRITONSERVER_Metric* level_metric_;
+  TRITONSERVER_MetricFamily* avg10_family_;
+  TRITONSERVER_Metric* some_avg10_metric_;
+  TRITONSERVER_Metric* full_avg10_metric_;
+  TRITONSERVER_MetricFamily* actions_family_;
+  TRITONSERVER_Metric* trim_metric_;
+  TRITONSERVER_Metric* limit_metric_;
+  TRITONSERVER_Metric* shed_metric_;
+};
+
+}}}  // namespace triton::developer_tools::server
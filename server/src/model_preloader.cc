@@ -0,0 +1,507 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "model_preloader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+
+#include "log.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+// The first word of a history file.
+constexpr char kTrafficHistoryMagic[] = "tds_traffic_history";
+
+ModelPreloader::ModelPreloader(
+    const ModelPreloading& options,
+    std::function<std::set<std::string>()> repository_models,
+    std::function<std::set<std::string>()> loaded_models,
+    std::function<void(const std::string&)> load_model,
+    std::function<void(const std::string&)> unload_model)
+    : options_(options),
+      bucket_count_(
+          (options.period_secs_ + options.bucket_secs_ - 1) /
+          options.bucket_secs_),
+      list_repository_models_(std::move(repository_models)),
+      loaded_models_(std::move(loaded_models)),
+      load_model_(std::move(load_model)),
+      unload_model_(std::move(unload_model)), bucket_(0), exiting_(false),
+      error_sum_(0), error_count_(0)
+{
+  LoadHistory();
+}
+
+ModelPreloader::~ModelPreloader()
+{
+  Stop();
+}
+
+void
+ModelPreloader::Start(std::function<void()> thread_init)
+{
+  RefreshRepositoryModels();
+  // The models loaded when the server starts are not cold starts.
+  std::set<std::string> loaded;
+  try {
+    loaded = loaded_models_();
+  }
+  catch (const TritonException& ex) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_WARN,
+        std::string("Failed to list the loaded models: ") + ex.what());
+  }
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    const auto now = std::chrono::steady_clock::now();
+    for (const auto& model_name : loaded) {
+      ModelTraffic& traffic = traffic_[model_name];
+      traffic.resident_ = true;
+      traffic.last_active_ = now;
+    }
+  }
+  bucket_start_ = std::chrono::system_clock::now();
+  const uint64_t now_secs = std::chrono::duration_cast<std::chrono::seconds>(
+                                bucket_start_.time_since_epoch())
+                                .count();
+  bucket_ = (now_secs % options_.period_secs_) / options_.bucket_secs_;
+
+  // Wake up often enough that a model is loaded close to 'lead_secs_' before
+  // its traffic, and right after the end of each bucket so that the requests
+  // of the next bucket are not counted in it.
+  const std::chrono::milliseconds wake_interval(
+      1000 * std::max<uint32_t>(
+                 1, std::min(
+                        options_.bucket_secs_, (options_.lead_secs_ == 0)
+                                                   ? options_.bucket_secs_
+                                                   : options_.lead_secs_) /
+                        4));
+  thread_ = std::thread([this, thread_init, wake_interval]() {
+    thread_init();
+    std::unique_lock<std::mutex> lk(mu_);
+    while (!exiting_) {
+      lk.unlock();
+      Update();
+      lk.lock();
+      const int64_t now_ms =
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              std::chrono::system_clock::now().time_since_epoch())
+              .count();
+      const int64_t bucket_ms = 1000 * int64_t(options_.bucket_secs_);
+      const std::chrono::milliseconds to_bucket_end(
+          bucket_ms - (now_ms % bucket_ms) + 1);
+      cv_.wait_for(lk, std::min(wake_interval, to_bucket_end), [this]() {
+        return exiting_;
+      });
+    }
+  });
+}
+
+void
+ModelPreloader::Stop()
+{
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    exiting_ = true;
+    cv_.notify_all();
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+    SaveHistory();
+  }
+}
+
+void
+ModelPreloader::Record(const std::string& model_name)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  auto it = traffic_.find(model_name);
+  if (it == traffic_.end()) {
+    // The unknown models are not tracked, so that a typo in a model name
+    // isn't kept in the traffic and in the history forever.
+    if (repository_models_.find(model_name) == repository_models_.end()) {
+      return;
+    }
+    it = traffic_.emplace(model_name, ModelTraffic()).first;
+  }
+  ModelTraffic& traffic = it->second;
+  traffic.count_++;
+  if (traffic.preloaded_ && !traffic.hit_) {
+    traffic.hit_ = true;
+    stats_.avoided_cold_start_count_++;
+  }
+  if (!traffic.resident_ && !traffic.cold_counted_) {
+    traffic.cold_counted_ = true;
+    stats_.cold_start_count_++;
+  }
+}
+
+void
+ModelPreloader::ModelLoaded(const std::string& model_name)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  auto it = traffic_.find(model_name);
+  if (it != traffic_.end()) {
+    it->second.resident_ = true;
+    it->second.preloaded_ = false;
+    it->second.cold_counted_ = false;
+  }
+}
+
+bool
+ModelPreloader::RefreshRepositoryModels()
+{
+  std::set<std::string> repository_models;
+  try {
+    repository_models = list_repository_models_();
+  }
+  catch (const TritonException& ex) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_WARN,
+        std::string("Failed to list the repository models: ") + ex.what());
+    return false;
+  }
+  std::lock_guard<std::mutex> lk(mu_);
+  repository_models_ = std::move(repository_models);
+  return true;
+}
+
+ModelPreloadingStats
+ModelPreloader::Stats()
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  ModelPreloadingStats stats = stats_;
+  stats.mean_absolute_error_ =
+      (error_count_ == 0) ? 0 : (error_sum_ / error_count_);
+  return stats;
+}
+
+void
+ModelPreloader::Update()
+{
+  const auto now = std::chrono::system_clock::now();
+  const auto steady_now = std::chrono::steady_clock::now();
+  const uint64_t now_secs =
+      std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch())
+          .count();
+  const size_t bucket = (now_secs % options_.period_secs_) /
+                        options_.bucket_secs_;
+  if (bucket != bucket_) {
+    // The requests recorded since the end of the bucket, within a
+    // millisecond or so, are attributed to it.
+    const auto bucket_end = std::chrono::system_clock::time_point(
+        std::chrono::seconds(now_secs - (now_secs % options_.bucket_secs_)));
+    const double duration_secs =
+        std::chrono::duration<double>(bucket_end - bucket_start_).count();
+    // A bucket the server only saw the end of is too short to tell its rate.
+    if (duration_secs >= options_.bucket_secs_ / 4.0) {
+      CloseBucket(bucket_, duration_secs);
+      SaveHistory();
+    } else {
+      std::lock_guard<std::mutex> lk(mu_);
+      for (auto& traffic : traffic_) {
+        traffic.second.count_ = 0;
+        traffic.second.last_count_ = 0;
+      }
+    }
+    bucket_ = bucket;
+    bucket_start_ = bucket_end;
+    budget_skipped_models_.clear();
+  }
+
+  const bool has_repository_models = RefreshRepositoryModels();
+  std::set<std::string> loaded;
+  try {
+    loaded = loaded_models_();
+  }
+  catch (const TritonException& ex) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_WARN,
+        std::string("Failed to list the loaded models: ") + ex.what());
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    // The models removed from the repositories are no longer tracked.
+    if (has_repository_models) {
+      for (auto it = traffic_.begin(); it != traffic_.end();) {
+        if ((repository_models_.find(it->first) == repository_models_.end()) &&
+            (loaded.find(it->first) == loaded.end())) {
+          it = traffic_.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+    for (auto& entry : traffic_) {
+      ModelTraffic& traffic = entry.second;
+      traffic.resident_ = (loaded.find(entry.first) != loaded.end());
+      if (traffic.resident_) {
+        traffic.cold_counted_ = false;
+      } else {
+        // Unloaded by the application.
+        traffic.preloaded_ = false;
+      }
+      if (traffic.count_ != traffic.last_count_) {
+        traffic.last_count_ = traffic.count_;
+        traffic.last_active_ = steady_now;
+      }
+    }
+    for (const auto& model_name : loaded) {
+      if (traffic_.find(model_name) == traffic_.end()) {
+        ModelTraffic& traffic = traffic_[model_name];
+        traffic.resident_ = true;
+        traffic.last_active_ = steady_now;
+      }
+    }
+  }
+
+  // Load the models expected soon, the highest rates first.
+  std::vector<std::pair<double, std::string>> candidates;
+  for (const auto& model : history_) {
+    if (loaded.find(model.first) == loaded.end()) {
+      const double rate = PredictedRate(model.first, now_secs);
+      if (rate >= options_.load_rate_) {
+        candidates.emplace_back(rate, model.first);
+      }
+    }
+  }
+  std::sort(candidates.rbegin(), candidates.rend());
+  for (const auto& candidate : candidates) {
+    const std::string& model_name = candidate.second;
+    if ((options_.max_loaded_models_ != 0) &&
+        (loaded.size() >= options_.max_loaded_models_)) {
+      if (budget_skipped_models_.insert(model_name).second) {
+        std::lock_guard<std::mutex> lk(mu_);
+        stats_.budget_skipped_count_++;
+      }
+      continue;
+    }
+    try {
+      load_model_(model_name);
+    }
+    catch (const TritonException& ex) {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_WARN,
+          "Failed to preload model '" + model_name + "': " + ex.what());
+      continue;
+    }
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_INFO, "Preloaded model '" + model_name + "'");
+    loaded.insert(model_name);
+    std::lock_guard<std::mutex> lk(mu_);
+    ModelTraffic& traffic = traffic_[model_name];
+    traffic.resident_ = true;
+    traffic.preloaded_ = true;
+    traffic.hit_ = false;
+    traffic.cold_counted_ = false;
+    traffic.last_active_ = steady_now;
+    stats_.preload_count_++;
+  }
+
+  // Unload the preloaded models that are idle and not expected soon.
+  std::vector<std::string> idle_models;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    for (const auto& entry : traffic_) {
+      const ModelTraffic& traffic = entry.second;
+      if (traffic.preloaded_ && traffic.resident_ &&
+          (steady_now - traffic.last_active_ >=
+           std::chrono::seconds(options_.idle_secs_)) &&
+          (PredictedRate(entry.first, now_secs) < options_.load_rate_)) {
+        idle_models.push_back(entry.first);
+      }
+    }
+  }
+  for (const auto& model_name : idle_models) {
+    try {
+      unload_model_(model_name);
+    }
+    catch (const TritonException& ex) {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_WARN,
+          "Failed to unload idle model '" + model_name + "': " + ex.what());
+      continue;
+    }
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_INFO, "Unloaded idle model '" + model_name + "'");
+    std::lock_guard<std::mutex> lk(mu_);
+    ModelTraffic& traffic = traffic_[model_name];
+    if (!traffic.hit_) {
+      stats_.wasted_preload_count_++;
+    }
+    traffic.resident_ = false;
+    traffic.preloaded_ = false;
+    stats_.unload_count_++;
+  }
+}
+
+void
+ModelPreloader::CloseBucket(const size_t bucket, const double duration_secs)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  for (const auto& entry : traffic_) {
+    history_.emplace(entry.first, std::vector<double>(bucket_count_, -1));
+  }
+  for (auto& model : history_) {
+    uint64_t count = 0;
+    auto it = traffic_.find(model.first);
+    if (it != traffic_.end()) {
+      count = it->second.count_;
+      it->second.count_ = 0;
+      it->second.last_count_ = 0;
+    }
+    const double observed = count / duration_secs;
+    double& rate = model.second[bucket];
+    if (rate < 0) {
+      rate = observed;
+      continue;
+    }
+    const bool predicted_used = (rate >= options_.load_rate_);
+    const bool used = (observed >= options_.load_rate_);
+    if (predicted_used && used) {
+      stats_.true_positive_count_++;
+    } else if (predicted_used) {
+      stats_.false_positive_count_++;
+    } else if (used) {
+      stats_.false_negative_count_++;
+    }
+    error_sum_ += std::fabs(rate - observed);
+    error_count_++;
+    rate = (1 - options_.smoothing_) * rate + options_.smoothing_ * observed;
+  }
+}
+
+double
+ModelPreloader::PredictedRate(
+    const std::string& model_name, const uint64_t now_secs) const
+{
+  const auto it = history_.find(model_name);
+  if (it == history_.end()) {
+    return -1;
+  }
+  double rate = -1;
+  const uint64_t end_secs = now_secs + options_.lead_secs_;
+  for (uint64_t secs = now_secs;; secs += options_.bucket_secs_) {
+    const uint64_t at_secs = std::min(secs, end_secs);
+    rate = std::max(
+        rate, it->second[(at_secs % options_.period_secs_) /
+                         options_.bucket_secs_]);
+    if (at_secs == end_secs) {
+      break;
+    }
+  }
+  return rate;
+}
+
+void
+ModelPreloader::LoadHistory()
+{
+  if (options_.history_path_.empty()) {
+    return;
+  }
+  std::ifstream file(options_.history_path_);
+  if (!file) {
+    return;
+  }
+  std::string line;
+  std::getline(file, line);
+  std::istringstream header(line);
+  std::string magic;
+  uint64_t period_secs = 0;
+  uint64_t bucket_secs = 0;
+  if (!(header >> magic >> period_secs >> bucket_secs) ||
+      (magic != kTrafficHistoryMagic)) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_WARN,
+        "Ignoring the traffic history '" + options_.history_path_ +
+            "', the file is not a traffic history");
+    return;
+  }
+  if ((period_secs != options_.period_secs_) ||
+      (bucket_secs != options_.bucket_secs_)) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_WARN,
+        "Ignoring the traffic history '" + options_.history_path_ +
+            "', it was recorded with another period or bucket duration");
+    return;
+  }
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    std::string model_name;
+    std::vector<double> rates(bucket_count_);
+    fields >> model_name;
+    for (auto& rate : rates) {
+      fields >> rate;
+    }
+    if (!model_name.empty() && fields) {
+      history_[model_name] = std::move(rates);
+    }
+  }
+}
+
+void
+ModelPreloader::SaveHistory()
+{
+  if (options_.history_path_.empty()) {
+    return;
+  }
+  // Write a new file and rename it over the old one so that a crash never
+  // leaves a partial history.
+  const std::string temp_path = options_.history_path_ + ".tmp";
+  {
+    std::ofstream file(temp_path);
+    file << kTrafficHistoryMagic << " " << options_.period_secs_ << " "
+         << options_.bucket_secs_ << "\n"
+         << std::setprecision(6);
+    for (const auto& model : history_) {
+      file << model.first;
+      for (const auto rate : model.second) {
+        file << " " << rate;
+      }
+      file << "\n";
+    }
+    if (!file.flush()) {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_WARN,
+          "Failed to write the traffic history '" + temp_path + "'");
+      return;
+    }
+  }
+  if (std::rename(temp_path.c_str(), options_.history_path_.c_str()) != 0) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_WARN,
+        "Failed to replace the traffic history '" + options_.history_path_ +
+            "'");
+  }
+}
+
+}}}  // namespace triton::developer_tools::server
@@ -0,0 +1,155 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "triton/developer_tools/common.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+//==============================================================================
+/// Loads the models ahead of their daily traffic and unloads them once idle.
+/// The requests of each model are counted per bucket of the cycle and the
+/// rate of each closed bucket is blended into a history that is saved to
+/// 'history_path_'. A thread wakes up a few times per bucket to close the
+/// bucket, compare the rates with the history, and load and unload models
+/// through the callbacks. See the 'ModelPreloading' structure for the rules.
+///
+class ModelPreloader {
+ public:
+  // The callbacks are called by the preloader thread only, they throw on
+  // failure. Only the models in 'repository_models' are tracked.
+  ModelPreloader(
+      const ModelPreloading& options,
+      std::function<std::set<std::string>()> repository_models,
+      std::function<std::set<std::string>()> loaded_models,
+      std::function<void(const std::string&)> load_model,
+      std::function<void(const std::string&)> unload_model);
+
+  ~ModelPreloader();
+
+  // Start the preloader thread. 'thread_init' is called at the start of the
+  // thread.
+  void Start(std::function<void()> thread_init);
+
+  // Stop and join the preloader thread and save the history.
+  void Stop();
+
+  // Count a request to 'model_name'. The requests to models that are not in
+  // the model repositories are ignored.
+  void Record(const std::string& model_name);
+
+  // Record that the application loaded 'model_name', which is then no longer
+  // unloaded when idle.
+  void ModelLoaded(const std::string& model_name);
+
+  ModelPreloadingStats Stats();
+
+ private:
+  struct ModelTraffic {
+    ModelTraffic()
+        : count_(0), last_count_(0), resident_(false), preloaded_(false),
+          hit_(false), cold_counted_(false)
+    {
+    }
+
+    // The requests in the current bucket and at the last wake up.
+    uint64_t count_;
+    uint64_t last_count_;
+    // The last wake up at which the model had new requests.
+    std::chrono::steady_clock::time_point last_active_;
+    // Whether the model was loaded at the last wake up.
+    bool resident_;
+    // Whether the model was loaded by the preloader and is still loaded, and
+    // whether it received a request since.
+    bool preloaded_;
+    bool hit_;
+    // Whether a request to the model was counted as a cold start since it
+    // was last loaded.
+    bool cold_counted_;
+  };
+
+  // Load the history from 'history_path_'. A missing file or a file of
+  // another cycle leaves the history empty.
+  void LoadHistory();
+  // Save the history to 'history_path_', replacing the file at once.
+  void SaveHistory();
+
+  // Run by the preloader thread at each wake up.
+  void Update();
+  // Refresh 'repository_models_', return false if the models can't be listed.
+  bool RefreshRepositoryModels();
+  // Blend the rates of 'bucket', which lasted 'duration_secs', into the
+  // history and compare them with the predictions.
+  void CloseBucket(const size_t bucket, const double duration_secs);
+  // Return the largest rate in the history of 'model_name' over the buckets
+  // from now to 'lead_secs_' ahead.
+  double PredictedRate(
+      const std::string& model_name, const uint64_t now_secs) const;
+
+  const ModelPreloading options_;
+  const size_t bucket_count_;
+  const std::function<std::set<std::string>()> list_repository_models_;
+  const std::function<std::set<std::string>()> loaded_models_;
+  const std::function<void(const std::string&)> load_model_;
+  const std::function<void(const std::string&)> unload_model_;
+
+  // Only used by the preloader thread. The rate of each model in each bucket
+  // of the cycle in requests per second, negative if never observed.
+  std::map<std::string, std::vector<double>> history_;
+  size_t bucket_;
+  std::chrono::system_clock::time_point bucket_start_;
+  // The models not preloaded in the current bucket because of
+  // 'max_loaded_models_'.
+  std::set<std::string> budget_skipped_models_;
+
+  // Guards the traffic, the statistics and the thread state.
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool exiting_;
+  std::unordered_map<std::string, ModelTraffic> traffic_;
+  // The models in the model repositories at the last wake up.
+  std::set<std::string> repository_models_;
+  ModelPreloadingStats stats_;
+  // The sum of the absolute differences between the rates in the history and
+  // the observed rates, and the number of differences summed.
+  double error_sum_;
+  uint64_t error_count_;
+  std::thread thread_;
+};
+
+}}}  // namespace triton::developer_tools::server
@@ -0,0 +1,192 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "model_startup.h"
+
+#include <utility>
+
+#include "triton/developer_tools/common.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+ModelStartupLoader::ModelStartupLoader(
+    TRITONSERVER_Server* server, const std::vector<std::string>& model_names,
+    std::function<void()> on_loaded)
+    : server_(server), model_names_(model_names),
+      on_loaded_(std::move(on_loaded)), exiting_(false),
+      remaining_count_(model_names.size())
+{
+  for (const auto& model_name : model_names_) {
+    models_[model_name];
+  }
+}
+
+ModelStartupLoader::~ModelStartupLoader()
+{
+  Stop();
+}
+
+void
+ModelStartupLoader::Start(std::function<void()> thread_init)
+{
+  thread_ = std::thread([this, thread_init]() {
+    thread_init();
+    for (const auto& model_name : model_names_) {
+      {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (exiting_) {
+          break;
+        }
+      }
+      std::string message;
+      TRITONSERVER_Error* err =
+          TRITONSERVER_ServerLoadModel(server_, model_name.c_str());
+      if (err != nullptr) {
+        message = std::string(TRITONSERVER_ErrorCodeString(err)) + "-" +
+                  TRITONSERVER_ErrorMessage(err);
+        TRITONSERVER_ErrorDelete(err);
+      }
+      on_loaded_();
+      Complete(model_name, message);
+    }
+
+    // The models that are not loaded because the server is being deleted.
+    std::vector<std::string> skipped_models;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      for (const auto& model : models_) {
+        if (!model.second.done_) {
+          skipped_models.push_back(model.first);
+        }
+      }
+    }
+    for (const auto& model_name : skipped_models) {
+      Complete(model_name, "the server is being deleted");
+    }
+  });
+}
+
+void
+ModelStartupLoader::Stop()
+{
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    exiting_ = true;
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+Future<void>
+ModelStartupLoader::ModelFuture(const std::string& model_name)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  auto it = models_.find(model_name);
+  if (it == models_.end()) {
+    return ReadyFuture(nullptr);
+  }
+  if (it->second.done_) {
+    return ReadyFuture(it->second.error_);
+  }
+  it->second.promises_.emplace_back();
+  return it->second.promises_.back().get_future();
+}
+
+Future<void>
+ModelStartupLoader::StartupFuture()
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  if (remaining_count_ == 0) {
+    return ReadyFuture(startup_error_);
+  }
+  startup_promises_.emplace_back();
+  return startup_promises_.back().get_future();
+}
+
+void
+ModelStartupLoader::Complete(
+    const std::string& model_name, const std::string& message)
+{
+  std::vector<Promise<void>> promises;
+  std::vector<Promise<void>> startup_promises;
+  std::exception_ptr error;
+  std::exception_ptr startup_error;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    ModelStatus& status = models_[model_name];
+    if (!message.empty()) {
+      status.error_ = std::make_exception_ptr(TritonException(
+          "Error - CreateAsync: failed to load model '" + model_name +
+          "': " + message));
+      failed_models_message_ += (failed_models_message_.empty() ? "'" : "; '") +
+                                model_name + "': " + message;
+    }
+    status.done_ = true;
+    error = status.error_;
+    promises.swap(status.promises_);
+    if (--remaining_count_ == 0) {
+      if (!failed_models_message_.empty()) {
+        startup_error_ = std::make_exception_ptr(TritonException(
+            "Error - CreateAsync: failed to load models: " +
+            failed_models_message_));
+      }
+      startup_error = startup_error_;
+      startup_promises.swap(startup_promises_);
+    }
+  }
+
+  // The futures are completed outside of the lock since their continuations
+  // run on this thread.
+  for (auto& promise : promises) {
+    if (error != nullptr) {
+      promise.set_exception(error);
+    } else {
+      promise.set_value();
+    }
+  }
+  for (auto& promise : startup_promises) {
+    if (startup_error != nullptr) {
+      promise.set_exception(startup_error);
+    } else {
+      promise.set_value();
+    }
+  }
+}
+
+Future<void>
+ModelStartupLoader::ReadyFuture(const std::exception_ptr& error)
+{
+  Promise<void> promise;
+  if (error != nullptr) {
+    promise.set_exception(error);
+  } else {
+    promise.set_value();
+  }
+  return promise.get_future();
+}
+
+}}}  // namespace triton::developer_tools::server
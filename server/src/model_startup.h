@@ -0,0 +1,110 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "triton/core/tritonserver.h"
+#include "triton/developer_tools/infer_future.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+//==============================================================================
+/// Loads the startup models of a server created by 'TritonServer::CreateAsync'
+/// in the background and completes the futures waiting for them. The server
+/// serializes explicit model loads, so the models are loaded one at a time in
+/// the given order by a single thread.
+///
+class ModelStartupLoader {
+ public:
+  // 'on_loaded' is called by the loader thread each time a model is loaded or
+  // fails to load, before its futures are completed.
+  ModelStartupLoader(
+      TRITONSERVER_Server* server, const std::vector<std::string>& model_names,
+      std::function<void()> on_loaded);
+
+  ~ModelStartupLoader();
+
+  // Start the loader thread. 'thread_init' is called at the start of the
+  // thread.
+  void Start(std::function<void()> thread_init);
+
+  // Stop and join the loader thread. The model being loaded, if any, is
+  // loaded to completion, the futures of the models that are not loaded yet
+  // are completed with an error.
+  void Stop();
+
+  // Return a future completed once 'model_name' is loaded. The future is
+  // ready if the model is not a startup model.
+  Future<void> ModelFuture(const std::string& model_name);
+
+  // Return a future completed once all the startup models are loaded.
+  Future<void> StartupFuture();
+
+ private:
+  struct ModelStatus {
+    ModelStatus() : done_(false) {}
+
+    bool done_;
+    // The error the model failed to load with, nullptr if it is loaded.
+    std::exception_ptr error_;
+    // The futures waiting for the model.
+    std::vector<Promise<void>> promises_;
+  };
+
+  // Record the result of loading 'model_name' and complete its futures, and
+  // the startup futures if it is the last model. 'message' is empty if the
+  // model is loaded.
+  void Complete(const std::string& model_name, const std::string& message);
+
+  // Return a future that is already completed with 'error', or with no error
+  // if nullptr.
+  static Future<void> ReadyFuture(const std::exception_ptr& error);
+
+  TRITONSERVER_Server* server_;
+  const std::vector<std::string> model_names_;
+  const std::function<void()> on_loaded_;
+
+  std::mutex mu_;
+  bool exiting_;
+  std::map<std::string, ModelStatus> models_;
+  size_t remaining_count_;
+  // The errors of the models that failed to load so far.
+  std::string failed_models_message_;
+  // The error of the startup once all the models are done, nullptr if they
+  // are all loaded.
+  std::exception_ptr startup_error_;
+  std::vector<Promise<void>> startup_promises_;
+  std::thread thread_;
+};
+
+}}}  // namespace triton::developer_tools::server
@@ -0,0 +1,118 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "output_usage.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+OutputUsageTracker::OutputUsageTracker(const uint32_t learning_window)
+    : learning_window_(learning_window), learned_response_count_(0),
+      pruning_(false), skipped_byte_size_per_request_(0),
+      pruned_request_count_(0), skipped_byte_size_(0), fallback_count_(0)
+{
+}
+
+void
+OutputUsageTracker::SelectOutputs(std::vector<std::string>* outputs)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  if (!pruning_ && (learned_response_count_ >= learning_window_) &&
+      !accessed_outputs_.empty()) {
+    pruning_ = true;
+    skipped_byte_size_per_request_ = 0;
+    for (const auto& output : output_byte_sizes_) {
+      if (accessed_outputs_.find(output.first) == accessed_outputs_.end()) {
+        skipped_byte_size_per_request_ +=
+            output.second.first / output.second.second;
+      }
+    }
+  }
+
+  if (pruning_) {
+    outputs->assign(accessed_outputs_.begin(), accessed_outputs_.end());
+    pruned_request_count_++;
+    skipped_byte_size_ += skipped_byte_size_per_request_;
+  }
+}
+
+void
+OutputUsageTracker::RecordResponse(
+    const std::unordered_map<std::string, std::shared_ptr<Tensor>>& outputs)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  if (pruning_) {
+    return;
+  }
+
+  for (const auto& output : outputs) {
+    auto& byte_size = output_byte_sizes_[output.first];
+    byte_size.first += output.second->byte_size_;
+    byte_size.second++;
+  }
+  learned_response_count_++;
+}
+
+void
+OutputUsageTracker::RecordAccess(const std::string& name, const bool found)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  if (!found &&
+      (output_byte_sizes_.find(name) == output_byte_sizes_.end())) {
+    // Not an output of the model.
+    return;
+  }
+
+  // A newly accessed output is not requested if already pruning, which may
+  // happen for results received before pruning started or for pruned results.
+  if (accessed_outputs_.insert(name).second && pruning_) {
+    Fallback();
+  }
+}
+
+void
+OutputUsageTracker::Fallback()
+{
+  pruning_ = false;
+  learned_response_count_ = 0;
+  fallback_count_++;
+}
+
+OutputPruningStats
+OutputUsageTracker::Stats()
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  OutputPruningStats stats;
+  stats.pruning_ = pruning_;
+  if (pruning_) {
+    stats.requested_outputs_ = accessed_outputs_;
+  }
+  stats.pruned_request_count_ = pruned_request_count_;
+  stats.skipped_byte_size_ = skipped_byte_size_;
+  stats.fallback_count_ = fallback_count_;
+  return stats;
+}
+
+}}}  // namespace triton::developer_tools::server
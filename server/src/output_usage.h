@@ -0,0 +1,87 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "triton/developer_tools/common.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+//==============================================================================
+/// Tracks which outputs of a model are accessed through 'InferResult' so that
+/// only those outputs are requested once the learning window is over. All
+/// outputs are returned while learning. If an output that is not requested is
+/// accessed, the tracker falls back to learning and the output will be
+/// requested from then on.
+///
+class OutputUsageTracker {
+ public:
+  OutputUsageTracker(const uint32_t learning_window);
+
+  // Select the outputs to be requested for a new inference request. 'outputs'
+  // is left empty if all outputs should be returned.
+  void SelectOutputs(std::vector<std::string>* outputs);
+
+  // Record the byte size of the outputs of a response received while
+  // learning. The sizes are used to estimate the bytes skipped by pruning.
+  void RecordResponse(
+      const std::unordered_map<std::string, std::shared_ptr<Tensor>>& outputs);
+
+  // Record an access to output 'name'. 'found' indicates whether the result
+  // contains the output.
+  void RecordAccess(const std::string& name, const bool found);
+
+  OutputPruningStats Stats();
+
+ private:
+  void Fallback();
+
+  std::mutex mu_;
+  const uint32_t learning_window_;
+  // The number of responses observed in the current learning window.
+  uint32_t learned_response_count_;
+  bool pruning_;
+  std::set<std::string> accessed_outputs_;
+  // The total byte size and the number of occurrences of each output observed
+  // while learning.
+  std::unordered_map<std::string, std::pair<uint64_t, uint64_t>>
+      output_byte_sizes_;
+  // The estimated byte size of the outputs skipped by each pruned request.
+  uint64_t skipped_byte_size_per_request_;
+
+  uint64_t pruned_request_count_;
+  uint64_t skipped_byte_size_;
+  uint64_t fallback_count_;
+};
+
+}}}  // namespace triton::developer_tools::server
@@ -0,0 +1,259 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "phase_counters.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif  // __linux__
+
+#include "log.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+//==============================================================================
+/// The counters of a thread, opened on the first read in the thread and
+/// closed when the thread exits. The counters are read as one group so that
+/// they cover the same interval.
+///
+class ThreadPhaseCounters {
+ public:
+  ThreadPhaseCounters();
+
+  ~ThreadPhaseCounters();
+
+  void Read(PhaseCounters::Sample* sample);
+
+ private:
+  int leader_fd_;
+  int fds_[PhaseCounters::EVENT_COUNT];
+  // The events in the order of their values in the group, and their number.
+  PhaseCounters::Event order_[PhaseCounters::EVENT_COUNT];
+  size_t opened_count_;
+};
+
+#ifdef __linux__
+int
+OpenPerfEvent(
+    const uint32_t type, const uint64_t config, const bool exclude_kernel,
+    const int group_fd)
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.exclude_kernel = exclude_kernel ? 1 : 0;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return syscall(
+      __NR_perf_event_open, &attr, 0 /* pid */, -1 /* cpu */, group_fd,
+      PERF_FLAG_FD_CLOEXEC);
+}
+#endif  // __linux__
+
+ThreadPhaseCounters::ThreadPhaseCounters() : leader_fd_(-1), opened_count_(0)
+{
+  for (auto& fd : fds_) {
+    fd = -1;
+  }
+#ifdef __linux__
+  struct EventConfig {
+    PhaseCounters::Event event_;
+    uint32_t type_;
+    uint64_t config_;
+  };
+  static const EventConfig configs[PhaseCounters::EVENT_COUNT] = {
+      {PhaseCounters::CYCLES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+      {PhaseCounters::INSTRUCTIONS, PERF_TYPE_HARDWARE,
+       PERF_COUNT_HW_INSTRUCTIONS},
+      {PhaseCounters::CACHE_MISSES, PERF_TYPE_HARDWARE,
+       PERF_COUNT_HW_CACHE_MISSES},
+      {PhaseCounters::CONTEXT_SWITCHES, PERF_TYPE_SOFTWARE,
+       PERF_COUNT_SW_CONTEXT_SWITCHES}};
+  int first_errno = 0;
+  for (const auto& config : configs) {
+    // Context switches happen in the kernel, which may not be counted by
+    // unprivileged processes, in which case the count stays 0.
+    const bool in_kernel = (config.event_ == PhaseCounters::CONTEXT_SWITCHES);
+    int fd =
+        OpenPerfEvent(config.type_, config.config_, !in_kernel, leader_fd_);
+    if ((fd < 0) && in_kernel) {
+      fd = OpenPerfEvent(config.type_, config.config_, true, leader_fd_);
+    }
+    if (fd < 0) {
+      if (first_errno == 0) {
+        first_errno = errno;
+      }
+      continue;
+    }
+    if (leader_fd_ < 0) {
+      leader_fd_ = fd;
+    }
+    fds_[config.event_] = fd;
+    order_[opened_count_++] = config.event_;
+  }
+
+  if (opened_count_ < PhaseCounters::EVENT_COUNT) {
+    // Reported once per process since the same counters are missing on every
+    // thread.
+    static std::atomic<bool> reported(false);
+    if (!reported.exchange(true)) {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_WARN,
+          std::string("Only ") + std::to_string(opened_count_) + " of " +
+              std::to_string(PhaseCounters::EVENT_COUNT) +
+              " phase counters could be opened: " + strerror(first_errno) +
+              ". Check '/proc/sys/kernel/perf_event_paranoid' and whether "
+              "the host exposes hardware counters.");
+    }
+  }
+#endif  // __linux__
+}
+
+ThreadPhaseCounters::~ThreadPhaseCounters()
+{
+  for (const auto fd : fds_) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
+
+void
+ThreadPhaseCounters::Read(PhaseCounters::Sample* sample)
+{
+  sample->valid_ = false;
+  if (leader_fd_ < 0) {
+    return;
+  }
+  struct {
+    uint64_t nr_;
+    uint64_t time_enabled_;
+    uint64_t time_running_;
+    uint64_t values_[PhaseCounters::EVENT_COUNT];
+  } group;
+  const ssize_t size = read(leader_fd_, &group, sizeof(group));
+  if ((size < ssize_t(3 * sizeof(uint64_t))) || (group.nr_ != opened_count_)) {
+    return;
+  }
+  for (auto& value : sample->values_) {
+    value = 0;
+  }
+  for (size_t i = 0; i < opened_count_; ++i) {
+    sample->values_[order_[i]] = group.values_[i];
+  }
+  sample->time_enabled_ = group.time_enabled_;
+  sample->time_running_ = group.time_running_;
+  sample->valid_ = true;
+}
+
+PhaseCounters::PhaseCounters()
+{
+  for (auto& totals : totals_) {
+    totals.count_ = 0;
+    for (auto& value : totals.values_) {
+      value = 0;
+    }
+  }
+}
+
+void
+PhaseCounters::Read(Sample* sample)
+{
+  static thread_local ThreadPhaseCounters thread_counters;
+  thread_counters.Read(sample);
+}
+
+void
+PhaseCounters::Add(const Phase phase, const Sample& start, const Sample& end)
+{
+  // The calls are counted even if the events can't be read so that the
+  // phases stay comparable across hosts.
+  Totals& totals = totals_[phase];
+  totals.count_.fetch_add(1, std::memory_order_relaxed);
+  if (!start.valid_ || !end.valid_) {
+    return;
+  }
+  const uint64_t enabled = end.time_enabled_ - start.time_enabled_;
+  const uint64_t running = end.time_running_ - start.time_running_;
+  if (running == 0) {
+    // The counters were not scheduled during the phase.
+    return;
+  }
+  // The counters are multiplexed if more events are opened than the PMU
+  // has counters for, the counts are scaled to the whole phase.
+  const double scale = double(enabled) / running;
+  for (int event = 0; event < EVENT_COUNT; ++event) {
+    const uint64_t delta = end.values_[event] - start.values_[event];
+    totals.values_[event].fetch_add(
+        uint64_t(delta * scale + 0.5), std::memory_order_relaxed);
+  }
+}
+
+std::map<std::string, PhaseCounterStats>
+PhaseCounters::Stats() const
+{
+  std::map<std::string, PhaseCounterStats> stats;
+  for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+    const Totals& totals = totals_[phase];
+    PhaseCounterStats& phase_stats = stats[PhaseName(Phase(phase))];
+    phase_stats.count_ = totals.count_.load(std::memory_order_relaxed);
+    phase_stats.cycles_ =
+        totals.values_[CYCLES].load(std::memory_order_relaxed);
+    phase_stats.instructions_ =
+        totals.values_[INSTRUCTIONS].load(std::memory_order_relaxed);
+    phase_stats.cache_misses_ =
+        totals.values_[CACHE_MISSES].load(std::memory_order_relaxed);
+    phase_stats.context_switches_ =
+        totals.values_[CONTEXT_SWITCHES].load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+const char*
+PhaseCounters::PhaseName(const Phase phase)
+{
+  switch (phase) {
+    case PREPARE:
+      return "prepare";
+    case RESPONSE:
+      return "response";
+    case OUTPUT_RELEASE:
+      return "output_release";
+    case TRACE:
+      return "trace";
+    default:
+      return "<invalid>";
+  }
+}
+
+}}}  // namespace triton::developer_tools::server
@@ -0,0 +1,125 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "triton/developer_tools/common.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+//==============================================================================
+/// Hardware performance counters read around the phases of the wrapper for
+/// one model. The counters are opened with 'perf_event_open' for each thread
+/// the first time it runs a measured phase, and only count the calling thread
+/// in user space, except for the context switches. The totals are updated
+/// with relaxed atomics so that measuring doesn't add a lock to the phases.
+///
+class PhaseCounters {
+ public:
+  enum Phase { PREPARE, RESPONSE, OUTPUT_RELEASE, TRACE, PHASE_COUNT };
+  enum Event {
+    CYCLES,
+    INSTRUCTIONS,
+    CACHE_MISSES,
+    CONTEXT_SWITCHES,
+    EVENT_COUNT
+  };
+
+  // The counter values of the calling thread at a point in time. Invalid if
+  // the counters of the thread could not be opened or read.
+  struct Sample {
+    bool valid_;
+    uint64_t time_enabled_;
+    uint64_t time_running_;
+    uint64_t values_[EVENT_COUNT];
+  };
+
+  PhaseCounters();
+
+  // Read the counters of the calling thread into 'sample'.
+  static void Read(Sample* sample);
+
+  // Count a call of 'phase' and add the counts between 'start' and 'end' to
+  // it if both samples are valid.
+  void Add(const Phase phase, const Sample& start, const Sample& end);
+
+  // Return the totals of each phase, keyed by the phase name.
+  std::map<std::string, PhaseCounterStats> Stats() const;
+
+  static const char* PhaseName(const Phase phase);
+
+ private:
+  struct Totals {
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> values_[EVENT_COUNT];
+  };
+
+  Totals totals_[PHASE_COUNT];
+};
+
+//==============================================================================
+/// Measure the scope it is declared in as 'phase' of 'counters'. Does nothing
+/// if 'counters' is nullptr, which is the case unless 'phase_counters_' is set
+/// in 'ServerOptions'.
+///
+class PhaseScope {
+ public:
+  PhaseScope(PhaseCounters* counters, const PhaseCounters::Phase phase)
+      : counters_(counters), phase_(phase)
+  {
+    if (counters_ != nullptr) {
+      PhaseCounters::Read(&start_);
+    }
+  }
+
+  ~PhaseScope()
+  {
+    if (counters_ != nullptr) {
+      // The counters of the thread can't be read at the end either if they
+      // couldn't be at the start, but the call is still counted.
+      PhaseCounters::Sample end;
+      end.valid_ = false;
+      if (start_.valid_) {
+        PhaseCounters::Read(&end);
+      }
+      counters_->Add(phase_, start_, end);
+    }
+  }
+
+  PhaseScope(const PhaseScope&) = delete;
+  PhaseScope& operator=(const PhaseScope&) = delete;
+
+ private:
+  PhaseCounters* counters_;
+  const PhaseCounters::Phase phase_;
+  PhaseCounters::Sample start_;
+};
+
+}}}  // namespace triton::developer_tools::server
@@ -0,0 +1,386 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "repo_fingerprint.h"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // __linux__
+
+#include <algorithm>
+
+#include "log.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+// The byte size of the parts of a file hashed by one task.
+constexpr int64_t kFingerprintSegmentByteSize = 16 * 1024 * 1024;
+// The byte size of each read of a segment.
+constexpr int64_t kFingerprintReadByteSize = 1024 * 1024;
+// The depth of the directories walked under a model directory, which bounds
+// the walk of a symbolic link loop.
+constexpr int kFingerprintMaxDepth = 16;
+constexpr uint64_t kFingerprintMultiplier = 0x9e3779b97f4a7c15ULL;
+
+uint64_t
+MixFingerprint(uint64_t hash)
+{
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+uint64_t
+CombineFingerprint(const uint64_t seed, const uint64_t value)
+{
+  return MixFingerprint(
+      seed ^ (value + kFingerprintMultiplier + (seed << 6) + (seed >> 2)));
+}
+
+// Hash 'byte_size' bytes at 'data' into 'seed'. The words are hashed in four
+// independent lanes so that the multiplications of consecutive words overlap.
+uint64_t
+HashFingerprintBytes(const char* data, const size_t byte_size, uint64_t seed)
+{
+  uint64_t lanes[4] = {seed, seed + kFingerprintMultiplier,
+                       seed ^ kFingerprintMultiplier, ~seed};
+  size_t i = 0;
+  for (; i + 32 <= byte_size; i += 32) {
+    for (size_t lane = 0; lane < 4; ++lane) {
+      uint64_t word;
+      memcpy(&word, data + i + lane * 8, sizeof(word));
+      lanes[lane] = (lanes[lane] ^ word) * kFingerprintMultiplier;
+      lanes[lane] ^= lanes[lane] >> 29;
+    }
+  }
+  uint64_t hash = byte_size;
+  for (size_t lane = 0; lane < 4; ++lane) {
+    hash = CombineFingerprint(hash, lanes[lane]);
+  }
+  for (; i < byte_size; ++i) {
+    hash = (hash ^ static_cast<uint8_t>(data[i])) * kFingerprintMultiplier;
+  }
+  return MixFingerprint(hash);
+}
+
+#ifdef __linux__
+struct RepositoryEntry {
+  std::string path_;
+  std::string relative_path_;
+  bool is_dir_;
+  int64_t byte_size_;
+  int64_t mtime_ns_;
+  uint64_t inode_;
+  uint64_t hash_;
+  // False if the content of the file couldn't be read.
+  bool readable_;
+};
+
+// Append the files and directories under 'dir' to 'entries', with their paths
+// relative to the model directory. Return false if a directory can't be read.
+bool
+ListRepositoryEntries(
+    const std::string& dir, const std::string& relative_dir, const int depth,
+    std::vector<RepositoryEntry>* entries)
+{
+  if (depth > kFingerprintMaxDepth) {
+    return false;
+  }
+  DIR* handle = opendir(dir.c_str());
+  if (handle == nullptr) {
+    return false;
+  }
+  bool listed = true;
+  for (struct dirent* entry = readdir(handle);
+       listed && (entry != nullptr); entry = readdir(handle)) {
+    const std::string name(entry->d_name);
+    if ((name == ".") || (name == "..")) {
+      continue;
+    }
+    RepositoryEntry repo_entry;
+    repo_entry.path_ = dir + "/" + name;
+    repo_entry.relative_path_ =
+        relative_dir.empty() ? name : (relative_dir + "/" + name);
+    repo_entry.hash_ = 0;
+    repo_entry.readable_ = true;
+    struct stat st;
+    if (stat(repo_entry.path_.c_str(), &st) == 0) {
+      repo_entry.is_dir_ = S_ISDIR(st.st_mode);
+      repo_entry.byte_size_ = repo_entry.is_dir_ ? 0 : st.st_size;
+      repo_entry.mtime_ns_ =
+          int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+      repo_entry.inode_ = st.st_ino;
+    } else {
+      // A dangling symbolic link, which is part of the fingerprint by name.
+      repo_entry.is_dir_ = false;
+      repo_entry.byte_size_ = -1;
+      repo_entry.mtime_ns_ = 0;
+      repo_entry.inode_ = 0;
+    }
+    entries->push_back(repo_entry);
+    if (repo_entry.is_dir_) {
+      listed = ListRepositoryEntries(
+          repo_entry.path_, repo_entry.relative_path_, depth + 1, entries);
+    }
+  }
+  closedir(handle);
+  return listed;
+}
+
+// Hash 'byte_size' bytes at 'offset' of the file at 'path' into '*hash'.
+// Return false if the file can't be read.
+bool
+HashFileSegment(
+    const std::string& path, const int64_t offset, const int64_t byte_size,
+    uint64_t* hash)
+{
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  std::vector<char> buffer(std::min(byte_size, kFingerprintReadByteSize));
+  *hash = offset;
+  int64_t read_byte_size = 0;
+  bool read = true;
+  while (read_byte_size < byte_size) {
+    const ssize_t count = pread(
+        fd, buffer.data(),
+        std::min<int64_t>(buffer.size(), byte_size - read_byte_size),
+        offset + read_byte_size);
+    if ((count < 0) && (errno == EINTR)) {
+      continue;
+    }
+    if (count <= 0) {
+      read = false;
+      break;
+    }
+    *hash = HashFingerprintBytes(buffer.data(), count, *hash);
+    read_byte_size += count;
+  }
+  close(fd);
+  return read;
+}
+#endif  // __linux__
+
+RepositoryFingerprint::RepositoryFingerprint(
+    const std::vector<std::string>& repository_paths,
+    std::shared_ptr<WorkExecutor> executor)
+    : repository_paths_(repository_paths), executor_(executor),
+      has_fingerprints_(false)
+{
+}
+
+bool
+RepositoryFingerprint::Update()
+{
+  bool complete = false;
+  std::vector<std::string> changed_models;
+  uint64_t hashed_file_count = 0;
+  uint64_t hashed_byte_size = 0;
+#ifdef __linux__
+  // The entries of each model directory, keyed by the name of the model.
+  std::map<std::string, std::vector<RepositoryEntry>> model_entries;
+  complete = true;
+  for (const auto& repository_path : repository_paths_) {
+    // Cloud storage is polled by the server through its own client.
+    if (repository_path.find("://") != std::string::npos) {
+      complete = false;
+      break;
+    }
+    DIR* handle = opendir(repository_path.c_str());
+    if (handle == nullptr) {
+      complete = false;
+      break;
+    }
+    std::vector<std::string> model_names;
+    for (struct dirent* entry = readdir(handle); entry != nullptr;
+         entry = readdir(handle)) {
+      const std::string name(entry->d_name);
+      struct stat st;
+      if ((name != ".") && (name != "..") &&
+          (stat((repository_path + "/" + name).c_str(), &st) == 0) &&
+          S_ISDIR(st.st_mode)) {
+        model_names.push_back(name);
+      }
+    }
+    closedir(handle);
+    for (const auto& name : model_names) {
+      complete &= ListRepositoryEntries(
+          repository_path + "/" + name, "", 0, &model_entries[name]);
+    }
+  }
+
+  if (complete) {
+    // Reuse the cached hash of the files that didn't change and split the
+    // others into segments hashed in parallel.
+    struct Segment {
+      RepositoryEntry* entry_;
+      int64_t offset_;
+      int64_t byte_size_;
+      uint64_t hash_;
+      bool read_;
+    };
+    std::vector<Segment> segments;
+    for (auto& model : model_entries) {
+      for (auto& entry : model.second) {
+        if (entry.is_dir_ || (entry.byte_size_ <= 0)) {
+          continue;
+        }
+        const auto it = files_.find(entry.path_);
+        if ((it != files_.end()) &&
+            (it->second.byte_size_ == entry.byte_size_) &&
+            (it->second.mtime_ns_ == entry.mtime_ns_) &&
+            (it->second.inode_ == entry.inode_)) {
+          entry.hash_ = it->second.hash_;
+          continue;
+        }
+        for (int64_t offset = 0; offset < entry.byte_size_;
+             offset += kFingerprintSegmentByteSize) {
+          segments.push_back(Segment{
+              &entry, offset,
+              std::min(kFingerprintSegmentByteSize, entry.byte_size_ - offset),
+              0, false});
+        }
+        hashed_file_count++;
+        hashed_byte_size += entry.byte_size_;
+      }
+    }
+    auto hash_segments = [&segments](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        Segment& segment = segments[i];
+        segment.read_ = HashFileSegment(
+            segment.entry_->path_, segment.offset_, segment.byte_size_,
+            &segment.hash_);
+      }
+    };
+    if ((executor_ != nullptr) && (segments.size() > 1)) {
+      executor_->ParallelFor(
+          0, segments.size(), 1, hash_segments, TaskPriority::BACKGROUND);
+    } else {
+      hash_segments(0, segments.size());
+    }
+    for (const auto& segment : segments) {
+      segment.entry_->hash_ =
+          CombineFingerprint(segment.entry_->hash_, segment.hash_);
+      if (!segment.read_) {
+        segment.entry_->readable_ = false;
+        complete = false;
+      }
+    }
+
+    std::map<std::string, FileState> files;
+    std::map<std::string, uint64_t> models;
+    for (auto& model : model_entries) {
+      std::vector<RepositoryEntry>& entries = model.second;
+      std::sort(
+          entries.begin(), entries.end(),
+          [](const RepositoryEntry& lhs, const RepositoryEntry& rhs) {
+            return lhs.relative_path_ < rhs.relative_path_;
+          });
+      uint64_t fingerprint =
+          HashFingerprintBytes(model.first.data(), model.first.size(), 0);
+      for (const auto& entry : entries) {
+        fingerprint = CombineFingerprint(
+            fingerprint, HashFingerprintBytes(
+                             entry.relative_path_.data(),
+                             entry.relative_path_.size(), entry.is_dir_));
+        fingerprint = CombineFingerprint(fingerprint, entry.byte_size_);
+        fingerprint = CombineFingerprint(fingerprint, entry.hash_);
+        if (!entry.is_dir_ && entry.readable_) {
+          files[entry.path_] = FileState{
+              entry.byte_size_, entry.mtime_ns_, entry.inode_, entry.hash_};
+        }
+      }
+      models[model.first] = fingerprint;
+    }
+
+    // Compare with the fingerprints of the last poll, both maps are sorted
+    // by name.
+    auto previous = models_.begin();
+    for (const auto& model : models) {
+      while ((previous != models_.end()) && (previous->first < model.first)) {
+        changed_models.push_back((previous++)->first);
+      }
+      if ((previous != models_.end()) && (previous->first == model.first)) {
+        if (!has_fingerprints_ || (previous->second != model.second)) {
+          changed_models.push_back(model.first);
+        }
+        ++previous;
+      } else {
+        changed_models.push_back(model.first);
+      }
+    }
+    for (; previous != models_.end(); ++previous) {
+      changed_models.push_back(previous->first);
+    }
+    std::sort(changed_models.begin(), changed_models.end());
+
+    files_.swap(files);
+    models_.swap(models);
+  }
+#endif  // __linux__
+
+  const bool poll = !complete || !has_fingerprints_ || !changed_models.empty();
+  // A repository that can't be fingerprinted is polled until it can.
+  has_fingerprints_ = complete;
+  if (!changed_models.empty()) {
+    std::string names;
+    for (const auto& name : changed_models) {
+      names += (names.empty() ? "" : ", ") + name;
+    }
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_VERBOSE,
+        "Polling the model repositories, changed models: " + names);
+  }
+
+  std::lock_guard<std::mutex> lock(mu_);
+  if (poll) {
+    stats_.poll_count_++;
+    stats_.changed_models_ = changed_models;
+  } else {
+    stats_.skipped_poll_count_++;
+  }
+  stats_.hashed_file_count_ += hashed_file_count;
+  stats_.hashed_byte_size_ += hashed_byte_size;
+  return poll;
+}
+
+RepositoryPollStats
+RepositoryFingerprint::Stats()
+{
+  std::lock_guard<std::mutex> lock(mu_);
+  return stats_;
+}
+
+}}}  // namespace triton::developer_tools::server
@@ -0,0 +1,84 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "triton/developer_tools/server_wrapper.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+//==============================================================================
+/// Content fingerprints of the model directories of local model repositories,
+/// used by the repository poll thread to skip the polls that would only see
+/// new modification times. The fingerprint of a model is the relative path,
+/// the size and a hash of the content of each file and directory under its
+/// directory. The hash of a file is cached with its size, modification time
+/// and inode, so a file is only read again when one of them changes, and the
+/// files to read are hashed in segments on the workers of the executor.
+///
+class RepositoryFingerprint {
+ public:
+  RepositoryFingerprint(
+      const std::vector<std::string>& repository_paths,
+      std::shared_ptr<WorkExecutor> executor);
+
+  // Fingerprint the repositories and return true if they must be polled:
+  // on the first call, if the fingerprint of a model changed or a model was
+  // added or removed, or if a repository can't be fingerprinted, e.g. it is
+  // not a local directory.
+  bool Update();
+
+  RepositoryPollStats Stats();
+
+ private:
+  struct FileState {
+    int64_t byte_size_;
+    int64_t mtime_ns_;
+    uint64_t inode_;
+    uint64_t hash_;
+  };
+
+  const std::vector<std::string> repository_paths_;
+  std::shared_ptr<WorkExecutor> executor_;
+
+  // Only used by the poll thread. The cached file hashes keyed by path and
+  // the fingerprints of the models when last polled.
+  bool has_fingerprints_;
+  std::map<std::string, FileState> files_;
+  std::map<std::string, uint64_t> models_;
+
+  // Updated by the poll thread, read by 'Stats'.
+  std::mutex mu_;
+  RepositoryPollStats stats_;
+};
+
+}}}  // namespace triton::developer_tools::server
@@ -0,0 +1,310 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "request_watchdog.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "log.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+RequestWatchdog::RequestWatchdog(const Watchdog& options)
+    : options_(options), min_threshold_ms_(options.threshold_ms_),
+      head_(nullptr), tail_(nullptr), in_flight_count_(0), stuck_count_(0),
+      cancelled_count_(0), exiting_(false), stuck_family_(nullptr),
+      in_flight_family_(nullptr), in_flight_metric_(nullptr)
+{
+  for (const auto& model : options_.model_threshold_ms_) {
+    if ((model.second != 0) &&
+        ((min_threshold_ms_ == 0) || (model.second < min_threshold_ms_))) {
+      min_threshold_ms_ = model.second;
+    }
+  }
+
+  // The metrics can't be created if metrics are disabled in the server, the
+  // watchdog still works without them.
+  TRITONSERVER_Error* err = TRITONSERVER_MetricFamilyNew(
+      &stuck_family_, TRITONSERVER_METRIC_KIND_COUNTER, "tds_stuck_requests",
+      "Number of inference requests in flight for longer than the watchdog "
+      "threshold");
+  if (err == nullptr) {
+    err = TRITONSERVER_MetricFamilyNew(
+        &in_flight_family_, TRITONSERVER_METRIC_KIND_GAUGE,
+        "tds_in_flight_requests",
+        "Number of inference requests in flight through the wrapper");
+  }
+  if (err == nullptr) {
+    err = TRITONSERVER_MetricNew(
+        &in_flight_metric_, in_flight_family_, nullptr /* labels */, 0);
+  }
+  if (err != nullptr) {
+    LOG_IF_ERROR(err, "Watchdog metrics are not available");
+  }
+}
+
+RequestWatchdog::~RequestWatchdog()
+{
+  Stop();
+  for (auto& metric : stuck_metrics_) {
+    LOG_IF_ERROR(
+        TRITONSERVER_MetricDelete(metric.second),
+        "Failed to delete watchdog metric");
+  }
+  if (in_flight_metric_ != nullptr) {
+    LOG_IF_ERROR(
+        TRITONSERVER_MetricDelete(in_flight_metric_),
+        "Failed to delete watchdog metric");
+  }
+  if (stuck_family_ != nullptr) {
+    LOG_IF_ERROR(
+        TRITONSERVER_MetricFamilyDelete(stuck_family_),
+        "Failed to delete watchdog metric family");
+  }
+  if (in_flight_family_ != nullptr) {
+    LOG_IF_ERROR(
+        TRITONSERVER_MetricFamilyDelete(in_flight_family_),
+        "Failed to delete watchdog metric family");
+  }
+}
+
+void
+RequestWatchdog::Start(std::function<void()> thread_init)
+{
+  if (min_threshold_ms_ == 0) {
+    // No model is watched.
+    return;
+  }
+  // Check often enough that a request is flagged within a quarter of the
+  // smallest threshold past it.
+  const std::chrono::milliseconds interval(
+      std::min<uint64_t>(std::max<uint64_t>(min_threshold_ms_ / 4, 10), 1000));
+  thread_ = std::thread([this, thread_init, interval]() {
+    thread_init();
+    std::unique_lock<std::mutex> lock(mu_);
+    while (!cv_.wait_for(lock, interval, [this]() { return exiting_; })) {
+      lock.unlock();
+      Check();
+      lock.lock();
+    }
+  });
+}
+
+void
+RequestWatchdog::Stop()
+{
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    exiting_ = true;
+    cv_.notify_all();
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+InFlightRequest*
+RequestWatchdog::Track(
+    TRITONSERVER_InferenceRequest* irequest, const std::string& model_name,
+    const std::string& request_id)
+{
+  auto it = options_.model_threshold_ms_.find(model_name);
+  const uint64_t threshold_ms = (it == options_.model_threshold_ms_.end())
+                                    ? options_.threshold_ms_
+                                    : it->second;
+  if (threshold_ms == 0) {
+    return nullptr;
+  }
+
+  InFlightRequest* request = new InFlightRequest();
+  request->next_ = nullptr;
+  request->watchdog_ = shared_from_this();
+  request->irequest_ = irequest;
+  request->model_name_ = model_name;
+  request->request_id_ = request_id;
+  request->threshold_ms_ = threshold_ms;
+  request->stuck_ = false;
+  request->ref_count_ = 2;
+
+  std::lock_guard<std::mutex> lk(mu_);
+  // The start time is taken under the lock so that the list stays ordered.
+  request->start_time_ = std::chrono::steady_clock::now();
+  request->prev_ = tail_;
+  if (tail_ != nullptr) {
+    tail_->next_ = request;
+  } else {
+    head_ = request;
+  }
+  tail_ = request;
+  in_flight_count_++;
+  return request;
+}
+
+void
+RequestWatchdog::Complete(InFlightRequest* request)
+{
+  RequestWatchdog* watchdog = request->watchdog_.get();
+  {
+    std::lock_guard<std::mutex> lk(watchdog->mu_);
+    if (request->prev_ != nullptr) {
+      request->prev_->next_ = request->next_;
+    } else {
+      watchdog->head_ = request->next_;
+    }
+    if (request->next_ != nullptr) {
+      request->next_->prev_ = request->prev_;
+    } else {
+      watchdog->tail_ = request->prev_;
+    }
+    watchdog->in_flight_count_--;
+  }
+  Unref(request);
+}
+
+void
+RequestWatchdog::Release(InFlightRequest* request)
+{
+  {
+    std::lock_guard<std::mutex> lk(request->watchdog_->mu_);
+    request->irequest_ = nullptr;
+  }
+  Unref(request);
+}
+
+void
+RequestWatchdog::Unref(InFlightRequest* request)
+{
+  if (request->ref_count_.fetch_sub(1) == 1) {
+    delete request;
+  }
+}
+
+WatchdogStats
+RequestWatchdog::Stats()
+{
+  WatchdogStats stats;
+  std::lock_guard<std::mutex> lk(mu_);
+  stats.in_flight_count_ = in_flight_count_;
+  stats.stuck_count_ = stuck_count_;
+  stats.cancelled_count_ = cancelled_count_;
+  if (head_ != nullptr) {
+    stats.oldest_in_flight_ms_ =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - head_->start_time_)
+            .count();
+  }
+  return stats;
+}
+
+void
+RequestWatchdog::Check()
+{
+  struct StuckRequest {
+    std::string model_name_;
+    std::string request_id_;
+    uint64_t elapsed_ms_;
+    bool cancelled_;
+  };
+  std::vector<StuckRequest> stuck_requests;
+  uint64_t in_flight_count = 0;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    in_flight_count = in_flight_count_;
+    const auto now = std::chrono::steady_clock::now();
+    // The list is ordered by start time, so the walk stops at the first
+    // request younger than the smallest threshold.
+    for (InFlightRequest* request = head_; request != nullptr;
+         request = request->next_) {
+      const uint64_t elapsed_ms =
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              now - request->start_time_)
+              .count();
+      if (elapsed_ms < min_threshold_ms_) {
+        break;
+      }
+      if (request->stuck_ || (elapsed_ms < request->threshold_ms_)) {
+        continue;
+      }
+      request->stuck_ = true;
+      stuck_count_++;
+      bool cancelled = false;
+      if ((options_.action_ == Watchdog::Action::CANCEL) &&
+          (request->irequest_ != nullptr)) {
+        TRITONSERVER_Error* err =
+            TRITONSERVER_InferenceRequestCancel(request->irequest_);
+        cancelled = (err == nullptr);
+        LOG_IF_ERROR(err, "Failed to cancel stuck inference request");
+        if (cancelled) {
+          cancelled_count_++;
+        }
+      }
+      stuck_requests.push_back(
+          {request->model_name_, request->request_id_, elapsed_ms, cancelled});
+    }
+  }
+
+  // Log and update the metrics outside of the lock so that the requests are
+  // not delayed.
+  for (const auto& stuck : stuck_requests) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_WARN,
+        "Inference request '" + stuck.request_id_ + "' of model '" +
+            stuck.model_name_ + "' has been in flight for " +
+            std::to_string(stuck.elapsed_ms_) + " ms" +
+            (stuck.cancelled_ ? ", cancelled." : "."));
+    IncrementStuckMetric(stuck.model_name_);
+  }
+  if (in_flight_metric_ != nullptr) {
+    IGNORE_ERROR(TRITONSERVER_MetricSet(in_flight_metric_, in_flight_count));
+  }
+}
+
+void
+RequestWatchdog::IncrementStuckMetric(const std::string& model_name)
+{
+  if (stuck_family_ == nullptr) {
+    return;
+  }
+  auto it = stuck_metrics_.find(model_name);
+  if (it == stuck_metrics_.end()) {
+    TRITONSERVER_Parameter* label = TRITONSERVER_ParameterNew(
+        "model", TRITONSERVER_PARAMETER_STRING, model_name.c_str());
+    const TRITONSERVER_Parameter* labels[] = {label};
+    TRITONSERVER_Metric* metric = nullptr;
+    TRITONSERVER_Error* err =
+        TRITONSERVER_MetricNew(&metric, stuck_family_, labels, 1);
+    TRITONSERVER_ParameterDelete(label);
+    if (err != nullptr) {
+      LOG_IF_ERROR(err, "Failed to create watchdog metric");
+      return;
+    }
+    it = stuck_metrics_.emplace(model_name, metric).first;
+  }
+  IGNORE_ERROR(TRITONSERVER_MetricIncrement(it->second, 1));
+}
+
+}}}  // namespace triton::developer_tools::server
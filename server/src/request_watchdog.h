@@ -0,0 +1,133 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "triton/core/tritonserver.h"
+#include "triton/developer_tools/common.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+class RequestWatchdog;
+
+//==============================================================================
+/// An inference request in flight, linked into the list of 'RequestWatchdog'.
+/// The entry is shared by the response callback, which completes it when the
+/// final response is received, and the request release callback, which clears
+/// 'irequest_'. It is deleted once both are done.
+///
+struct InFlightRequest {
+  InFlightRequest* prev_;
+  InFlightRequest* next_;
+  std::shared_ptr<RequestWatchdog> watchdog_;
+  // The request in the server, nullptr once it is released. Protected by the
+  // mutex of the watchdog.
+  TRITONSERVER_InferenceRequest* irequest_;
+  std::string model_name_;
+  std::string request_id_;
+  uint64_t threshold_ms_;
+  std::chrono::steady_clock::time_point start_time_;
+  bool stuck_;
+  std::atomic<int> ref_count_;
+};
+
+//==============================================================================
+/// Keeps the inference requests in flight in a list ordered by submission
+/// time, so that tracking a request costs one insertion and one removal. A
+/// thread periodically walks the list from the oldest request and flags the
+/// requests that exceed the threshold of their model.
+///
+class RequestWatchdog : public std::enable_shared_from_this<RequestWatchdog> {
+ public:
+  RequestWatchdog(const Watchdog& options);
+
+  ~RequestWatchdog();
+
+  // Start the watchdog thread. 'thread_init' is called at the start of the
+  // thread.
+  void Start(std::function<void()> thread_init);
+
+  // Stop and join the watchdog thread.
+  void Stop();
+
+  // Start tracking 'irequest' submitted for 'model_name'. Return nullptr if
+  // the model is not watched.
+  InFlightRequest* Track(
+      TRITONSERVER_InferenceRequest* irequest, const std::string& model_name,
+      const std::string& request_id);
+
+  // Stop tracking the request when its final response is received or when it
+  // failed to be submitted.
+  static void Complete(InFlightRequest* request);
+
+  // Record that the request is released by the server, after which it can't
+  // be cancelled.
+  static void Release(InFlightRequest* request);
+
+  WatchdogStats Stats();
+
+ private:
+  static void Unref(InFlightRequest* request);
+
+  // Flag the requests that exceed their threshold.
+  void Check();
+
+  // Increment the 'tds_stuck_requests' metric of 'model_name'.
+  void IncrementStuckMetric(const std::string& model_name);
+
+  const Watchdog options_;
+  // The smallest threshold, requests younger than it are not checked.
+  uint64_t min_threshold_ms_;
+
+  std::mutex mu_;
+  InFlightRequest* head_;
+  InFlightRequest* tail_;
+  uint64_t in_flight_count_;
+  uint64_t stuck_count_;
+  uint64_t cancelled_count_;
+
+  bool exiting_;
+  std::condition_variable cv_;
+  std::thread thread_;
+
+  // The metrics reported with the server metrics, nullptr if metrics are not
+  // available. Only used by the watchdog thread.
+  TRITONSERVER_MetricFamily* stuck_family_;
+  std::map<std::string, TRITONSERVER_Metric*> stuck_metrics_;
+  TRITONSERVER_MetricFamily* in_flight_family_;
+  TRITONSERVER_Metric* in_flight_metric_;
+};
+
+}}}  // namespace triton::developer_tools::server
@@ -26,8 +26,16 @@
 
 #include "triton/developer_tools/server_wrapper.h"
 
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif  // __GLIBC__
 #include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif  // __SSE2__
 
+#include <algorithm>
 #include <iostream>
 #include <mutex>
 #include <sstream>
@@ -40,26 +48,26 @@
 #define TRITONJSON_STATUSSUCCESS nullptr
 #include "triton/common/triton_json.h"
 
+#include "container_limits.h"
+#include "health_cache.h"
+#include "latency_histogram.h"
+#include "log.h"
+#include "memory_pressure.h"
+#include "model_preloader.h"
+#include "model_startup.h"
+#include "output_usage.h"
+#include "phase_counters.h"
+#include "repo_fingerprint.h"
+#include "request_watchdog.h"
+#include "shadow_mirror.h"
+#include "slo_tracker.h"
+#include "sparse_input.h"
+#include "stats_publisher.h"
+#include "topology.h"
+#include "work_executor.h"
+
 namespace triton { namespace developer_tools { namespace server {
 
-#define THROW_IF_TRITON_ERR(X)                                     \
-  do {                                                             \
-    TRITONSERVER_Error* err__ = (X);                               \
-    if (err__ != nullptr) {                                        \
-      TritonException ex(                                          \
-          TRITONSERVER_ErrorCodeString(err__) + std::string("-") + \
-          TRITONSERVER_ErrorMessage(err__) + "\n");                \
-      TRITONSERVER_ErrorDelete(err__);                             \
-      throw ex;                                                    \
-    }                                                              \
-  } while (false)
-#define IGNORE_ERROR(X)                   \
-  do {                                    \
-    TRITONSERVER_Error* ie_err__ = (X);   \
-    if (ie_err__ != nullptr) {            \
-      TRITONSERVER_ErrorDelete(ie_err__); \
-    }                                     \
-  } while (false)
 #define RETURN_IF_ERR(X)           \
   {                                \
     Error err = (X);               \
@@ -67,26 +75,10 @@ namespace triton { namespace developer_tools { namespace server {
       return Error(err.Message()); \
     }                              \
   }
-#define LOG_IF_ERROR(X, MSG)                                                   \
-  do {                                                                         \
-    TRITONSERVER_Error* lie_err__ = (X);                                       \
-    if (lie_err__ != nullptr) {                                                \
-      IGNORE_ERROR(TRITONSERVER_LogMessage(                                    \
-          TRITONSERVER_LOG_ERROR, __FILE__, __LINE__,                          \
-          (std::string(MSG) + ": " + TRITONSERVER_ErrorCodeString(lie_err__) + \
-           " - " + TRITONSERVER_ErrorMessage(lie_err__))                       \
-              .c_str()));                                                      \
-      TRITONSERVER_ErrorDelete(lie_err__);                                     \
-    }                                                                          \
-  } while (false)
-#define LOG_MESSAGE(LEVEL, MSG)                                  \
-  do {                                                           \
-    LOG_IF_ERROR(                                                \
-        TRITONSERVER_LogMessage(LEVEL, __FILE__, __LINE__, MSG), \
-        ("failed to log message: "));                            \
-  } while (false)
 
 using AllocInfo = std::pair<std::shared_ptr<Allocator>, TensorAllocMap>;
+using SloTrackers =
+    std::unordered_map<std::string, std::shared_ptr<SloTracker>>;
 
 //==============================================================================
 /// Helper functions
@@ -130,6 +122,70 @@ DataTypeString(const DataType& data_type)
   return "<invalid>";
 }
 
+size_t
+DataTypeByteSize(const DataType& data_type)
+{
+  switch (data_type) {
+    case DataType::BOOL:
+    case DataType::UINT8:
+    case DataType::INT8:
+      return 1;
+    case DataType::UINT16:
+    case DataType::INT16:
+    case DataType::FP16:
+    case DataType::BF16:
+      return 2;
+    case DataType::UINT32:
+    case DataType::INT32:
+    case DataType::FP32:
+      return 4;
+    case DataType::UINT64:
+    case DataType::INT64:
+    case DataType::FP64:
+      return 8;
+    default:
+      break;
+  }
+
+  // 'BYTES' and 'INVALID' do not have a fixed element size.
+  return 0;
+}
+
+// The total byte size of the gathered output above which the copy is split
+// across threads, and the minimum byte size to be copied by each thread.
+constexpr size_t kGatherParallelByteSize = 4 * 1024 * 1024;
+// The total byte size of the gathered output above which the copy bypasses
+// the cache as the output will not fit in the cache anyway.
+constexpr size_t kGatherNonTemporalByteSize = 8 * 1024 * 1024;
+
+// Copy 'byte_size' bytes from 'src' to 'dst' with non-temporal stores where
+// supported. '_mm_sfence' must be called before the data is read by another
+// thread.
+void
+StreamCopy(char* dst, const char* src, size_t byte_size)
+{
+#ifdef __SSE2__
+  // Copy the head with regular stores so that the streaming stores are
+  // aligned.
+  size_t head = (16 - (reinterpret_cast<uintptr_t>(dst) & 15)) & 15;
+  head = std::min(head, byte_size);
+  memcpy(dst, src, head);
+  dst += head;
+  src += head;
+  byte_size -= head;
+
+  const size_t count = byte_size / 16;
+  for (size_t i = 0; i < count; ++i) {
+    _mm_stream_si128(
+        reinterpret_cast<__m128i*>(dst) + i,
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src) + i));
+  }
+  memcpy(dst + count * 16, src + count * 16, byte_size - count * 16);
+#else
+  memcpy(dst, src, byte_size);
+#endif  // __SSE2__
+}
+
 std::string
 MemoryTypeString(const MemoryType& memory_type)
 {
@@ -336,6 +392,66 @@ HostPolicySettingString(const HostPolicy::Setting& setting)
   }
 }
 
+std::string
+HostLayoutString(
+    const std::vector<NumaNode>& numa_nodes,
+    const std::vector<HostPolicy>& host_policy, const NumaNode* wrapper_node)
+{
+  std::string layout = "Host layout: NUMA nodes [";
+  for (size_t i = 0; i < numa_nodes.size(); ++i) {
+    layout += (i == 0 ? "" : ", ") + std::to_string(numa_nodes[i].id_) +
+              " (CPUs " + numa_nodes[i].cpus_ + ")";
+  }
+  layout += "], host policies [";
+  for (size_t i = 0; i < host_policy.size(); ++i) {
+    layout +=
+        (i == 0 ? "" : ", ") + host_policy[i].name_ + " " +
+        HostPolicySettingString(host_policy[i].setting_) + "=" +
+        host_policy[i].value_;
+  }
+  layout += "], wrapper threads ";
+  if (wrapper_node != nullptr) {
+    layout += "pinned to NUMA node " + std::to_string(wrapper_node->id_) +
+              " (CPUs " + wrapper_node->cpus_ + ")";
+  } else {
+    layout += "not pinned";
+  }
+  return layout;
+}
+
+std::string
+ResourceReportString(
+    const ContainerLimits& limits, const ServerOptions& options)
+{
+  std::stringstream report;
+  report << "Container limits: ";
+  if (limits.cgroup_version_ == 0) {
+    report << "no cgroup";
+  } else {
+    report << "cgroup v" << limits.cgroup_version_;
+  }
+  report << ", CPU quota ";
+  if (limits.cpu_quota_ > 0) {
+    report << limits.cpu_quota_;
+  } else {
+    report << "unlimited";
+  }
+  report << ", cpuset " << limits.cpuset_cpu_count_ << " CPUs, memory limit ";
+  if (limits.memory_limit_byte_size_ > 0) {
+    report << limits.memory_limit_byte_size_ << " bytes";
+  } else {
+    report << "unlimited";
+  }
+  report << "; effective resources: " << limits.effective_cpu_count_
+         << " CPUs, model load threads "
+         << std::max(1u, options.model_load_thread_count_)
+         << ", buffer manager threads "
+         << std::max(0, options.buffer_manager_thread_count_)
+         << ", pinned memory pool " << options.pinned_memory_pool_byte_size_
+         << " bytes";
+  return report.str();
+}
+
 TRITONSERVER_InferenceTraceLevel
 ToTritonTraceLevel(const Trace::Level& level)
 {
@@ -375,6 +491,24 @@ struct ResponseParameters {
   const void* vvalue_;
 };
 
+//==============================================================================
+/// Constant inputs bound to a model via 'TritonServer::BindConstantInput'. The
+/// object is not modified once it is published to 'TritonServer', binding or
+/// unbinding an input creates a new object so that the requests holding the
+/// previous one are not affected.
+class BoundInputs {
+ public:
+  struct Input {
+    std::string name_;
+    std::unique_ptr<char[]> buffer_;
+    size_t byte_size_;
+    TRITONSERVER_DataType data_type_;
+    std::vector<int64_t> shape_;
+  };
+
+  std::vector<std::shared_ptr<const Input>> inputs_;
+};
+
 //==============================================================================
 /// InternalServer class
 ///
@@ -405,27 +539,74 @@ class InternalServer : public TritonServer {
 
   bool IsModelDecoupled(const InferRequest& infer_request);
 
-  std::future<std::unique_ptr<InferResult>> GetInferResult(
+  // Return 'result' to the future of the first result of 'request' if not
+  // returned yet, otherwise to the future of the next result.
+  static void SetResult(
+      InferRequest* request, std::unique_ptr<InferResult>&& result);
+
+  InferFuture GetInferResult(
       InferRequest& infer_request, TRITONSERVER_InferenceRequest* irequest,
       TRITONSERVER_InferenceTrace* triton_trace);
 
   std::unique_ptr<InferResult> Infer(InferRequest& infer_request) override;
 
-  std::future<std::unique_ptr<InferResult>> AsyncInfer(
-      InferRequest& infer_request) override;
+  InferFuture AsyncInfer(InferRequest& infer_request) override;
 
   std::unique_ptr<GenericInferResult> Infer(
       GenericInferRequest& infer_request) override;
 
+  // Return the names of all the models in the model repositories, whether
+  // loaded or not.
+  std::vector<std::string> RepositoryModelNames();
+
+  // Start loading 'model_names' in the background for 'CreateAsync'. If
+  // 'disable_model_control' is true, loading and unloading models is rejected
+  // once started.
+  void StartModelStartupLoader(
+      const std::vector<std::string>& model_names,
+      const bool disable_model_control);
+
  private:
+  // Return the SLO tracker of the model requested by 'infer_request', nullptr
+  // if the model has no service level objective.
+  std::shared_ptr<SloTracker> ModelSloTracker(
+      const InferRequest& infer_request);
+
+  // Return the shadow sample of 'infer_request' if it should be mirrored,
+  // nullptr otherwise. The shadow request of the sample is prepared with a
+  // copy of the inputs.
+  std::shared_ptr<ShadowSample> SampleShadow(InferRequest& infer_request);
+
+  // Create the shadow request of 'infer_request' in 'sample'. Errors are
+  // recorded to the sample rather than thrown.
+  void PrepareMirror(
+      InferRequest& infer_request, const std::shared_ptr<ShadowSample>& sample);
+
+  // Send the shadow request of 'sample' to the shadow model. Errors are
+  // recorded to the sample rather than thrown.
+  void MirrorRequest(const std::shared_ptr<ShadowSample>& sample);
+
+  // Release the memory cached by the wrapper to the system. Called by the
+  // memory pressure monitor when the pressure rises.
+  void TrimMemory();
+
   void StartRepoPollThread();
   void StopRepoPollThread();
+  void StartHealthRefreshThread(const int32_t refresh_ms);
+  void StopHealthRefreshThread();
+
+  // Pin the calling thread to 'wrapper_thread_cpus_' if set. Called at the
+  // start of every thread owned by the wrapper.
+  void PinWrapperThread();
 
-  bool is_exiting_;
+  std::atomic<bool> is_exiting_;
   std::mutex exit_mu_;
   std::condition_variable exit_cv_;
   int32_t repository_poll_secs_;
   std::thread repo_poll_thread_;
+  std::thread health_refresh_thread_;
+  // The CPUs the wrapper threads are pinned to. Empty if not pinned.
+  std::string wrapper_thread_cpus_;
 };
 
 //==============================================================================
@@ -455,6 +636,29 @@ class InternalResult : public InferResult {
 
   void FinalizeResponse(
       TRITONSERVER_InferenceResponse* response, const AllocInfo& alloc_info);
+
+  // Make the outputs of this result growable so that the outputs of the
+  // following responses can be appended with 'AggregateResponse'.
+  void PrepareAggregation();
+
+  // Append the outputs of 'response' to the outputs of this result. The
+  // outputs of 'response' are copied so 'response' can be released after.
+  void AggregateResponse(const InternalResult& response);
+
+  // Return a tensor that owns 'buffer', which must be allocated with
+  // 'malloc' or one of its variants.
+  static std::shared_ptr<Tensor> OwnedOutput(
+      char* buffer, const size_t byte_size, const DataType& data_type,
+      const std::vector<int64_t>& shape);
+
+ private:
+  // Return a copy of 'output' in a CPU buffer owned by the returned tensor
+  // that can be grown with 'realloc'.
+  std::shared_ptr<Tensor> GrowableOutput(
+      const std::string& name, const Tensor& output);
+
+  // The capacity of the buffer of each aggregated output.
+  std::unordered_map<std::string, size_t> output_capacity_;
 };
 
 //==============================================================================
@@ -643,6 +847,9 @@ void
 InternalServer::InferRequestComplete(
     TRITONSERVER_InferenceRequest* request, const uint32_t flags, void* userp)
 {
+  if (userp != nullptr) {
+    RequestWatchdog::Release(reinterpret_cast<InFlightRequest*>(userp));
+  }
   if (request != nullptr) {
     LOG_IF_ERROR(
         TRITONSERVER_InferenceRequestDelete(request),
@@ -655,6 +862,10 @@ InternalServer::InferResponseComplete(
     TRITONSERVER_InferenceResponse* response, const uint32_t flags, void* userp)
 {
   auto p = reinterpret_cast<InferRequest*>(userp);
+  // The request may be reused by the user once its result is set, so the
+  // counters are held for the whole callback.
+  std::shared_ptr<PhaseCounters> phase_counters = p->phase_counters_;
+  PhaseScope response_scope(phase_counters.get(), PhaseCounters::RESPONSE);
   // The allocation info of output tensor, which will be used to finalize
   // the response and stored in the output 'Tensor' object so that When calling
   // the destructor of an output tensor, it will know how to clean the buffer
@@ -663,14 +874,82 @@ InternalServer::InferResponseComplete(
       p->infer_options_->custom_allocator_, p->tensor_alloc_map_);
   bool is_decoupled = p->is_decoupled_;
 
+  // Stop watching the request once the final response is received, before the
+  // result is returned to the user who may reuse the request.
+  const bool is_final =
+      !is_decoupled || ((flags & TRITONSERVER_RESPONSE_COMPLETE_FINAL) != 0);
+  if (is_final && (p->in_flight_ != nullptr)) {
+    RequestWatchdog::Complete(p->in_flight_);
+    p->in_flight_ = nullptr;
+  }
+  if (is_final && (p->memory_monitor_ != nullptr)) {
+    p->memory_monitor_->Complete();
+    p->memory_monitor_.reset();
+  }
+  if (is_final && (p->live_stats_ != nullptr)) {
+    // The error is owned by the response.
+    p->live_stats_->Complete(
+        p->start_time_, (response != nullptr) &&
+                            (TRITONSERVER_InferenceResponseError(response) !=
+                             nullptr));
+    p->live_stats_.reset();
+  }
+
   if (response != nullptr) {
     std::unique_ptr<InternalResult> result = std::make_unique<InternalResult>();
+    result->output_usage_ = p->output_usage_;
+    result->phase_counters_ = phase_counters;
     result->FinalizeResponse(response, alloc_info);
+    if (p->slo_tracker_ != nullptr) {
+      p->slo_tracker_->Record(p->start_time_, result->has_error_);
+      p->slo_tracker_.reset();
+    }
+    if (p->latency_histogram_ != nullptr) {
+      p->latency_histogram_->Record(
+          p->start_time_, p->infer_options_->request_id_,
+          (p->trace_ != nullptr) ? p->trace_->trace_id_ : 0);
+      p->latency_histogram_.reset();
+    }
+
+    if (is_decoupled && p->infer_options_->aggregate_decoupled_responses_) {
+      // Only the aggregated result is returned, the response is released
+      // here once its outputs are appended.
+      if (p->aggregated_result_ == nullptr) {
+        result->PrepareAggregation();
+        p->aggregated_result_ = std::move(result);
+      } else {
+        static_cast<InternalResult*>(p->aggregated_result_.get())
+            ->AggregateResponse(*result);
+      }
+      if ((flags & TRITONSERVER_RESPONSE_COMPLETE_FINAL) != 0) {
+        p->aggregated_result_->next_result_future_.reset();
+        SetResult(p, std::move(p->aggregated_result_));
+      }
+      return;
+    }
+
+    if (p->shadow_sample_ != nullptr) {
+      // The outputs are shared with the shadow comparison rather than copied.
+      // Pre-allocated buffers are owned by the user and GPU buffers can't be
+      // read directly, so those outputs are not compared.
+      ShadowOutputs outputs;
+      for (const auto& output : result->infer_outputs_) {
+        if ((p->tensor_alloc_map_.find(output.first) ==
+             p->tensor_alloc_map_.end()) &&
+            (output.second->memory_type_ != MemoryType::GPU)) {
+          outputs.emplace(output);
+        }
+      }
+      ShadowMirror::Record(
+          std::move(p->shadow_sample_), false /* is_shadow */,
+          result->has_error_, std::move(outputs));
+    }
+
     std::unique_ptr<InferResult> infer_result = std::move(result);
 
     if (!is_decoupled) {
       infer_result->next_result_future_.reset();
-      p->prev_promise_->set_value(std::move(infer_result));
+      SetResult(p, std::move(infer_result));
     } else {
       if ((flags & TRITONSERVER_RESPONSE_COMPLETE_FINAL) == 0) {
         // Not the last response. Need to store the promise associated with the
@@ -679,24 +958,39 @@ InternalServer::InferResponseComplete(
         infer_result->next_result_future_ =
             std::make_unique<std::future<std::unique_ptr<InferResult>>>(
                 promise->get_future());
-        p->prev_promise_->set_value(std::move(infer_result));
+        SetResult(p, std::move(infer_result));
         p->prev_promise_.reset(std::move(promise));
       } else {
         // The last response.
         infer_result->next_result_future_.reset();
-        p->prev_promise_->set_value(std::move(infer_result));
+        SetResult(p, std::move(infer_result));
       }
     }
   } else if (
       is_decoupled && (flags & TRITONSERVER_RESPONSE_COMPLETE_FINAL) != 0) {
     // An empty response may be the last response for decoupled models.
-    p->prev_promise_->set_value(nullptr);
+    if (p->aggregated_result_ != nullptr) {
+      p->aggregated_result_->next_result_future_.reset();
+    }
+    SetResult(p, std::move(p->aggregated_result_));
   } else {
-    p->prev_promise_->set_value(nullptr);
+    SetResult(p, nullptr);
     throw TritonException("Unexpected empty response.");
   }
 }
 
+void
+InternalServer::SetResult(
+    InferRequest* request, std::unique_ptr<InferResult>&& result)
+{
+  if (request->infer_promise_.valid()) {
+    InferPromise promise = std::move(request->infer_promise_);
+    promise.set_value(std::move(result));
+  } else {
+    request->prev_promise_->set_value(std::move(result));
+  }
+}
+
 TRITONSERVER_Error*
 OutputBufferQuery(
     TRITONSERVER_ResponseAllocator* allocator, void* userp,
@@ -778,6 +1072,11 @@ HostPolicy::HostPolicy(
 {
 }
 
+NumaNode::NumaNode(const int32_t id, const std::string& cpus)
+    : id_(id), cpus_(cpus)
+{
+}
+
 Trace::Trace(const std::string& file, const Level& level)
     : file_(file), level_(level), rate_(1000), count_(-1), log_frequency_(0)
 {
@@ -799,12 +1098,17 @@ ServerOptions::ServerOptions(
       repo_agent_dir_("/opt/tritonserver/repoagents"),
       disable_auto_complete_config_(false),
       model_control_mode_(ModelControlMode::NONE), repository_poll_secs_(15),
+      repository_poll_fingerprint_(false),
       pinned_memory_pool_byte_size_(1 << 28), response_cache_byte_size_(0),
       min_cuda_compute_capability_(0), exit_on_error_(true),
       exit_timeout_secs_(30), buffer_manager_thread_count_(0),
       model_load_thread_count_(
-          std::max(2u, 2 * std::thread::hardware_concurrency())),
-      trace_(nullptr)
+          std::max(2u, 2 * ProcessContainerLimits().effective_cpu_count_)),
+      auto_host_policy_(false), pin_wrapper_threads_(false),
+      health_check_refresh_ms_(0), trace_(nullptr), watchdog_(nullptr),
+      memory_pressure_(nullptr), phase_counters_(false),
+      latency_histogram_exemplars_(false), stats_segment_interval_ms_(100),
+      model_preloading_(nullptr)
 {
   // FIXME: Use iterator instead of vector for 'model_repository_paths_'.
   be_config_.clear();
@@ -813,6 +1117,15 @@ ServerOptions::ServerOptions(
   cuda_memory_pool_byte_size_.clear();
   model_load_gpu_limit_.clear();
   host_policy_.clear();
+
+  // Keep the pinned memory pool well within the memory limit of the
+  // container, the pool is allocated on each NUMA node if 'NUMA_NODE' is set.
+  const uint64_t memory_limit =
+      ProcessContainerLimits().memory_limit_byte_size_;
+  if (memory_limit != 0) {
+    pinned_memory_pool_byte_size_ = std::min<int64_t>(
+        pinned_memory_pool_byte_size_, memory_limit / 16);
+  }
 }
 
 ServerOptions::ServerOptions(
@@ -839,7 +1152,7 @@ ServerOptions::ServerOptions(
       disable_auto_complete_config_(disable_auto_complete_config),
       model_control_mode_(model_control_mode),
       repository_poll_secs_(repository_poll_secs),
-      startup_models_(startup_models),
+      repository_poll_fingerprint_(false), startup_models_(startup_models),
       rate_limit_resource_(rate_limit_resource),
       pinned_memory_pool_byte_size_(pinned_memory_pool_byte_size),
       cuda_memory_pool_byte_size_(cuda_memory_pool_byte_size),
@@ -849,7 +1162,124 @@ ServerOptions::ServerOptions(
       buffer_manager_thread_count_(buffer_manager_thread_count),
       model_load_thread_count_(model_load_thread_count),
       model_load_gpu_limit_(model_load_gpu_limit), host_policy_(host_policy),
-      trace_(trace)
+      auto_host_policy_(false), pin_wrapper_threads_(false),
+      health_check_refresh_ms_(0), trace_(trace), watchdog_(nullptr),
+      memory_pressure_(nullptr), phase_counters_(false),
+      latency_histogram_exemplars_(false), stats_segment_interval_ms_(100),
+      model_preloading_(nullptr)
+{
+}
+
+Watchdog::Watchdog(const uint64_t threshold_ms, const Action& action)
+    : threshold_ms_(threshold_ms), action_(action)
+{
+}
+
+WatchdogStats::WatchdogStats()
+    : in_flight_count_(0), oldest_in_flight_ms_(0), stuck_count_(0),
+      cancelled_count_(0)
+{
+}
+
+MemoryPressure::MemoryPressure()
+    : psi_path_("/proc/pressure/memory"), trim_threshold_(10),
+      limit_threshold_(25), shed_threshold_(50), max_in_flight_(16),
+      shed_priority_(1), interval_ms_(1000)
+{
+}
+
+MemoryPressureStats::MemoryPressureStats()
+    : level_(MemoryPressure::Level::NONE), some_avg10_(0), full_avg10_(0),
+      high_event_count_(0), max_event_count_(0), oom_event_count_(0),
+      trigger_count_(0), trim_count_(0), limited_count_(0), shed_count_(0),
+      in_flight_count_(0)
+{
+}
+
+PhaseCounterStats::PhaseCounterStats()
+    : count_(0), cycles_(0), instructions_(0), cache_misses_(0),
+      context_switches_(0)
+{
+}
+
+WorkExecutorOptions::WorkExecutorOptions()
+    : thread_count_(0), affinity_(Affinity::WRAPPER)
+{
+}
+
+WorkExecutorStats::WorkExecutorStats()
+    : thread_count_(0), latency_queue_depth_(0), background_queue_depth_(0),
+      submitted_count_(0), executed_count_(0), steal_count_(0),
+      parallel_for_count_(0)
+{
+}
+
+ModelPreloading::ModelPreloading(const std::string& history_path)
+    : history_path_(history_path), period_secs_(86400), bucket_secs_(900),
+      lead_secs_(600), load_rate_(0.01), idle_secs_(1800),
+      max_loaded_models_(0), smoothing_(0.3)
+{
+}
+
+ModelPreloadingStats::ModelPreloadingStats()
+    : preload_count_(0), unload_count_(0), avoided_cold_start_count_(0),
+      wasted_preload_count_(0), cold_start_count_(0), budget_skipped_count_(0),
+      true_positive_count_(0), false_positive_count_(0),
+      false_negative_count_(0), mean_absolute_error_(0)
+{
+}
+
+RepositoryPollStats::RepositoryPollStats()
+    : poll_count_(0), skipped_poll_count_(0), hashed_file_count_(0),
+      hashed_byte_size_(0)
+{
+}
+
+ContainerLimits::ContainerLimits()
+    : cgroup_version_(0), cpu_quota_(0), cpuset_cpu_count_(0),
+      effective_cpu_count_(1), memory_limit_byte_size_(0)
+{
+}
+
+OutputPruningStats::OutputPruningStats()
+    : pruning_(false), pruned_request_count_(0), skipped_byte_size_(0),
+      fallback_count_(0)
+{
+}
+
+ShadowMirroring::ShadowMirroring(
+    const std::string& shadow_model_name, const double sample_rate,
+    const uint32_t max_in_flight)
+    : shadow_model_name_(shadow_model_name), shadow_model_version_(-1),
+      sample_rate_(sample_rate), max_in_flight_(max_in_flight),
+      tolerance_(1e-5)
+{
+}
+
+ShadowMirroringStats::ShadowMirroringStats()
+    : mirrored_count_(0), dropped_count_(0), compared_count_(0),
+      divergent_count_(0), shadow_error_count_(0), max_abs_diff_(0),
+      avg_primary_latency_us_(0), avg_shadow_latency_us_(0)
+{
+}
+
+ServiceLevelObjective::ServiceLevelObjective(
+    const uint64_t latency_threshold_us, const double latency_target,
+    const double success_target)
+    : latency_threshold_us_(latency_threshold_us),
+      latency_target_(latency_target), success_target_(success_target),
+      windows_s_({300, 3600})
+{
+}
+
+BurnRate::BurnRate()
+    : window_s_(0), request_count_(0), slow_count_(0), error_count_(0),
+      latency_burn_rate_(0), error_burn_rate_(0)
+{
+}
+
+ServiceLevelStats::ServiceLevelStats()
+    : request_count_(0), slow_count_(0), error_count_(0)
 {
 }
 
@@ -887,15 +1317,12 @@ Tensor::~Tensor()
   // and input tensor.
   if (!is_pre_alloc_ && is_output_) {
     if (custom_allocator_ == nullptr) {
-      std::stringstream ss;
-      ss << (void*)buffer_;
-      std::string buffer_str = ss.str();
-
-      LOG_MESSAGE(
-          TRITONSERVER_LOG_VERBOSE,
-          ("Releasing buffer " + buffer_str + " of size " +
-           std::to_string(byte_size_) + " in " + MemoryTypeString(memory_type_))
-              .c_str());
+      LOG_MESSAGE(TRITONSERVER_LOG_VERBOSE, [this]() {
+        std::stringstream ss;
+        ss << "Releasing buffer " << (void*)buffer_ << " of size "
+           << byte_size_ << " in " << MemoryTypeString(memory_type_);
+        return ss.str();
+      }());
 
       switch (memory_type_) {
         case MemoryType::CPU:
@@ -968,7 +1395,8 @@ InferOptions::InferOptions(const std::string& model_name)
     : model_name_(model_name), model_version_(-1), request_id_(""),
       correlation_id_(0), correlation_id_str_(""), sequence_start_(false),
       sequence_end_(false), priority_(0), request_timeout_(0),
-      custom_allocator_(nullptr), trace_(nullptr)
+      custom_allocator_(nullptr), trace_(nullptr),
+      aggregate_decoupled_responses_(false)
 {
 }
 
@@ -984,7 +1412,7 @@ InferOptions::InferOptions(
       correlation_id_str_(correlation_id_str), sequence_start_(sequence_start),
       sequence_end_(sequence_end), priority_(priority),
       request_timeout_(request_timeout), custom_allocator_(custom_allocator),
-      trace_(trace)
+      trace_(trace), aggregate_decoupled_responses_(false)
 {
 }
 
@@ -1005,14 +1433,94 @@ TritonServer::Create(const ServerOptions& options)
   return internal_server;
 }
 
+std::unique_ptr<TritonServer>
+TritonServer::CreateAsync(const ServerOptions& options)
+{
+  if (options.model_control_mode_ == ModelControlMode::POLL) {
+    throw TritonException(
+        "Error - CreateAsync: POLL model control mode is not supported.");
+  }
+
+  // The server is started without any model, the startup models are loaded
+  // explicitly once it runs.
+  ServerOptions server_options(options);
+  server_options.model_control_mode_ = ModelControlMode::EXPLICIT;
+  server_options.startup_models_.clear();
+  std::unique_ptr<InternalServer> internal_server;
+  internal_server.reset(new InternalServer(server_options));
+
+  std::vector<std::string> model_names;
+  if ((options.model_control_mode_ == ModelControlMode::NONE) ||
+      (options.startup_models_.find("*") != options.startup_models_.end())) {
+    model_names = internal_server->RepositoryModelNames();
+  } else {
+    model_names.assign(
+        options.startup_models_.begin(), options.startup_models_.end());
+  }
+  internal_server->StartModelStartupLoader(
+      model_names, options.model_control_mode_ == ModelControlMode::NONE);
+  return internal_server;
+}
+
+TritonServer::TritonServer()
+    : allocator_(nullptr), has_bound_inputs_(false), has_output_usage_(false),
+      has_shadow_mirrors_(false), has_slo_trackers_(false),
+      slo_trackers_(std::make_shared<const SloTrackers>()),
+      has_phase_counters_(false), model_control_disabled_(false)
+{
+}
+
 TritonServer::~TritonServer() {}
 
+void
+TritonServer::RefreshHealth()
+{
+  if (health_cache_ != nullptr) {
+    health_cache_->Refresh();
+  }
+}
+
+Future<void>
+TritonServer::StartupFuture()
+{
+  if (startup_loader_ == nullptr) {
+    Promise<void> promise;
+    promise.set_value();
+    return promise.get_future();
+  }
+  return startup_loader_->StartupFuture();
+}
+
+Future<void>
+TritonServer::ModelStartupFuture(const std::string& model_name)
+{
+  if (startup_loader_ == nullptr) {
+    Promise<void> promise;
+    promise.set_value();
+    return promise.get_future();
+  }
+  return startup_loader_->ModelFuture(model_name);
+}
+
 void
 TritonServer::LoadModel(const std::string& model_name)
 {
   try {
-    THROW_IF_TRITON_ERR(
-        TRITONSERVER_ServerLoadModel(server_.get(), model_name.c_str()));
+    if (model_control_disabled_) {
+      throw TritonException(
+          "explicit model load / unload is not allowed in NONE model control "
+          "mode");
+    }
+    TRITONSERVER_Error* err =
+        TRITONSERVER_ServerLoadModel(server_.get(), model_name.c_str());
+    RefreshHealth();
+    THROW_IF_TRITON_ERR(err);
+    // A model loaded by the application is never unloaded by the preloader.
+    // The preloader loads its models through here as well, and marks them
+    // as preloaded once this returns.
+    if (model_preloader_ != nullptr) {
+      model_preloader_->ModelLoaded(model_name);
+    }
   }
   catch (const TritonException& ex) {
     throw TritonException(std::string("Error - LoadModel: ") + ex.what());
@@ -1023,8 +1531,15 @@ void
 TritonServer::UnloadModel(const std::string& model_name)
 {
   try {
-    THROW_IF_TRITON_ERR(TRITONSERVER_ServerUnloadModelAndDependents(
-        server_.get(), model_name.c_str()));
+    if (model_control_disabled_) {
+      throw TritonException(
+          "explicit model load / unload is not allowed in NONE model control "
+          "mode");
+    }
+    TRITONSERVER_Error* err = TRITONSERVER_ServerUnloadModelAndDependents(
+        server_.get(), model_name.c_str());
+    RefreshHealth();
+    THROW_IF_TRITON_ERR(err);
   }
   catch (const TritonException& ex) {
     throw TritonException(std::string("Error - UnloadModel: ") + ex.what());
@@ -1101,6 +1616,24 @@ TritonServer::ServerMetrics()
     throw TritonException(std::string("Error - Metrics: ") + ex.what());
   }
 
+  if (has_slo_trackers_) {
+    std::map<std::string, ServiceLevelStats> slo_stats;
+    for (const auto& tracker : *std::atomic_load(&slo_trackers_)) {
+      slo_stats.emplace(tracker.first, tracker.second->Stats());
+    }
+    metrics_str += SloTracker::FormatMetrics(slo_stats);
+  }
+  if (!latency_histogram_bounds_us_.empty()) {
+    std::map<std::string, std::shared_ptr<LatencyHistogram>> histograms;
+    {
+      std::lock_guard<std::mutex> lk(latency_histograms_mu_);
+      histograms.insert(latency_histograms_.begin(), latency_histograms_.end());
+    }
+    metrics_str += LatencyHistogram::FormatMetrics(
+        histograms, latency_histogram_exemplars_);
+  }
+  metrics_str += executor_->FormatMetrics();
+
   return metrics_str;
 }
 
@@ -1134,10 +1667,22 @@ TritonServer::ModelStatistics(
 
 bool
 TritonServer::IsServerLive()
+{
+  return IsServerLive(false /* fresh */);
+}
+
+bool
+TritonServer::IsServerLive(const bool fresh)
 {
   bool live = false;
   try {
-    THROW_IF_TRITON_ERR(TRITONSERVER_ServerIsLive(server_.get(), &live));
+    if (health_cache_ == nullptr) {
+      THROW_IF_TRITON_ERR(TRITONSERVER_ServerIsLive(server_.get(), &live));
+    } else if (fresh) {
+      live = health_cache_->QueryServerLive();
+    } else {
+      live = health_cache_->ServerLive();
+    }
   }
   catch (const TritonException& ex) {
     throw TritonException(std::string("Error - IsLive: ") + ex.what());
@@ -1148,10 +1693,22 @@ TritonServer::IsServerLive()
 
 bool
 TritonServer::IsServerReady()
+{
+  return IsServerReady(false /* fresh */);
+}
+
+bool
+TritonServer::IsServerReady(const bool fresh)
 {
   bool ready = false;
   try {
-    THROW_IF_TRITON_ERR(TRITONSERVER_ServerIsReady(server_.get(), &ready));
+    if (health_cache_ == nullptr) {
+      THROW_IF_TRITON_ERR(TRITONSERVER_ServerIsReady(server_.get(), &ready));
+    } else if (fresh) {
+      ready = health_cache_->QueryServerReady();
+    } else {
+      ready = health_cache_->ServerReady();
+    }
   }
   catch (const TritonException& ex) {
     throw TritonException(std::string("Error - IsReady: ") + ex.what());
@@ -1164,16 +1721,31 @@ void
 TritonServer::ServerStop()
 {
   TRITONSERVER_ServerStop(server_.get());
+  RefreshHealth();
 }
 
 bool
 TritonServer::IsModelReady(
     const std::string& model_name, const int64_t model_version)
+{
+  return IsModelReady(model_name, model_version, false /* fresh */);
+}
+
+bool
+TritonServer::IsModelReady(
+    const std::string& model_name, const int64_t model_version,
+    const bool fresh)
 {
   bool ready = false;
   try {
-    THROW_IF_TRITON_ERR(TRITONSERVER_ServerModelIsReady(
-        server_.get(), model_name.c_str(), model_version, &ready));
+    if (health_cache_ == nullptr) {
+      THROW_IF_TRITON_ERR(TRITONSERVER_ServerModelIsReady(
+          server_.get(), model_name.c_str(), model_version, &ready));
+    } else if (fresh) {
+      ready = health_cache_->QueryModelReady(model_name, model_version);
+    } else {
+      ready = health_cache_->ModelReady(model_name, model_version);
+    }
   }
   catch (const TritonException& ex) {
     throw TritonException(std::string("Error - IsModelReady: ") + ex.what());
@@ -1293,52 +1865,328 @@ TritonServer::UnregisterModelRepo(const std::string& repo_path)
 }
 
 void
-TritonServer::PrepareInferenceRequest(
-    TRITONSERVER_InferenceRequest** irequest, const InferRequest& request)
+TritonServer::BindConstantInput(
+    const std::string& model_name, const std::string& input_name,
+    const Tensor& input)
 {
-  try {
-    THROW_IF_TRITON_ERR(TRITONSERVER_InferenceRequestNew(
-        irequest, server_.get(), request.infer_options_->model_name_.c_str(),
-        request.infer_options_->model_version_));
-
-    THROW_IF_TRITON_ERR(TRITONSERVER_InferenceRequestSetId(
-        *irequest, request.infer_options_->request_id_.c_str()));
-    if (request.infer_options_->correlation_id_str_.empty()) {
-      THROW_IF_TRITON_ERR(TRITONSERVER_InferenceRequestSetCorrelationId(
-          *irequest, request.infer_options_->correlation_id_));
-    } else {
-      THROW_IF_TRITON_ERR(TRITONSERVER_InferenceRequestSetCorrelationIdString(
-          *irequest, request.infer_options_->correlation_id_str_.c_str()));
+  if (input.memory_type_ == MemoryType::GPU) {
+    throw TritonException(
+        "Error - BindConstantInput: input '" + input_name + "' of model '" +
+        model_name + "' must be in CPU memory.");
+  }
+
+  std::shared_ptr<BoundInputs::Input> bound_input(new BoundInputs::Input());
+  bound_input->name_ = input_name;
+  bound_input->buffer_.reset(new char[input.byte_size_]);
+  if (input.byte_size_ != 0) {
+    memcpy(bound_input->buffer_.get(), input.buffer_, input.byte_size_);
+  }
+  bound_input->byte_size_ = input.byte_size_;
+  bound_input->data_type_ = ToTritonDataType(input.data_type_);
+  bound_input->shape_ = input.shape_;
+
+  std::lock_guard<std::mutex> lk(bound_inputs_mu_);
+  std::shared_ptr<BoundInputs> updated(new BoundInputs());
+  auto it = bound_inputs_.find(model_name);
+  if (it != bound_inputs_.end()) {
+    for (const auto& existing : it->second->inputs_) {
+      if (existing->name_ != input_name) {
+        updated->inputs_.push_back(existing);
+      }
     }
+  }
+  updated->inputs_.push_back(std::move(bound_input));
+  bound_inputs_[model_name] = std::move(updated);
+  has_bound_inputs_ = true;
+}
 
-    uint32_t flags = 0;
-    if (request.infer_options_->sequence_start_) {
-      flags |= TRITONSERVER_REQUEST_FLAG_SEQUENCE_START;
-    }
-    if (request.infer_options_->sequence_end_) {
-      flags |= TRITONSERVER_REQUEST_FLAG_SEQUENCE_END;
-    }
-    THROW_IF_TRITON_ERR(
-        TRITONSERVER_InferenceRequestSetFlags(*irequest, flags));
+void
+TritonServer::UnbindConstantInputs(const std::string& model_name)
+{
+  std::lock_guard<std::mutex> lk(bound_inputs_mu_);
+  bound_inputs_.erase(model_name);
+  has_bound_inputs_ = !bound_inputs_.empty();
+}
 
-    THROW_IF_TRITON_ERR(TRITONSERVER_InferenceRequestSetPriority(
-        *irequest, request.infer_options_->priority_));
+void
+TritonServer::EnableOutputPruning(
+    const std::string& model_name, const uint32_t learning_window)
+{
+  std::lock_guard<std::mutex> lk(output_usage_mu_);
+  output_usage_[model_name] =
+      std::make_shared<OutputUsageTracker>(learning_window);
+  has_output_usage_ = true;
+}
 
-    THROW_IF_TRITON_ERR(TRITONSERVER_InferenceRequestSetTimeoutMicroseconds(
-        *irequest, request.infer_options_->request_timeout_));
-    THROW_IF_TRITON_ERR(TRITONSERVER_InferenceRequestSetReleaseCallback(
-        *irequest, InternalServer::InferRequestComplete,
-        nullptr /* request_release_userp */));
-  }
-  catch (const TritonException& ex) {
-    throw TritonException(
-        std::string("Error - PrepareInferenceRequest: ") + ex.what());
+void
+TritonServer::DisableOutputPruning(const std::string& model_name)
+{
+  std::lock_guard<std::mutex> lk(output_usage_mu_);
+  output_usage_.erase(model_name);
+  has_output_usage_ = !output_usage_.empty();
+}
+
+OutputPruningStats
+TritonServer::OutputPruningStatistics(const std::string& model_name)
+{
+  std::shared_ptr<OutputUsageTracker> tracker;
+  {
+    std::lock_guard<std::mutex> lk(output_usage_mu_);
+    auto it = output_usage_.find(model_name);
+    if (it == output_usage_.end()) {
+      throw TritonException(
+          "Error - OutputPruningStatistics: output pruning is not enabled "
+          "for model '" +
+          model_name + "'.");
+    }
+    tracker = it->second;
   }
+  return tracker->Stats();
 }
 
 void
-TritonServer::PrepareInferenceInput(
-    TRITONSERVER_InferenceRequest* irequest, const InferRequest& request)
+TritonServer::EnableShadowMirroring(
+    const std::string& model_name, const ShadowMirroring& options)
+{
+  if ((options.sample_rate_ < 0) || (options.sample_rate_ > 1)) {
+    throw TritonException(
+        "Error - EnableShadowMirroring: sample rate must be between 0 and 1, "
+        "got " +
+        std::to_string(options.sample_rate_));
+  }
+  if (options.max_in_flight_ == 0) {
+    throw TritonException(
+        "Error - EnableShadowMirroring: the maximum number of shadow requests "
+        "in flight must be positive.");
+  }
+  if (options.shadow_model_name_ == model_name) {
+    throw TritonException(
+        "Error - EnableShadowMirroring: model '" + model_name +
+        "' can't be its own shadow model.");
+  }
+
+  std::lock_guard<std::mutex> lk(shadow_mirrors_mu_);
+  // The mirror is replaced as a whole so that the shadow requests in flight
+  // are recorded to the mirror they were sampled by.
+  shadow_mirrors_[model_name] = std::make_shared<ShadowMirror>(
+      model_name, options, executor_);
+  has_shadow_mirrors_ = true;
+}
+
+void
+TritonServer::DisableShadowMirroring(const std::string& model_name)
+{
+  std::lock_guard<std::mutex> lk(shadow_mirrors_mu_);
+  shadow_mirrors_.erase(model_name);
+  has_shadow_mirrors_ = !shadow_mirrors_.empty();
+}
+
+ShadowMirroringStats
+TritonServer::ShadowMirroringStatistics(const std::string& model_name)
+{
+  std::shared_ptr<ShadowMirror> mirror;
+  {
+    std::lock_guard<std::mutex> lk(shadow_mirrors_mu_);
+    auto it = shadow_mirrors_.find(model_name);
+    if (it == shadow_mirrors_.end()) {
+      throw TritonException(
+          "Error - ShadowMirroringStatistics: shadow mirroring is not enabled "
+          "for model '" +
+          model_name + "'.");
+    }
+    mirror = it->second;
+  }
+  return mirror->Stats();
+}
+
+void
+TritonServer::SetServiceLevelObjective(
+    const std::string& model_name, const ServiceLevelObjective& objective)
+{
+  if ((objective.latency_target_ <= 0) || (objective.latency_target_ >= 1) ||
+      (objective.success_target_ <= 0) || (objective.success_target_ >= 1)) {
+    throw TritonException(
+        "Error - SetServiceLevelObjective: the latency and success targets "
+        "must be between 0 and 1 exclusive.");
+  }
+  if (objective.windows_s_.empty() ||
+      (std::find(
+           objective.windows_s_.begin(), objective.windows_s_.end(), 0) !=
+       objective.windows_s_.end())) {
+    throw TritonException(
+        "Error - SetServiceLevelObjective: at least one window is required "
+        "and the windows must be positive.");
+  }
+
+  std::lock_guard<std::mutex> lk(slo_trackers_mu_);
+  // The tracker is replaced as a whole so that the requests in flight are
+  // recorded to the tracker they were started with.
+  auto trackers =
+      std::make_shared<SloTrackers>(*std::atomic_load(&slo_trackers_));
+  (*trackers)[model_name] = std::make_shared<SloTracker>(objective);
+  std::atomic_store(
+      &slo_trackers_, std::shared_ptr<const SloTrackers>(std::move(trackers)));
+  has_slo_trackers_ = true;
+}
+
+void
+TritonServer::RemoveServiceLevelObjective(const std::string& model_name)
+{
+  std::lock_guard<std::mutex> lk(slo_trackers_mu_);
+  auto trackers =
+      std::make_shared<SloTrackers>(*std::atomic_load(&slo_trackers_));
+  trackers->erase(model_name);
+  has_slo_trackers_ = !trackers->empty();
+  std::atomic_store(
+      &slo_trackers_, std::shared_ptr<const SloTrackers>(std::move(trackers)));
+}
+
+ServiceLevelStats
+TritonServer::ServiceLevelStatistics(const std::string& model_name)
+{
+  std::shared_ptr<const SloTrackers> trackers =
+      std::atomic_load(&slo_trackers_);
+  auto it = trackers->find(model_name);
+  if (it == trackers->end()) {
+    throw TritonException(
+        "Error - ServiceLevelStatistics: no service level objective is set "
+        "for model '" +
+        model_name + "'.");
+  }
+  return it->second->Stats();
+}
+
+WatchdogStats
+TritonServer::WatchdogStatistics()
+{
+  if (watchdog_ == nullptr) {
+    throw TritonException(
+        "Error - WatchdogStatistics: the in-flight request watchdog is not "
+        "enabled.");
+  }
+  return watchdog_->Stats();
+}
+
+MemoryPressureStats
+TritonServer::MemoryPressureStatistics()
+{
+  if (memory_monitor_ == nullptr) {
+    throw TritonException(
+        "Error - MemoryPressureStatistics: the memory pressure monitor is not "
+        "enabled.");
+  }
+  return memory_monitor_->Stats();
+}
+
+std::map<std::string, PhaseCounterStats>
+TritonServer::PhaseCounterStatistics(const std::string& model_name)
+{
+  if (!has_phase_counters_) {
+    throw TritonException(
+        "Error - PhaseCounterStatistics: the phase counters are not "
+        "enabled.");
+  }
+  return ModelPhaseCounters(model_name)->Stats();
+}
+
+ModelPreloadingStats
+TritonServer::ModelPreloadingStatistics()
+{
+  if (model_preloader_ == nullptr) {
+    throw TritonException(
+        "Error - ModelPreloadingStatistics: model preloading is not enabled.");
+  }
+  return model_preloader_->Stats();
+}
+
+RepositoryPollStats
+TritonServer::RepositoryPollStatistics()
+{
+  if (repo_fingerprint_ == nullptr) {
+    throw TritonException(
+        "Error - RepositoryPollStatistics: the repository fingerprints are not "
+        "enabled.");
+  }
+  return repo_fingerprint_->Stats();
+}
+
+WorkExecutor&
+TritonServer::SharedExecutor()
+{
+  return *executor_;
+}
+
+std::shared_ptr<PhaseCounters>
+TritonServer::ModelPhaseCounters(const std::string& model_name)
+{
+  std::lock_guard<std::mutex> lk(phase_counters_mu_);
+  std::shared_ptr<PhaseCounters>& counters = phase_counters_[model_name];
+  if (counters == nullptr) {
+    counters = std::make_shared<PhaseCounters>();
+  }
+  return counters;
+}
+
+std::shared_ptr<LatencyHistogram>
+TritonServer::ModelLatencyHistogram(const std::string& model_name)
+{
+  std::lock_guard<std::mutex> lk(latency_histograms_mu_);
+  std::shared_ptr<LatencyHistogram>& histogram =
+      latency_histograms_[model_name];
+  if (histogram == nullptr) {
+    histogram =
+        std::make_shared<LatencyHistogram>(latency_histogram_bounds_us_);
+  }
+  return histogram;
+}
+
+void
+TritonServer::PrepareInferenceRequest(
+    TRITONSERVER_InferenceRequest** irequest, const InferRequest& request)
+{
+  try {
+    THROW_IF_TRITON_ERR(TRITONSERVER_InferenceRequestNew(
+        irequest, server_.get(), request.infer_options_->model_name_.c_str(),
+        request.infer_options_->model_version_));
+
+    THROW_IF_TRITON_ERR(TRITONSERVER_InferenceRequestSetId(
+        *irequest, request.infer_options_->request_id_.c_str()));
+    if (request.infer_options_->correlation_id_str_.empty()) {
+      THROW_IF_TRITON_ERR(TRITONSERVER_InferenceRequestSetCorrelationId(
+          *irequest, request.infer_options_->correlation_id_));
+    } else {
+      THROW_IF_TRITON_ERR(TRITONSERVER_InferenceRequestSetCorrelationIdString(
+          *irequest, request.infer_options_->correlation_id_str_.c_str()));
+    }
+
+    uint32_t flags = 0;
+    if (request.infer_options_->sequence_start_) {
+      flags |= TRITONSERVER_REQUEST_FLAG_SEQUENCE_START;
+    }
+    if (request.infer_options_->sequence_end_) {
+      flags |= TRITONSERVER_REQUEST_FLAG_SEQUENCE_END;
+    }
+    THROW_IF_TRITON_ERR(
+        TRITONSERVER_InferenceRequestSetFlags(*irequest, flags));
+
+    THROW_IF_TRITON_ERR(TRITONSERVER_InferenceRequestSetPriority(
+        *irequest, request.infer_options_->priority_));
+
+    THROW_IF_TRITON_ERR(TRITONSERVER_InferenceRequestSetTimeoutMicroseconds(
+        *irequest, request.infer_options_->request_timeout_));
+    THROW_IF_TRITON_ERR(TRITONSERVER_InferenceRequestSetReleaseCallback(
+        *irequest, InternalServer::InferRequestComplete,
+        nullptr /* request_release_userp */));
+  }
+  catch (const TritonException& ex) {
+    throw TritonException(
+        std::string("Error - PrepareInferenceRequest: ") + ex.what());
+  }
+}
+
+void
+TritonServer::PrepareInferenceInput(
+    TRITONSERVER_InferenceRequest* irequest, InferRequest& request)
 {
   try {
     for (auto& input : request.inputs_) {
@@ -1354,6 +2202,30 @@ TritonServer::PrepareInferenceInput(
           input.second->byte_size_, memory_type,
           input.second->memory_type_id_));
     }
+
+    // Attach the constant inputs bound to the model. The buffers are owned by
+    // the server so they are passed to the request as they are.
+    request.bound_inputs_.reset();
+    if (has_bound_inputs_) {
+      std::lock_guard<std::mutex> lk(bound_inputs_mu_);
+      auto it = bound_inputs_.find(request.infer_options_->model_name_);
+      if (it != bound_inputs_.end()) {
+        request.bound_inputs_ = it->second;
+      }
+    }
+    if (request.bound_inputs_ != nullptr) {
+      for (const auto& bound_input : request.bound_inputs_->inputs_) {
+        if (request.inputs_.find(bound_input->name_) != request.inputs_.end()) {
+          continue;
+        }
+        THROW_IF_TRITON_ERR(TRITONSERVER_InferenceRequestAddInput(
+            irequest, bound_input->name_.c_str(), bound_input->data_type_,
+            bound_input->shape_.data(), bound_input->shape_.size()));
+        THROW_IF_TRITON_ERR(TRITONSERVER_InferenceRequestAppendInputData(
+            irequest, bound_input->name_.c_str(), bound_input->buffer_.get(),
+            bound_input->byte_size_, TRITONSERVER_MEMORY_CPU, 0));
+      }
+    }
   }
   catch (const TritonException& ex) {
     throw TritonException(
@@ -1379,6 +2251,9 @@ InternalServer::PrepareTraceManager(InferRequest& infer_request)
     }
     infer_request.trace_ = std::move(
         trace_manager_->SampleTrace(infer_request.infer_options_->model_name_));
+    if (infer_request.trace_ != nullptr) {
+      infer_request.trace_->phase_counters_ = infer_request.phase_counters_;
+    }
   } else if (infer_request.infer_options_->trace_) {
     LOG_MESSAGE(
         TRITONSERVER_LOG_ERROR,
@@ -1405,6 +2280,24 @@ TritonServer::PrepareInferenceOutput(
             infer_output->MemoryTypeId());
       }
     }
+
+    // Let output pruning select the outputs if none is requested explicitly.
+    request.output_usage_.reset();
+    if (request.outputs_.empty() && has_output_usage_) {
+      std::lock_guard<std::mutex> lk(output_usage_mu_);
+      auto it = output_usage_.find(request.infer_options_->model_name_);
+      if (it != output_usage_.end()) {
+        request.output_usage_ = it->second;
+      }
+    }
+    if (request.output_usage_ != nullptr) {
+      std::vector<std::string> selected_outputs;
+      request.output_usage_->SelectOutputs(&selected_outputs);
+      for (const auto& name : selected_outputs) {
+        THROW_IF_TRITON_ERR(TRITONSERVER_InferenceRequestAddRequestedOutput(
+            irequest, name.c_str()));
+      }
+    }
   }
   catch (const TritonException& ex) {
     throw TritonException(
@@ -1423,14 +2316,15 @@ InternalServer::IsModelDecoupled(const InferRequest& infer_request)
   return (txn_flags & TRITONSERVER_TXN_DECOUPLED) != 0;
 }
 
-std::future<std::unique_ptr<InferResult>>
+InferFuture
 InternalServer::GetInferResult(
     InferRequest& infer_request, TRITONSERVER_InferenceRequest* irequest,
     TRITONSERVER_InferenceTrace* triton_trace)
 {
-  auto p = new std::promise<std::unique_ptr<InferResult>>();
-  std::future<std::unique_ptr<InferResult>> result_future = p->get_future();
-  infer_request.prev_promise_.reset(std::move(p));
+  infer_request.infer_promise_ = InferPromise();
+  InferFuture result_future = infer_request.infer_promise_.get_future();
+  infer_request.prev_promise_.reset();
+  infer_request.aggregated_result_.reset();
   if (infer_request.infer_options_->custom_allocator_ == nullptr) {
     THROW_IF_TRITON_ERR(TRITONSERVER_InferenceRequestSetResponseCallback(
         irequest, allocator_, reinterpret_cast<void*>(&infer_request),
@@ -1443,8 +2337,32 @@ InternalServer::GetInferResult(
         InternalServer::InferResponseComplete,
         reinterpret_cast<void*>(&infer_request)));
   }
-  THROW_IF_TRITON_ERR(
-      TRITONSERVER_ServerInferAsync(server_.get(), irequest, triton_trace));
+
+  infer_request.in_flight_ = nullptr;
+  if (watchdog_ != nullptr) {
+    infer_request.in_flight_ = watchdog_->Track(
+        irequest, infer_request.infer_options_->model_name_,
+        infer_request.infer_options_->request_id_);
+    if (infer_request.in_flight_ != nullptr) {
+      // The release callback is used to know when the request can no longer
+      // be cancelled.
+      THROW_IF_TRITON_ERR(TRITONSERVER_InferenceRequestSetReleaseCallback(
+          irequest, InternalServer::InferRequestComplete,
+          reinterpret_cast<void*>(infer_request.in_flight_)));
+    }
+  }
+
+  TRITONSERVER_Error* err =
+      TRITONSERVER_ServerInferAsync(server_.get(), irequest, triton_trace);
+  if (err != nullptr) {
+    // The callbacks are not called if the request is not submitted.
+    if (infer_request.in_flight_ != nullptr) {
+      RequestWatchdog::Complete(infer_request.in_flight_);
+      RequestWatchdog::Release(infer_request.in_flight_);
+      infer_request.in_flight_ = nullptr;
+    }
+    THROW_IF_TRITON_ERR(err);
+  }
   return result_future;
 }
 
@@ -1466,7 +2384,7 @@ TritonServer::PreprocessIrequest(
   }
 
   PrepareInferenceRequest(irequest, infer_request);
-  PrepareInferenceInput(*irequest, infer_request);
+  PrepareInferenceInput(*irequest, const_cast<InferRequest&>(infer_request));
   PrepareInferenceOutput(*irequest, const_cast<InferRequest&>(infer_request));
 }
 
@@ -1480,6 +2398,36 @@ InternalServer::InternalServer(const ServerOptions& options)
       (TRITONSERVER_API_VERSION_MINOR > api_version_minor)) {
     throw TritonException("triton server API version mismatch");
   }
+  // Checked before any thread is started.
+  if (options.model_preloading_ != nullptr) {
+    if (options.model_control_mode_ != ModelControlMode::EXPLICIT) {
+      throw TritonException(
+          "model preloading is only supported in EXPLICIT model control mode");
+    }
+    if ((options.model_preloading_->bucket_secs_ == 0) ||
+        (options.model_preloading_->bucket_secs_ >
+         options.model_preloading_->period_secs_)) {
+      throw TritonException(
+          "the bucket duration of model preloading must be between 1 and its "
+          "period");
+    }
+    if (!(options.model_preloading_->smoothing_ >= 0) ||
+        !(options.model_preloading_->smoothing_ <= 1)) {
+      throw TritonException(
+          "the smoothing of model preloading must be between 0 and 1");
+    }
+    if (!(options.model_preloading_->load_rate_ > 0)) {
+      throw TritonException(
+          "the load rate of model preloading must be greater than 0");
+    }
+  }
+  // The stats segment is created before any thread is started since it
+  // fails if another process uses it.
+  if (!options.stats_segment_name_.empty()) {
+    stats_publisher_ = std::make_shared<StatsPublisher>(
+        options.stats_segment_name_, options.stats_segment_interval_ms_,
+        options.pinned_memory_pool_byte_size_);
+  }
 
   TRITONSERVER_ServerOptions* server_options = nullptr;
   THROW_IF_TRITON_ERR(TRITONSERVER_ServerOptionsNew(&server_options));
@@ -1505,6 +2453,9 @@ InternalServer::InternalServer(const ServerOptions& options)
       TRITONSERVER_ServerOptionsSetLogFormat(server_options, log_format));
   THROW_IF_TRITON_ERR(TRITONSERVER_ServerOptionsSetLogFile(
       server_options, options.logging_.log_file_.c_str()));
+  // The log settings are global to the process and applied as they are set,
+  // so the levels cached by the wrapper are refreshed right away.
+  RefreshLogLevels();
 
   // Set metrics options
   THROW_IF_TRITON_ERR(TRITONSERVER_ServerOptionsSetMetrics(
@@ -1614,12 +2565,53 @@ InternalServer::InternalServer(const ServerOptions& options)
   }
 
   // Set host policy
-  for (const auto& hp : options.host_policy_) {
+  std::vector<HostPolicy> host_policy = options.host_policy_;
+  std::vector<NumaNode> numa_nodes;
+  if (options.auto_host_policy_ || options.pin_wrapper_threads_) {
+    numa_nodes = NumaTopology();
+  }
+  if (options.auto_host_policy_ && host_policy.empty() &&
+      (numa_nodes.size() > 1)) {
+    host_policy = GenerateHostPolicies(numa_nodes);
+  }
+  for (const auto& hp : host_policy) {
     THROW_IF_TRITON_ERR(TRITONSERVER_ServerOptionsSetHostPolicy(
         server_options, hp.name_.c_str(),
         HostPolicySettingString(hp.setting_).c_str(), hp.value_.c_str()));
   }
 
+  // Pin the wrapper threads to the NUMA node the server is created on.
+  const NumaNode* wrapper_node = nullptr;
+  if (options.pin_wrapper_threads_) {
+    wrapper_node = CurrentNumaNode(numa_nodes);
+    if (wrapper_node != nullptr) {
+      wrapper_thread_cpus_ = wrapper_node->cpus_;
+    } else {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_WARN,
+          "Unable to determine the NUMA node of the current thread, wrapper "
+          "threads are not pinned.");
+    }
+  }
+  host_layout_ = HostLayoutString(numa_nodes, host_policy, wrapper_node);
+  LOG_MESSAGE(TRITONSERVER_LOG_INFO, host_layout_.c_str());
+
+  // Report the effective resources so that over-subscription of the
+  // container can be spotted.
+  const ContainerLimits& limits = ProcessContainerLimits();
+  resource_report_ = ResourceReportString(limits, options);
+  LOG_MESSAGE(TRITONSERVER_LOG_INFO, resource_report_.c_str());
+  if (options.model_load_thread_count_ > 2 * limits.effective_cpu_count_) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_WARN,
+        ("The model load thread count " +
+         std::to_string(options.model_load_thread_count_) +
+         " exceeds twice the number of CPUs the container can use (" +
+         std::to_string(limits.effective_cpu_count_) +
+         "), which may cause CPU throttling.")
+            .c_str());
+  }
+
   TRITONSERVER_Server* server_ptr;
   THROW_IF_TRITON_ERR(TRITONSERVER_ServerNew(&server_ptr, server_options));
   THROW_IF_TRITON_ERR(TRITONSERVER_ServerOptionsDelete(server_options));
@@ -1645,6 +2637,57 @@ InternalServer::InternalServer(const ServerOptions& options)
     trace_manager_ = nullptr;
   }
 
+  // Initialize the health cache
+  if (options.health_check_refresh_ms_ > 0) {
+    health_cache_ = std::make_shared<HealthCache>(server_.get());
+    health_cache_->Refresh();
+    StartHealthRefreshThread(options.health_check_refresh_ms_);
+  }
+
+  // Initialize the in-flight request watchdog
+  if (options.watchdog_ != nullptr) {
+    watchdog_ = std::make_shared<RequestWatchdog>(*options.watchdog_);
+    watchdog_->Start([this]() { PinWrapperThread(); });
+  }
+
+  // The phase counters of a model are created by its first request.
+  has_phase_counters_ = options.phase_counters_;
+  latency_histogram_bounds_us_ = options.latency_histogram_bounds_us_;
+  latency_histogram_exemplars_ = options.latency_histogram_exemplars_;
+
+  // Start publishing to the stats segment
+  if (stats_publisher_ != nullptr) {
+    stats_publisher_->Start([this]() { PinWrapperThread(); });
+  }
+
+  // Initialize the memory pressure monitor
+  if (options.memory_pressure_ != nullptr) {
+    memory_monitor_ = std::make_shared<MemoryPressureMonitor>(
+        *options.memory_pressure_, [this]() { TrimMemory(); });
+    memory_monitor_->Start([this]() { PinWrapperThread(); });
+  }
+
+  executor_ = std::make_shared<WorkStealingExecutor>(
+      options.executor_, [this]() { PinWrapperThread(); },
+      wrapper_thread_cpus_);
+
+  if (options.model_preloading_ != nullptr) {
+    model_preloader_ = std::make_shared<ModelPreloader>(
+        *options.model_preloading_,
+        [this]() {
+          const std::vector<std::string> model_names = RepositoryModelNames();
+          return std::set<std::string>(model_names.begin(), model_names.end());
+        },
+        [this]() { return LoadedModels(); },
+        [this](const std::string& model_name) { LoadModel(model_name); },
+        [this](const std::string& model_name) { UnloadModel(model_name); });
+    model_preloader_->Start([this]() { PinWrapperThread(); });
+  }
+
+  if ((repository_poll_secs_ > 0) && options.repository_poll_fingerprint_) {
+    repo_fingerprint_ = std::make_shared<RepositoryFingerprint>(
+        options.model_repository_paths_, executor_);
+  }
   StartRepoPollThread();
 }
 
@@ -1656,63 +2699,254 @@ InternalServer::~InternalServer()
         "Failed to delete allocator.");
   }
 
+  // The loader is stopped first since it refreshes the health cache.
+  if (startup_loader_ != nullptr) {
+    startup_loader_->Stop();
+  }
+  if (model_preloader_ != nullptr) {
+    model_preloader_->Stop();
+  }
   StopRepoPollThread();
+  StopHealthRefreshThread();
+  if (watchdog_ != nullptr) {
+    watchdog_->Stop();
+  }
+  if (memory_monitor_ != nullptr) {
+    memory_monitor_->Stop();
+  }
+  if (stats_publisher_ != nullptr) {
+    stats_publisher_->Stop();
+  }
+  executor_->Stop();
+}
+
+std::vector<std::string>
+InternalServer::RepositoryModelNames()
+{
+  TRITONSERVER_Message* message = nullptr;
+  THROW_IF_TRITON_ERR(TRITONSERVER_ServerModelIndex(
+      server_.get(), 0 /* flags */, &message));
+  const char* buffer;
+  size_t byte_size;
+  THROW_IF_TRITON_ERR(
+      TRITONSERVER_MessageSerializeToJson(message, &buffer, &byte_size));
+
+  common::TritonJson::Value repo_index;
+  THROW_IF_TRITON_ERR(repo_index.Parse(buffer, byte_size));
+  THROW_IF_TRITON_ERR(TRITONSERVER_MessageDelete(message));
+  // The index has an entry for each version of the loaded models.
+  std::set<std::string> model_names;
+  for (size_t i = 0; i < repo_index.ArraySize(); i++) {
+    triton::common::TritonJson::Value index;
+    THROW_IF_TRITON_ERR(repo_index.IndexAsObject(i, &index));
+    std::string name;
+    THROW_IF_TRITON_ERR(index.MemberAsString("name", &name));
+    model_names.insert(name);
+  }
+  return std::vector<std::string>(model_names.begin(), model_names.end());
+}
+
+void
+InternalServer::StartModelStartupLoader(
+    const std::vector<std::string>& model_names,
+    const bool disable_model_control)
+{
+  model_control_disabled_ = disable_model_control;
+  startup_loader_ = std::make_shared<ModelStartupLoader>(
+      server_.get(), model_names, [this]() { RefreshHealth(); });
+  startup_loader_->Start([this]() { PinWrapperThread(); });
+}
+
+void
+InternalServer::TrimMemory()
+{
+  TrimFutureStatePools();
+#ifdef __GLIBC__
+  // The output buffers are allocated with 'malloc', the memory they were
+  // allocated from is kept by the allocator after they are freed.
+  malloc_trim(0);
+#endif  // __GLIBC__
 }
 
 void
 InternalServer::StartRepoPollThread()
 {
   repo_poll_thread_ = std::thread([this]() {
+    PinWrapperThread();
+    const std::chrono::seconds wait_timeout(
+        (repository_poll_secs_ == 0) ? 3600 : repository_poll_secs_);
+    std::unique_lock<std::mutex> lock(exit_mu_);
     while (!is_exiting_) {
-      if (repository_poll_secs_ > 0) {
+      lock.unlock();
+      // The fingerprint is taken before the poll, so a change made during
+      // the poll is seen by the next one.
+      if ((repository_poll_secs_ > 0) &&
+          ((repo_fingerprint_ == nullptr) || repo_fingerprint_->Update())) {
         THROW_IF_TRITON_ERR(
             TRITONSERVER_ServerPollModelRepository(server_.get()));
+        RefreshHealth();
       }
-      std::unique_lock<std::mutex> lock(exit_mu_);
-      std::chrono::seconds wait_timeout(
-          (repository_poll_secs_ == 0) ? 3600 : repository_poll_secs_);
-      exit_cv_.wait_for(lock, wait_timeout);
+      lock.lock();
+      exit_cv_.wait_for(
+          lock, wait_timeout, [this]() { return is_exiting_.load(); });
+    }
+  });
+}
+
+void
+InternalServer::StartHealthRefreshThread(const int32_t refresh_ms)
+{
+  health_refresh_thread_ = std::thread([this, refresh_ms]() {
+    PinWrapperThread();
+    std::unique_lock<std::mutex> lock(exit_mu_);
+    while (!exit_cv_.wait_for(
+        lock, std::chrono::milliseconds(refresh_ms),
+        [this]() { return is_exiting_.load(); })) {
+      lock.unlock();
+      health_cache_->Refresh();
+      lock.lock();
     }
   });
 }
 
+void
+InternalServer::StopHealthRefreshThread()
+{
+  {
+    std::unique_lock<std::mutex> lock(exit_mu_);
+    is_exiting_ = true;
+    exit_cv_.notify_all();
+  }
+  // The thread uses the server object, so it must be joined before the server
+  // is deleted.
+  if (health_refresh_thread_.joinable()) {
+    health_refresh_thread_.join();
+  }
+}
+
+void
+InternalServer::PinWrapperThread()
+{
+  if (!wrapper_thread_cpus_.empty() &&
+      !PinCurrentThread(wrapper_thread_cpus_)) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_WARN,
+        ("Failed to pin wrapper thread to CPUs " + wrapper_thread_cpus_)
+            .c_str());
+  }
+}
+
 void
 InternalServer::StopRepoPollThread()
 {
-  std::unique_lock<std::mutex> lock(exit_mu_);
-  is_exiting_ = true;
-  exit_cv_.notify_all();
-  repo_poll_thread_.detach();
+  {
+    std::unique_lock<std::mutex> lock(exit_mu_);
+    is_exiting_ = true;
+    exit_cv_.notify_all();
+  }
+  // The thread uses the server object, so it must be joined before the server
+  // is deleted.
+  if (repo_poll_thread_.joinable()) {
+    repo_poll_thread_.join();
+  }
 }
 
 std::unique_ptr<InferResult>
 InternalServer::Infer(InferRequest& infer_request)
 {
-  std::future<std::unique_ptr<InferResult>> result_future =
-      AsyncInfer(infer_request);
+  InferFuture result_future = AsyncInfer(infer_request);
   return result_future.get();
 }
 
-std::future<std::unique_ptr<InferResult>>
+InferFuture
 InternalServer::AsyncInfer(InferRequest& infer_request)
 {
-  std::future<std::unique_ptr<InferResult>> result_future;
+  InferFuture result_future;
+  // The latency evaluated against the service level objective and recorded
+  // in the histograms includes the preparation of the request.
+  const bool records_latency = has_slo_trackers_ ||
+                               !latency_histogram_bounds_us_.empty() ||
+                               (stats_publisher_ != nullptr);
+  const auto start_time = records_latency
+                              ? std::chrono::steady_clock::now()
+                              : std::chrono::steady_clock::time_point();
   // The inference request object for sending internal requests.
   TRITONSERVER_InferenceRequest* irequest = nullptr;
   try {
-    infer_request.is_decoupled_ = IsModelDecoupled(infer_request);
-    PreprocessIrequest(&irequest, infer_request);
-
+    // The request is counted before it can be rejected, so that a request to
+    // a model that isn't loaded is counted as a cold start.
+    if (model_preloader_ != nullptr) {
+      model_preloader_->Record(infer_request.infer_options_->model_name_);
+    }
+    // Rejected requests are not sent to the server at all.
+    if (memory_monitor_ != nullptr) {
+      memory_monitor_->Admit(infer_request.infer_options_->priority_);
+      infer_request.memory_monitor_ = memory_monitor_;
+    }
+    infer_request.phase_counters_ =
+        has_phase_counters_
+            ? ModelPhaseCounters(infer_request.infer_options_->model_name_)
+            : nullptr;
     TRITONSERVER_InferenceTrace* triton_trace = nullptr;
-    PrepareTraceManager(infer_request);
-    if (trace_manager_) {
-      if (infer_request.trace_ != nullptr) {
-        triton_trace = infer_request.trace_->trace_;
+    {
+      PhaseScope prepare_scope(
+          infer_request.phase_counters_.get(), PhaseCounters::PREPARE);
+      infer_request.is_decoupled_ = IsModelDecoupled(infer_request);
+      PreprocessIrequest(&irequest, infer_request);
+
+      PrepareTraceManager(infer_request);
+      if (trace_manager_) {
+        if (infer_request.trace_ != nullptr) {
+          triton_trace = infer_request.trace_->trace_;
+        }
+      }
+    }
+
+    // The sample is attached before the request is submitted so that the
+    // response can be recorded, but the shadow request is only sent after.
+    infer_request.shadow_sample_.reset();
+    if (has_shadow_mirrors_) {
+      infer_request.shadow_sample_ = SampleShadow(infer_request);
+    }
+    std::shared_ptr<ShadowSample> shadow_sample = infer_request.shadow_sample_;
+    infer_request.slo_tracker_.reset();
+    infer_request.latency_histogram_.reset();
+    infer_request.live_stats_.reset();
+    if (records_latency) {
+      infer_request.start_time_ = start_time;
+      if (has_slo_trackers_ && !infer_request.is_decoupled_) {
+        infer_request.slo_tracker_ = ModelSloTracker(infer_request);
+      }
+      if (!latency_histogram_bounds_us_.empty() &&
+          !infer_request.is_decoupled_) {
+        infer_request.latency_histogram_ =
+            ModelLatencyHistogram(infer_request.infer_options_->model_name_);
+      }
+      if (stats_publisher_ != nullptr) {
+        infer_request.live_stats_ = stats_publisher_->ModelStats(
+            infer_request.infer_options_->model_name_);
+        if (infer_request.live_stats_ != nullptr) {
+          infer_request.live_stats_->Start();
+        }
       }
     }
     result_future = GetInferResult(infer_request, irequest, triton_trace);
+    if (shadow_sample != nullptr) {
+      MirrorRequest(shadow_sample);
+    }
   }
   catch (const TritonException& ex) {
+    infer_request.shadow_sample_.reset();
+    infer_request.slo_tracker_.reset();
+    infer_request.latency_histogram_.reset();
+    if (infer_request.live_stats_ != nullptr) {
+      infer_request.live_stats_->Abandon();
+      infer_request.live_stats_.reset();
+    }
+    if (infer_request.memory_monitor_ != nullptr) {
+      infer_request.memory_monitor_->Complete();
+      infer_request.memory_monitor_.reset();
+    }
     LOG_IF_ERROR(
         TRITONSERVER_InferenceRequestDelete(irequest),
         "Failed to delete inference request.");
@@ -1722,13 +2956,155 @@ InternalServer::AsyncInfer(InferRequest& infer_request)
   return result_future;
 }
 
+std::shared_ptr<SloTracker>
+InternalServer::ModelSloTracker(const InferRequest& infer_request)
+{
+  std::shared_ptr<const SloTrackers> trackers =
+      std::atomic_load(&slo_trackers_);
+  auto it = trackers->find(infer_request.infer_options_->model_name_);
+  return (it == trackers->end()) ? nullptr : it->second;
+}
+
+std::shared_ptr<ShadowSample>
+InternalServer::SampleShadow(InferRequest& infer_request)
+{
+  const InferOptions& options = *infer_request.infer_options_;
+  if (infer_request.is_decoupled_ || (options.correlation_id_ != 0) ||
+      !options.correlation_id_str_.empty()) {
+    return nullptr;
+  }
+  // Mirroring doubles the memory used by the sampled requests, so it is
+  // paused under memory pressure.
+  if ((memory_monitor_ != nullptr) &&
+      (memory_monitor_->Level() != MemoryPressure::Level::NONE)) {
+    return nullptr;
+  }
+  std::shared_ptr<ShadowMirror> mirror;
+  {
+    std::lock_guard<std::mutex> lk(shadow_mirrors_mu_);
+    auto it = shadow_mirrors_.find(options.model_name_);
+    if (it == shadow_mirrors_.end()) {
+      return nullptr;
+    }
+    mirror = it->second;
+  }
+  // The inputs are copied from host memory, so the requests with inputs in
+  // GPU memory are not mirrored.
+  for (const auto& input : infer_request.inputs_) {
+    if (input.second->memory_type_ == MemoryType::GPU) {
+      return nullptr;
+    }
+  }
+  std::shared_ptr<ShadowSample> sample = mirror->Sample();
+  if (sample != nullptr) {
+    PrepareMirror(infer_request, sample);
+  }
+  return sample;
+}
+
+void
+InternalServer::PrepareMirror(
+    InferRequest& infer_request, const std::shared_ptr<ShadowSample>& sample)
+{
+  try {
+    const ShadowMirroring& mirroring = sample->mirror_->Options();
+    InferOptions options(*infer_request.infer_options_);
+    options.model_name_ = mirroring.shadow_model_name_;
+    options.model_version_ = mirroring.shadow_model_version_;
+    options.custom_allocator_ = nullptr;
+    options.trace_ = nullptr;
+    sample->shadow_request_ = InferRequest::Create(options);
+    InferRequest& shadow_request = *sample->shadow_request_;
+
+    // The inputs are copied into one buffer owned by the sample, so that the
+    // mirrored request can be reset or destroyed as soon as its result is
+    // received, regardless of the shadow model.
+    size_t input_byte_size = 0;
+    for (const auto& input : infer_request.inputs_) {
+      input_byte_size += input.second->byte_size_;
+    }
+    sample->input_data_.reset(new char[std::max<size_t>(input_byte_size, 1)]);
+    char* input_data = sample->input_data_.get();
+    for (const auto& input : infer_request.inputs_) {
+      const Tensor& tensor = *input.second;
+      if (tensor.byte_size_ != 0) {
+        memcpy(input_data, tensor.buffer_, tensor.byte_size_);
+      }
+      shadow_request.inputs_[input.first] = std::make_unique<Tensor>(
+          input_data, tensor.byte_size_, tensor.data_type_, tensor.shape_,
+          MemoryType::CPU, 0);
+      input_data += tensor.byte_size_;
+    }
+    // The bound inputs are constant and shared with the shadow request.
+    if (infer_request.bound_inputs_ != nullptr) {
+      sample->bound_inputs_ = infer_request.bound_inputs_;
+      for (const auto& bound_input : infer_request.bound_inputs_->inputs_) {
+        if (shadow_request.inputs_.find(bound_input->name_) !=
+            shadow_request.inputs_.end()) {
+          continue;
+        }
+        shadow_request.inputs_[bound_input->name_] = std::make_unique<Tensor>(
+            bound_input->buffer_.get(), bound_input->byte_size_,
+            TritonToDataType(bound_input->data_type_), bound_input->shape_,
+            MemoryType::CPU, 0);
+      }
+    }
+    for (const auto& output : infer_request.outputs_) {
+      shadow_request.AddRequestedOutput(output->Name());
+    }
+  }
+  catch (const TritonException& ex) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_WARN,
+        std::string("Failed to mirror request to shadow model: ") + ex.what());
+    sample->shadow_request_.reset();
+    ShadowMirror::Record(
+        sample, true /* is_shadow */, true /* has_error */, ShadowOutputs());
+  }
+}
+
+void
+InternalServer::MirrorRequest(const std::shared_ptr<ShadowSample>& sample)
+{
+  if (sample->shadow_request_ == nullptr) {
+    // Already recorded as failed by 'PrepareMirror'.
+    return;
+  }
+  try {
+    sample->shadow_start_time_ = std::chrono::steady_clock::now();
+    AsyncInfer(*sample->shadow_request_).then([sample](InferFuture ready) {
+      bool has_error = true;
+      ShadowOutputs outputs;
+      try {
+        std::unique_ptr<InferResult> result = ready.get();
+        if (result != nullptr) {
+          has_error = result->has_error_;
+          outputs = result->infer_outputs_;
+        }
+      }
+      catch (...) {
+        // Recorded as a failed shadow request.
+      }
+      ShadowMirror::Record(
+          sample, true /* is_shadow */, has_error, std::move(outputs));
+    });
+  }
+  catch (const TritonException& ex) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_WARN,
+        (std::string("Failed to mirror request to shadow model: ") + ex.what())
+            .c_str());
+    ShadowMirror::Record(
+        sample, true /* is_shadow */, true /* has_error */, ShadowOutputs());
+  }
+}
+
 std::unique_ptr<GenericInferResult>
 InternalServer::Infer(GenericInferRequest& infer_request)
 {
   InferRequest* derived_ptr_request =
       dynamic_cast<InferRequest*>(&infer_request);
-  std::future<std::unique_ptr<InferResult>> result_future =
-      AsyncInfer(*derived_ptr_request);
+  InferFuture result_future = AsyncInfer(*derived_ptr_request);
   return result_future.get();
 }
 
@@ -1748,7 +3124,8 @@ InferRequest::Create(const InferOptions& options)
   return internal_request;
 }
 
-InferRequest::InferRequest() : is_decoupled_(false)
+InferRequest::InferRequest()
+    : dense_bufs_in_use_(0), in_flight_(nullptr), is_decoupled_(false)
 {
   str_bufs_.clear();
   inputs_.clear();
@@ -1759,11 +3136,7 @@ InferRequest::~InferRequest() {}
 
 InternalRequest::InternalRequest(const InferOptions& options) : InferRequest()
 {
-  infer_options_.reset(new InferOptions(
-      options.model_name_, options.model_version_, options.request_id_,
-      options.correlation_id_, options.correlation_id_str_,
-      options.sequence_start_, options.sequence_end_, options.priority_,
-      options.request_timeout_, options.custom_allocator_, options.trace_));
+  infer_options_.reset(new InferOptions(options));
 
   // Store custom allocator as a static variable as it's needed in global
   // functions.
@@ -1832,9 +3205,224 @@ InferRequest::AddRequestedOutput(const std::string& name)
 void
 InferRequest::Reset()
 {
+  shadow_sample_.reset();
   inputs_.clear();
   outputs_.clear();
   tensor_alloc_map_.clear();
+  input_bufs_.clear();
+  dense_bufs_in_use_ = 0;
+  bound_inputs_.reset();
+  output_usage_.reset();
+  aggregated_result_.reset();
+}
+
+char*
+InferRequest::AllocateInputBuffer(const size_t byte_size)
+{
+  input_bufs_.emplace_back(new char[byte_size]);
+  return input_bufs_.back().get();
+}
+
+char*
+InferRequest::AllocateDenseBuffer(const size_t byte_size)
+{
+  // Take the smallest kept buffer that is large enough.
+  size_t best = dense_bufs_.size();
+  for (size_t i = dense_bufs_in_use_; i < dense_bufs_.size(); ++i) {
+    if ((dense_bufs_[i].first >= byte_size) &&
+        ((best == dense_bufs_.size()) ||
+         (dense_bufs_[i].first < dense_bufs_[best].first))) {
+      best = i;
+    }
+  }
+  if (best == dense_bufs_.size()) {
+    void* buffer = nullptr;
+    if (posix_memalign(&buffer, 64, std::max(byte_size, size_t(1))) != 0) {
+      throw TritonException(
+          "failed to allocate " + std::to_string(byte_size) + " bytes.");
+    }
+    dense_bufs_.emplace_back(
+        byte_size, std::shared_ptr<char>(static_cast<char*>(buffer), free));
+  }
+  std::swap(dense_bufs_[dense_bufs_in_use_], dense_bufs_[best]);
+  return dense_bufs_[dense_bufs_in_use_++].second.get();
+}
+
+void
+InferRequest::AddSparseInput(
+    const std::string& name, const Tensor& indices, const Tensor& values,
+    const std::vector<int64_t>& dense_shape, const SparseFormat& format,
+    WorkExecutor* executor)
+{
+  try {
+    if ((indices.memory_type_ == MemoryType::GPU) ||
+        (values.memory_type_ == MemoryType::GPU)) {
+      throw TritonException(
+          "the indices and the values must be in CPU memory.");
+    }
+    if ((indices.data_type_ != DataType::INT32) &&
+        (indices.data_type_ != DataType::INT64)) {
+      throw TritonException(
+          "the indices must be INT32 or INT64, got " +
+          DataTypeString(indices.data_type_) + ".");
+    }
+    const size_t element_byte_size = DataTypeByteSize(values.data_type_);
+    if (element_byte_size == 0) {
+      throw TritonException(
+          "unsupported data type " + DataTypeString(values.data_type_) + ".");
+    }
+    if (values.byte_size_ % element_byte_size != 0) {
+      throw TritonException(
+          "the byte size of the values " + std::to_string(values.byte_size_) +
+          " is not a multiple of the element byte size.");
+    }
+
+    const size_t dense_byte_size =
+        DenseElementCount(dense_shape, element_byte_size) * element_byte_size;
+    char* buffer = AllocateDenseBuffer(dense_byte_size);
+    DensifySparseInput(
+        format, indices.buffer_, indices.byte_size_,
+        DataTypeByteSize(indices.data_type_), values.buffer_,
+        values.byte_size_ / element_byte_size, element_byte_size, dense_shape,
+        buffer, dense_byte_size, executor);
+    AddInput(
+        name, Tensor(
+                  buffer, dense_byte_size, values.data_type_, dense_shape,
+                  MemoryType::CPU, 0));
+  }
+  catch (const TritonException& ex) {
+    throw TritonException(std::string("Error - AddSparseInput: ") + ex.what());
+  }
+}
+
+RaggedBatchBuilder::RaggedBatchBuilder(
+    const DataType& data_type, const IndexKind& index_kind,
+    const DataType& index_data_type)
+    : data_type_(data_type), index_kind_(index_kind),
+      index_data_type_(index_data_type),
+      element_byte_size_(DataTypeByteSize(data_type)), element_count_(0)
+{
+  if (element_byte_size_ == 0) {
+    throw TritonException(
+        "Error - RaggedBatchBuilder: unsupported data type " +
+        DataTypeString(data_type));
+  }
+  if ((index_data_type != DataType::INT32) &&
+      (index_data_type != DataType::INT64)) {
+    throw TritonException(
+        "Error - RaggedBatchBuilder: index data type must be INT32 or INT64, "
+        "got " +
+        DataTypeString(index_data_type));
+  }
+}
+
+void
+RaggedBatchBuilder::AddItemBytes(const char* data, const size_t element_count)
+{
+  items_.push_back(data);
+  lengths_.push_back(element_count);
+  element_count_ += element_count;
+}
+
+void
+RaggedBatchBuilder::Clear()
+{
+  items_.clear();
+  lengths_.clear();
+  element_count_ = 0;
+}
+
+void
+RaggedBatchBuilder::Build(
+    InferRequest& request, const std::string& data_name,
+    const std::string& index_name)
+{
+  if (items_.empty()) {
+    throw TritonException(
+        "Error - RaggedBatchBuilder: no item is added for '" + data_name +
+        "'.");
+  }
+
+  // The index is placed at the front of the buffer and padded to 8 bytes so
+  // that the data following it is aligned for any fixed-size data type.
+  const size_t index_element_size = DataTypeByteSize(index_data_type_);
+  const size_t index_byte_size = index_element_size * items_.size();
+  const size_t data_offset = (index_byte_size + 7) & ~static_cast<size_t>(7);
+  const size_t data_byte_size = element_count_ * element_byte_size_;
+  char* buffer = request.AllocateInputBuffer(data_offset + data_byte_size);
+
+  char* index_ptr = buffer;
+  char* data_ptr = buffer + data_offset;
+  int64_t accumulated = 0;
+  for (size_t i = 0; i < items_.size(); ++i) {
+    const size_t item_byte_size = lengths_[i] * element_byte_size_;
+    if (item_byte_size != 0) {
+      memcpy(data_ptr, items_[i], item_byte_size);
+      data_ptr += item_byte_size;
+    }
+    accumulated += lengths_[i];
+    const int64_t value =
+        (index_kind_ == IndexKind::OFFSETS) ? accumulated : lengths_[i];
+    if (index_data_type_ == DataType::INT32) {
+      reinterpret_cast<int32_t*>(index_ptr)[i] = static_cast<int32_t>(value);
+    } else {
+      reinterpret_cast<int64_t*>(index_ptr)[i] = value;
+    }
+  }
+
+  request.AddInput(
+      data_name, Tensor(
+                     buffer + data_offset, data_byte_size, data_type_,
+                     {static_cast<int64_t>(element_count_)}, MemoryType::CPU,
+                     0));
+  request.AddInput(
+      index_name, Tensor(
+                      index_ptr, index_byte_size, index_data_type_,
+                      {static_cast<int64_t>(items_.size())}, MemoryType::CPU,
+                      0));
+}
+
+std::vector<Tensor>
+RaggedBatchBuilder::Unpack(
+    const Tensor& output, const std::vector<int64_t>& lengths)
+{
+  if (output.shape_.empty()) {
+    throw TritonException(
+        "Error - RaggedBatchBuilder: cannot unpack a scalar output.");
+  }
+  if (output.data_type_ == DataType::BYTES) {
+    throw TritonException(
+        "Error - RaggedBatchBuilder: cannot unpack a 'BYTES' output.");
+  }
+
+  int64_t total_length = 0;
+  for (const auto length : lengths) {
+    total_length += length;
+  }
+  if (total_length != output.shape_[0]) {
+    throw TritonException(
+        "Error - RaggedBatchBuilder: the sum of item lengths " +
+        std::to_string(total_length) +
+        " does not match the first dimension of the output " +
+        std::to_string(output.shape_[0]) + ".");
+  }
+
+  const size_t row_byte_size =
+      (total_length == 0) ? 0 : (output.byte_size_ / total_length);
+  std::vector<Tensor> views;
+  views.reserve(lengths.size());
+  size_t offset = 0;
+  for (const auto length : lengths) {
+    std::vector<int64_t> shape(output.shape_);
+    shape[0] = length;
+    const size_t byte_size = length * row_byte_size;
+    views.emplace_back(
+        output.buffer_ + offset, byte_size, output.data_type_, shape,
+        output.memory_type_, output.memory_type_id_);
+    offset += byte_size;
+  }
+
+  return views;
 }
 
 GenericInferResult::~GenericInferResult() {}
@@ -1850,11 +3438,15 @@ InternalResult::InternalResult() : InferResult() {}
 
 InternalResult::~InternalResult()
 {
+  PhaseScope release_scope(
+      phase_counters_.get(), PhaseCounters::OUTPUT_RELEASE);
   if (completed_response_ != nullptr) {
     LOG_IF_ERROR(
         TRITONSERVER_InferenceResponseDelete(completed_response_),
         "Failed to delete inference response.");
   }
+  // The outputs not held by the user are released within the phase.
+  infer_outputs_.clear();
 }
 
 void
@@ -1928,6 +3520,10 @@ InternalResult::FinalizeResponse(
       }
       infer_outputs_[name]->is_output_ = true;
     }
+
+    if (output_usage_ != nullptr) {
+      output_usage_->RecordResponse(infer_outputs_);
+    }
   }
   catch (const TritonException& ex) {
     if (response != nullptr) {
@@ -1943,6 +3539,144 @@ InternalResult::FinalizeResponse(
   completed_response_ = response;
 }
 
+void
+InternalResult::PrepareAggregation()
+{
+  if (has_error_) {
+    return;
+  }
+
+  try {
+    for (auto& output : infer_outputs_) {
+      const Tensor& tensor = *output.second;
+      if (tensor.shape_.empty()) {
+        throw TritonException(
+            "output '" + output.first +
+            "' has no dimension to be concatenated along.");
+      }
+      if ((tensor.memory_type_ == MemoryType::CPU) && !tensor.is_pre_alloc_ &&
+          (tensor.custom_allocator_ == nullptr)) {
+        // The buffer is allocated with 'malloc' by the default allocator and
+        // can be grown as it is.
+        output_capacity_[output.first] = tensor.byte_size_;
+      } else {
+        output.second = GrowableOutput(output.first, tensor);
+      }
+    }
+  }
+  catch (const TritonException& ex) {
+    has_error_ = true;
+    error_msg_ = std::string("Error - PrepareAggregation: ") + ex.what();
+  }
+}
+
+void
+InternalResult::AggregateResponse(const InternalResult& response)
+{
+  if (has_error_) {
+    return;
+  }
+  if (response.has_error_) {
+    has_error_ = true;
+    error_msg_ = response.error_msg_;
+    return;
+  }
+
+  try {
+    for (const auto& output : response.infer_outputs_) {
+      const Tensor& src = *output.second;
+      auto it = infer_outputs_.find(output.first);
+      if (it == infer_outputs_.end()) {
+        infer_outputs_[output.first] = GrowableOutput(output.first, src);
+        continue;
+      }
+
+      Tensor& dst = *it->second;
+      if (src.memory_type_ == MemoryType::GPU) {
+        throw TritonException(
+            "output '" + output.first + "' is not in CPU memory.");
+      }
+      if ((src.data_type_ != dst.data_type_) ||
+          (src.shape_.size() != dst.shape_.size()) ||
+          !std::equal(
+              src.shape_.begin() + 1, src.shape_.end(),
+              dst.shape_.begin() + 1)) {
+        throw TritonException(
+            "output '" + output.first +
+            "' does not match the data type or the shape of the previous "
+            "responses.");
+      }
+
+      const size_t byte_size = dst.byte_size_ + src.byte_size_;
+      size_t& capacity = output_capacity_[output.first];
+      if (byte_size > capacity) {
+        // Grow geometrically so that the number of reallocations is
+        // logarithmic to the number of responses.
+        const size_t new_capacity = std::max(byte_size, capacity * 2);
+        char* buffer =
+            reinterpret_cast<char*>(realloc(dst.buffer_, new_capacity));
+        if (buffer == nullptr) {
+          throw TritonException(
+              "failed to allocate " + std::to_string(new_capacity) +
+              " bytes for output '" + output.first + "'.");
+        }
+        dst.buffer_ = buffer;
+        capacity = new_capacity;
+      }
+      if (src.byte_size_ != 0) {
+        memcpy(dst.buffer_ + dst.byte_size_, src.buffer_, src.byte_size_);
+      }
+      dst.byte_size_ = byte_size;
+      dst.shape_[0] += src.shape_[0];
+    }
+  }
+  catch (const TritonException& ex) {
+    has_error_ = true;
+    error_msg_ = std::string("Error - AggregateResponse: ") + ex.what();
+  }
+}
+
+std::shared_ptr<Tensor>
+InternalResult::OwnedOutput(
+    char* buffer, const size_t byte_size, const DataType& data_type,
+    const std::vector<int64_t>& shape)
+{
+  std::shared_ptr<Tensor> tensor = std::make_shared<Tensor>(
+      buffer, byte_size, data_type, shape, MemoryType::CPU, 0);
+  tensor->is_output_ = true;
+  return tensor;
+}
+
+std::shared_ptr<Tensor>
+InternalResult::GrowableOutput(const std::string& name, const Tensor& output)
+{
+  if (output.memory_type_ == MemoryType::GPU) {
+    throw TritonException("output '" + name + "' is not in CPU memory.");
+  }
+  if (output.shape_.empty()) {
+    throw TritonException(
+        "output '" + name + "' has no dimension to be concatenated along.");
+  }
+
+  char* buffer =
+      reinterpret_cast<char*>(malloc(std::max(output.byte_size_, size_t(1))));
+  if (buffer == nullptr) {
+    throw TritonException(
+        "failed to allocate " + std::to_string(output.byte_size_) +
+        " bytes for output '" + name + "'.");
+  }
+  if (output.byte_size_ != 0) {
+    memcpy(buffer, output.buffer_, output.byte_size_);
+  }
+  std::shared_ptr<Tensor> tensor = std::make_shared<Tensor>(
+      buffer, output.byte_size_, output.data_type_, output.shape_,
+      MemoryType::CPU, 0);
+  tensor->is_output_ = true;
+  output_capacity_[name] = output.byte_size_;
+
+  return tensor;
+}
+
 std::string
 InferResult::ModelName() noexcept
 {
@@ -1976,8 +3710,12 @@ std::shared_ptr<Tensor>
 InferResult::Output(const std::string& name)
 {
   std::shared_ptr<Tensor> output;
-  if (infer_outputs_.find(name) != infer_outputs_.end()) {
-    output = infer_outputs_[name];
+  auto it = infer_outputs_.find(name);
+  if (output_usage_ != nullptr) {
+    output_usage_->RecordAccess(name, it != infer_outputs_.end());
+  }
+  if (it != infer_outputs_.end()) {
+    output = it->second;
   } else {
     throw TritonException(
         std::string("Error - Output: ") +
@@ -1991,6 +3729,10 @@ std::vector<std::string>
 InferResult::StringData(const std::string& name)
 {
   std::vector<std::string> string_result;
+  if (output_usage_ != nullptr) {
+    output_usage_->RecordAccess(
+        name, infer_outputs_.find(name) != infer_outputs_.end());
+  }
   if (infer_outputs_.find(name) != infer_outputs_.end()) {
     if (infer_outputs_[name]->data_type_ == DataType::BYTES) {
       const char* buf =
@@ -2118,4 +3860,175 @@ InferResult::GetNextResult()
   return std::move(next_result_future_);
 }
 
+//==============================================================================
+/// Gather outputs from results.
+///
+struct GatherLayout {
+  // The outputs to be gathered and their offsets in the gathered output.
+  std::vector<std::shared_ptr<Tensor>> outputs_;
+  std::vector<size_t> offsets_;
+  DataType data_type_;
+  std::vector<int64_t> shape_;
+  size_t byte_size_;
+};
+
+void
+ComputeGatherLayout(
+    std::vector<std::unique_ptr<InferResult>>& results,
+    const std::string& name, GatherLayout* layout)
+{
+  if (results.empty()) {
+    throw TritonException("no result to gather output '" + name + "' from.");
+  }
+
+  layout->byte_size_ = 0;
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (results[i] == nullptr) {
+      throw TritonException("result " + std::to_string(i) + " is empty.");
+    }
+    if (results[i]->HasError()) {
+      throw TritonException(
+          "result " + std::to_string(i) + " has error: " +
+          results[i]->ErrorMsg());
+    }
+    std::shared_ptr<Tensor> output = results[i]->Output(name);
+    if (output->memory_type_ == MemoryType::GPU) {
+      throw TritonException(
+          "output '" + name + "' of result " + std::to_string(i) +
+          " is not in CPU memory.");
+    }
+    if (output->shape_.empty()) {
+      throw TritonException(
+          "output '" + name + "' has no dimension to be gathered along.");
+    }
+    if (i == 0) {
+      layout->data_type_ = output->data_type_;
+      layout->shape_ = output->shape_;
+    } else if (
+        (output->data_type_ != layout->data_type_) ||
+        (output->shape_.size() != layout->shape_.size()) ||
+        !std::equal(
+            output->shape_.begin() + 1, output->shape_.end(),
+            layout->shape_.begin() + 1)) {
+      throw TritonException(
+          "output '" + name + "' of result " + std::to_string(i) +
+          " does not match the data type or the shape of result 0.");
+    } else {
+      layout->shape_[0] += output->shape_[0];
+    }
+    layout->offsets_.push_back(layout->byte_size_);
+    layout->byte_size_ += output->byte_size_;
+    layout->outputs_.push_back(std::move(output));
+  }
+}
+
+void
+GatherCopy(
+    std::vector<std::unique_ptr<InferResult>>& results, GatherLayout& layout,
+    char* buffer, const bool release_results, WorkExecutor* executor)
+{
+  const bool non_temporal = layout.byte_size_ >= kGatherNonTemporalByteSize;
+  auto copy_fn = [&results, &layout, buffer, release_results, non_temporal](
+                     const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const Tensor& output = *layout.outputs_[i];
+      if (non_temporal) {
+        StreamCopy(
+            buffer + layout.offsets_[i], output.buffer_, output.byte_size_);
+      } else if (output.byte_size_ != 0) {
+        memcpy(buffer + layout.offsets_[i], output.buffer_, output.byte_size_);
+      }
+      if (release_results) {
+        layout.outputs_[i].reset();
+        results[i].reset();
+      }
+    }
+#ifdef __SSE2__
+    if (non_temporal) {
+      _mm_sfence();
+    }
+#endif  // __SSE2__
+  };
+
+  if ((executor != nullptr) &&
+      (layout.byte_size_ >= 2 * kGatherParallelByteSize) &&
+      (layout.outputs_.size() > 1)) {
+    // Split the byte range of the gathered output, each chunk copies the
+    // results whose output starts in it.
+    executor->ParallelFor(
+        0, layout.byte_size_, kGatherParallelByteSize,
+        [&layout, &copy_fn](const size_t begin, const size_t end) {
+          copy_fn(
+              std::lower_bound(
+                  layout.offsets_.begin(), layout.offsets_.end(), begin) -
+                  layout.offsets_.begin(),
+              std::lower_bound(
+                  layout.offsets_.begin(), layout.offsets_.end(), end) -
+                  layout.offsets_.begin());
+        });
+    return;
+  }
+
+  // Without an executor the copy is done by the calling thread, starting
+  // threads for each call costs more than it saves under load.
+  copy_fn(0, layout.outputs_.size());
+}
+
+std::shared_ptr<Tensor>
+GatherOutputs(
+    std::vector<std::unique_ptr<InferResult>>& results,
+    const std::string& name, const bool release_results,
+    WorkExecutor* executor)
+{
+  try {
+    GatherLayout layout;
+    ComputeGatherLayout(results, name, &layout);
+
+    void* buffer = nullptr;
+    if (posix_memalign(&buffer, 64, std::max(layout.byte_size_, size_t(1))) !=
+        0) {
+      throw TritonException(
+          "failed to allocate " + std::to_string(layout.byte_size_) +
+          " bytes for output '" + name + "'.");
+    }
+    // The tensor owns the buffer from here in case the copy fails.
+    std::shared_ptr<Tensor> output = InternalResult::OwnedOutput(
+        reinterpret_cast<char*>(buffer), layout.byte_size_, layout.data_type_,
+        layout.shape_);
+    GatherCopy(results, layout, output->buffer_, release_results, executor);
+    return output;
+  }
+  catch (const TritonException& ex) {
+    throw TritonException(std::string("Error - GatherOutputs: ") + ex.what());
+  }
+}
+
+void
+GatherOutputs(
+    std::vector<std::unique_ptr<InferResult>>& results,
+    const std::string& name, Tensor& output, const bool release_results,
+    WorkExecutor* executor)
+{
+  try {
+    if (output.memory_type_ == MemoryType::GPU) {
+      throw TritonException("the buffer to gather into is not in CPU memory.");
+    }
+    GatherLayout layout;
+    ComputeGatherLayout(results, name, &layout);
+    if (layout.byte_size_ > output.byte_size_) {
+      throw TritonException(
+          "the buffer to gather into has " +
+          std::to_string(output.byte_size_) + " bytes, " +
+          std::to_string(layout.byte_size_) + " bytes are required.");
+    }
+    GatherCopy(results, layout, output.buffer_, release_results, executor);
+    output.byte_size_ = layout.byte_size_;
+    output.data_type_ = layout.data_type_;
+    output.shape_ = layout.shape_;
+  }
+  catch (const TritonException& ex) {
+    throw TritonException(std::string("Error - GatherOutputs: ") + ex.what());
+  }
+}
+
 }}}  // namespace triton::developer_tools::server
@@ -0,0 +1,408 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "shadow_mirror.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "log.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+template <typename T>
+double
+ReadElement(const char* buffer, const size_t idx)
+{
+  T value;
+  memcpy(&value, buffer + idx * sizeof(T), sizeof(T));
+  return static_cast<double>(value);
+}
+
+// Read the element 'idx' of a tensor in host memory as a double. Return false
+// if the elements of the tensor are not numeric.
+bool
+NumericElement(const Tensor& tensor, const size_t idx, double* value)
+{
+  switch (tensor.data_type_) {
+    case DataType::UINT8:
+      *value = ReadElement<uint8_t>(tensor.buffer_, idx);
+      return true;
+    case DataType::UINT16:
+      *value = ReadElement<uint16_t>(tensor.buffer_, idx);
+      return true;
+    case DataType::UINT32:
+      *value = ReadElement<uint32_t>(tensor.buffer_, idx);
+      return true;
+    case DataType::UINT64:
+      *value = ReadElement<uint64_t>(tensor.buffer_, idx);
+      return true;
+    case DataType::INT8:
+      *value = ReadElement<int8_t>(tensor.buffer_, idx);
+      return true;
+    case DataType::INT16:
+      *value = ReadElement<int16_t>(tensor.buffer_, idx);
+      return true;
+    case DataType::INT32:
+      *value = ReadElement<int32_t>(tensor.buffer_, idx);
+      return true;
+    case DataType::INT64:
+      *value = ReadElement<int64_t>(tensor.buffer_, idx);
+      return true;
+    case DataType::FP32:
+      *value = ReadElement<float>(tensor.buffer_, idx);
+      return true;
+    case DataType::FP64:
+      *value = ReadElement<double>(tensor.buffer_, idx);
+      return true;
+    default:
+      return false;
+  }
+}
+
+size_t
+NumericElementByteSize(const DataType& data_type)
+{
+  switch (data_type) {
+    case DataType::UINT8:
+    case DataType::INT8:
+      return 1;
+    case DataType::UINT16:
+    case DataType::INT16:
+      return 2;
+    case DataType::UINT32:
+    case DataType::INT32:
+    case DataType::FP32:
+      return 4;
+    case DataType::UINT64:
+    case DataType::INT64:
+    case DataType::FP64:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+// Compare an output of the mirrored request with the same output of the
+// shadow request. Return true if they match, and update 'max_abs_diff' with
+// the largest difference between numeric elements.
+bool
+CompareOutput(
+    const Tensor& primary, const Tensor& shadow, const double tolerance,
+    double* max_abs_diff)
+{
+  if ((primary.data_type_ != shadow.data_type_) ||
+      (primary.shape_ != shadow.shape_) ||
+      (primary.byte_size_ != shadow.byte_size_)) {
+    return false;
+  }
+  const size_t element_byte_size = NumericElementByteSize(primary.data_type_);
+  if (element_byte_size == 0) {
+    return (primary.byte_size_ == 0) ||
+           (memcmp(primary.buffer_, shadow.buffer_, primary.byte_size_) == 0);
+  }
+
+  bool match = true;
+  const size_t element_count = primary.byte_size_ / element_byte_size;
+  for (size_t idx = 0; idx < element_count; ++idx) {
+    double primary_value = 0;
+    double shadow_value = 0;
+    NumericElement(primary, idx, &primary_value);
+    NumericElement(shadow, idx, &shadow_value);
+    if (std::isnan(primary_value) || std::isnan(shadow_value)) {
+      if (std::isnan(primary_value) != std::isnan(shadow_value)) {
+        match = false;
+      }
+      continue;
+    }
+    const double diff = std::fabs(primary_value - shadow_value);
+    if (diff > tolerance) {
+      match = false;
+    }
+    if (diff > *max_abs_diff) {
+      *max_abs_diff = diff;
+    }
+  }
+  return match;
+}
+
+std::shared_ptr<ShadowMetricFamilies>
+ShadowMetricFamilies::Get()
+{
+  static std::mutex mu;
+  static std::weak_ptr<ShadowMetricFamilies> instance;
+  std::lock_guard<std::mutex> lk(mu);
+  std::shared_ptr<ShadowMetricFamilies> families = instance.lock();
+  if (families == nullptr) {
+    families.reset(new ShadowMetricFamilies());
+    instance = families;
+  }
+  return families;
+}
+
+ShadowMetricFamilies::ShadowMetricFamilies()
+    : mirrored_(nullptr), divergent_(nullptr), latency_delta_(nullptr)
+{
+  // The metrics can't be created if metrics are disabled in the server, the
+  // mirroring still works without them.
+  TRITONSERVER_Error* err = TRITONSERVER_MetricFamilyNew(
+      &mirrored_, TRITONSERVER_METRIC_KIND_COUNTER, "tds_shadow_requests",
+      "Number of inference requests mirrored to a shadow model");
+  if (err == nullptr) {
+    err = TRITONSERVER_MetricFamilyNew(
+        &divergent_, TRITONSERVER_METRIC_KIND_COUNTER,
+        "tds_shadow_divergent_requests",
+        "Number of mirrored inference requests whose shadow outputs differ");
+  }
+  if (err == nullptr) {
+    err = TRITONSERVER_MetricFamilyNew(
+        &latency_delta_, TRITONSERVER_METRIC_KIND_GAUGE,
+        "tds_shadow_latency_delta_us",
+        "Average latency of the shadow requests minus the average latency of "
+        "the mirrored requests in microseconds");
+  }
+  if (err != nullptr) {
+    LOG_IF_ERROR(err, "Shadow mirroring metrics are not available");
+    for (auto family : {&mirrored_, &divergent_, &latency_delta_}) {
+      if (*family != nullptr) {
+        LOG_IF_ERROR(
+            TRITONSERVER_MetricFamilyDelete(*family),
+            "Failed to delete shadow mirroring metric family");
+        *family = nullptr;
+      }
+    }
+  }
+}
+
+ShadowMetricFamilies::~ShadowMetricFamilies()
+{
+  for (auto family : {mirrored_, divergent_, latency_delta_}) {
+    if (family != nullptr) {
+      LOG_IF_ERROR(
+          TRITONSERVER_MetricFamilyDelete(family),
+          "Failed to delete shadow mirroring metric family");
+    }
+  }
+}
+
+ShadowSample::ShadowSample(const std::shared_ptr<ShadowMirror>& mirror)
+    : mirror_(mirror), start_time_(std::chrono::steady_clock::now()),
+      primary_done_(false), shadow_done_(false), primary_error_(false),
+      shadow_error_(false), primary_latency_us_(0), shadow_latency_us_(0)
+{
+}
+
+ShadowSample::~ShadowSample()
+{
+  mirror_->in_flight_count_--;
+}
+
+ShadowMirror::ShadowMirror(
+    const std::string& model_name, const ShadowMirroring& options,
+    const std::shared_ptr<WorkExecutor>& executor)
+    : model_name_(model_name), options_(options), executor_(executor),
+      request_count_(0), in_flight_count_(0), mirrored_count_(0),
+      dropped_count_(0), compared_count_(0), divergent_count_(0),
+      shadow_error_count_(0), max_abs_diff_(0), total_primary_latency_us_(0),
+      total_shadow_latency_us_(0), families_(ShadowMetricFamilies::Get()),
+      mirrored_metric_(nullptr), divergent_metric_(nullptr),
+      latency_delta_metric_(nullptr)
+{
+  if (families_->mirrored_ == nullptr) {
+    return;
+  }
+  TRITONSERVER_Parameter* model_label = TRITONSERVER_ParameterNew(
+      "model", TRITONSERVER_PARAMETER_STRING, model_name_.c_str());
+  TRITONSERVER_Parameter* shadow_label = TRITONSERVER_ParameterNew(
+      "shadow_model", TRITONSERVER_PARAMETER_STRING,
+      options_.shadow_model_name_.c_str());
+  const TRITONSERVER_Parameter* labels[] = {model_label, shadow_label};
+  LOG_IF_ERROR(
+      TRITONSERVER_MetricNew(
+          &mirrored_metric_, families_->mirrored_, labels, 2),
+      "Failed to create shadow mirroring metric");
+  LOG_IF_ERROR(
+      TRITONSERVER_MetricNew(
+          &divergent_metric_, families_->divergent_, labels, 2),
+      "Failed to create shadow mirroring metric");
+  LOG_IF_ERROR(
+      TRITONSERVER_MetricNew(
+          &latency_delta_metric_, families_->latency_delta_, labels, 2),
+      "Failed to create shadow mirroring metric");
+  TRITONSERVER_ParameterDelete(model_label);
+  TRITONSERVER_ParameterDelete(shadow_label);
+}
+
+ShadowMirror::~ShadowMirror()
+{
+  for (auto metric :
+       {mirrored_metric_, divergent_metric_, latency_delta_metric_}) {
+    if (metric != nullptr) {
+      LOG_IF_ERROR(
+          TRITONSERVER_MetricDelete(metric),
+          "Failed to delete shadow mirroring metric");
+    }
+  }
+}
+
+std::shared_ptr<ShadowSample>
+ShadowMirror::Sample()
+{
+  // Mirror one request every '1 / sample_rate_' requests.
+  const uint64_t n = request_count_.fetch_add(1);
+  if (std::floor((n + 1) * options_.sample_rate_) ==
+      std::floor(n * options_.sample_rate_)) {
+    return nullptr;
+  }
+
+  uint32_t in_flight_count = in_flight_count_.load();
+  do {
+    if (in_flight_count >= options_.max_in_flight_) {
+      dropped_count_++;
+      return nullptr;
+    }
+  } while (!in_flight_count_.compare_exchange_weak(
+      in_flight_count, in_flight_count + 1));
+
+  mirrored_count_++;
+  if (mirrored_metric_ != nullptr) {
+    LOG_IF_ERROR(
+        TRITONSERVER_MetricIncrement(mirrored_metric_, 1),
+        "Failed to increment shadow mirroring metric");
+  }
+  return std::make_shared<ShadowSample>(shared_from_this());
+}
+
+void
+ShadowMirror::Record(
+    std::shared_ptr<ShadowSample> sample, const bool is_shadow,
+    const bool has_error, ShadowOutputs&& outputs)
+{
+  const auto now = std::chrono::steady_clock::now();
+  bool completed = false;
+  {
+    std::lock_guard<std::mutex> lk(sample->mu_);
+    if (is_shadow) {
+      sample->shadow_done_ = true;
+      sample->shadow_error_ = has_error;
+      sample->shadow_latency_us_ =
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              now - sample->shadow_start_time_)
+              .count();
+      sample->shadow_outputs_ = std::move(outputs);
+    } else {
+      sample->primary_done_ = true;
+      sample->primary_error_ = has_error;
+      sample->primary_latency_us_ =
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              now - sample->start_time_)
+              .count();
+      sample->primary_outputs_ = std::move(outputs);
+    }
+    completed = sample->primary_done_ && sample->shadow_done_;
+  }
+  if (completed) {
+    std::shared_ptr<WorkExecutor> executor = sample->mirror_->executor_;
+    executor->Submit(
+        [sample]() { sample->mirror_->Compare(*sample); },
+        TaskPriority::BACKGROUND);
+  }
+}
+
+void
+ShadowMirror::Compare(const ShadowSample& sample)
+{
+  if (sample.primary_error_) {
+    // Nothing to compare against.
+    return;
+  }
+  if (sample.shadow_error_) {
+    std::lock_guard<std::mutex> lk(mu_);
+    shadow_error_count_++;
+    return;
+  }
+
+  bool divergent = false;
+  double max_abs_diff = 0;
+  for (const auto& output : sample.primary_outputs_) {
+    auto it = sample.shadow_outputs_.find(output.first);
+    if ((it == sample.shadow_outputs_.end()) ||
+        !CompareOutput(
+            *output.second, *it->second, options_.tolerance_,
+            &max_abs_diff)) {
+      divergent = true;
+    }
+  }
+
+  double latency_delta_us = 0;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    compared_count_++;
+    if (divergent) {
+      divergent_count_++;
+    }
+    max_abs_diff_ = std::max(max_abs_diff_, max_abs_diff);
+    total_primary_latency_us_ += sample.primary_latency_us_;
+    total_shadow_latency_us_ += sample.shadow_latency_us_;
+    latency_delta_us = (static_cast<double>(total_shadow_latency_us_) -
+                        static_cast<double>(total_primary_latency_us_)) /
+                       compared_count_;
+  }
+  if (divergent && (divergent_metric_ != nullptr)) {
+    LOG_IF_ERROR(
+        TRITONSERVER_MetricIncrement(divergent_metric_, 1),
+        "Failed to increment shadow mirroring metric");
+  }
+  if (latency_delta_metric_ != nullptr) {
+    LOG_IF_ERROR(
+        TRITONSERVER_MetricSet(latency_delta_metric_, latency_delta_us),
+        "Failed to set shadow mirroring metric");
+  }
+}
+
+ShadowMirroringStats
+ShadowMirror::Stats()
+{
+  ShadowMirroringStats stats;
+  stats.mirrored_count_ = mirrored_count_;
+  stats.dropped_count_ = dropped_count_;
+  std::lock_guard<std::mutex> lk(mu_);
+  stats.compared_count_ = compared_count_;
+  stats.divergent_count_ = divergent_count_;
+  stats.shadow_error_count_ = shadow_error_count_;
+  stats.max_abs_diff_ = max_abs_diff_;
+  if (compared_count_ != 0) {
+    stats.avg_primary_latency_us_ =
+        static_cast<double>(total_primary_latency_us_) / compared_count_;
+    stats.avg_shadow_latency_us_ =
+        static_cast<double>(total_shadow_latency_us_) / compared_count_;
+  }
+  return stats;
+}
+
+}}}  // namespace triton::developer_tools::server
@@ -0,0 +1,150 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "triton/core/tritonserver.h"
+#include "triton/developer_tools/server_wrapper.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+using ShadowOutputs = std::unordered_map<std::string, std::shared_ptr<Tensor>>;
+
+//==============================================================================
+/// The metric families of the shadow mirrors, shared by all the servers of
+/// the process since a family can only be registered once.
+///
+class ShadowMetricFamilies {
+ public:
+  static std::shared_ptr<ShadowMetricFamilies> Get();
+
+  ~ShadowMetricFamilies();
+
+  // The families are nullptr if metrics are not available.
+  TRITONSERVER_MetricFamily* mirrored_;
+  TRITONSERVER_MetricFamily* divergent_;
+  TRITONSERVER_MetricFamily* latency_delta_;
+
+ private:
+  ShadowMetricFamilies();
+};
+
+class ShadowMirror;
+
+//==============================================================================
+/// A request mirrored to the shadow model. It holds a slot of the in-flight
+/// budget of its mirror, the copy of the inputs read by the shadow request,
+/// and the results of both models until they are compared.
+///
+struct ShadowSample {
+  ShadowSample(const std::shared_ptr<ShadowMirror>& mirror);
+
+  ~ShadowSample();
+
+  std::shared_ptr<ShadowMirror> mirror_;
+  // The copy of the inputs of the mirrored request.
+  std::unique_ptr<char[]> input_data_;
+  // The constant inputs bound to the model of the mirrored request, which are
+  // shared with the shadow request.
+  std::shared_ptr<const void> bound_inputs_;
+  std::unique_ptr<InferRequest> shadow_request_;
+  std::chrono::steady_clock::time_point start_time_;
+  std::chrono::steady_clock::time_point shadow_start_time_;
+
+  std::mutex mu_;
+  bool primary_done_;
+  bool shadow_done_;
+  bool primary_error_;
+  bool shadow_error_;
+  uint64_t primary_latency_us_;
+  uint64_t shadow_latency_us_;
+  ShadowOutputs primary_outputs_;
+  ShadowOutputs shadow_outputs_;
+};
+
+//==============================================================================
+/// Mirrors a sample of the requests of a model to its shadow model and
+/// compares their outputs and latencies. See
+/// 'TritonServer::EnableShadowMirroring' for more information.
+///
+class ShadowMirror : public std::enable_shared_from_this<ShadowMirror> {
+ public:
+  ShadowMirror(
+      const std::string& model_name, const ShadowMirroring& options,
+      const std::shared_ptr<WorkExecutor>& executor);
+
+  ~ShadowMirror();
+
+  const ShadowMirroring& Options() const { return options_; }
+
+  // Return a sample if the next request of the model should be mirrored, or
+  // nullptr if it is not sampled or if the in-flight budget is exhausted.
+  std::shared_ptr<ShadowSample> Sample();
+
+  // Record the result of the mirrored request, or of its shadow request if
+  // 'is_shadow'. The comparison is submitted to the background lane of the
+  // executor once both are recorded, off the path of the requests.
+  static void Record(
+      std::shared_ptr<ShadowSample> sample, const bool is_shadow,
+      const bool has_error, ShadowOutputs&& outputs);
+
+  ShadowMirroringStats Stats();
+
+ private:
+  friend struct ShadowSample;
+
+  void Compare(const ShadowSample& sample);
+
+  const std::string model_name_;
+  const ShadowMirroring options_;
+  std::shared_ptr<WorkExecutor> executor_;
+
+  std::atomic<uint64_t> request_count_;
+  std::atomic<uint32_t> in_flight_count_;
+  std::atomic<uint64_t> mirrored_count_;
+  std::atomic<uint64_t> dropped_count_;
+
+  std::mutex mu_;
+  uint64_t compared_count_;
+  uint64_t divergent_count_;
+  uint64_t shadow_error_count_;
+  double max_abs_diff_;
+  uint64_t total_primary_latency_us_;
+  uint64_t total_shadow_latency_us_;
+
+  std::shared_ptr<ShadowMetricFamilies> families_;
+  TRITONSERVER_Metric* mirrored_metric_;
+  TRITONSERVER_Metric* divergent_metric_;
+  TRITONSERVER_Metric* latency_delta_metric_;
+};
+
+}}}  // namespace triton::developer_tools::server
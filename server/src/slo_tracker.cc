@@ -0,0 +1,215 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "slo_tracker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+namespace triton { namespace developer_tools { namespace server {
+
+// A bucket counter holds the tag of its bucket in the high bits and the count
+// in the low bits.
+constexpr int kSloCountBits = 40;
+constexpr uint64_t kSloCountMask = (uint64_t(1) << kSloCountBits) - 1;
+constexpr uint64_t kSloTagMask = (uint64_t(1) << (64 - kSloCountBits)) - 1;
+
+SloTracker::SloTracker(const ServiceLevelObjective& objective)
+    : objective_(objective)
+{
+  const uint32_t shortest_window_s = *std::min_element(
+      objective.windows_s_.begin(), objective.windows_s_.end());
+  const uint32_t longest_window_s = *std::max_element(
+      objective.windows_s_.begin(), objective.windows_s_.end());
+  // The windows are rounded to a bucket, 60 buckets keep the error of the
+  // shortest window under 2%.
+  bucket_s_ = std::max<uint64_t>(1, shortest_window_s / 60);
+  bucket_count_ = (longest_window_s + bucket_s_ - 1) / bucket_s_;
+  buckets_.reset(new Bucket[bucket_count_]);
+  for (size_t i = 0; i < bucket_count_; ++i) {
+    for (auto& counter : buckets_[i].counters_) {
+      counter = 0;
+    }
+  }
+  for (auto& total : totals_) {
+    total = 0;
+  }
+}
+
+uint64_t
+SloTracker::BucketIndex(const std::chrono::steady_clock::time_point& time) const
+{
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             time.time_since_epoch())
+             .count() /
+         bucket_s_;
+}
+
+void
+SloTracker::Record(
+    const std::chrono::steady_clock::time_point& start_time, const bool failed)
+{
+  const auto now = std::chrono::steady_clock::now();
+  const bool slow =
+      std::chrono::duration_cast<std::chrono::microseconds>(now - start_time)
+          .count() > int64_t(objective_.latency_threshold_us_);
+  const uint64_t bucket = BucketIndex(now);
+  Bucket& counters = buckets_[bucket % bucket_count_];
+  const uint64_t tag = bucket & kSloTagMask;
+
+  Increment(&counters.counters_[REQUESTS], tag);
+  totals_[REQUESTS].fetch_add(1, std::memory_order_relaxed);
+  if (slow) {
+    Increment(&counters.counters_[SLOW], tag);
+    totals_[SLOW].fetch_add(1, std::memory_order_relaxed);
+  }
+  if (failed) {
+    Increment(&counters.counters_[FAILED], tag);
+    totals_[FAILED].fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void
+SloTracker::Increment(std::atomic<uint64_t>* counter, const uint64_t tag)
+{
+  // A counter tagged with another bucket was left from an earlier turn of
+  // the ring and is restarted.
+  uint64_t current = counter->load(std::memory_order_relaxed);
+  uint64_t next;
+  do {
+    next = ((current >> kSloCountBits) == tag)
+               ? current + 1
+               : ((tag << kSloCountBits) | 1);
+  } while (!counter->compare_exchange_weak(
+      current, next, std::memory_order_relaxed));
+}
+
+uint64_t
+SloTracker::Count(const std::atomic<uint64_t>& counter, const uint64_t tag)
+{
+  const uint64_t value = counter.load(std::memory_order_relaxed);
+  return ((value >> kSloCountBits) == tag) ? (value & kSloCountMask) : 0;
+}
+
+ServiceLevelStats
+SloTracker::Stats() const
+{
+  ServiceLevelStats stats;
+  stats.request_count_ = totals_[REQUESTS].load(std::memory_order_relaxed);
+  stats.slow_count_ = totals_[SLOW].load(std::memory_order_relaxed);
+  stats.error_count_ = totals_[FAILED].load(std::memory_order_relaxed);
+
+  const uint64_t current_bucket =
+      BucketIndex(std::chrono::steady_clock::now());
+  for (const auto window_s : objective_.windows_s_) {
+    BurnRate burn_rate;
+    burn_rate.window_s_ = window_s;
+    // The window ends with the current bucket.
+    const uint64_t window_buckets = std::min<uint64_t>(
+        std::min<uint64_t>(
+            bucket_count_, (window_s + bucket_s_ - 1) / bucket_s_),
+        current_bucket + 1);
+    for (uint64_t i = 0; i < window_buckets; ++i) {
+      const uint64_t bucket = current_bucket - i;
+      const Bucket& counters = buckets_[bucket % bucket_count_];
+      const uint64_t tag = bucket & kSloTagMask;
+      burn_rate.request_count_ += Count(counters.counters_[REQUESTS], tag);
+      burn_rate.slow_count_ += Count(counters.counters_[SLOW], tag);
+      burn_rate.error_count_ += Count(counters.counters_[FAILED], tag);
+    }
+    if (burn_rate.request_count_ != 0) {
+      burn_rate.latency_burn_rate_ =
+          (double(burn_rate.slow_count_) / burn_rate.request_count_) /
+          (1 - objective_.latency_target_);
+      burn_rate.error_burn_rate_ =
+          (double(burn_rate.error_count_) / burn_rate.request_count_) /
+          (1 - objective_.success_target_);
+    }
+    stats.burn_rates_.push_back(burn_rate);
+  }
+  return stats;
+}
+
+// Return the window as in alerting rules, i.e. "5m" or "1h".
+std::string
+SloWindowLabel(const uint32_t window_s)
+{
+  if ((window_s % 3600) == 0) {
+    return std::to_string(window_s / 3600) + "h";
+  } else if ((window_s % 60) == 0) {
+    return std::to_string(window_s / 60) + "m";
+  }
+  return std::to_string(window_s) + "s";
+}
+
+std::string
+SloTracker::FormatMetrics(const std::map<std::string, ServiceLevelStats>& stats)
+{
+  std::stringstream ss;
+  ss << "# HELP tds_slo_requests_total Number of requests evaluated against "
+        "the service level objective of the model"
+     << std::endl
+     << "# TYPE tds_slo_requests_total counter" << std::endl;
+  for (const auto& model : stats) {
+    ss << "tds_slo_requests_total{model=\"" << model.first << "\"} "
+       << model.second.request_count_ << std::endl;
+  }
+  ss << "# HELP tds_slo_slow_requests_total Number of requests slower than "
+        "the latency threshold of the model"
+     << std::endl
+     << "# TYPE tds_slo_slow_requests_total counter" << std::endl;
+  for (const auto& model : stats) {
+    ss << "tds_slo_slow_requests_total{model=\"" << model.first << "\"} "
+       << model.second.slow_count_ << std::endl;
+  }
+  ss << "# HELP tds_slo_failed_requests_total Number of failed requests "
+        "evaluated against the service level objective of the model"
+     << std::endl
+     << "# TYPE tds_slo_failed_requests_total counter" << std::endl;
+  for (const auto& model : stats) {
+    ss << "tds_slo_failed_requests_total{model=\"" << model.first << "\"} "
+       << model.second.error_count_ << std::endl;
+  }
+  ss << "# HELP tds_slo_burn_rate Rate at which the error budget of the "
+        "service level objective of the model is consumed over the window"
+     << std::endl
+     << "# TYPE tds_slo_burn_rate gauge" << std::endl;
+  for (const auto& model : stats) {
+    for (const auto& burn_rate : model.second.burn_rates_) {
+      const std::string window = SloWindowLabel(burn_rate.window_s_);
+      ss << "tds_slo_burn_rate{model=\"" << model.first
+         << "\",slo=\"latency\",window=\"" << window << "\"} "
+         << burn_rate.latency_burn_rate_ << std::endl
+         << "tds_slo_burn_rate{model=\"" << model.first
+         << "\",slo=\"success\",window=\"" << window << "\"} "
+         << burn_rate.error_burn_rate_ << std::endl;
+    }
+  }
+  return ss.str();
+}
+
+}}}  // namespace triton::developer_tools::server
@@ -0,0 +1,86 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "triton/developer_tools/common.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+//==============================================================================
+/// Evaluates the completed requests of a model against its service level
+/// objective and keeps the counts of the recent requests in a ring of time
+/// buckets to compute the burn rates over the windows of the objective.
+/// Recording doesn't take a lock: each bucket counter is tagged with the
+/// bucket it counts for, so a counter left from an earlier turn of the ring
+/// is restarted by the first request of the new bucket.
+///
+class SloTracker {
+ public:
+  SloTracker(const ServiceLevelObjective& objective);
+
+  // Record a request started at 'start_time' that completed now.
+  void Record(
+      const std::chrono::steady_clock::time_point& start_time,
+      const bool failed);
+
+  ServiceLevelStats Stats() const;
+
+  // Return the statistics of each model, keyed by model name, in the
+  // Prometheus text format.
+  static std::string FormatMetrics(
+      const std::map<std::string, ServiceLevelStats>& stats);
+
+ private:
+  enum Counter { REQUESTS, SLOW, FAILED, COUNTER_COUNT };
+
+  struct Bucket {
+    std::atomic<uint64_t> counters_[COUNTER_COUNT];
+  };
+
+  // Return the index of the bucket that 'time' falls in.
+  uint64_t BucketIndex(const std::chrono::steady_clock::time_point& time) const;
+
+  static void Increment(std::atomic<uint64_t>* counter, const uint64_t tag);
+  static uint64_t Count(
+      const std::atomic<uint64_t>& counter, const uint64_t tag);
+
+  const ServiceLevelObjective objective_;
+  // The length of a bucket in seconds.
+  uint64_t bucket_s_;
+  std::unique_ptr<Bucket[]> buckets_;
+  size_t bucket_count_;
+
+  std::atomic<uint64_t> totals_[COUNTER_COUNT];
+};
+
+}}}  // namespace triton::developer_tools::server
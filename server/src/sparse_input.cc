@@ -0,0 +1,407 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "sparse_input.h"
+
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif  // __SSE2__
+#ifdef __AVX512F__
+#include <immintrin.h>
+#endif  // __AVX512F__
+
+#include <algorithm>
+#include <limits>
+#include <string>
+
+namespace triton { namespace developer_tools { namespace server {
+
+// The byte size of the dense tensor above which the zero-fill is split
+// across the workers of the executor, and the minimum byte size of a part.
+constexpr size_t kSparseParallelByteSize = 4 * 1024 * 1024;
+// The number of values above which the scatter is split across the workers
+// of the executor, and the minimum number of values of a part.
+constexpr size_t kSparseParallelValueCount = 64 * 1024;
+// The byte size of the dense tensor above which the zero-fill bypasses the
+// cache. The tensor doesn't fit in the cache anyway, and the scatter only
+// touches a few of its cache lines again.
+constexpr size_t kSparseNonTemporalByteSize = 8 * 1024 * 1024;
+// The number of values whose offsets are computed before they are scattered.
+constexpr size_t kSparseBlockSize = 256;
+
+// Set 'byte_size' bytes at 'dst' to 0, with streaming stores if
+// 'non_temporal' and SSE2 is supported.
+void
+StreamZero(char* dst, size_t byte_size, const bool non_temporal)
+{
+#ifdef __SSE2__
+  if (non_temporal) {
+    // Zero the head with regular stores so that the streaming stores are
+    // aligned.
+    size_t head = (16 - (reinterpret_cast<uintptr_t>(dst) & 15)) & 15;
+    head = std::min(head, byte_size);
+    memset(dst, 0, head);
+    dst += head;
+    byte_size -= head;
+
+    const __m128i zero = _mm_setzero_si128();
+    const size_t count = byte_size / 16;
+    for (size_t i = 0; i < count; ++i) {
+      _mm_stream_si128(reinterpret_cast<__m128i*>(dst) + i, zero);
+    }
+    memset(dst + count * 16, 0, byte_size - count * 16);
+    _mm_sfence();
+    return;
+  }
+#endif  // __SSE2__
+  memset(dst, 0, byte_size);
+}
+
+// Copy the 'count' values at 'values' to the elements of 'dense' at
+// 'offsets'.
+using SparseScatterFn = void (*)(
+    char* dense, const char* values, const int64_t* offsets,
+    const size_t count);
+
+template <size_t ElementByteSize>
+void
+ScatterSparseBlock(
+    char* dense, const char* values, const int64_t* offsets,
+    const size_t count)
+{
+  for (size_t i = 0; i < count; ++i) {
+    memcpy(
+        dense + offsets[i] * ElementByteSize, values + i * ElementByteSize,
+        ElementByteSize);
+  }
+}
+
+#ifdef __AVX512F__
+// Scatter 8 values per instruction. The scatter writes the lanes in order,
+// so a duplicated offset keeps the last value like the scalar loop.
+template <>
+void
+ScatterSparseBlock<8>(
+    char* dense, const char* values, const int64_t* offsets,
+    const size_t count)
+{
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m512i index = _mm512_loadu_si512(offsets + i);
+    const __m512i value = _mm512_loadu_si512(values + i * 8);
+    _mm512_i64scatter_epi64(dense, index, value, 8);
+  }
+  for (; i < count; ++i) {
+    memcpy(dense + offsets[i] * 8, values + i * 8, 8);
+  }
+}
+
+template <>
+void
+ScatterSparseBlock<4>(
+    char* dense, const char* values, const int64_t* offsets,
+    const size_t count)
+{
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const __m512i index = _mm512_loadu_si512(offsets + i);
+    const __m256i value =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i * 4));
+    _mm512_i64scatter_epi32(dense, index, value, 4);
+  }
+  for (; i < count; ++i) {
+    memcpy(dense + offsets[i] * 4, values + i * 4, 4);
+  }
+}
+#endif  // __AVX512F__
+
+SparseScatterFn
+SparseScatterFunction(const size_t element_byte_size)
+{
+  switch (element_byte_size) {
+    case 1:
+      return ScatterSparseBlock<1>;
+    case 2:
+      return ScatterSparseBlock<2>;
+    case 4:
+      return ScatterSparseBlock<4>;
+    case 8:
+      return ScatterSparseBlock<8>;
+    default:
+      throw TritonException(
+          "unsupported element byte size " + std::to_string(element_byte_size) +
+          ".");
+  }
+}
+
+//==============================================================================
+/// The shape of a sparse input and its components.
+///
+template <typename Index>
+struct SparseLayout {
+  SparseFormat format_;
+  // COO: the coordinates of each value. CSR: the row offsets followed by the
+  // columns of the values.
+  const Index* indices_;
+  const char* values_;
+  size_t element_byte_size_;
+  std::vector<int64_t> dense_shape_;
+  // CSR: the number of rows and of columns of the dense tensor.
+  int64_t rows_;
+  int64_t columns_;
+};
+
+std::string
+OutOfBoundsMessage(
+    const size_t value_index, const int64_t index, const int64_t dim)
+{
+  return "the index " + std::to_string(index) + " of value " +
+         std::to_string(value_index) + " is out of the bounds of dimension " +
+         std::to_string(dim) + ".";
+}
+
+// Check that the indices of the values from 'begin' to 'end' are within the
+// bounds of the dense shape.
+template <typename Index>
+void
+CheckSparseIndices(
+    const SparseLayout<Index>& layout, const size_t begin, const size_t end)
+{
+  if (layout.format_ == SparseFormat::COO) {
+    const size_t rank = layout.dense_shape_.size();
+    const Index* coords = layout.indices_ + begin * rank;
+    for (size_t i = begin; i < end; ++i, coords += rank) {
+      for (size_t k = 0; k < rank; ++k) {
+        const int64_t dim = layout.dense_shape_[k];
+        if ((coords[k] < 0) || (coords[k] >= dim)) {
+          throw TritonException(OutOfBoundsMessage(i, coords[k], dim));
+        }
+      }
+    }
+  } else {
+    const Index* columns = layout.indices_ + layout.rows_ + 1;
+    for (size_t i = begin; i < end; ++i) {
+      if ((columns[i] < 0) || (columns[i] >= layout.columns_)) {
+        throw TritonException(
+            OutOfBoundsMessage(i, columns[i], layout.columns_));
+      }
+    }
+  }
+}
+
+// Compute the element offsets in the dense tensor of the 'count' values from
+// 'begin'. The indices are checked beforehand.
+template <typename Index>
+void
+SparseOffsets(
+    const SparseLayout<Index>& layout, const size_t begin, const size_t count,
+    int64_t* offsets)
+{
+  if (layout.format_ == SparseFormat::COO) {
+    const size_t rank = layout.dense_shape_.size();
+    const Index* coords = layout.indices_ + begin * rank;
+    for (size_t i = 0; i < count; ++i, coords += rank) {
+      int64_t offset = 0;
+      for (size_t k = 0; k < rank; ++k) {
+        offset = offset * layout.dense_shape_[k] + coords[k];
+      }
+      offsets[i] = offset;
+    }
+  } else {
+    const Index* row_offsets = layout.indices_;
+    const Index* columns = layout.indices_ + layout.rows_ + 1;
+    // The row offsets are checked to be sorted beforehand.
+    int64_t row = std::upper_bound(
+                      row_offsets, row_offsets + layout.rows_ + 1,
+                      static_cast<Index>(begin)) -
+                  row_offsets - 1;
+    for (size_t i = 0; i < count; ++i) {
+      while (static_cast<size_t>(row_offsets[row + 1]) <= begin + i) {
+        row++;
+      }
+      offsets[i] = row * layout.columns_ + columns[begin + i];
+    }
+  }
+}
+
+template <typename Index>
+void
+DensifySparseLayout(
+    const SparseLayout<Index>& layout, const size_t value_count, char* dense,
+    const size_t dense_byte_size, WorkExecutor* executor)
+{
+  // The indices are checked first so that a rejected input doesn't write the
+  // dense tensor.
+  const bool parallel_values =
+      (executor != nullptr) && (value_count >= 2 * kSparseParallelValueCount);
+  auto check_fn = [&layout](const size_t begin, const size_t end) {
+    CheckSparseIndices(layout, begin, end);
+  };
+  if (parallel_values) {
+    executor->ParallelFor(0, value_count, kSparseParallelValueCount, check_fn);
+  } else {
+    check_fn(0, value_count);
+  }
+
+  const bool non_temporal = dense_byte_size >= kSparseNonTemporalByteSize;
+  auto zero_fn = [dense, non_temporal](const size_t begin, const size_t end) {
+    StreamZero(dense + begin, end - begin, non_temporal);
+  };
+  if ((executor != nullptr) &&
+      (dense_byte_size >= 2 * kSparseParallelByteSize)) {
+    executor->ParallelFor(0, dense_byte_size, kSparseParallelByteSize, zero_fn);
+  } else {
+    zero_fn(0, dense_byte_size);
+  }
+
+  const SparseScatterFn scatter =
+      SparseScatterFunction(layout.element_byte_size_);
+  auto scatter_fn = [&layout, dense, scatter](
+                        const size_t begin, const size_t end) {
+    int64_t offsets[kSparseBlockSize];
+    for (size_t block = begin; block < end; block += kSparseBlockSize) {
+      const size_t count = std::min(kSparseBlockSize, end - block);
+      SparseOffsets(layout, block, count, offsets);
+      scatter(
+          dense, layout.values_ + block * layout.element_byte_size_, offsets,
+          count);
+    }
+  };
+  if (parallel_values) {
+    executor->ParallelFor(
+        0, value_count, kSparseParallelValueCount, scatter_fn);
+  } else {
+    scatter_fn(0, value_count);
+  }
+}
+
+template <typename Index>
+void
+DensifySparseIndices(
+    const SparseFormat& format, const char* indices,
+    const size_t indices_byte_size, const char* values,
+    const size_t value_count, const size_t element_byte_size,
+    const std::vector<int64_t>& dense_shape, char* dense,
+    const size_t dense_byte_size, WorkExecutor* executor)
+{
+  if (DenseElementCount(dense_shape, element_byte_size) * element_byte_size !=
+      dense_byte_size) {
+    throw TritonException(
+        "the dense tensor has " + std::to_string(dense_byte_size) +
+        " bytes, which doesn't match its shape.");
+  }
+
+  SparseLayout<Index> layout;
+  layout.format_ = format;
+  layout.indices_ = reinterpret_cast<const Index*>(indices);
+  layout.values_ = values;
+  layout.element_byte_size_ = element_byte_size;
+  layout.dense_shape_ = dense_shape;
+  layout.rows_ = 0;
+  layout.columns_ = 0;
+
+  size_t expected_index_count = 0;
+  if (format == SparseFormat::COO) {
+    if (dense_shape.empty()) {
+      throw TritonException("a COO input must have at least 1 dimension.");
+    }
+    expected_index_count = value_count * dense_shape.size();
+  } else {
+    if (dense_shape.size() < 2) {
+      throw TritonException("a CSR input must have at least 2 dimensions.");
+    }
+    layout.rows_ = dense_shape[0];
+    layout.columns_ = DenseElementCount(
+        std::vector<int64_t>(dense_shape.begin() + 1, dense_shape.end()), 1);
+    expected_index_count = static_cast<size_t>(layout.rows_) + 1 + value_count;
+  }
+  if (indices_byte_size != expected_index_count * sizeof(Index)) {
+    throw TritonException(
+        "expected " + std::to_string(expected_index_count) +
+        " indices for " + std::to_string(value_count) + " values, got " +
+        std::to_string(indices_byte_size / sizeof(Index)) + ".");
+  }
+  if (format == SparseFormat::CSR) {
+    const Index* row_offsets = layout.indices_;
+    if ((row_offsets[0] != 0) ||
+        (static_cast<size_t>(row_offsets[layout.rows_]) != value_count)) {
+      throw TritonException(
+          "the row offsets must start at 0 and end at the number of values.");
+    }
+    for (int64_t row = 0; row < layout.rows_; ++row) {
+      if (row_offsets[row + 1] < row_offsets[row]) {
+        throw TritonException(
+            "the offset of row " + std::to_string(row + 1) +
+            " is smaller than the offset of the previous row.");
+      }
+    }
+  }
+
+  DensifySparseLayout(layout, value_count, dense, dense_byte_size, executor);
+}
+
+size_t
+DenseElementCount(
+    const std::vector<int64_t>& dense_shape, const size_t element_byte_size)
+{
+  const int64_t max_element_count =
+      std::numeric_limits<int64_t>::max() / element_byte_size;
+  int64_t element_count = 1;
+  for (const auto dim : dense_shape) {
+    if (dim < 0) {
+      throw TritonException("the dense shape has a negative dimension.");
+    }
+    if ((dim != 0) && (element_count > max_element_count / dim)) {
+      throw TritonException(
+          "the byte size of the dense shape overflows a 64-bit integer.");
+    }
+    element_count *= dim;
+  }
+  return element_count;
+}
+
+void
+DensifySparseInput(
+    const SparseFormat& format, const char* indices,
+    const size_t indices_byte_size, const size_t index_byte_size,
+    const char* values, const size_t value_count,
+    const size_t element_byte_size, const std::vector<int64_t>& dense_shape,
+    char* dense, const size_t dense_byte_size, WorkExecutor* executor)
+{
+  if (index_byte_size == sizeof(int32_t)) {
+    DensifySparseIndices<int32_t>(
+        format, indices, indices_byte_size, values, value_count,
+        element_byte_size, dense_shape, dense, dense_byte_size, executor);
+  } else {
+    DensifySparseIndices<int64_t>(
+        format, indices, indices_byte_size, values, value_count,
+        element_byte_size, dense_shape, dense, dense_byte_size, executor);
+  }
+}
+
+}}}  // namespace triton::developer_tools::server
@@ -0,0 +1,60 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "triton/developer_tools/server_wrapper.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+// Return the number of elements of a dense tensor of 'dense_shape' whose
+// elements have 'element_byte_size' bytes. A 'TritonException' is thrown if
+// a dimension is negative or if the product of the dimensions or the byte
+// size of the tensor doesn't fit in 'int64_t', the type of the element
+// offsets.
+size_t DenseElementCount(
+    const std::vector<int64_t>& dense_shape, const size_t element_byte_size);
+
+// Expand the 'value_count' values of 'element_byte_size' bytes in 'values'
+// at the positions given by 'indices' in 'format' into 'dense', a buffer of
+// 'dense_byte_size' bytes holding a tensor of 'dense_shape' whose other
+// elements are set to 0. 'indices' has 'indices_byte_size' bytes of integers
+// of 'index_byte_size' bytes, 4 or 8. The check of the indices, the zero-fill
+// and the scatter are split on 'executor' if set and the input is large
+// enough. A 'TritonException' is thrown before 'dense' is written if the
+// indices don't match the shape.
+void DensifySparseInput(
+    const SparseFormat& format, const char* indices,
+    const size_t indices_byte_size, const size_t index_byte_size,
+    const char* values, const size_t value_count,
+    const size_t element_byte_size, const std::vector<int64_t>& dense_shape,
+    char* dense, const size_t dense_byte_size, WorkExecutor* executor);
+
+}}}  // namespace triton::developer_tools::server
@@ -0,0 +1,315 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "stats_publisher.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <malloc.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif  // __linux__
+
+#include <algorithm>
+
+#include "log.h"
+#include "tracer.h"
+#include "triton/developer_tools/common.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+namespace {
+
+#ifdef __linux__
+// Remove the shared memory object 'name' if it is the stats segment of a
+// process that no longer exists. Otherwise return false with the reason in
+// 'reason'. An object without the magic is kept, it may be a segment that
+// another process is initializing.
+bool
+RemoveStaleSegment(const std::string& name, std::string* reason)
+{
+  const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    *reason = strerror(errno);
+    return false;
+  }
+  struct stat st;
+  void* address = MAP_FAILED;
+  if ((fstat(fd, &st) == 0) &&
+      (static_cast<size_t>(st.st_size) >= sizeof(StatsSegment))) {
+    address =
+        mmap(nullptr, sizeof(StatsSegment), PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (address == MAP_FAILED) {
+    *reason = "the object exists and is not a stats segment";
+    return false;
+  }
+  const StatsSegment* segment = static_cast<const StatsSegment*>(address);
+  const uint32_t magic = segment->magic_;
+  const pid_t pid = static_cast<pid_t>(segment->pid_);
+  munmap(address, sizeof(StatsSegment));
+  if (magic != kStatsSegmentMagic) {
+    *reason = "the object exists and is not a stats segment";
+    return false;
+  }
+  if ((kill(pid, 0) == 0) || (errno != ESRCH)) {
+    *reason = "the segment is used by process " + std::to_string(pid);
+    return false;
+  }
+
+  LOG_MESSAGE(
+      TRITONSERVER_LOG_WARN,
+      "removing the stats segment '" + name + "' of exited process " +
+          std::to_string(pid));
+  shm_unlink(name.c_str());
+  return true;
+}
+#endif  // __linux__
+
+}  // namespace
+
+LiveModelStats::LiveModelStats()
+    : in_flight_count_(0), request_count_(0), error_count_(0),
+      latency_sum_us_(0)
+{
+  for (auto& bucket : latency_buckets_) {
+    bucket = 0;
+  }
+}
+
+void
+LiveModelStats::Complete(
+    const std::chrono::steady_clock::time_point& start_time, const bool failed)
+{
+  const uint64_t latency_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start_time)
+          .count();
+  // The bucket of a latency is its number of significant bits.
+  size_t bucket = 0;
+  for (uint64_t remaining = latency_us; remaining != 0; remaining >>= 1) {
+    ++bucket;
+  }
+  bucket = std::min(bucket, kStatsSegmentLatencyBucketCount - 1);
+
+  in_flight_count_.fetch_sub(1, std::memory_order_relaxed);
+  request_count_.fetch_add(1, std::memory_order_relaxed);
+  if (failed) {
+    error_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+  latency_sum_us_.fetch_add(latency_us, std::memory_order_relaxed);
+  latency_buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+LiveModelStats::Read(StatsSegmentModel* model) const
+{
+  model->in_flight_count_ = in_flight_count_.load(std::memory_order_relaxed);
+  model->request_count_ = request_count_.load(std::memory_order_relaxed);
+  model->error_count_ = error_count_.load(std::memory_order_relaxed);
+  model->latency_sum_us_ = latency_sum_us_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < kStatsSegmentLatencyBucketCount; ++i) {
+    model->latency_buckets_[i] =
+        latency_buckets_[i].load(std::memory_order_relaxed);
+  }
+}
+
+StatsPublisher::StatsPublisher(
+    const std::string& name, const uint32_t interval_ms,
+    const uint64_t pinned_memory_pool_byte_size)
+    : name_(name), interval_ms_(std::max<uint32_t>(interval_ms, 1)),
+      pinned_memory_pool_byte_size_(pinned_memory_pool_byte_size),
+      segment_(nullptr), staging_(new StatsSegmentData()),
+      models_(std::make_shared<const Models>()), dropped_request_count_(0),
+      exiting_(false)
+{
+#ifdef __linux__
+  // The object is always created so that a reader still attached to the
+  // segment of a previous process doesn't see the new one, and so that the
+  // segment of another live server is never taken over.
+  int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if ((fd < 0) && (errno == EEXIST)) {
+    std::string reason;
+    if (!RemoveStaleSegment(name_, &reason)) {
+      throw TritonException(
+          "failed to create the stats segment '" + name_ + "': " + reason);
+    }
+    fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  }
+  if (fd < 0) {
+    throw TritonException(
+        "failed to create the stats segment '" + name_ +
+        "': " + strerror(errno));
+  }
+  void* address = MAP_FAILED;
+  if (ftruncate(fd, sizeof(StatsSegment)) == 0) {
+    address = mmap(
+        nullptr, sizeof(StatsSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+        0);
+  }
+  const int map_errno = errno;
+  close(fd);
+  if (address == MAP_FAILED) {
+    shm_unlink(name_.c_str());
+    throw TritonException(
+        "failed to map the stats segment '" + name_ +
+        "': " + strerror(map_errno));
+  }
+
+  // The object is zero-filled, the magic is written last so that a reader
+  // never sees a partially initialized header.
+  segment_ = static_cast<StatsSegment*>(address);
+  segment_->version_ = kStatsSegmentVersion;
+  segment_->byte_size_ = sizeof(StatsSegment);
+  segment_->pid_ = getpid();
+  segment_->update_interval_ms_ = interval_ms_;
+  segment_->sequence_.store(0, std::memory_order_relaxed);
+  Publish();
+  std::atomic_thread_fence(std::memory_order_release);
+  segment_->magic_ = kStatsSegmentMagic;
+#else
+  throw TritonException(
+      "the stats segment is only supported on Linux, can't create '" + name_ +
+      "'");
+#endif  // __linux__
+}
+
+StatsPublisher::~StatsPublisher()
+{
+  Stop();
+#ifdef __linux__
+  if (segment_ != nullptr) {
+    munmap(segment_, sizeof(StatsSegment));
+    shm_unlink(name_.c_str());
+  }
+#endif  // __linux__
+}
+
+void
+StatsPublisher::Start(std::function<void()> thread_init)
+{
+  const std::chrono::milliseconds interval(interval_ms_);
+  thread_ = std::thread([this, thread_init, interval]() {
+    thread_init();
+    std::unique_lock<std::mutex> lock(mu_);
+    while (!cv_.wait_for(lock, interval, [this]() { return exiting_; })) {
+      lock.unlock();
+      Publish();
+      lock.lock();
+    }
+  });
+}
+
+void
+StatsPublisher::Stop()
+{
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (exiting_) {
+      return;
+    }
+    exiting_ = true;
+    cv_.notify_all();
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (segment_ != nullptr) {
+    Publish();
+  }
+}
+
+std::shared_ptr<LiveModelStats>
+StatsPublisher::ModelStats(const std::string& model_name)
+{
+  std::shared_ptr<const Models> models = std::atomic_load(&models_);
+  auto it = models->find(model_name);
+  if (it != models->end()) {
+    return it->second;
+  }
+
+  // The segment only has room for 'kStatsSegmentMaxModels' models, so the
+  // map is capped at that size instead of growing with every model name
+  // the requests use.
+  std::lock_guard<std::mutex> lk(models_mu_);
+  models = std::atomic_load(&models_);
+  it = models->find(model_name);
+  if (it != models->end()) {
+    return it->second;
+  }
+  if (models->size() >= kStatsSegmentMaxModels) {
+    dropped_request_count_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  auto updated = std::make_shared<Models>(*models);
+  auto stats = std::make_shared<LiveModelStats>();
+  updated->emplace(model_name, stats);
+  std::atomic_store(&models_, std::shared_ptr<const Models>(updated));
+  return stats;
+}
+
+void
+StatsPublisher::Publish()
+{
+  // The counters are gathered before the sequence is incremented so that
+  // the readers only retry for the copy to the segment.
+  StatsSegmentData* data = staging_.get();
+  memset(static_cast<void*>(data), 0, sizeof(StatsSegmentData));
+  data->update_time_ns_ =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+  data->pinned_memory_pool_byte_size_ = pinned_memory_pool_byte_size_;
+#if defined(__GLIBC__) && \
+    ((__GLIBC__ > 2) || ((__GLIBC__ == 2) && (__GLIBC_MINOR__ >= 33)))
+  const struct mallinfo2 info = mallinfo2();
+  data->heap_in_use_byte_size_ = info.uordblks + info.hblkhd;
+#endif  // __GLIBC__
+  data->dropped_trace_count_ = TraceManager::DroppedTraceCount();
+  data->dropped_model_request_count_ =
+      dropped_request_count_.load(std::memory_order_relaxed);
+  for (const auto& model : *std::atomic_load(&models_)) {
+    StatsSegmentModel& segment_model = data->models_[data->model_count_++];
+    strncpy(
+        segment_model.name_, model.first.c_str(),
+        kStatsSegmentModelNameSize - 1);
+    model.second->Read(&segment_model);
+  }
+
+  const uint64_t sequence = segment_->sequence_.load(std::memory_order_relaxed);
+  segment_->sequence_.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(
+      static_cast<void*>(&segment_->data_), data, sizeof(StatsSegmentData));
+  segment_->sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+}}}  // namespace triton::developer_tools::server
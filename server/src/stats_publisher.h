@@ -0,0 +1,124 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "triton/developer_tools/stats_segment.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+//==============================================================================
+/// The live counters of a model published to the stats segment.
+///
+class LiveModelStats {
+ public:
+  LiveModelStats();
+
+  // Count a request sent to the model as in flight.
+  void Start() { in_flight_count_.fetch_add(1, std::memory_order_relaxed); }
+
+  // Stop counting a request that could not be sent.
+  void Abandon() { in_flight_count_.fetch_sub(1, std::memory_order_relaxed); }
+
+  // Record a request started at 'start_time' that completed now.
+  void Complete(
+      const std::chrono::steady_clock::time_point& start_time,
+      const bool failed);
+
+  void Read(StatsSegmentModel* model) const;
+
+ private:
+  std::atomic<uint64_t> in_flight_count_;
+  std::atomic<uint64_t> request_count_;
+  std::atomic<uint64_t> error_count_;
+  std::atomic<uint64_t> latency_sum_us_;
+  std::atomic<uint64_t> latency_buckets_[kStatsSegmentLatencyBucketCount];
+};
+
+//==============================================================================
+/// Publishes the live counters of the models and of the process to a POSIX
+/// shared memory segment with the layout of 'StatsSegment'. A thread copies
+/// the counters to the segment every 'interval_ms' under the sequence of the
+/// segment, the requests only update the atomic counters of their model.
+///
+class StatsPublisher {
+ public:
+  // Create the shared memory object 'name' and map it. A stale object left
+  // by a process that exited is replaced. Throw 'TritonException' if the
+  // segment can't be created or if the object is used by a live process.
+  StatsPublisher(
+      const std::string& name, const uint32_t interval_ms,
+      const uint64_t pinned_memory_pool_byte_size);
+
+  // Stop the thread and remove the shared memory object.
+  ~StatsPublisher();
+
+  // Start the publishing thread. 'thread_init' is called at the start of the
+  // thread.
+  void Start(std::function<void()> thread_init);
+
+  // Publish a last time, then stop and join the publishing thread.
+  void Stop();
+
+  // Return the counters of 'model_name', created on first use. Return
+  // nullptr once 'kStatsSegmentMaxModels' models have counters, the request
+  // is then only counted as dropped.
+  std::shared_ptr<LiveModelStats> ModelStats(const std::string& model_name);
+
+ private:
+  using Models = std::map<std::string, std::shared_ptr<LiveModelStats>>;
+
+  void Publish();
+
+  const std::string name_;
+  const uint32_t interval_ms_;
+  const uint64_t pinned_memory_pool_byte_size_;
+  StatsSegment* segment_;
+  // The counters copied to the segment, only used by the thread publishing.
+  std::unique_ptr<StatsSegmentData> staging_;
+
+  // The counters of the models, read without locking and replaced under
+  // 'models_mu_' when a model is added.
+  std::mutex models_mu_;
+  std::shared_ptr<const Models> models_;
+  std::atomic<uint64_t> dropped_request_count_;
+
+  std::mutex mu_;
+  bool exiting_;
+  std::condition_variable cv_;
+  std::thread thread_;
+};
+
+}}}  // namespace triton::developer_tools::server
@@ -0,0 +1,213 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "topology.h"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif  // __linux__
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+#include "triton/developer_tools/server_wrapper.h"
+#ifdef TRITON_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRITON_ENABLE_GPU
+
+namespace triton { namespace developer_tools { namespace server {
+
+std::string
+ReadSysfsLine(const std::string& path)
+{
+  std::ifstream file(path);
+  std::string line;
+  std::getline(file, line);
+  const auto begin = line.find_first_not_of(" \t\r\n");
+  if (begin == std::string::npos) {
+    return "";
+  }
+  return line.substr(begin, line.find_last_not_of(" \t\r\n") - begin + 1);
+}
+
+#ifdef TRITON_ENABLE_GPU
+// Return the NUMA node of GPU 'device', or -1 if unknown.
+int32_t
+GpuNumaNode(const int device)
+{
+  char pci_bus_id[64];
+  if (cudaDeviceGetPCIBusId(pci_bus_id, sizeof(pci_bus_id), device) !=
+      cudaSuccess) {
+    return -1;
+  }
+  std::string bus_id(pci_bus_id);
+  std::transform(bus_id.begin(), bus_id.end(), bus_id.begin(), ::tolower);
+  const std::string node =
+      ReadSysfsLine("/sys/bus/pci/devices/" + bus_id + "/numa_node");
+  return node.empty() ? -1 : std::stoi(node);
+}
+#endif  // TRITON_ENABLE_GPU
+
+std::vector<int>
+ParseCpuList(const std::string& cpu_list)
+{
+  std::vector<int> cpus;
+  std::stringstream ss(cpu_list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty()) {
+      continue;
+    }
+    const auto dash = range.find('-');
+    const int first = std::stoi(range.substr(0, dash));
+    const int last =
+        (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+std::vector<NumaNode>
+DiscoverNumaNodes(const std::string& sysfs_node_dir)
+{
+  std::vector<NumaNode> nodes;
+#ifdef __linux__
+  DIR* dir = opendir(sysfs_node_dir.c_str());
+  if (dir == nullptr) {
+    return nodes;
+  }
+  for (struct dirent* entry = readdir(dir); entry != nullptr;
+       entry = readdir(dir)) {
+    const std::string name(entry->d_name);
+    if ((name.size() <= 4) || (name.compare(0, 4, "node") != 0) ||
+        !std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+      continue;
+    }
+    // Nodes without CPUs only provide memory and are not used for placement.
+    const std::string cpus =
+        ReadSysfsLine(sysfs_node_dir + "/" + name + "/cpulist");
+    if (!cpus.empty()) {
+      nodes.emplace_back(std::stoi(name.substr(4)), cpus);
+    }
+  }
+  closedir(dir);
+  std::sort(
+      nodes.begin(), nodes.end(),
+      [](const NumaNode& lhs, const NumaNode& rhs) {
+        return lhs.id_ < rhs.id_;
+      });
+#endif  // __linux__
+  return nodes;
+}
+
+const NumaNode*
+CurrentNumaNode(const std::vector<NumaNode>& nodes)
+{
+#ifdef __linux__
+  const int cpu = sched_getcpu();
+  if (cpu >= 0) {
+    for (const auto& node : nodes) {
+      const auto cpus = ParseCpuList(node.cpus_);
+      if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end()) {
+        return &node;
+      }
+    }
+  }
+#endif  // __linux__
+  return nullptr;
+}
+
+bool
+PinCurrentThread(const std::string& cpu_list)
+{
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (const int cpu : ParseCpuList(cpu_list)) {
+    if ((cpu >= 0) && (cpu < CPU_SETSIZE)) {
+      CPU_SET(cpu, &cpu_set);
+    }
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) ==
+         0;
+#else
+  return false;
+#endif  // __linux__
+}
+
+std::vector<NumaNode>
+NumaTopology()
+{
+  return DiscoverNumaNodes("/sys/devices/system/node");
+}
+
+std::vector<HostPolicy>
+GenerateHostPolicies(const std::vector<NumaNode>& nodes)
+{
+  std::vector<HostPolicy> policies;
+  if (nodes.empty()) {
+    return policies;
+  }
+
+  auto add_policy = [&policies](
+                        const std::string& name, const NumaNode& node) {
+    policies.emplace_back(
+        name, HostPolicy::Setting::NUMA_NODE, std::to_string(node.id_));
+    policies.emplace_back(name, HostPolicy::Setting::CPU_CORES, node.cpus_);
+  };
+
+  for (const auto& node : nodes) {
+    add_policy("numa" + std::to_string(node.id_), node);
+  }
+
+#ifdef TRITON_ENABLE_GPU
+  // GPU instances use the host policy named after their device by default, so
+  // each GPU is bound to its own NUMA node, or spread across the nodes if the
+  // node of the GPU is unknown.
+  int device_count = 0;
+  if (cudaGetDeviceCount(&device_count) == cudaSuccess) {
+    for (int device = 0; device < device_count; ++device) {
+      const int32_t node_id = GpuNumaNode(device);
+      auto it = std::find_if(
+          nodes.begin(), nodes.end(),
+          [node_id](const NumaNode& node) { return node.id_ == node_id; });
+      const NumaNode& node =
+          (it != nodes.end()) ? *it : nodes[device % nodes.size()];
+      add_policy("gpu" + std::to_string(device), node);
+    }
+  }
+#endif  // TRITON_ENABLE_GPU
+
+  return policies;
+}
+
+}}}  // namespace triton::developer_tools::server
@@ -0,0 +1,55 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "triton/developer_tools/common.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+// Return the first line of the file at 'path' with surrounding whitespace
+// removed, or an empty string if the file can't be read.
+std::string ReadSysfsLine(const std::string& path);
+
+// Parse a CPU list in the format of '/sys/devices/system/node/node*/cpulist',
+// e.g. "0-3,8,10-11", into the CPU ids.
+std::vector<int> ParseCpuList(const std::string& cpu_list);
+
+// Discover the NUMA nodes with CPUs under 'sysfs_node_dir'.
+std::vector<NumaNode> DiscoverNumaNodes(const std::string& sysfs_node_dir);
+
+// Return the NUMA node of the CPU the calling thread is running on, or
+// nullptr if it can't be determined.
+const NumaNode* CurrentNumaNode(const std::vector<NumaNode>& nodes);
+
+// Pin the calling thread to the CPUs in 'cpu_list'. Return false if the
+// affinity can't be set.
+bool PinCurrentThread(const std::string& cpu_list);
+
+}}}  // namespace triton::developer_tools::server
@@ -30,6 +30,8 @@
 
 #include <unordered_map>
 
+#include "log.h"
+#include "phase_counters.h"
 #include "triton/common/logging.h"
 #ifdef TRITON_ENABLE_GPU
 #include <cuda_runtime_api.h>
@@ -38,26 +40,7 @@
 
 namespace triton { namespace developer_tools { namespace server {
 
-#define IGNORE_ERROR(X)                   \
-  do {                                    \
-    TRITONSERVER_Error* ie_err__ = (X);   \
-    if (ie_err__ != nullptr) {            \
-      TRITONSERVER_ErrorDelete(ie_err__); \
-    }                                     \
-  } while (false)
-
-#define LOG_IF_ERROR(X, MSG)                                                   \
-  do {                                                                         \
-    TRITONSERVER_Error* lie_err__ = (X);                                       \
-    if (lie_err__ != nullptr) {                                                \
-      IGNORE_ERROR(TRITONSERVER_LogMessage(                                    \
-          TRITONSERVER_LOG_ERROR, __FILE__, __LINE__,                          \
-          (std::string(MSG) + ": " + TRITONSERVER_ErrorCodeString(lie_err__) + \
-           " - " + TRITONSERVER_ErrorMessage(lie_err__))                       \
-              .c_str()));                                                      \
-      TRITONSERVER_ErrorDelete(lie_err__);                                     \
-    }                                                                          \
-  } while (false)
+std::atomic<uint64_t> TraceManager::dropped_trace_count_(0);
 
 TraceManager::TraceManager(
     const TRITONSERVER_InferenceTraceLevel level, const uint32_t rate,
@@ -140,6 +123,7 @@ TraceManager::TraceActivity(
   // group the activity of the same trace together for more readable output.
   auto ts =
       reinterpret_cast<std::shared_ptr<TraceManager::Trace>*>(userp)->get();
+  PhaseScope trace_scope(ts->phase_counters_.get(), PhaseCounters::TRACE);
 
   std::lock_guard<std::mutex> lk(ts->mtx_);
   std::stringstream* ss = nullptr;
@@ -234,6 +218,7 @@ TraceManager::TraceTensorActivity(
   // group the activity of the same trace together for more readable output.
   auto ts =
       reinterpret_cast<std::shared_ptr<TraceManager::Trace>*>(userp)->get();
+  PhaseScope trace_scope(ts->phase_counters_.get(), PhaseCounters::TRACE);
 
   std::lock_guard<std::mutex> lk(ts->mtx_);
   std::stringstream* ss = nullptr;
@@ -431,9 +416,11 @@ TraceManager::TraceFile::~TraceFile()
 
 void
 TraceManager::TraceFile::SaveTraces(
-    std::stringstream& trace_stream, const bool to_index_file)
+    std::stringstream& trace_stream, const bool to_index_file,
+    const uint32_t trace_count)
 {
   try {
+    bool written = false;
     if (to_index_file) {
       std::string file_name =
           file_name_ + "." + std::to_string(index_.fetch_add(1));
@@ -442,6 +429,7 @@ TraceManager::TraceFile::SaveTraces(
       file_stream << "[";
       file_stream << trace_stream.rdbuf();
       file_stream << "]";
+      written = file_stream.good();
     } else {
       std::lock_guard<std::mutex> lock(mu_);
       if (first_write_) {
@@ -452,13 +440,20 @@ TraceManager::TraceFile::SaveTraces(
         trace_file_ << ",";
       }
       trace_file_ << trace_stream.rdbuf();
+      written = trace_file_.good();
+    }
+    if (!written) {
+      LOG_ERROR << "failed writing trace file " << file_name_;
+      dropped_trace_count_ += trace_count;
     }
   }
   catch (const std::ofstream::failure& e) {
     LOG_ERROR << "failed creating trace file: " << e.what();
+    dropped_trace_count_ += trace_count;
   }
   catch (...) {
     LOG_ERROR << "failed creating trace file: reason unknown";
+    dropped_trace_count_ += trace_count;
   }
 }
 
@@ -489,6 +484,7 @@ TraceManager::TraceSetting::SampleTrace()
     if (err != nullptr) {
       LOG_IF_ERROR(err, "creating inference trace object");
       delete trace_userp;
+      dropped_trace_count_++;
       return nullptr;
     }
     lts->trace_ = trace;
@@ -530,12 +526,13 @@ TraceManager::TraceSetting::WriteTrace(
   if (((count_ == 0) && (collected_ == sample_)) ||
       ((log_frequency_ != 0) && (sample_in_stream_ >= log_frequency_))) {
     // Reset variables and release lock before saving to file
+    const uint32_t trace_count = sample_in_stream_;
     sample_in_stream_ = 0;
     std::stringstream stream;
     trace_stream_.swap(stream);
     lock.unlock();
 
-    file_->SaveTraces(stream, true /* to_index_file */);
+    file_->SaveTraces(stream, true /* to_index_file */, trace_count);
   }
 }
 
@@ -567,7 +564,8 @@ TraceManager::TraceSetting::~TraceSetting()
 {
   // If log frequency is set, should log the remaining traces to indexed file.
   if (sample_in_stream_ != 0) {
-    file_->SaveTraces(trace_stream_, (log_frequency_ != 0));
+    file_->SaveTraces(
+        trace_stream_, (log_frequency_ != 0), sample_in_stream_);
   }
 }
 
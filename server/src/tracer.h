@@ -40,6 +40,8 @@
 
 namespace triton { namespace developer_tools { namespace server {
 
+class PhaseCounters;
+
 class TraceManager {
  public:
   class TraceSetting;
@@ -56,8 +58,12 @@ class TraceManager {
     // specifies whether the file name should be indexed, if true, the traces
     // will be written to 'file_name.index' where index will be incremented
     // every time the traces are written to a file with index. If false, the
-    // trace will be written to 'file_name'.
-    void SaveTraces(std::stringstream& trace_stream, const bool to_index_file);
+    // trace will be written to 'file_name'. 'trace_count' is the number of
+    // traces in 'trace_stream', which are counted as dropped if the write
+    // fails.
+    void SaveTraces(
+        std::stringstream& trace_stream, const bool to_index_file,
+        const uint32_t trace_count);
 
     const std::string& FileName() { return file_name_; }
 
@@ -89,6 +95,9 @@ class TraceManager {
     void* trace_userp_;
 
     uint64_t trace_id_;
+
+    // The counters of the traced model if the phase counters are enabled.
+    std::shared_ptr<PhaseCounters> phase_counters_;
   };
 
   TraceManager(
@@ -107,6 +116,13 @@ class TraceManager {
 
   static void TraceRelease(TRITONSERVER_InferenceTrace* trace, void* userp);
 
+  // Return the number of traces sampled in the process that could not be
+  // created or written to their file.
+  static uint64_t DroppedTraceCount()
+  {
+    return dropped_trace_count_.load(std::memory_order_relaxed);
+  }
+
   class TraceSetting {
    public:
     TraceSetting();
@@ -163,6 +179,8 @@ class TraceManager {
       const int64_t* shape, uint64_t dim_count,
       TRITONSERVER_MemoryType memory_type, int64_t memory_type_id, void* userp);
 
+  static std::atomic<uint64_t> dropped_trace_count_;
+
   std::shared_ptr<TraceSetting> global_setting_;
   std::unordered_map<std::string, std::shared_ptr<TraceSetting>>
       model_settings_;
@@ -0,0 +1,393 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "work_executor.h"
+
+#ifdef __linux__
+#include <sched.h>
+#endif  // __linux__
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <sstream>
+
+#include "container_limits.h"
+#include "log.h"
+#include "topology.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+//==============================================================================
+/// The chunks of a 'ParallelFor' call, shared by the calling thread and the
+/// tasks helping it. The chunks are claimed in order, so a task that starts
+/// after every chunk is claimed returns without touching 'fn_'.
+///
+struct ParallelForState {
+  ParallelForState(
+      const size_t begin, const size_t end, const size_t chunk_size,
+      const size_t chunk_count, const std::function<void(size_t, size_t)>& fn)
+      : begin_(begin), end_(end), chunk_size_(chunk_size),
+        chunk_count_(chunk_count), fn_(&fn), next_chunk_(0), done_count_(0)
+  {
+  }
+
+  // Run the chunks that are not claimed yet.
+  void RunChunks()
+  {
+    size_t chunk;
+    while ((chunk = next_chunk_.fetch_add(1)) < chunk_count_) {
+      const size_t chunk_begin = begin_ + chunk * chunk_size_;
+      try {
+        (*fn_)(chunk_begin, std::min(end_, chunk_begin + chunk_size_));
+      }
+      catch (...) {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (exception_ == nullptr) {
+          exception_ = std::current_exception();
+        }
+      }
+      if (done_count_.fetch_add(1) + 1 == chunk_count_) {
+        std::lock_guard<std::mutex> lk(mu_);
+        cv_.notify_all();
+      }
+    }
+  }
+
+  // Block until every chunk is done.
+  void Wait()
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait(lock, [this]() { return done_count_.load() == chunk_count_; });
+  }
+
+  const size_t begin_;
+  const size_t end_;
+  const size_t chunk_size_;
+  const size_t chunk_count_;
+  // Owned by the calling thread, which waits for every chunk to be done.
+  const std::function<void(size_t, size_t)>* fn_;
+  std::atomic<size_t> next_chunk_;
+  std::atomic<size_t> done_count_;
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::exception_ptr exception_;
+};
+
+thread_local const WorkStealingExecutor*
+    WorkStealingExecutor::current_executor_ = nullptr;
+thread_local size_t WorkStealingExecutor::current_worker_ = 0;
+
+WorkStealingExecutor::WorkStealingExecutor(
+    const WorkExecutorOptions& options, std::function<void()> thread_init,
+    const std::string& cpu_list)
+    : thread_count_(
+          (options.thread_count_ != 0)
+              ? options.thread_count_
+              : ProcessContainerLimits().effective_cpu_count_),
+      thread_init_(thread_init), started_(false), exiting_(false),
+      pending_count_(0), idle_count_(0), next_worker_(0), submitted_count_(0),
+      executed_count_(0), steal_count_(0), parallel_for_count_(0)
+{
+  for (auto& depth : queue_depth_) {
+    depth = 0;
+  }
+  for (uint32_t i = 0; i < thread_count_; ++i) {
+    workers_.emplace_back(new Worker());
+  }
+
+  if (options.affinity_ == WorkExecutorOptions::Affinity::CPU) {
+    std::vector<int> cpus = ParseCpuList(cpu_list);
+#ifdef __linux__
+    if (cpus.empty()) {
+      cpu_set_t cpu_set;
+      CPU_ZERO(&cpu_set);
+      if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+          if (CPU_ISSET(cpu, &cpu_set)) {
+            cpus.push_back(cpu);
+          }
+        }
+      }
+    }
+#endif  // __linux__
+    for (uint32_t i = 0; (i < thread_count_) && !cpus.empty(); ++i) {
+      worker_cpus_.push_back(cpus[i % cpus.size()]);
+    }
+  }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor()
+{
+  Stop();
+}
+
+void
+WorkStealingExecutor::Submit(
+    std::function<void()>&& task, const TaskPriority priority)
+{
+  if (exiting_) {
+    return;
+  }
+  if (!started_.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lk(start_mu_);
+    if (exiting_) {
+      return;
+    }
+    if (!started_.load(std::memory_order_relaxed)) {
+      StartWorkers();
+      started_.store(true, std::memory_order_release);
+    }
+  }
+
+  const size_t lane = (priority == TaskPriority::LATENCY) ? 0 : 1;
+  const size_t index =
+      (current_executor_ == this)
+          ? current_worker_
+          : (next_worker_.fetch_add(1, std::memory_order_relaxed) %
+             thread_count_);
+  // The task is counted before it is queued so that the counts never go
+  // below 0 when it is taken right away.
+  queue_depth_[lane].fetch_add(1, std::memory_order_relaxed);
+  submitted_count_.fetch_add(1, std::memory_order_relaxed);
+  pending_count_.fetch_add(1);
+  {
+    Worker& worker = *workers_[index];
+    std::lock_guard<std::mutex> lk(worker.mu_);
+    worker.lanes_[lane].emplace_back(std::move(task));
+  }
+  if (idle_count_.load() != 0) {
+    std::lock_guard<std::mutex> lk(idle_mu_);
+    idle_cv_.notify_one();
+  }
+}
+
+void
+WorkStealingExecutor::ParallelFor(
+    const size_t begin, const size_t end, const size_t grain_size,
+    const std::function<void(size_t, size_t)>& fn,
+    const TaskPriority priority)
+{
+  if (end <= begin) {
+    return;
+  }
+  // A few chunks per worker so that the workers that finish early balance
+  // the chunks that are slower, each chunk being at least 'grain_size'.
+  const size_t size = end - begin;
+  const size_t max_chunk_count = 4 * (size_t(thread_count_) + 1);
+  const size_t chunk_size = std::max(
+      std::max(grain_size, size_t(1)),
+      (size + max_chunk_count - 1) / max_chunk_count);
+  const size_t chunk_count = (size + chunk_size - 1) / chunk_size;
+  if ((chunk_count <= 1) || exiting_) {
+    fn(begin, end);
+    return;
+  }
+
+  parallel_for_count_.fetch_add(1, std::memory_order_relaxed);
+  std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>(
+      begin, end, chunk_size, chunk_count, fn);
+  const size_t helper_count =
+      std::min(chunk_count - 1, size_t(thread_count_));
+  for (size_t i = 0; i < helper_count; ++i) {
+    Submit([state]() { state->RunChunks(); }, priority);
+  }
+  state->RunChunks();
+  state->Wait();
+  if (state->exception_ != nullptr) {
+    std::rethrow_exception(state->exception_);
+  }
+}
+
+WorkExecutorStats
+WorkStealingExecutor::Statistics()
+{
+  WorkExecutorStats stats;
+  stats.thread_count_ = thread_count_;
+  stats.latency_queue_depth_ = queue_depth_[0].load(std::memory_order_relaxed);
+  stats.background_queue_depth_ =
+      queue_depth_[1].load(std::memory_order_relaxed);
+  stats.submitted_count_ = submitted_count_.load(std::memory_order_relaxed);
+  stats.executed_count_ = executed_count_.load(std::memory_order_relaxed);
+  stats.steal_count_ = steal_count_.load(std::memory_order_relaxed);
+  stats.parallel_for_count_ =
+      parallel_for_count_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+std::string
+WorkStealingExecutor::FormatMetrics()
+{
+  const WorkExecutorStats stats = Statistics();
+  std::stringstream ss;
+  ss << "# HELP tds_executor_threads Number of workers of the shared executor"
+     << std::endl
+     << "# TYPE tds_executor_threads gauge" << std::endl
+     << "tds_executor_threads "
+     << (started_ ? stats.thread_count_ : uint32_t(0)) << std::endl
+     << "# HELP tds_executor_queue_depth Number of tasks queued in the shared "
+        "executor"
+     << std::endl
+     << "# TYPE tds_executor_queue_depth gauge" << std::endl
+     << "tds_executor_queue_depth{lane=\"latency\"} "
+     << stats.latency_queue_depth_ << std::endl
+     << "tds_executor_queue_depth{lane=\"background\"} "
+     << stats.background_queue_depth_ << std::endl
+     << "# HELP tds_executor_tasks_total Number of tasks run by the shared "
+        "executor"
+     << std::endl
+     << "# TYPE tds_executor_tasks_total counter" << std::endl
+     << "tds_executor_tasks_total " << stats.executed_count_ << std::endl
+     << "# HELP tds_executor_steals_total Number of tasks a worker of the "
+        "shared executor took from another worker"
+     << std::endl
+     << "# TYPE tds_executor_steals_total counter" << std::endl
+     << "tds_executor_steals_total " << stats.steal_count_ << std::endl;
+  return ss.str();
+}
+
+void
+WorkStealingExecutor::Stop()
+{
+  {
+    std::lock_guard<std::mutex> lk(start_mu_);
+    exiting_ = true;
+  }
+  {
+    std::lock_guard<std::mutex> lk(idle_mu_);
+    idle_cv_.notify_all();
+  }
+  for (auto& worker : workers_) {
+    if (!worker->thread_.joinable()) {
+      continue;
+    }
+    // The last reference to the server may be released by a task, the
+    // worker running it holds a reference to the executor until it exits.
+    if (worker->thread_.get_id() == std::this_thread::get_id()) {
+      worker->thread_.detach();
+    } else {
+      worker->thread_.join();
+    }
+  }
+  // The dropped tasks are destroyed outside of the locks since they may
+  // release the last reference to an object that submits tasks.
+  for (auto& worker : workers_) {
+    std::deque<std::function<void()>> dropped_tasks[kLaneCount];
+    {
+      std::lock_guard<std::mutex> lk(worker->mu_);
+      for (size_t lane = 0; lane < kLaneCount; ++lane) {
+        queue_depth_[lane].fetch_sub(
+            worker->lanes_[lane].size(), std::memory_order_relaxed);
+        dropped_tasks[lane].swap(worker->lanes_[lane]);
+      }
+    }
+  }
+}
+
+void
+WorkStealingExecutor::StartWorkers()
+{
+  std::shared_ptr<WorkStealingExecutor> self = shared_from_this();
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i]->thread_ = std::thread([self, i]() { self->WorkerLoop(i); });
+  }
+}
+
+void
+WorkStealingExecutor::WorkerLoop(const size_t index)
+{
+  thread_init_();
+  if (!worker_cpus_.empty()) {
+    const std::string cpu = std::to_string(worker_cpus_[index]);
+    if (!PinCurrentThread(cpu)) {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_WARN,
+          ("Failed to pin executor worker to CPU " + cpu).c_str());
+    }
+  }
+  current_executor_ = this;
+  current_worker_ = index;
+
+  std::function<void()> task;
+  while (!exiting_) {
+    if (NextTask(index, 0, &task) || NextTask(index, 1, &task)) {
+      pending_count_.fetch_sub(1);
+      try {
+        task();
+      }
+      catch (const std::exception& ex) {
+        LOG_MESSAGE(
+            TRITONSERVER_LOG_ERROR,
+            (std::string("Executor task failed: ") + ex.what()).c_str());
+      }
+      catch (...) {
+        LOG_MESSAGE(
+            TRITONSERVER_LOG_ERROR, "Executor task failed: unknown exception");
+      }
+      // The task is destroyed before waiting for the next one since it may
+      // hold the last reference to an object.
+      task = nullptr;
+      executed_count_.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(idle_mu_);
+    idle_count_.fetch_add(1);
+    idle_cv_.wait(
+        lock, [this]() { return exiting_ || (pending_count_.load() != 0); });
+    idle_count_.fetch_sub(1);
+  }
+}
+
+bool
+WorkStealingExecutor::NextTask(
+    const size_t index, const size_t lane, std::function<void()>* task)
+{
+  {
+    Worker& own = *workers_[index];
+    std::lock_guard<std::mutex> lk(own.mu_);
+    if (!own.lanes_[lane].empty()) {
+      *task = std::move(own.lanes_[lane].front());
+      own.lanes_[lane].pop_front();
+      queue_depth_[lane].fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  for (size_t i = 1; i < workers_.size(); ++i) {
+    Worker& victim = *workers_[(index + i) % workers_.size()];
+    std::lock_guard<std::mutex> lk(victim.mu_);
+    if (!victim.lanes_[lane].empty()) {
+      *task = std::move(victim.lanes_[lane].back());
+      victim.lanes_[lane].pop_back();
+      queue_depth_[lane].fetch_sub(1, std::memory_order_relaxed);
+      steal_count_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+}}}  // namespace triton::developer_tools::server
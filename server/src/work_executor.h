@@ -0,0 +1,133 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "triton/developer_tools/server_wrapper.h"
+
+namespace triton { namespace developer_tools { namespace server {
+
+//==============================================================================
+/// The executor shared by the parallel work of a server. Each worker owns a
+/// deque per lane guarded by its own mutex. A task submitted from a worker is
+/// pushed to the deque of that worker, other tasks are spread round-robin. A
+/// worker runs the tasks of its own deque in order and, once it is empty,
+/// steals the most recent task from the deques of the other workers. The
+/// latency lanes of all workers are drained before any background task is
+/// run. The workers share the ownership of the executor, so a task that
+/// releases the last reference to the server, and stops the executor from a
+/// worker, never leaves that worker with a destroyed executor. See
+/// 'TritonServer::SharedExecutor' for more information.
+///
+class WorkStealingExecutor
+    : public WorkExecutor,
+      public std::enable_shared_from_this<WorkStealingExecutor> {
+ public:
+  // 'thread_init' is run first by each worker, 'cpu_list' is the CPUs of the
+  // wrapper threads if they are pinned. The executor must be owned by a
+  // 'std::shared_ptr' and stopped by its owner, the workers keep it alive
+  // until then.
+  WorkStealingExecutor(
+      const WorkExecutorOptions& options, std::function<void()> thread_init,
+      const std::string& cpu_list);
+
+  ~WorkStealingExecutor();
+
+  using WorkExecutor::Submit;
+  void Submit(
+      std::function<void()>&& task, const TaskPriority priority) override;
+
+  void ParallelFor(
+      const size_t begin, const size_t end, const size_t grain_size,
+      const std::function<void(size_t, size_t)>& fn,
+      const TaskPriority priority) override;
+
+  WorkExecutorStats Statistics() override;
+
+  // Format the statistics in the Prometheus text format.
+  std::string FormatMetrics();
+
+  // Stop and join the workers, the pending tasks are dropped. The tasks
+  // submitted afterwards are dropped as well. A worker calling it is
+  // detached instead and exits after its current task.
+  void Stop();
+
+ private:
+  static constexpr size_t kLaneCount = 2;
+
+  struct Worker {
+    std::mutex mu_;
+    std::deque<std::function<void()>> lanes_[kLaneCount];
+    std::thread thread_;
+  };
+
+  void StartWorkers();
+  void WorkerLoop(const size_t index);
+
+  // Pop the next task of 'lane' for worker 'index', from its own deque or
+  // stolen from another worker. Return false if the lane is empty.
+  bool NextTask(
+      const size_t index, const size_t lane, std::function<void()>* task);
+
+  const uint32_t thread_count_;
+  std::function<void()> thread_init_;
+  // The CPU each worker is pinned to, empty if the workers are not pinned to
+  // a single CPU.
+  std::vector<int> worker_cpus_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  std::mutex start_mu_;
+  std::atomic<bool> started_;
+  std::atomic<bool> exiting_;
+
+  // The tasks queued in all the deques, which the idle workers wait for.
+  std::atomic<uint64_t> pending_count_;
+  std::atomic<uint32_t> idle_count_;
+  std::mutex idle_mu_;
+  std::condition_variable idle_cv_;
+
+  std::atomic<uint64_t> next_worker_;
+  std::atomic<uint64_t> queue_depth_[kLaneCount];
+  std::atomic<uint64_t> submitted_count_;
+  std::atomic<uint64_t> executed_count_;
+  std::atomic<uint64_t> steal_count_;
+  std::atomic<uint64_t> parallel_for_count_;
+
+  // The executor and the index of the worker running on the current thread.
+  static thread_local const WorkStealingExecutor* current_executor_;
+  static thread_local size_t current_worker_;
+};
+
+}}}  // namespace triton::developer_tools::server
@@ -23,13 +23,33 @@
 // OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <exception>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
 
+#include "codegen.h"
+#include "container_limits.h"
 #include "gtest/gtest.h"
+#include "sparse_input.h"
 #include "triton/core/tritonserver.h"
 #include "triton/developer_tools/server_wrapper.h"
+#include "triton/developer_tools/stats_segment.h"
+#include "triton/developer_tools/typed_tensor.h"
 
 namespace tds = triton::developer_tools::server;
+namespace tools = triton::developer_tools::tools;
 
 namespace {
 
@@ -60,174 +80,1782 @@ TEST(TritonServer, StartInvalidRepository)
   }
 }
 
-class TritonServerTest : public ::testing::Test {
- protected:
-  TritonServerTest() : options_({"./models"})
-  {
-    options_.logging_ = tds::LoggingOptions(
-        tds::LoggingOptions::VerboseLevel(0), false, false, false,
-        tds::LoggingOptions::LogFormat::DEFAULT, "");
-  }
-
-  tds::ServerOptions options_;
-};
-
-void
-CPUAllocator(
-    const char* tensor_name, size_t byte_size,
-    tds::MemoryType preferred_memory_type, int64_t preferred_memory_type_id,
-    void** buffer, tds::MemoryType* actual_memory_type,
-    int64_t* actual_memory_type_id)
+TEST(RaggedBatchBuilder, PackAndUnpack)
+{
+  try {
+    std::vector<int32_t> item0{1, 2, 3};
+    std::vector<int32_t> item1{4};
+    std::vector<int32_t> item2{5, 6};
+    tds::RaggedBatchBuilder builder(
+        tds::DataType::INT32, tds::RaggedBatchBuilder::IndexKind::OFFSETS);
+    builder.AddItem(item0.begin(), item0.end());
+    builder.AddItem(item1.data(), item1.size());
+    builder.AddItem(item2.begin(), item2.end());
+    ASSERT_EQ(builder.ItemCount(), 3);
+    ASSERT_EQ(builder.ElementCount(), 6);
+    ASSERT_EQ(builder.Lengths(), (std::vector<int64_t>{3, 1, 2}));
+
+    auto request = tds::InferRequest::Create(tds::InferOptions("ragged"));
+    builder.Build(*request, "INPUT", "INDEX");
+
+    // Unpack a [6, 2] output into per-item views.
+    std::vector<int32_t> output_data(12);
+    for (size_t i = 0; i < output_data.size(); ++i) {
+      output_data[i] = i;
+    }
+    tds::Tensor output(
+        reinterpret_cast<char*>(output_data.data()),
+        output_data.size() * sizeof(int32_t), tds::DataType::INT32, {6, 2},
+        tds::MemoryType::CPU, 0);
+    std::vector<tds::Tensor> views = builder.Unpack(output);
+    ASSERT_EQ(views.size(), 3);
+    ASSERT_EQ(views[0].shape_, (std::vector<int64_t>{3, 2}));
+    ASSERT_EQ(views[1].shape_, (std::vector<int64_t>{1, 2}));
+    ASSERT_EQ(views[2].shape_, (std::vector<int64_t>{2, 2}));
+    ASSERT_EQ(views[1].byte_size_, 2 * sizeof(int32_t));
+    EXPECT_EQ(reinterpret_cast<const int32_t*>(views[1].buffer_)[0], 6);
+    EXPECT_EQ(reinterpret_cast<const int32_t*>(views[2].buffer_)[1], 11);
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST(RaggedBatchBuilder, MismatchedLengths)
+{
+  std::vector<float> output_data(4);
+  tds::Tensor output(
+      reinterpret_cast<char*>(output_data.data()),
+      output_data.size() * sizeof(float), tds::DataType::FP32, {4},
+      tds::MemoryType::CPU, 0);
+  try {
+    tds::RaggedBatchBuilder::Unpack(output, {1, 2});
+    FAIL() << "Expected an exception for mismatched item lengths";
+  }
+  catch (std::exception& ex) {
+    ASSERT_STREQ(
+        ex.what(),
+        "Error - RaggedBatchBuilder: the sum of item lengths 3 does not match "
+        "the first dimension of the output 4.");
+  }
+}
+
+TEST(Codegen, GenerateHeader)
+{
+  const std::string pbtxt = R"(
+name: "image-model"
+max_batch_size: 8
+input [
+  { name: "INPUT0" data_type: TYPE_FP32 dims: [ 3, 4 ] },
+  { name: "MASK" data_type: TYPE_BOOL dims: [ -1 ] optional: true }
+]
+output [
+  { name: "OUTPUT0" data_type: TYPE_INT64 dims: [ 2 ] },
+  { name: "LABEL" data_type: TYPE_STRING dims: [ 1 ] }
+]
+)";
+  const auto config = tools::ParseModelConfig(pbtxt, "");
+  std::stringstream header;
+  tools::GenerateHeader(config, "gen", header);
+  const std::string text = header.str();
+  auto contains = [&text](const std::string& str) {
+    return text.find(str) != std::string::npos;
+  };
+
+  ASSERT_TRUE(contains("namespace gen { namespace image_model {"));
+  ASSERT_TRUE(contains("constexpr char kModelName[] = \"image-model\";"));
+  ASSERT_TRUE(contains("constexpr int64_t kMaxBatchSize = 8;"));
+  ASSERT_TRUE(contains("names{\"INPUT0\", \"MASK\"};"));
+  ASSERT_TRUE(contains("names{\"OUTPUT0\", \"LABEL\"};"));
+
+  // The data types of the model configuration map to the typed views, and
+  // the default shape of a fully specified input has one batch.
+  ASSERT_TRUE(contains("tds::TypedInput<tds::DataType::FP32> INPUT0;"));
+  ASSERT_TRUE(contains("tds::TypedInput<tds::DataType::BOOL> MASK;"));
+  ASSERT_TRUE(
+      contains("inputs.INPUT0.AddTo(request, InputNames()[0], {1, 3, 4});"));
+  ASSERT_TRUE(contains("tds::TypedOutput<tds::DataType::INT64>\n  OUTPUT0()"));
+  ASSERT_TRUE(contains("tds::TypedOutput<tds::DataType::BYTES>\n  LABEL()"));
+
+  // The optional input of variable shape is added only if set, and must have
+  // its shape set by the caller.
+  ASSERT_TRUE(contains("  if (inputs.MASK.data_ != nullptr) {\n"));
+  ASSERT_TRUE(contains("if (inputs.MASK.shape_.empty()) {"));
+  ASSERT_TRUE(contains("inputs.MASK.AddTo(request, InputNames()[1], {});"));
+
+  ASSERT_THROW(
+      tools::ParseModelConfig(
+          "input [ { name: \"X\" data_type: TYPE_COMPLEX dims: [ 1 ] } ]",
+          "bad"),
+      std::runtime_error);
+}
+
+TEST(Codegen, Reproducible)
+{
+  const std::string pbtxt = R"(
+name: "add_sub"
+max_batch_size: 0
+input [
+  { name: "INPUT0" data_type: TYPE_INT32 dims: [ 16 ] },
+  { name: "INPUT1" data_type: TYPE_INT32 dims: [ 16 ] }
+]
+output [
+  { name: "OUTPUT0" data_type: TYPE_INT32 dims: [ 16 ] },
+  { name: "OUTPUT1" data_type: TYPE_INT32 dims: [ 16 ] }
+]
+)";
+  // The same configuration returned by 'TritonServer::ModelConfig'.
+  const std::string json =
+      R"({"name":"add_sub","max_batch_size":0,"input":[)"
+      R"({"name":"INPUT0","data_type":"TYPE_INT32","dims":[16]},)"
+      R"({"name":"INPUT1","data_type":"TYPE_INT32","dims":[16]}],)"
+      R"("output":[{"name":"OUTPUT0","data_type":"TYPE_INT32","dims":[16]},)"
+      R"({"name":"OUTPUT1","data_type":"TYPE_INT32","dims":[16]}]})";
+
+  auto generate = [](const std::string& config_text) {
+    std::stringstream header;
+    tools::GenerateHeader(
+        tools::ParseModelConfig(config_text, ""), "tds_models", header);
+    return header.str();
+  };
+  const std::string first = generate(pbtxt);
+  ASSERT_EQ(first, generate(pbtxt));
+  ASSERT_EQ(first, generate(json));
+  ASSERT_NE(
+      first.find("inputs.INPUT1.AddTo(request, InputNames()[1], {16});"),
+      std::string::npos);
+}
+
+TEST(HostTopology, GenerateHostPolicies)
+{
+  try {
+    std::vector<tds::HostPolicy> policies = tds::GenerateHostPolicies(
+        {tds::NumaNode(0, "0-3"), tds::NumaNode(1, "4-7")});
+    size_t numa_policy_count = 0;
+    for (const auto& policy : policies) {
+      if (policy.name_ == "numa0" || policy.name_ == "numa1") {
+        const std::string id = policy.name_.substr(4);
+        if (policy.setting_ == tds::HostPolicy::Setting::NUMA_NODE) {
+          ASSERT_EQ(policy.value_, id);
+        } else {
+          ASSERT_EQ(policy.setting_, tds::HostPolicy::Setting::CPU_CORES);
+          ASSERT_EQ(policy.value_, (id == "0") ? "0-3" : "4-7");
+        }
+        numa_policy_count++;
+      }
+    }
+    ASSERT_EQ(numa_policy_count, size_t(4));
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+// Write 'content' to 'path' under 'root', creating the parent directories.
+void
+WriteCgroupFile(
+    const std::string& root, const std::string& path,
+    const std::string& content)
+{
+  for (size_t pos = path.find('/', 1); pos != std::string::npos;
+       pos = path.find('/', pos + 1)) {
+    mkdir((root + path.substr(0, pos)).c_str(), 0755);
+  }
+  std::ofstream(root + path) << content << "\n";
+}
+
+TEST(HostTopology, ContainerLimitsCgroupV2)
+{
+  const std::string root = "./container_limits_v2";
+  mkdir(root.c_str(), 0755);
+  WriteCgroupFile(root, "/proc_self_cgroup", "0::/kubepods/pod1");
+  // The smallest quota and memory limit of the hierarchy apply.
+  WriteCgroupFile(root, "/kubepods/cpu.max", "max 100000");
+  WriteCgroupFile(root, "/kubepods/pod1/cpu.max", "150000 100000");
+  WriteCgroupFile(root, "/kubepods/pod1/cpuset.cpus.effective", "0-3,8");
+  WriteCgroupFile(root, "/kubepods/memory.max", "1073741824");
+  WriteCgroupFile(root, "/kubepods/pod1/memory.max", "max");
+
+  tds::ContainerLimits limits =
+      tds::DetectContainerLimits(root + "/proc_self_cgroup", root, 16);
+  ASSERT_EQ(limits.cgroup_version_, 2);
+  ASSERT_DOUBLE_EQ(limits.cpu_quota_, 1.5);
+  ASSERT_EQ(limits.cpuset_cpu_count_, uint32_t(5));
+  ASSERT_EQ(limits.effective_cpu_count_, uint32_t(2));
+  ASSERT_EQ(limits.memory_limit_byte_size_, uint64_t(1) << 30);
+
+  // The CPU affinity of the process limits the cpuset.
+  limits = tds::DetectContainerLimits(root + "/proc_self_cgroup", root, 1);
+  ASSERT_EQ(limits.cpuset_cpu_count_, uint32_t(1));
+  ASSERT_EQ(limits.effective_cpu_count_, uint32_t(1));
+}
+
+TEST(HostTopology, ContainerLimitsCgroupV1)
+{
+  const std::string root = "./container_limits_v1";
+  mkdir(root.c_str(), 0755);
+  // The hybrid layout, the controllers are attached to the v1 hierarchies.
+  WriteCgroupFile(
+      root, "/proc_self_cgroup",
+      "12:cpu,cpuacct:/docker/abc\n11:cpuset:/docker/abc\n"
+      "10:memory:/docker/abc\n0::/");
+  WriteCgroupFile(root, "/cpu,cpuacct/docker/abc/cpu.cfs_quota_us", "250000");
+  WriteCgroupFile(root, "/cpu,cpuacct/docker/abc/cpu.cfs_period_us", "100000");
+  WriteCgroupFile(root, "/cpuset/docker/abc/cpuset.cpus", "0-7");
+  // The unlimited value of the cgroup is ignored for the parent's limit.
+  WriteCgroupFile(
+      root, "/memory/docker/abc/memory.limit_in_bytes",
+      "9223372036854771712");
+  WriteCgroupFile(root, "/memory/docker/memory.limit_in_bytes", "536870912");
+
+  const tds::ContainerLimits limits =
+      tds::DetectContainerLimits(root + "/proc_self_cgroup", root, 4);
+  ASSERT_EQ(limits.cgroup_version_, 1);
+  ASSERT_DOUBLE_EQ(limits.cpu_quota_, 2.5);
+  ASSERT_EQ(limits.cpuset_cpu_count_, uint32_t(4));
+  ASSERT_EQ(limits.effective_cpu_count_, uint32_t(3));
+  ASSERT_EQ(limits.memory_limit_byte_size_, uint64_t(512) << 20);
+}
+
+TEST(HostTopology, ContainerLimitsNoCgroup)
+{
+  const tds::ContainerLimits limits = tds::DetectContainerLimits(
+      "./container_limits_none/proc_self_cgroup", "./container_limits_none",
+      6);
+  ASSERT_EQ(limits.cgroup_version_, 0);
+  ASSERT_EQ(limits.cpu_quota_, 0);
+  ASSERT_EQ(limits.cpuset_cpu_count_, uint32_t(6));
+  ASSERT_EQ(limits.effective_cpu_count_, uint32_t(6));
+  ASSERT_EQ(limits.memory_limit_byte_size_, uint64_t(0));
+}
+
+TEST(InferFuture, Continuations)
+{
+  // An executor running each task on its own thread.
+  class ThreadExecutor : public tds::Executor {
+   public:
+    ~ThreadExecutor()
+    {
+      for (auto& thread : threads_) {
+        thread.join();
+      }
+    }
+    void Submit(std::function<void()>&& task) override
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      threads_.emplace_back(std::move(task));
+    }
+
+   private:
+    std::mutex mu_;
+    std::vector<std::thread> threads_;
+  };
+
+  try {
+    ThreadExecutor executor;
+    tds::Promise<int> promise;
+    tds::Future<int> future = promise.get_future();
+    ASSERT_FALSE(future.is_ready());
+    auto doubled =
+        future.then([](tds::Future<int> ready) { return 2 * ready.get(); });
+    ASSERT_FALSE(future.valid());
+    auto described =
+        doubled.then(executor, [](tds::Future<int> ready) {
+          return std::to_string(ready.get());
+        });
+    // A continuation returning a future is unwrapped.
+    tds::Promise<int> inner_promise;
+    auto inner = described.then(
+        [&inner_promise](tds::Future<std::string> ready) {
+          return inner_promise.get_future();
+        });
+    promise.set_value(21);
+    ASSERT_EQ(
+        inner.wait_for(std::chrono::milliseconds(10)),
+        std::future_status::timeout);
+    inner_promise.set_value(42);
+    ASSERT_EQ(inner.get(), 42);
+
+    // Exceptions are propagated through the continuations.
+    tds::Promise<int> failed_promise;
+    auto failed = failed_promise.get_future().then(
+        [](tds::Future<int> ready) { return ready.get() + 1; });
+    failed_promise.set_exception(
+        std::make_exception_ptr(std::runtime_error("failed")));
+    ASSERT_THROW(failed.get(), std::runtime_error);
+
+    // A destroyed promise breaks its future.
+    tds::Future<int> broken;
+    {
+      tds::Promise<int> broken_promise;
+      broken = broken_promise.get_future();
+    }
+    ASSERT_THROW(broken.get(), std::future_error);
+
+    // Combinators
+    std::vector<tds::Promise<int>> promises(3);
+    std::vector<tds::Future<int>> futures;
+    for (auto& p : promises) {
+      futures.emplace_back(p.get_future());
+    }
+    auto all = tds::when_all(std::move(futures));
+    promises[0].set_value(0);
+    promises[2].set_value(2);
+    ASSERT_FALSE(all.is_ready());
+    promises[1].set_value(1);
+    auto all_result = all.get();
+    for (size_t i = 0; i < all_result.size(); ++i) {
+      ASSERT_EQ(all_result[i].get(), int(i));
+    }
+
+    std::vector<tds::Promise<int>> any_promises(3);
+    futures.clear();
+    for (auto& p : any_promises) {
+      futures.emplace_back(p.get_future());
+    }
+    auto any = tds::when_any(std::move(futures));
+    any_promises[1].set_value(1);
+    auto any_result = any.get();
+    ASSERT_EQ(any_result.first, size_t(1));
+    ASSERT_EQ(any_result.second[1].get(), 1);
+    ASSERT_FALSE(any_result.second[0].is_ready());
+
+    // Conversion to 'std::future'
+    tds::Promise<int> std_promise;
+    std::future<int> std_future = std_promise.get_future();
+    std_promise.set_value(7);
+    ASSERT_EQ(std_future.get(), 7);
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+class TritonServerTest : public ::testing::Test {
+ protected:
+  TritonServerTest() : options_({"./models"})
+  {
+    options_.logging_ = tds::LoggingOptions(
+        tds::LoggingOptions::VerboseLevel(0), false, false, false,
+        tds::LoggingOptions::LogFormat::DEFAULT, "");
+  }
+
+  tds::ServerOptions options_;
+};
+
+void
+CPUAllocator(
+    const char* tensor_name, size_t byte_size,
+    tds::MemoryType preferred_memory_type, int64_t preferred_memory_type_id,
+    void** buffer, tds::MemoryType* actual_memory_type,
+    int64_t* actual_memory_type_id)
+{
+  std::cout << "Using custom allocation function" << std::endl;
+
+  *actual_memory_type = tds::MemoryType::CPU;
+  *actual_memory_type_id = preferred_memory_type_id;
+
+  // If 'byte_size' is zero just return 'buffer' == nullptr, we don't
+  // need to do any other book-keeping.
+  if (byte_size == 0) {
+    *buffer = nullptr;
+    std::cout << "allocated " << byte_size << " bytes for result tensor "
+              << tensor_name << std::endl;
+  } else {
+    void* allocated_ptr = malloc(byte_size);
+    if (allocated_ptr != nullptr) {
+      *buffer = allocated_ptr;
+      std::cout << "allocated " << byte_size << " bytes in "
+                << MemoryTypeString(*actual_memory_type)
+                << " for result tensor " << tensor_name << std::endl;
+    }
+  }
+}
+
+void
+ResponseRelease(
+    void* buffer, size_t byte_size, tds::MemoryType memory_type,
+    int64_t memory_type_id)
+{
+  std::cout << "Using custom response release function" << std::endl;
+
+  std::stringstream ss;
+  ss << buffer;
+  std::string buffer_str = ss.str();
+
+  std::cout << "Releasing buffer " << buffer_str << " of size "
+            << std::to_string(byte_size) << " in "
+            << tds::MemoryTypeString(memory_type);
+
+  switch (memory_type) {
+    case tds::MemoryType::CPU:
+      free(buffer);
+      break;
+
+    default:
+      std::cerr << "error: unexpected buffer allocated in CUDA managed memory"
+                << std::endl;
+      break;
+  }
+}
+
+TEST_F(TritonServerTest, StartNone)
+{
+  // Start server with default mode (NONE)
+  try {
+    auto server = tds::TritonServer::Create(options_);
+    std::set<std::string> loaded_models = server->LoadedModels();
+    ASSERT_EQ(loaded_models.size(), 4);
+    ASSERT_NE(loaded_models.find("add_sub"), loaded_models.end());
+    ASSERT_NE(loaded_models.find("add_sub_str"), loaded_models.end());
+    ASSERT_NE(loaded_models.find("failing_infer"), loaded_models.end());
+    ASSERT_NE(loaded_models.find("square_int32"), loaded_models.end());
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST_F(TritonServerTest, NoneLoadUnload)
+{
+  // Start server with NONE mode which explicit model control is not allowed
+  try {
+    auto server = tds::TritonServer::Create(options_);
+    server->LoadModel("add_sub");
+    server->UnloadModel("add_sub");
+  }
+  catch (std::exception& ex) {
+    ASSERT_STREQ(
+        ex.what(),
+        "Error - LoadModel: Unavailable-explicit model load / unload is not "
+        "allowed if polling is enabled\n");
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST_F(TritonServerTest, Explicit)
+{
+  try {
+    options_.model_control_mode_ = tds::ModelControlMode::EXPLICIT;
+
+    std::set<std::string> startup_models;
+    startup_models.insert("add_sub");
+    options_.startup_models_ = startup_models;
+
+    auto server = tds::TritonServer::Create(options_);
+    std::set<std::string> loaded_models = server->LoadedModels();
+    ASSERT_EQ(loaded_models.size(), 1);
+    ASSERT_EQ(*loaded_models.begin(), "add_sub");
+    server->UnloadModel("add_sub");
+    loaded_models = server->LoadedModels();
+    ASSERT_EQ(loaded_models.size(), 0);
+
+    server->LoadModel("add_sub_str");
+    loaded_models = server->LoadedModels();
+    ASSERT_EQ(loaded_models.size(), 1);
+    ASSERT_EQ(*loaded_models.begin(), "add_sub_str");
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST_F(TritonServerTest, CreateAsync)
+{
+  try {
+    options_.model_control_mode_ = tds::ModelControlMode::EXPLICIT;
+    options_.startup_models_ = {"add_sub", "add_sub_str", "missing_model"};
+    auto server = tds::TritonServer::CreateAsync(options_);
+
+    // A model can be inferred as soon as it is loaded.
+    server->ModelStartupFuture("add_sub").get();
+    ASSERT_TRUE(server->IsModelReady("add_sub", -1));
+    std::vector<int32_t> input_data;
+    while (input_data.size() < 16) {
+      input_data.emplace_back(input_data.size());
+    }
+    auto request = tds::InferRequest::Create(tds::InferOptions("add_sub"));
+    for (const auto& name : std::vector<std::string>{"INPUT0", "INPUT1"}) {
+      request->AddInput(
+          name, tds::Tensor(
+                    reinterpret_cast<char*>(input_data.data()),
+                    input_data.size() * sizeof(int32_t), tds::DataType::INT32,
+                    {16}, tds::MemoryType::CPU, 0));
+    }
+    auto result = server->Infer(*request);
+    ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
+
+    // The startup completes with the error of the model that failed to load.
+    ASSERT_THROW(server->StartupFuture().get(), tds::TritonException);
+    ASSERT_THROW(
+        server->ModelStartupFuture("missing_model").get(),
+        tds::TritonException);
+    server->ModelStartupFuture("add_sub_str").get();
+    std::set<std::string> loaded_models = server->LoadedModels();
+    ASSERT_EQ(loaded_models.size(), 2);
+    ASSERT_TRUE(server->ModelStartupFuture("square_int32").is_ready());
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST_F(TritonServerTest, CreateAsyncNone)
+{
+  try {
+    // All the models are loaded in NONE mode, which still rejects explicit
+    // model control.
+    auto server = tds::TritonServer::CreateAsync(options_);
+    server->StartupFuture().get();
+    std::set<std::string> loaded_models = server->LoadedModels();
+    ASSERT_EQ(loaded_models.size(), 4);
+    ASSERT_THROW(server->LoadModel("add_sub"), tds::TritonException);
+
+    options_.model_control_mode_ = tds::ModelControlMode::POLL;
+    ASSERT_THROW(
+        tds::TritonServer::CreateAsync(options_), tds::TritonException);
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST_F(TritonServerTest, CachedHealthChecks)
+{
+  try {
+    options_.model_control_mode_ = tds::ModelControlMode::EXPLICIT;
+    options_.startup_models_.insert("add_sub");
+    options_.health_check_refresh_ms_ = 10;
+
+    auto server = tds::TritonServer::Create(options_);
+    ASSERT_TRUE(server->IsServerLive());
+    ASSERT_TRUE(server->IsServerReady());
+    ASSERT_TRUE(server->IsModelReady("add_sub"));
+    ASSERT_FALSE(server->IsModelReady("add_sub_str"));
+
+    // Loading and unloading through the wrapper updates the cached readiness
+    // right away.
+    server->LoadModel("add_sub_str");
+    ASSERT_TRUE(server->IsModelReady("add_sub_str"));
+    server->UnloadModel("add_sub");
+    ASSERT_FALSE(server->IsModelReady("add_sub"));
+    ASSERT_FALSE(server->IsModelReady("add_sub", -1, true /* fresh */));
+
+    // The background refresh keeps the cached values in sync with the server.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_TRUE(server->IsServerLive());
+    ASSERT_EQ(
+        server->IsModelReady("add_sub_str"),
+        server->IsModelReady("add_sub_str", -1, true /* fresh */));
+    ASSERT_EQ(server->IsServerReady(), server->IsServerReady(true /* fresh */));
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST_F(TritonServerTest, RepositoryPollFingerprint)
+{
+  try {
+    options_.model_control_mode_ = tds::ModelControlMode::POLL;
+    options_.repository_poll_secs_ = 1;
+    options_.repository_poll_fingerprint_ = true;
+
+    auto server = tds::TritonServer::Create(options_);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+    tds::RepositoryPollStats stats = server->RepositoryPollStatistics();
+    ASSERT_EQ(stats.poll_count_, 1);
+    ASSERT_GE(stats.skipped_poll_count_, 1);
+    ASSERT_EQ(stats.changed_models_.size(), 4);
+    ASSERT_GT(stats.hashed_file_count_, 0);
+
+    // Touching a file of a model doesn't change its content.
+    const std::string config_path = "./models/add_sub/config.pbtxt";
+    ASSERT_EQ(utime(config_path.c_str(), nullptr), 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+    stats = server->RepositoryPollStatistics();
+    ASSERT_EQ(stats.poll_count_, 1);
+    ASSERT_TRUE(server->IsModelReady("add_sub"));
+
+    // Changing the content of a file is polled. The original content is
+    // restored before checking the statistics.
+    std::string config;
+    {
+      std::ifstream in(config_path);
+      std::stringstream ss;
+      ss << in.rdbuf();
+      config = ss.str();
+    }
+    {
+      std::ofstream out(config_path, std::ios::app);
+      out << "\n# RepositoryPollFingerprint\n";
+    }
+    for (size_t i = 0; (i < 100) && (stats.poll_count_ == 1); ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      stats = server->RepositoryPollStatistics();
+    }
+    {
+      std::ofstream out(config_path, std::ios::trunc);
+      out << config;
+    }
+    ASSERT_EQ(stats.poll_count_, 2);
+    ASSERT_EQ(stats.changed_models_, std::vector<std::string>{"add_sub"});
+
+    server.reset();
+    options_.repository_poll_fingerprint_ = false;
+    options_.model_control_mode_ = tds::ModelControlMode::NONE;
+    auto unfingerprinted = tds::TritonServer::Create(options_);
+    ASSERT_THROW(
+        unfingerprinted->RepositoryPollStatistics(), tds::TritonException);
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST_F(TritonServerTest, ModelPreloading)
+{
+  try {
+    // A history in which 'add_sub' is used at all times of the day.
+    const std::string history_path = "./model_preloading_history.txt";
+    {
+      std::ofstream history(history_path);
+      history << "tds_traffic_history 86400 900\nadd_sub";
+      for (size_t i = 0; i < 96; ++i) {
+        history << " 1";
+      }
+      history << "\n";
+    }
+    options_.model_control_mode_ = tds::ModelControlMode::EXPLICIT;
+    options_.model_preloading_ =
+        std::make_shared<tds::ModelPreloading>(history_path);
+
+    {
+      auto server = tds::TritonServer::Create(options_);
+      for (size_t i = 0; (i < 500) && !server->IsModelReady("add_sub"); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      ASSERT_TRUE(server->IsModelReady("add_sub"));
+      ASSERT_FALSE(server->IsModelReady("add_sub_str"));
+      tds::ModelPreloadingStats stats = server->ModelPreloadingStatistics();
+      ASSERT_EQ(stats.preload_count_, 1);
+
+      std::vector<int32_t> input_data(16, 1);
+      auto request = tds::InferRequest::Create(tds::InferOptions("add_sub"));
+      for (const auto& name : std::vector<std::string>{"INPUT0", "INPUT1"}) {
+        request->AddInput(
+            name, tds::Tensor(
+                      reinterpret_cast<char*>(input_data.data()),
+                      input_data.size() * sizeof(int32_t),
+                      tds::DataType::INT32, {16}, tds::MemoryType::CPU, 0));
+      }
+      auto result = server->Infer(*request);
+      ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
+
+      // A request to a model that isn't loaded is a cold start, counted once.
+      auto cold_request =
+          tds::InferRequest::Create(tds::InferOptions("add_sub_str"));
+      for (size_t i = 0; i < 2; ++i) {
+        try {
+          server->Infer(*cold_request);
+        }
+        catch (const tds::TritonException&) {
+        }
+      }
+      // A request to a model that isn't in the repository is not counted.
+      auto unknown_request =
+          tds::InferRequest::Create(tds::InferOptions("add_sub_typo"));
+      try {
+        server->Infer(*unknown_request);
+      }
+      catch (const tds::TritonException&) {
+      }
+
+      stats = server->ModelPreloadingStatistics();
+      ASSERT_EQ(stats.avoided_cold_start_count_, 1);
+      ASSERT_EQ(stats.cold_start_count_, 1);
+      ASSERT_EQ(stats.unload_count_, 0);
+    }
+
+    // The history is saved when the server is destroyed.
+    std::ifstream history(history_path);
+    std::string header;
+    ASSERT_TRUE(std::getline(history, header));
+    ASSERT_EQ(header, "tds_traffic_history 86400 900");
+
+    options_.model_preloading_->smoothing_ = 1.5;
+    ASSERT_THROW(tds::TritonServer::Create(options_), tds::TritonException);
+    options_.model_preloading_->smoothing_ = 0.3;
+    options_.model_preloading_->load_rate_ = 0;
+    ASSERT_THROW(tds::TritonServer::Create(options_), tds::TritonException);
+    options_.model_preloading_->load_rate_ = 0.01;
+
+    options_.model_control_mode_ = tds::ModelControlMode::NONE;
+    ASSERT_THROW(tds::TritonServer::Create(options_), tds::TritonException);
+    std::remove(history_path.c_str());
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST_F(TritonServerTest, ModelRepoRegister)
+{
+  try {
+    options_.model_control_mode_ = tds::ModelControlMode::EXPLICIT;
+    auto server = tds::TritonServer::Create(options_);
+    server->UnregisterModelRepo("./models");
+    try {
+      server->LoadModel("add_sub");
+    }
+    catch (std::exception& ex) {
+      ASSERT_STREQ(
+          ex.what(),
+          "Error - LoadModel: Internal-failed to load 'add_sub', failed to "
+          "poll from model repository\n");
+    }
+    server->RegisterModelRepo(
+        tds::NewModelRepo("./models1", "add_sub", "add_sub1"));
+    try {
+      server->LoadModel("add_sub");
+    }
+    catch (std::exception& ex) {
+      ASSERT_STREQ(
+          ex.what(),
+          "Error - LoadModel: Internal-failed to load 'add_sub', failed to "
+          "poll from model repository\n");
+    }
+    server->LoadModel("add_sub1");
+    std::set<std::string> loaded_models = server->LoadedModels();
+    ASSERT_EQ(loaded_models.size(), 1);
+    ASSERT_EQ(*loaded_models.begin(), "add_sub1");
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST_F(TritonServerTest, InferMinimal)
+{
+  try {
+    auto server = tds::TritonServer::Create(options_);
+
+    std::vector<int32_t> input_data;
+    while (input_data.size() < 16) {
+      input_data.emplace_back(input_data.size());
+    }
+    auto request = tds::InferRequest::Create(tds::InferOptions("add_sub"));
+    for (const auto& name : std::vector<std::string>{"INPUT0", "INPUT1"}) {
+      request->AddInput(
+          name, tds::Tensor(
+                    reinterpret_cast<char*>(input_data.data()),
+                    input_data.size() * sizeof(int32_t), tds::DataType::INT32,
+                    {16}, tds::MemoryType::CPU, 0));
+    }
+    std::future<std::unique_ptr<tds::InferResult>> result_future =
+        server->AsyncInfer(*request);
+    auto result = result_future.get();
+    ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
+
+    // Check result metadata
+    ASSERT_EQ(result->ModelName(), "add_sub");
+    ASSERT_EQ(result->ModelVersion(), "1");
+    ASSERT_EQ(result->Id(), "");
+
+    // OUTPUT0 -> sum
+    {
+      std::string out_name("OUTPUT0");
+      std::shared_ptr<tds::Tensor> out = result->Output(out_name);
+      ASSERT_EQ(out->shape_, std::vector<int64_t>{16});
+      ASSERT_EQ(out->data_type_, tds::DataType::INT32);
+      ASSERT_EQ(out->byte_size_, (input_data.size() * sizeof(int32_t)));
+      for (size_t i = 0; i < input_data.size(); ++i) {
+        EXPECT_EQ(
+            reinterpret_cast<const int32_t*>(out->buffer_)[i],
+            (2 * input_data[i]));
+      }
+    }
+
+    // OUTPUT1 -> diff
+    {
+      std::string out_name("OUTPUT1");
+      std::shared_ptr<tds::Tensor> out = result->Output(out_name);
+      ASSERT_EQ(out->shape_, std::vector<int64_t>{16});
+      ASSERT_EQ(out->data_type_, tds::DataType::INT32);
+      ASSERT_EQ(out->byte_size_, (input_data.size() * sizeof(int32_t)));
+      for (size_t i = 0; i < input_data.size(); ++i) {
+        EXPECT_EQ(reinterpret_cast<const int32_t*>(out->buffer_)[i], 0);
+      }
+    }
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST_F(TritonServerTest, InferBoundConstantInput)
+{
+  try {
+    auto server = tds::TritonServer::Create(options_);
+
+    std::vector<int32_t> input_data;
+    std::vector<int32_t> constant_data(16, 1);
+    while (input_data.size() < 16) {
+      input_data.emplace_back(input_data.size());
+    }
+    server->BindConstantInput(
+        "add_sub", "INPUT1",
+        tds::Tensor(
+            reinterpret_cast<char*>(constant_data.data()),
+            constant_data.size() * sizeof(int32_t), tds::DataType::INT32, {16},
+            tds::MemoryType::CPU, 0));
+    // The bound input is copied so the original buffer can be modified.
+    std::fill(constant_data.begin(), constant_data.end(), 0);
+
+    auto request = tds::InferRequest::Create(tds::InferOptions("add_sub"));
+    request->AddInput(
+        "INPUT0", tds::Tensor(
+                      reinterpret_cast<char*>(input_data.data()),
+                      input_data.size() * sizeof(int32_t), tds::DataType::INT32,
+                      {16}, tds::MemoryType::CPU, 0));
+    auto result = server->AsyncInfer(*request).get();
+    ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
+    {
+      std::shared_ptr<tds::Tensor> out = result->Output("OUTPUT0");
+      ASSERT_EQ(out->shape_, std::vector<int64_t>{16});
+      for (size_t i = 0; i < input_data.size(); ++i) {
+        EXPECT_EQ(
+            reinterpret_cast<const int32_t*>(out->buffer_)[i],
+            (input_data[i] + 1));
+      }
+    }
+
+    // An input added to the request overrides the bound input.
+    request->Reset();
+    for (const auto& name : std::vector<std::string>{"INPUT0", "INPUT1"}) {
+      request->AddInput(
+          name, tds::Tensor(
+                    reinterpret_cast<char*>(input_data.data()),
+                    input_data.size() * sizeof(int32_t), tds::DataType::INT32,
+                    {16}, tds::MemoryType::CPU, 0));
+    }
+    result = server->AsyncInfer(*request).get();
+    ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
+    {
+      std::shared_ptr<tds::Tensor> out = result->Output("OUTPUT1");
+      for (size_t i = 0; i < input_data.size(); ++i) {
+        EXPECT_EQ(reinterpret_cast<const int32_t*>(out->buffer_)[i], 0);
+      }
+    }
+
+    // Without the bound input the request is missing 'INPUT1'.
+    server->UnbindConstantInputs("add_sub");
+    request->Reset();
+    request->AddInput(
+        "INPUT0", tds::Tensor(
+                      reinterpret_cast<char*>(input_data.data()),
+                      input_data.size() * sizeof(int32_t), tds::DataType::INT32,
+                      {16}, tds::MemoryType::CPU, 0));
+    bool failed = false;
+    try {
+      failed = server->AsyncInfer(*request).get()->HasError();
+    }
+    catch (const tds::TritonException&) {
+      failed = true;
+    }
+    ASSERT_TRUE(failed);
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST_F(TritonServerTest, InferOutputPruning)
+{
+  try {
+    auto server = tds::TritonServer::Create(options_);
+    server->EnableOutputPruning("add_sub", 2 /* learning_window */);
+
+    std::vector<int32_t> input_data;
+    while (input_data.size() < 16) {
+      input_data.emplace_back(input_data.size());
+    }
+    auto request = tds::InferRequest::Create(tds::InferOptions("add_sub"));
+    for (const auto& name : std::vector<std::string>{"INPUT0", "INPUT1"}) {
+      request->AddInput(
+          name, tds::Tensor(
+                    reinterpret_cast<char*>(input_data.data()),
+                    input_data.size() * sizeof(int32_t), tds::DataType::INT32,
+                    {16}, tds::MemoryType::CPU, 0));
+    }
+
+    // Only 'OUTPUT0' is accessed during the learning window.
+    for (size_t i = 0; i < 2; ++i) {
+      auto result = server->AsyncInfer(*request).get();
+      ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
+      ASSERT_EQ(result->OutputNames().size(), size_t(2));
+      result->Output("OUTPUT0");
+    }
+    ASSERT_FALSE(server->OutputPruningStatistics("add_sub").pruning_);
+
+    auto result = server->AsyncInfer(*request).get();
+    ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
+    ASSERT_EQ(result->OutputNames(), std::vector<std::string>{"OUTPUT0"});
+    auto stats = server->OutputPruningStatistics("add_sub");
+    ASSERT_TRUE(stats.pruning_);
+    ASSERT_EQ(stats.requested_outputs_, std::set<std::string>{"OUTPUT0"});
+    ASSERT_EQ(stats.pruned_request_count_, uint64_t(1));
+    ASSERT_EQ(stats.skipped_byte_size_, input_data.size() * sizeof(int32_t));
+
+    // Accessing the pruned output falls back to returning all outputs.
+    ASSERT_THROW(result->Output("OUTPUT1"), tds::TritonException);
+    stats = server->OutputPruningStatistics("add_sub");
+    ASSERT_FALSE(stats.pruning_);
+    ASSERT_EQ(stats.fallback_count_, uint64_t(1));
+    result = server->AsyncInfer(*request).get();
+    ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
+    ASSERT_EQ(result->OutputNames().size(), size_t(2));
+
+    server->DisableOutputPruning("add_sub");
+    ASSERT_THROW(
+        server->OutputPruningStatistics("add_sub"), tds::TritonException);
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST_F(TritonServerTest, InferWatchdog)
+{
+  try {
+    options_.watchdog_ = std::make_shared<tds::Watchdog>(60000);
+    // 'add_sub_str' is not watched.
+    options_.watchdog_->model_threshold_ms_["add_sub_str"] = 0;
+    auto server = tds::TritonServer::Create(options_);
+
+    std::vector<int32_t> input_data;
+    while (input_data.size() < 16) {
+      input_data.emplace_back(input_data.size());
+    }
+    auto request = tds::InferRequest::Create(tds::InferOptions("add_sub"));
+    for (const auto& name : std::vector<std::string>{"INPUT0", "INPUT1"}) {
+      request->AddInput(
+          name, tds::Tensor(
+                    reinterpret_cast<char*>(input_data.data()),
+                    input_data.size() * sizeof(int32_t), tds::DataType::INT32,
+                    {16}, tds::MemoryType::CPU, 0));
+    }
+    for (size_t i = 0; i < 2; ++i) {
+      auto result = server->AsyncInfer(*request).get();
+      ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
+    }
+
+    // The requests are no longer tracked once their response is received.
+    auto stats = server->WatchdogStatistics();
+    ASSERT_EQ(stats.in_flight_count_, uint64_t(0));
+    ASSERT_EQ(stats.oldest_in_flight_ms_, uint64_t(0));
+    ASSERT_EQ(stats.stuck_count_, uint64_t(0));
+    ASSERT_EQ(stats.cancelled_count_, uint64_t(0));
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST_F(TritonServerTest, InferWatchdogCancel)
+{
+  try {
+    // With a threshold of 1 ms, the tail of a backlog of requests is still
+    // queued in the server when the watchdog checks it, and can be cancelled.
+    options_.watchdog_ =
+        std::make_shared<tds::Watchdog>(1, tds::Watchdog::Action::CANCEL);
+    auto server = tds::TritonServer::Create(options_);
+
+    std::vector<int32_t> input_data;
+    while (input_data.size() < 16) {
+      input_data.emplace_back(input_data.size());
+    }
+    std::vector<std::unique_ptr<tds::InferRequest>> requests;
+    std::vector<std::future<std::unique_ptr<tds::InferResult>>> futures;
+    for (size_t i = 0; i < 1000; ++i) {
+      requests.push_back(
+          tds::InferRequest::Create(tds::InferOptions("add_sub")));
+      for (const auto& name : std::vector<std::string>{"INPUT0", "INPUT1"}) {
+        requests.back()->AddInput(
+            name, tds::Tensor(
+                      reinterpret_cast<char*>(input_data.data()),
+                      input_data.size() * sizeof(int32_t),
+                      tds::DataType::INT32, {16}, tds::MemoryType::CPU, 0));
+      }
+      futures.push_back(server->AsyncInfer(*requests.back()));
+    }
+    // Only the cancelled requests may fail.
+    uint64_t failed_count = 0;
+    for (auto& future : futures) {
+      if (future.get()->HasError()) {
+        failed_count++;
+      }
+    }
+
+    auto stats = server->WatchdogStatistics();
+    ASSERT_GT(stats.stuck_count_, uint64_t(0));
+    ASSERT_GT(stats.cancelled_count_, uint64_t(0));
+    ASSERT_LE(stats.cancelled_count_, stats.stuck_count_);
+    ASSERT_LE(failed_count, stats.cancelled_count_);
+    ASSERT_EQ(stats.in_flight_count_, uint64_t(0));
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST_F(TritonServerTest, InferMemoryPressure)
+{
+  try {
+    // The pressure is read from files written by the test.
+    const std::string psi_path = "./memory_pressure_psi";
+    const std::string events_path = "./memory_pressure_events";
+    std::ofstream(psi_path)
+        << "some avg10=0.00 avg60=0.00 avg300=0.00 total=0\n"
+        << "full avg10=0.00 avg60=0.00 avg300=0.00 total=0\n";
+    std::ofstream(events_path) << "low 0\nhigh 0\nmax 0\noom 0\noom_kill 0\n";
+    options_.memory_pressure_ = std::make_shared<tds::MemoryPressure>();
+    options_.memory_pressure_->psi_path_ = psi_path;
+    options_.memory_pressure_->memory_events_path_ = events_path;
+    options_.memory_pressure_->interval_ms_ = 10;
+    auto server = tds::TritonServer::Create(options_);
+    auto wait_for_level = [&server](const tds::MemoryPressure::Level level) {
+      for (size_t i = 0; i < 500; ++i) {
+        if (server->MemoryPressureStatistics().level_ == level) {
+          return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      return false;
+    };
+
+    std::vector<int32_t> input_data;
+    while (input_data.size() < 16) {
+      input_data.emplace_back(input_data.size());
+    }
+    tds::InferOptions low_priority("add_sub");
+    low_priority.priority_ = 2;
+    tds::InferOptions high_priority("add_sub");
+    high_priority.priority_ = 1;
+    std::vector<std::unique_ptr<tds::InferRequest>> requests;
+    for (const auto& options : {low_priority, high_priority}) {
+      requests.emplace_back(tds::InferRequest::Create(options));
+      for (const auto& name : std::vector<std::string>{"INPUT0", "INPUT1"}) {
+        requests.back()->AddInput(
+            name, tds::Tensor(
+                      reinterpret_cast<char*>(input_data.data()),
+                      input_data.size() * sizeof(int32_t),
+                      tds::DataType::INT32, {16}, tds::MemoryType::CPU, 0));
+      }
+    }
+    auto result = server->Infer(*requests[0]);
+    ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
+
+    // An OOM event of the cgroup sheds the low priority requests.
+    std::ofstream(events_path) << "low 0\nhigh 0\nmax 0\noom 1\noom_kill 0\n";
+    ASSERT_TRUE(wait_for_level(tds::MemoryPressure::Level::SHED));
+    ASSERT_THROW(server->AsyncInfer(*requests[0]), tds::TritonException);
+    result = server->Infer(*requests[1]);
+    ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
+
+    // The level is lowered stage by stage once the pressure falls.
+    ASSERT_TRUE(wait_for_level(tds::MemoryPressure::Level::NONE));
+    result = server->Infer(*requests[0]);
+    ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
+
+    auto stats = server->MemoryPressureStatistics();
+    ASSERT_EQ(stats.oom_event_count_, uint64_t(1));
+    ASSERT_EQ(stats.trim_count_, uint64_t(1));
+    ASSERT_EQ(stats.shed_count_, uint64_t(1));
+    ASSERT_EQ(stats.limited_count_, uint64_t(0));
+    ASSERT_EQ(stats.in_flight_count_, uint64_t(0));
+    std::remove(psi_path.c_str());
+    std::remove(events_path.c_str());
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST_F(TritonServerTest, PhaseCounters)
+{
+  try {
+    {
+      auto server = tds::TritonServer::Create(options_);
+      ASSERT_THROW(
+          server->PhaseCounterStatistics("add_sub"), tds::TritonException);
+    }
+
+    options_.phase_counters_ = true;
+    auto server = tds::TritonServer::Create(options_);
+
+    std::vector<int32_t> input_data;
+    while (input_data.size() < 16) {
+      input_data.emplace_back(input_data.size());
+    }
+    auto request = tds::InferRequest::Create(tds::InferOptions("add_sub"));
+    for (const auto& name : std::vector<std::string>{"INPUT0", "INPUT1"}) {
+      request->AddInput(
+          name, tds::Tensor(
+                    reinterpret_cast<char*>(input_data.data()),
+                    input_data.size() * sizeof(int32_t), tds::DataType::INT32,
+                    {16}, tds::MemoryType::CPU, 0));
+    }
+    for (size_t i = 0; i < 3; ++i) {
+      auto result = server->Infer(*request);
+      ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
+    }
+
+    // Each phase is counted per call even if the events can't be read. The
+    // response phase ends after the result is set, so the last call may be
+    // counted after 'Infer' returns.
+    auto stats = server->PhaseCounterStatistics("add_sub");
+    for (size_t i = 0; (i < 100) && (stats["response"].count_ < 3); ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      stats = server->PhaseCounterStatistics("add_sub");
+    }
+    ASSERT_EQ(stats.size(), size_t(4));
+    ASSERT_EQ(stats["prepare"].count_, uint64_t(3));
+    ASSERT_EQ(stats["response"].count_, uint64_t(3));
+    ASSERT_EQ(stats["output_release"].count_, uint64_t(3));
+    ASSERT_EQ(stats["trace"].count_, uint64_t(0));
+    ASSERT_EQ(
+        server->PhaseCounterStatistics("add_sub_str")["prepare"].count_,
+        uint64_t(0));
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST_F(TritonServerTest, InferFutureThen)
+{
+  try {
+    auto server = tds::TritonServer::Create(options_);
+
+    std::vector<int32_t> input_data;
+    while (input_data.size() < 16) {
+      input_data.emplace_back(input_data.size());
+    }
+    std::vector<std::unique_ptr<tds::InferRequest>> requests;
+    for (size_t i = 0; i < 2; ++i) {
+      requests.emplace_back(
+          tds::InferRequest::Create(tds::InferOptions("add_sub")));
+      for (const auto& name : std::vector<std::string>{"INPUT0", "INPUT1"}) {
+        requests.back()->AddInput(
+            name, tds::Tensor(
+                      reinterpret_cast<char*>(input_data.data()),
+                      input_data.size() * sizeof(int32_t),
+                      tds::DataType::INT32, {16}, tds::MemoryType::CPU, 0));
+      }
+    }
+
+    // The continuation is run once the result is ready.
+    auto last_sum =
+        server->AsyncInfer(*requests[0]).then([](tds::InferFuture ready) {
+          auto result = ready.get();
+          return reinterpret_cast<const int32_t*>(
+              result->Output("OUTPUT0")->buffer_)[15];
+        });
+    ASSERT_EQ(last_sum.get(), 30);
+
+    std::vector<tds::InferFuture> futures;
+    for (auto& request : requests) {
+      futures.emplace_back(server->AsyncInfer(*request));
+    }
+    auto results = tds::when_all(std::move(futures)).get();
+    ASSERT_EQ(results.size(), size_t(2));
+    for (auto& result : results) {
+      ASSERT_FALSE(result.get()->HasError());
+    }
+
+    // The future can still be used as a 'std::future'.
+    std::future<std::unique_ptr<tds::InferResult>> result_future =
+        server->AsyncInfer(*requests[0]);
+    ASSERT_FALSE(result_future.get()->HasError());
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST_F(TritonServerTest, InferShadowMirroring)
+{
+  try {
+    options_.model_control_mode_ = tds::ModelControlMode::EXPLICIT;
+    options_.startup_models_.insert("add_sub");
+    auto server = tds::TritonServer::Create(options_);
+    // Use a copy of 'add_sub' as the shadow model, so the outputs match.
+    server->RegisterModelRepo(
+        tds::NewModelRepo("./models1", "add_sub", "add_sub1"));
+    server->LoadModel("add_sub1");
+    tds::ShadowMirroring mirroring("add_sub1");
+    mirroring.sample_rate_ = 1.0;
+    mirroring.max_in_flight_ = 1;
+    server->EnableShadowMirroring("add_sub", mirroring);
+
+    std::vector<int32_t> input_data;
+    while (input_data.size() < 16) {
+      input_data.emplace_back(input_data.size());
+    }
+    auto request = tds::InferRequest::Create(tds::InferOptions("add_sub"));
+    for (const auto& name : std::vector<std::string>{"INPUT0", "INPUT1"}) {
+      request->AddInput(
+          name, tds::Tensor(
+                    reinterpret_cast<char*>(input_data.data()),
+                    input_data.size() * sizeof(int32_t), tds::DataType::INT32,
+                    {16}, tds::MemoryType::CPU, 0));
+    }
+    for (size_t i = 0; i < 4; ++i) {
+      auto result = server->AsyncInfer(*request).get();
+      ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
+      // The shadow request reads a copy of the inputs, so they can be
+      // overwritten while it is in flight.
+      std::fill(input_data.begin(), input_data.end(), int32_t(i + 1));
+    }
+
+    // Sampled requests are dropped while the shadow request of a previous one
+    // is in flight. The comparisons are done in the background.
+    auto stats = server->ShadowMirroringStatistics("add_sub");
+    ASSERT_EQ(stats.mirrored_count_ + stats.dropped_count_, uint64_t(4));
+    ASSERT_GE(stats.mirrored_count_, uint64_t(1));
+    for (size_t i = 0;
+         (i < 100) && (stats.compared_count_ < stats.mirrored_count_); ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      stats = server->ShadowMirroringStatistics("add_sub");
+    }
+    ASSERT_EQ(stats.compared_count_, stats.mirrored_count_);
+    ASSERT_EQ(stats.divergent_count_, uint64_t(0));
+    ASSERT_EQ(stats.shadow_error_count_, uint64_t(0));
+    ASSERT_EQ(stats.max_abs_diff_, 0.0);
+
+    server->DisableShadowMirroring("add_sub");
+    ASSERT_THROW(
+        server->ShadowMirroringStatistics("add_sub"), tds::TritonException);
+    ASSERT_THROW(
+        server->EnableShadowMirroring(
+            "add_sub", tds::ShadowMirroring("add_sub1", 2.0)),
+        tds::TritonException);
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST_F(TritonServerTest, InferServiceLevelObjective)
+{
+  try {
+    auto server = tds::TritonServer::Create(options_);
+    ASSERT_THROW(
+        server->ServiceLevelStatistics("add_sub"), tds::TritonException);
+    ASSERT_THROW(
+        server->SetServiceLevelObjective(
+            "add_sub", tds::ServiceLevelObjective(1000, 1.0)),
+        tds::TritonException);
+
+    // No request completes within a microsecond, so all the requests to
+    // 'add_sub' are slow and the latency budget burns 10 times too fast.
+    tds::ServiceLevelObjective objective(1, 0.9, 0.99);
+    objective.windows_s_ = {60, 3600};
+    server->SetServiceLevelObjective("add_sub", objective);
+    server->SetServiceLevelObjective(
+        "failing_infer", tds::ServiceLevelObjective(10000000, 0.9, 0.5));
+
+    std::vector<int32_t> input_data;
+    while (input_data.size() < 16) {
+      input_data.emplace_back(input_data.size());
+    }
+    auto request = tds::InferRequest::Create(tds::InferOptions("add_sub"));
+    for (const auto& name : std::vector<std::string>{"INPUT0", "INPUT1"}) {
+      request->AddInput(
+          name, tds::Tensor(
+                    reinterpret_cast<char*>(input_data.data()),
+                    input_data.size() * sizeof(int32_t), tds::DataType::INT32,
+                    {16}, tds::MemoryType::CPU, 0));
+    }
+    auto failing_request =
+        tds::InferRequest::Create(tds::InferOptions("failing_infer"));
+    failing_request->AddInput(
+        "INPUT", tds::Tensor(
+                     reinterpret_cast<char*>(input_data.data()),
+                     input_data.size() * sizeof(int32_t), tds::DataType::INT32,
+                     {16}, tds::MemoryType::CPU, 0));
+    for (size_t i = 0; i < 4; ++i) {
+      auto result = server->Infer(*request);
+      ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
+      result = server->Infer(*failing_request);
+      ASSERT_TRUE(result->HasError());
+    }
+
+    auto stats = server->ServiceLevelStatistics("add_sub");
+    ASSERT_EQ(stats.request_count_, uint64_t(4));
+    ASSERT_EQ(stats.slow_count_, uint64_t(4));
+    ASSERT_EQ(stats.error_count_, uint64_t(0));
+    ASSERT_EQ(stats.burn_rates_.size(), size_t(2));
+    for (const auto& burn_rate : stats.burn_rates_) {
+      ASSERT_EQ(burn_rate.request_count_, uint64_t(4));
+      ASSERT_NEAR(burn_rate.latency_burn_rate_, 10, 1e-6);
+      ASSERT_EQ(burn_rate.error_burn_rate_, 0);
+    }
+
+    stats = server->ServiceLevelStatistics("failing_infer");
+    ASSERT_EQ(stats.error_count_, uint64_t(4));
+    ASSERT_EQ(stats.burn_rates_[0].window_s_, uint32_t(300));
+    ASSERT_NEAR(stats.burn_rates_[0].error_burn_rate_, 2, 1e-6);
+
+    server->RemoveServiceLevelObjective("failing_infer");
+    ASSERT_THROW(
+        server->ServiceLevelStatistics("failing_infer"), tds::TritonException);
+    ASSERT_NE(
+        server->ServerMetrics().find(
+            "tds_slo_burn_rate{model=\"add_sub\",slo=\"latency\",window="
+            "\"1h\"} 10"),
+        std::string::npos);
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
+TEST_F(TritonServerTest, InferLatencyHistogram)
 {
-  std::cout << "Using custom allocation function" << std::endl;
-
-  *actual_memory_type = tds::MemoryType::CPU;
-  *actual_memory_type_id = preferred_memory_type_id;
+  try {
+    options_.latency_histogram_bounds_us_ = {100000000, 1};
+    auto server = tds::TritonServer::Create(options_);
 
-  // If 'byte_size' is zero just return 'buffer' == nullptr, we don't
-  // need to do any other book-keeping.
-  if (byte_size == 0) {
-    *buffer = nullptr;
-    std::cout << "allocated " << byte_size << " bytes for result tensor "
-              << tensor_name << std::endl;
-  } else {
-    void* allocated_ptr = malloc(byte_size);
-    if (allocated_ptr != nullptr) {
-      *buffer = allocated_ptr;
-      std::cout << "allocated " << byte_size << " bytes in "
-                << MemoryTypeString(*actual_memory_type)
-                << " for result tensor " << tensor_name << std::endl;
+    std::vector<int32_t> input_data;
+    while (input_data.size() < 16) {
+      input_data.emplace_back(input_data.size());
+    }
+    tds::InferOptions infer_options("add_sub");
+    infer_options.request_id_ = "slow \"one\"";
+    auto request = tds::InferRequest::Create(infer_options);
+    for (const auto& name : std::vector<std::string>{"INPUT0", "INPUT1"}) {
+      request->AddInput(
+          name, tds::Tensor(
+                    reinterpret_cast<char*>(input_data.data()),
+                    input_data.size() * sizeof(int32_t), tds::DataType::INT32,
+                    {16}, tds::MemoryType::CPU, 0));
+    }
+    for (size_t i = 0; i < 3; ++i) {
+      auto result = server->Infer(*request);
+      ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
     }
-  }
-}
-
-void
-ResponseRelease(
-    void* buffer, size_t byte_size, tds::MemoryType memory_type,
-    int64_t memory_type_id)
-{
-  std::cout << "Using custom response release function" << std::endl;
-
-  std::stringstream ss;
-  ss << buffer;
-  std::string buffer_str = ss.str();
-
-  std::cout << "Releasing buffer " << buffer_str << " of size "
-            << std::to_string(byte_size) << " in "
-            << tds::MemoryTypeString(memory_type);
 
-  switch (memory_type) {
-    case tds::MemoryType::CPU:
-      free(buffer);
-      break;
+    // Every request falls in the bucket between 1 microsecond and 100
+    // seconds. The exemplars are not exposed unless enabled.
+    std::string metrics = server->ServerMetrics();
+    ASSERT_NE(
+        metrics.find("tds_request_latency_us_bucket{model=\"add_sub\",le=\""
+                     "100000000\"} 3\n"),
+        std::string::npos)
+        << metrics;
+    ASSERT_NE(
+        metrics.find(
+            "tds_request_latency_us_bucket{model=\"add_sub\",le=\"+Inf\"} 3\n"),
+        std::string::npos)
+        << metrics;
+    ASSERT_NE(
+        metrics.find("tds_request_latency_us_count{model=\"add_sub\"} 3\n"),
+        std::string::npos)
+        << metrics;
+    ASSERT_EQ(metrics.find(" # {"), std::string::npos) << metrics;
 
-    default:
-      std::cerr << "error: unexpected buffer allocated in CUDA managed memory"
-                << std::endl;
-      break;
+    // With exemplars, the bucket links to the request.
+    server.reset();
+    options_.latency_histogram_exemplars_ = true;
+    server = tds::TritonServer::Create(options_);
+    auto result = server->Infer(*request);
+    ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
+    metrics = server->ServerMetrics();
+    ASSERT_NE(
+        metrics.find("tds_request_latency_us_bucket{model=\"add_sub\",le=\""
+                     "100000000\"} 1 # {request_id=\"slow \\\"one\\\"\"}"),
+        std::string::npos)
+        << metrics;
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
   }
 }
 
-TEST_F(TritonServerTest, StartNone)
+TEST_F(TritonServerTest, InferStatsSegment)
 {
-  // Start server with default mode (NONE)
   try {
+    options_.stats_segment_name_ = "/tds_wrapper_test_stats";
+    options_.stats_segment_interval_ms_ = 10;
     auto server = tds::TritonServer::Create(options_);
-    std::set<std::string> loaded_models = server->LoadedModels();
-    ASSERT_EQ(loaded_models.size(), 4);
-    ASSERT_NE(loaded_models.find("add_sub"), loaded_models.end());
-    ASSERT_NE(loaded_models.find("add_sub_str"), loaded_models.end());
-    ASSERT_NE(loaded_models.find("failing_infer"), loaded_models.end());
-    ASSERT_NE(loaded_models.find("square_int32"), loaded_models.end());
+
+    const int fd = shm_open(options_.stats_segment_name_.c_str(), O_RDONLY, 0);
+    ASSERT_NE(fd, -1);
+    void* addr =
+        mmap(nullptr, sizeof(tds::StatsSegment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    ASSERT_NE(addr, MAP_FAILED);
+    const tds::StatsSegment& segment =
+        *static_cast<const tds::StatsSegment*>(addr);
+    ASSERT_EQ(segment.magic_, tds::kStatsSegmentMagic);
+    ASSERT_EQ(segment.version_, tds::kStatsSegmentVersion);
+    ASSERT_EQ(segment.byte_size_, sizeof(tds::StatsSegment));
+
+    // The segment of a live server is never taken over.
+    ASSERT_THROW(tds::TritonServer::Create(options_), tds::TritonException);
+    ASSERT_EQ(segment.pid_, static_cast<uint64_t>(getpid()));
+    ASSERT_EQ(segment.magic_, tds::kStatsSegmentMagic);
+
+    std::vector<int32_t> input_data;
+    while (input_data.size() < 16) {
+      input_data.emplace_back(input_data.size());
+    }
+    auto request = tds::InferRequest::Create(tds::InferOptions("add_sub"));
+    for (const auto& name : std::vector<std::string>{"INPUT0", "INPUT1"}) {
+      request->AddInput(
+          name, tds::Tensor(
+                    reinterpret_cast<char*>(input_data.data()),
+                    input_data.size() * sizeof(int32_t), tds::DataType::INT32,
+                    {16}, tds::MemoryType::CPU, 0));
+    }
+    for (size_t i = 0; i < 3; ++i) {
+      auto result = server->Infer(*request);
+      ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
+    }
+
+    // The requests are published at the next update.
+    tds::StatsSegmentData data;
+    const tds::StatsSegmentModel* model = nullptr;
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while ((model == nullptr) &&
+           (std::chrono::steady_clock::now() < deadline)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      ASSERT_TRUE(tds::ReadStatsSegment(segment, &data));
+      for (uint64_t i = 0; i < data.model_count_; ++i) {
+        if ((std::string(data.models_[i].name_) == "add_sub") &&
+            (data.models_[i].request_count_ == 3)) {
+          model = &data.models_[i];
+        }
+      }
+    }
+    ASSERT_NE(model, nullptr);
+    ASSERT_EQ(model->in_flight_count_, 0);
+    ASSERT_EQ(model->error_count_, 0);
+    uint64_t bucket_count = 0;
+    for (const auto count : model->latency_buckets_) {
+      bucket_count += count;
+    }
+    ASSERT_EQ(bucket_count, 3);
+    munmap(addr, sizeof(tds::StatsSegment));
   }
   catch (...) {
     ASSERT_NO_THROW(throw);
   }
 }
 
-TEST_F(TritonServerTest, NoneLoadUnload)
+TEST_F(TritonServerTest, SharedExecutor)
 {
-  // Start server with NONE mode which explicit model control is not allowed
   try {
+    options_.executor_.thread_count_ = 2;
     auto server = tds::TritonServer::Create(options_);
-    server->LoadModel("add_sub");
-    server->UnloadModel("add_sub");
-  }
-  catch (std::exception& ex) {
-    ASSERT_STREQ(
-        ex.what(),
-        "Error - LoadModel: Unavailable-explicit model load / unload is not "
-        "allowed if polling is enabled\n");
+    tds::WorkExecutor& executor = server->SharedExecutor();
+
+    std::atomic<uint32_t> run_count(0);
+    std::vector<std::future<void>> futures;
+    std::vector<std::shared_ptr<std::promise<void>>> promises;
+    for (size_t i = 0; i < 8; ++i) {
+      promises.emplace_back(std::make_shared<std::promise<void>>());
+      futures.emplace_back(promises.back()->get_future());
+      auto promise = promises.back();
+      executor.Submit(
+          [&run_count, promise]() {
+            run_count++;
+            promise->set_value();
+          },
+          (i % 2 == 0) ? tds::TaskPriority::LATENCY
+                       : tds::TaskPriority::BACKGROUND);
+    }
+    for (auto& future : futures) {
+      future.get();
+    }
+    ASSERT_EQ(run_count.load(), 8);
+
+    // Every index is visited once, and an exception of a chunk is rethrown.
+    std::vector<std::atomic<uint32_t>> visits(10000);
+    executor.ParallelFor(0, visits.size(), 100, [&visits](size_t b, size_t e) {
+      for (size_t i = b; i < e; ++i) {
+        visits[i]++;
+      }
+    });
+    for (const auto& visit : visits) {
+      ASSERT_EQ(visit.load(), 1);
+    }
+    ASSERT_THROW(
+        executor.ParallelFor(
+            0, 1000, 10,
+            [](size_t b, size_t e) {
+              if (b == 0) {
+                throw std::runtime_error("first chunk");
+              }
+            }),
+        std::runtime_error);
+
+    const tds::WorkExecutorStats stats = executor.Statistics();
+    ASSERT_EQ(stats.thread_count_, 2);
+    ASSERT_EQ(stats.parallel_for_count_, 2);
+    ASSERT_GE(stats.executed_count_, 8);
+    const std::string metrics = server->ServerMetrics();
+    ASSERT_NE(metrics.find("tds_executor_threads 2\n"), std::string::npos)
+        << metrics;
+    ASSERT_NE(
+        metrics.find("tds_executor_queue_depth{lane=\"background\"}"),
+        std::string::npos)
+        << metrics;
   }
   catch (...) {
     ASSERT_NO_THROW(throw);
   }
 }
 
-TEST_F(TritonServerTest, Explicit)
+TEST_F(TritonServerTest, InferSparseInput)
 {
   try {
-    options_.model_control_mode_ = tds::ModelControlMode::EXPLICIT;
+    auto server = tds::TritonServer::Create(options_);
 
-    std::set<std::string> startup_models;
-    startup_models.insert("add_sub");
-    options_.startup_models_ = startup_models;
+    std::vector<int64_t> indices{1, 5, 15};
+    std::vector<int32_t> values{7, -3, 11};
+    std::vector<int32_t> zeros(16, 0);
+    auto request = tds::InferRequest::Create(tds::InferOptions("add_sub"));
+    for (size_t run = 0; run < 2; ++run) {
+      request->Reset();
+      request->AddSparseInput(
+          "INPUT0",
+          tds::Tensor(
+              reinterpret_cast<char*>(indices.data()),
+              indices.size() * sizeof(int64_t), tds::DataType::INT64,
+              {3, 1}, tds::MemoryType::CPU, 0),
+          tds::Tensor(
+              reinterpret_cast<char*>(values.data()),
+              values.size() * sizeof(int32_t), tds::DataType::INT32, {3},
+              tds::MemoryType::CPU, 0),
+          {16}, tds::SparseFormat::COO,
+          (run == 0) ? nullptr : &server->SharedExecutor());
+      request->AddInput(
+          "INPUT1", tds::Tensor(
+                        reinterpret_cast<char*>(zeros.data()),
+                        zeros.size() * sizeof(int32_t), tds::DataType::INT32,
+                        {16}, tds::MemoryType::CPU, 0));
 
-    auto server = tds::TritonServer::Create(options_);
-    std::set<std::string> loaded_models = server->LoadedModels();
-    ASSERT_EQ(loaded_models.size(), 1);
-    ASSERT_EQ(*loaded_models.begin(), "add_sub");
-    server->UnloadModel("add_sub");
-    loaded_models = server->LoadedModels();
-    ASSERT_EQ(loaded_models.size(), 0);
+      auto result = server->AsyncInfer(*request).get();
+      ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
+      std::shared_ptr<tds::Tensor> out = result->Output("OUTPUT0");
+      ASSERT_EQ(out->shape_, std::vector<int64_t>{16});
+      std::vector<int32_t> expected(16, 0);
+      for (size_t i = 0; i < indices.size(); ++i) {
+        expected[indices[i]] = values[i];
+      }
+      for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(
+            reinterpret_cast<const int32_t*>(out->buffer_)[i], expected[i]);
+      }
+      // The second run reuses the dense buffer of the first one.
+      values[0] += 1;
+    }
 
-    server->LoadModel("add_sub_str");
-    loaded_models = server->LoadedModels();
-    ASSERT_EQ(loaded_models.size(), 1);
-    ASSERT_EQ(*loaded_models.begin(), "add_sub_str");
+    // An index out of the bounds of the dense shape is rejected.
+    request->Reset();
+    std::vector<int64_t> out_of_bounds{1, 16, 3};
+    ASSERT_THROW(
+        request->AddSparseInput(
+            "INPUT0",
+            tds::Tensor(
+                reinterpret_cast<char*>(out_of_bounds.data()),
+                out_of_bounds.size() * sizeof(int64_t), tds::DataType::INT64,
+                {3, 1}, tds::MemoryType::CPU, 0),
+            tds::Tensor(
+                reinterpret_cast<char*>(values.data()),
+                values.size() * sizeof(int32_t), tds::DataType::INT32, {3},
+                tds::MemoryType::CPU, 0),
+            {16}, tds::SparseFormat::COO),
+        tds::TritonException);
+
+    // CSR requires rows and columns, and row offsets ending at the value
+    // count.
+    std::vector<int32_t> csr{0, 2, 3, 1, 0, 1};
+    tds::Tensor csr_values(
+        reinterpret_cast<char*>(values.data()),
+        values.size() * sizeof(int32_t), tds::DataType::INT32, {3},
+        tds::MemoryType::CPU, 0);
+    ASSERT_THROW(
+        request->AddSparseInput(
+            "INPUT0",
+            tds::Tensor(
+                reinterpret_cast<char*>(csr.data()),
+                csr.size() * sizeof(int32_t), tds::DataType::INT32, {6},
+                tds::MemoryType::CPU, 0),
+            csr_values, {16}, tds::SparseFormat::CSR),
+        tds::TritonException);
+    csr[2] = 2;
+    ASSERT_THROW(
+        request->AddSparseInput(
+            "INPUT0",
+            tds::Tensor(
+                reinterpret_cast<char*>(csr.data()),
+                csr.size() * sizeof(int32_t), tds::DataType::INT32, {6},
+                tds::MemoryType::CPU, 0),
+            csr_values, {2, 8}, tds::SparseFormat::CSR),
+        tds::TritonException);
+
+    // A shape whose byte size overflows is rejected.
+    ASSERT_THROW(
+        request->AddSparseInput(
+            "INPUT0",
+            tds::Tensor(
+                reinterpret_cast<char*>(indices.data()),
+                indices.size() * sizeof(int64_t), tds::DataType::INT64,
+                {3, 1}, tds::MemoryType::CPU, 0),
+            csr_values, {int64_t(1) << 40, int64_t(1) << 22},
+            tds::SparseFormat::COO),
+        tds::TritonException);
+
+    // The model takes a 1-D input, so the CSR and the large inputs are
+    // checked on the dense tensor. Every third element of a 512x1024 tensor
+    // is set, more values than 'kSparseParallelValueCount' per worker, and
+    // both formats are expanded on the calling thread and on the executor.
+    const int64_t rows = 512;
+    const int64_t columns = 1024;
+    std::vector<int32_t> expected(rows * columns, 0);
+    std::vector<int32_t> large_values;
+    std::vector<int64_t> coo;
+    std::vector<int32_t> row_offsets{0};
+    std::vector<int32_t> csr_columns;
+    for (int64_t row = 0; row < rows; ++row) {
+      for (int64_t column = 0; column < columns; ++column) {
+        if ((row * columns + column) % 3 == 0) {
+          large_values.push_back(row - column);
+          expected[row * columns + column] = large_values.back();
+          coo.push_back(row);
+          coo.push_back(column);
+          csr_columns.push_back(column);
+        }
+      }
+      row_offsets.push_back(csr_columns.size());
+    }
+    std::vector<int32_t> large_csr(row_offsets);
+    large_csr.insert(large_csr.end(), csr_columns.begin(), csr_columns.end());
+    ASSERT_GT(large_values.size(), 2 * 64 * 1024);
+
+    std::vector<int32_t> dense(expected.size());
+    for (const auto executor :
+         std::vector<tds::WorkExecutor*>{nullptr, &server->SharedExecutor()}) {
+      std::fill(dense.begin(), dense.end(), -1);
+      tds::DensifySparseInput(
+          tds::SparseFormat::COO, reinterpret_cast<char*>(coo.data()),
+          coo.size() * sizeof(int64_t), sizeof(int64_t),
+          reinterpret_cast<char*>(large_values.data()), large_values.size(),
+          sizeof(int32_t), {rows, columns},
+          reinterpret_cast<char*>(dense.data()),
+          dense.size() * sizeof(int32_t), executor);
+      ASSERT_EQ(dense, expected);
+
+      std::fill(dense.begin(), dense.end(), -1);
+      tds::DensifySparseInput(
+          tds::SparseFormat::CSR, reinterpret_cast<char*>(large_csr.data()),
+          large_csr.size() * sizeof(int32_t), sizeof(int32_t),
+          reinterpret_cast<char*>(large_values.data()), large_values.size(),
+          sizeof(int32_t), {rows, columns},
+          reinterpret_cast<char*>(dense.data()),
+          dense.size() * sizeof(int32_t), executor);
+      ASSERT_EQ(dense, expected);
+
+      // An index out of bounds is rejected before the dense tensor is
+      // written.
+      std::fill(dense.begin(), dense.end(), -1);
+      coo.back() = columns;
+      ASSERT_THROW(
+          tds::DensifySparseInput(
+              tds::SparseFormat::COO, reinterpret_cast<char*>(coo.data()),
+              coo.size() * sizeof(int64_t), sizeof(int64_t),
+              reinterpret_cast<char*>(large_values.data()),
+              large_values.size(), sizeof(int32_t), {rows, columns},
+              reinterpret_cast<char*>(dense.data()),
+              dense.size() * sizeof(int32_t), executor),
+          tds::TritonException);
+      ASSERT_EQ(dense, std::vector<int32_t>(expected.size(), -1));
+      coo.back() = csr_columns.back();
+    }
   }
   catch (...) {
     ASSERT_NO_THROW(throw);
   }
 }
 
-TEST_F(TritonServerTest, ModelRepoRegister)
+TEST_F(TritonServerTest, GatherOutputs)
 {
   try {
-    options_.model_control_mode_ = tds::ModelControlMode::EXPLICIT;
     auto server = tds::TritonServer::Create(options_);
-    server->UnregisterModelRepo("./models");
-    try {
-      server->LoadModel("add_sub");
+
+    std::vector<int32_t> input_data;
+    while (input_data.size() < 16) {
+      input_data.emplace_back(input_data.size());
     }
-    catch (std::exception& ex) {
-      ASSERT_STREQ(
-          ex.what(),
-          "Error - LoadModel: Internal-failed to load 'add_sub', failed to "
-          "poll from model repository\n");
+    std::vector<std::unique_ptr<tds::InferRequest>> requests;
+    std::vector<std::future<std::unique_ptr<tds::InferResult>>> futures;
+    for (size_t i = 0; i < 4; ++i) {
+      requests.emplace_back(
+          tds::InferRequest::Create(tds::InferOptions("add_sub")));
+      for (const auto& name : std::vector<std::string>{"INPUT0", "INPUT1"}) {
+        requests.back()->AddInput(
+            name, tds::Tensor(
+                      reinterpret_cast<char*>(input_data.data()),
+                      input_data.size() * sizeof(int32_t),
+                      tds::DataType::INT32, {16}, tds::MemoryType::CPU, 0));
+      }
+      futures.emplace_back(server->AsyncInfer(*requests.back()));
     }
-    server->RegisterModelRepo(
-        tds::NewModelRepo("./models1", "add_sub", "add_sub1"));
-    try {
-      server->LoadModel("add_sub");
+    std::vector<std::unique_ptr<tds::InferResult>> results;
+    for (auto& future : futures) {
+      results.emplace_back(future.get());
     }
-    catch (std::exception& ex) {
-      ASSERT_STREQ(
-          ex.what(),
-          "Error - LoadModel: Internal-failed to load 'add_sub', failed to "
-          "poll from model repository\n");
+
+    // OUTPUT0 -> sum
+    std::shared_ptr<tds::Tensor> out = tds::GatherOutputs(results, "OUTPUT0");
+    ASSERT_EQ(out->shape_, std::vector<int64_t>{64});
+    ASSERT_EQ(out->data_type_, tds::DataType::INT32);
+    ASSERT_EQ(out->byte_size_, 4 * input_data.size() * sizeof(int32_t));
+    for (size_t i = 0; i < 64; ++i) {
+      EXPECT_EQ(
+          reinterpret_cast<const int32_t*>(out->buffer_)[i],
+          (2 * input_data[i % 16]));
+    }
+
+    // OUTPUT1 -> diff, gathered into the caller's buffer.
+    std::vector<int32_t> gathered(64, -1);
+    tds::Tensor gathered_tensor(
+        reinterpret_cast<char*>(gathered.data()),
+        gathered.size() * sizeof(int32_t), tds::DataType::INT32, {64},
+        tds::MemoryType::CPU, 0);
+    tds::GatherOutputs(
+        results, "OUTPUT1", gathered_tensor, true /* release_results */);
+    ASSERT_EQ(gathered_tensor.shape_, std::vector<int64_t>{64});
+    for (size_t i = 0; i < 64; ++i) {
+      EXPECT_EQ(gathered[i], 0);
+    }
+    for (const auto& result : results) {
+      ASSERT_EQ(result, nullptr);
     }
-    server->LoadModel("add_sub1");
-    std::set<std::string> loaded_models = server->LoadedModels();
-    ASSERT_EQ(loaded_models.size(), 1);
-    ASSERT_EQ(*loaded_models.begin(), "add_sub1");
   }
   catch (...) {
     ASSERT_NO_THROW(throw);
   }
 }
 
-TEST_F(TritonServerTest, InferMinimal)
+TEST_F(TritonServerTest, InferTypedTensor)
 {
   try {
     auto server = tds::TritonServer::Create(options_);
@@ -237,48 +1865,21 @@ TEST_F(TritonServerTest, InferMinimal)
       input_data.emplace_back(input_data.size());
     }
     auto request = tds::InferRequest::Create(tds::InferOptions("add_sub"));
-    for (const auto& name : std::vector<std::string>{"INPUT0", "INPUT1"}) {
-      request->AddInput(
-          name, tds::Tensor(
-                    reinterpret_cast<char*>(input_data.data()),
-                    input_data.size() * sizeof(int32_t), tds::DataType::INT32,
-                    {16}, tds::MemoryType::CPU, 0));
-    }
-    std::future<std::unique_ptr<tds::InferResult>> result_future =
-        server->AsyncInfer(*request);
-    auto result = result_future.get();
+    tds::TypedInput<tds::DataType::INT32> input(input_data);
+    input.AddTo(*request, "INPUT0", {16});
+    input.AddTo(*request, "INPUT1", {16});
+    auto result = server->AsyncInfer(*request).get();
     ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
 
-    // Check result metadata
-    ASSERT_EQ(result->ModelName(), "add_sub");
-    ASSERT_EQ(result->ModelVersion(), "1");
-    ASSERT_EQ(result->Id(), "");
-
-    // OUTPUT0 -> sum
-    {
-      std::string out_name("OUTPUT0");
-      std::shared_ptr<tds::Tensor> out = result->Output(out_name);
-      ASSERT_EQ(out->shape_, std::vector<int64_t>{16});
-      ASSERT_EQ(out->data_type_, tds::DataType::INT32);
-      ASSERT_EQ(out->byte_size_, (input_data.size() * sizeof(int32_t)));
-      for (size_t i = 0; i < input_data.size(); ++i) {
-        EXPECT_EQ(
-            reinterpret_cast<const int32_t*>(out->buffer_)[i],
-            (2 * input_data[i]));
-      }
-    }
-
-    // OUTPUT1 -> diff
-    {
-      std::string out_name("OUTPUT1");
-      std::shared_ptr<tds::Tensor> out = result->Output(out_name);
-      ASSERT_EQ(out->shape_, std::vector<int64_t>{16});
-      ASSERT_EQ(out->data_type_, tds::DataType::INT32);
-      ASSERT_EQ(out->byte_size_, (input_data.size() * sizeof(int32_t)));
-      for (size_t i = 0; i < input_data.size(); ++i) {
-        EXPECT_EQ(reinterpret_cast<const int32_t*>(out->buffer_)[i], 0);
-      }
+    tds::TypedOutput<tds::DataType::INT32> sum(*result, "OUTPUT0");
+    ASSERT_EQ(sum.Shape(), std::vector<int64_t>{16});
+    ASSERT_EQ(sum.Size(), input_data.size());
+    for (size_t i = 0; i < input_data.size(); ++i) {
+      EXPECT_EQ(sum.Data()[i], (2 * input_data[i]));
     }
+    ASSERT_THROW(
+        (tds::TypedOutput<tds::DataType::FP32>(*result, "OUTPUT1")),
+        tds::TritonException);
   }
   catch (...) {
     ASSERT_NO_THROW(throw);
@@ -562,6 +2163,43 @@ TEST_F(TritonServerTest, InferDecoupledMultipleResponses)
   }
 }
 
+TEST_F(TritonServerTest, InferDecoupledAggregatedResponses)
+{
+  try {
+    auto server = tds::TritonServer::Create(options_);
+
+    std::vector<int32_t> input_data = {3};
+    tds::InferOptions options("square_int32");
+    options.aggregate_decoupled_responses_ = true;
+    auto request = tds::InferRequest::Create(options);
+    request->AddInput(
+        "IN", tds::Tensor(
+                  reinterpret_cast<char*>(input_data.data()),
+                  input_data.size() * sizeof(int32_t), tds::DataType::INT32,
+                  {1}, tds::MemoryType::CPU, 0));
+    std::future<std::unique_ptr<tds::InferResult>> result_future =
+        server->AsyncInfer(*request);
+
+    // The outputs of all responses are concatenated into one result.
+    auto result = result_future.get();
+    ASSERT_NE(result, nullptr);
+    ASSERT_FALSE(result->HasError()) << result->ErrorMsg();
+    ASSERT_EQ(result->GetNextResult(), nullptr);
+    ASSERT_EQ(result->ModelName(), "square_int32");
+
+    std::shared_ptr<tds::Tensor> out = result->Output("OUT");
+    ASSERT_EQ(out->shape_, std::vector<int64_t>{3});
+    ASSERT_EQ(out->data_type_, tds::DataType::INT32);
+    ASSERT_EQ(out->byte_size_, 3 * sizeof(int32_t));
+    for (size_t i = 0; i < 3; ++i) {
+      EXPECT_EQ(reinterpret_cast<const int32_t*>(out->buffer_)[i], 3);
+    }
+  }
+  catch (...) {
+    ASSERT_NO_THROW(throw);
+  }
+}
+
 TEST_F(TritonServerTest, InferDecoupledZeroResponse)
 {
   try {
@@ -0,0 +1,230 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+// Generation of the typed model headers written by tds_codegen.
+
+#include <cctype>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "model_config.h"
+
+namespace triton { namespace developer_tools { namespace tools {
+
+//==============================================================================
+/// Header generation.
+///
+// Turn 'name' into a valid C++ identifier.
+inline std::string
+Identifier(const std::string& name)
+{
+  std::string identifier;
+  for (const char c : name) {
+    identifier += isalnum(static_cast<unsigned char>(c)) ? c : '_';
+  }
+  if (identifier.empty() ||
+      isdigit(static_cast<unsigned char>(identifier[0]))) {
+    identifier = "_" + identifier;
+  }
+  return identifier;
+}
+
+inline std::string
+DimsString(const std::vector<int64_t>& dims)
+{
+  std::string str;
+  for (const auto dim : dims) {
+    str += (str.empty() ? "" : ", ") + std::to_string(dim);
+  }
+  return "{" + str + "}";
+}
+
+// Return the shape used when the shape of an input is not set, or false if
+// the shape in the configuration is not fully specified. One batch is assumed
+// for models that support batching.
+inline bool
+DefaultShape(
+    const ModelConfig& config, const TensorConfig& tensor,
+    std::vector<int64_t>* shape)
+{
+  if (config.max_batch_size_ > 0) {
+    shape->push_back(1);
+  }
+  for (const auto dim : tensor.dims_) {
+    if (dim < 0) {
+      shape->clear();
+      return false;
+    }
+    shape->push_back(dim);
+  }
+  return true;
+}
+
+inline std::string
+NameList(const std::vector<TensorConfig>& tensors)
+{
+  std::string str;
+  for (const auto& tensor : tensors) {
+    str += (str.empty() ? "\"" : ", \"") + tensor.name_ + "\"";
+  }
+  return str;
+}
+
+// Write the header of the model described by 'config' to 'out', in the
+// namespace 'ns'. The output depends only on the arguments.
+inline void
+GenerateHeader(
+    const ModelConfig& config, const std::string& ns, std::ostream& out)
+{
+  const std::string model_ns = Identifier(config.name_);
+  out << "// Generated by tds_codegen from the configuration of model '"
+      << config.name_ << "'.\n"
+      << "// Do not edit.\n"
+      << "#pragma once\n\n"
+      << "#include <future>\n"
+      << "#include <memory>\n"
+      << "#include <string>\n"
+      << "#include <vector>\n\n"
+      << "#include \"triton/developer_tools/typed_tensor.h\"\n\n"
+      << "namespace " << ns << " { namespace " << model_ns << " {\n\n"
+      << "namespace tds = ::triton::developer_tools::server;\n\n"
+      << "constexpr char kModelName[] = \"" << config.name_ << "\";\n"
+      << "constexpr int64_t kMaxBatchSize = " << config.max_batch_size_
+      << ";\n\n";
+
+  // The names are constructed once instead of for every request.
+  out << "inline const std::vector<std::string>&\n"
+      << "InputNames()\n"
+      << "{\n"
+      << "  static const std::vector<std::string> names{"
+      << NameList(config.inputs_) << "};\n"
+      << "  return names;\n"
+      << "}\n\n"
+      << "inline const std::vector<std::string>&\n"
+      << "OutputNames()\n"
+      << "{\n"
+      << "  static const std::vector<std::string> names{"
+      << NameList(config.outputs_) << "};\n"
+      << "  return names;\n"
+      << "}\n\n";
+
+  out << "/// The inputs of model '" << config.name_ << "'.\n"
+      << "struct Inputs {\n";
+  for (const auto& input : config.inputs_) {
+    out << "  // '" << input.name_ << "': " << input.data_type_ << ", dims "
+        << DimsString(input.dims_) << (input.optional_ ? ", optional" : "")
+        << ".\n"
+        << "  tds::TypedInput<tds::DataType::" << input.data_type_ << "> "
+        << Identifier(input.name_) << ";\n";
+  }
+  out << "};\n\n";
+
+  out << "/// Add the inputs to 'request'. The optional inputs are added only "
+         "if\n"
+      << "/// their data is set.\n"
+      << "inline void\n"
+      << "AddInputs(tds::InferRequest& request, const Inputs& inputs)\n"
+      << "{\n";
+  for (size_t i = 0; i < config.inputs_.size(); ++i) {
+    const auto& input = config.inputs_[i];
+    const std::string member = "inputs." + Identifier(input.name_);
+    std::string indent = "  ";
+    if (input.optional_) {
+      out << "  if (" << member << ".data_ != nullptr) {\n";
+      indent = "    ";
+    }
+    std::vector<int64_t> shape;
+    if (!DefaultShape(config, input, &shape)) {
+      out << indent << "if (" << member << ".shape_.empty()) {\n"
+          << indent << "  throw tds::TritonException(\n"
+          << indent << "      \"Error - AddInputs: The shape of input '"
+          << input.name_ << "' must be set.\");\n"
+          << indent << "}\n";
+    }
+    out << indent << member << ".AddTo(request, InputNames()[" << i << "], "
+        << DimsString(shape) << ");\n";
+    if (input.optional_) {
+      out << "  }\n";
+    }
+  }
+  out << "}\n\n";
+
+  out << "/// Create a request for model '" << config.name_ << "'.\n"
+      << "inline std::unique_ptr<tds::InferRequest>\n"
+      << "CreateRequest()\n"
+      << "{\n"
+      << "  return tds::InferRequest::Create(tds::InferOptions(kModelName));\n"
+      << "}\n\n"
+      << "/// Reset 'request', add the inputs to it and run asynchronous "
+         "inference.\n"
+      << "inline std::future<std::unique_ptr<tds::InferResult>>\n"
+      << "Submit(\n"
+      << "    tds::TritonServer& server, tds::InferRequest& request,\n"
+      << "    const Inputs& inputs)\n"
+      << "{\n"
+      << "  request.Reset();\n"
+      << "  AddInputs(request, inputs);\n"
+      << "  return server.AsyncInfer(request);\n"
+      << "}\n\n";
+
+  out << "/// Typed accessors of the outputs of model '" << config.name_
+      << "'. An exception is\n"
+      << "/// thrown if the result has an error.\n"
+      << "class Result {\n"
+      << " public:\n"
+      << "  explicit Result(std::unique_ptr<tds::InferResult> result)\n"
+      << "      : result_(std::move(result))\n"
+      << "  {\n"
+      << "    if (result_ == nullptr) {\n"
+      << "      throw tds::TritonException(\"Error - Result: Empty "
+         "result.\");\n"
+      << "    }\n"
+      << "    if (result_->HasError()) {\n"
+      << "      throw tds::TritonException(result_->ErrorMsg());\n"
+      << "    }\n"
+      << "  }\n\n";
+  for (size_t i = 0; i < config.outputs_.size(); ++i) {
+    const auto& output = config.outputs_[i];
+    out << "  // '" << output.name_ << "': " << output.data_type_ << ", dims "
+        << DimsString(output.dims_) << ".\n"
+        << "  tds::TypedOutput<tds::DataType::" << output.data_type_ << ">\n"
+        << "  " << Identifier(output.name_) << "() const\n"
+        << "  {\n"
+        << "    return tds::TypedOutput<tds::DataType::" << output.data_type_
+        << ">(\n"
+        << "        *result_, OutputNames()[" << i << "]);\n"
+        << "  }\n\n";
+  }
+  out << "  tds::InferResult& Raw() const { return *result_; }\n\n"
+      << " private:\n"
+      << "  std::unique_ptr<tds::InferResult> result_;\n"
+      << "};\n\n"
+      << "}}  // namespace " << ns << "::" << model_ns << "\n";
+}
+
+}}}  // namespace triton::developer_tools::tools
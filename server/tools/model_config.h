@@ -0,0 +1,341 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+// Parsing of model configurations shared by the tools. The configuration may
+// be in the protobuf text format ('config.pbtxt') or in the JSON format
+// returned by 'TritonServer::ModelConfig'.
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace triton { namespace developer_tools { namespace tools {
+
+//==============================================================================
+/// A node of a parsed configuration. Both the protobuf text format and JSON
+/// are parsed into the same representation.
+///
+struct ConfigNode {
+  enum class Kind { SCALAR, MESSAGE, LIST };
+
+  ConfigNode() : kind_(Kind::SCALAR) {}
+
+  // Return all the values of field 'name'. A repeated field may be given
+  // either as a list or as repeated fields, the lists are flattened.
+  std::vector<std::shared_ptr<ConfigNode>> Fields(const std::string& name) const
+  {
+    std::vector<std::shared_ptr<ConfigNode>> values;
+    for (const auto& field : fields_) {
+      if (field.first != name) {
+        continue;
+      }
+      if (field.second->kind_ == Kind::LIST) {
+        values.insert(
+            values.end(), field.second->elements_.begin(),
+            field.second->elements_.end());
+      } else {
+        values.push_back(field.second);
+      }
+    }
+    return values;
+  }
+
+  // Return the value of scalar field 'name', or 'default_value' if the field
+  // is not set.
+  std::string Scalar(
+      const std::string& name, const std::string& default_value) const
+  {
+    for (const auto& field : fields_) {
+      if ((field.first == name) && (field.second->kind_ == Kind::SCALAR)) {
+        return field.second->scalar_;
+      }
+    }
+    return default_value;
+  }
+
+  Kind kind_;
+  std::string scalar_;
+  std::vector<std::pair<std::string, std::shared_ptr<ConfigNode>>> fields_;
+  std::vector<std::shared_ptr<ConfigNode>> elements_;
+};
+
+//==============================================================================
+/// Parser of the protobuf text format and JSON. Only the subset needed to
+/// read a model configuration is supported, the values are kept as strings.
+///
+class ConfigParser {
+ public:
+  explicit ConfigParser(const std::string& text)
+      : text_(text), pos_(0), is_punct_(false), at_end_(false)
+  {
+  }
+
+  std::shared_ptr<ConfigNode> Parse()
+  {
+    Next();
+    // JSON wraps the top-level message in braces, the text format does not.
+    if (token_ == "{") {
+      Next();
+      auto root = ParseMessage("}");
+      Next();
+      return root;
+    }
+    return ParseMessage("");
+  }
+
+ private:
+  std::shared_ptr<ConfigNode> ParseMessage(const std::string& end)
+  {
+    auto message = std::make_shared<ConfigNode>();
+    message->kind_ = ConfigNode::Kind::MESSAGE;
+    while (token_ != end) {
+      if (at_end_) {
+        throw std::runtime_error("unexpected end of configuration");
+      }
+      const std::string name = token_;
+      Next();
+      if (token_ == ":") {
+        Next();
+      }
+      message->fields_.emplace_back(name, ParseValue());
+      if ((token_ == ",") || (token_ == ";")) {
+        Next();
+      }
+    }
+    return message;
+  }
+
+  std::shared_ptr<ConfigNode> ParseValue()
+  {
+    if ((token_ == "{") || (token_ == "<")) {
+      const std::string end = (token_ == "{") ? "}" : ">";
+      Next();
+      auto message = ParseMessage(end);
+      Next();
+      return message;
+    }
+
+    if (token_ == "[") {
+      auto list = std::make_shared<ConfigNode>();
+      list->kind_ = ConfigNode::Kind::LIST;
+      Next();
+      while (token_ != "]") {
+        if (at_end_) {
+          throw std::runtime_error("unexpected end of configuration");
+        }
+        list->elements_.push_back(ParseValue());
+        if (token_ == ",") {
+          Next();
+        }
+      }
+      Next();
+      return list;
+    }
+
+    if (at_end_ || is_punct_) {
+      throw std::runtime_error("unexpected token '" + token_ + "'");
+    }
+    auto scalar = std::make_shared<ConfigNode>();
+    scalar->scalar_ = token_;
+    Next();
+    return scalar;
+  }
+
+  // Read the next token into 'token_'. Strings are unquoted.
+  void Next()
+  {
+    while (pos_ < text_.size()) {
+      if (isspace(static_cast<unsigned char>(text_[pos_]))) {
+        pos_++;
+      } else if (text_[pos_] == '#') {
+        while ((pos_ < text_.size()) && (text_[pos_] != '\n')) {
+          pos_++;
+        }
+      } else {
+        break;
+      }
+    }
+
+    token_.clear();
+    is_punct_ = false;
+    at_end_ = (pos_ == text_.size());
+    if (at_end_) {
+      return;
+    }
+
+    const char c = text_[pos_];
+    if ((c == '"') || (c == '\'')) {
+      pos_++;
+      while ((pos_ < text_.size()) && (text_[pos_] != c)) {
+        if ((text_[pos_] == '\\') && (pos_ + 1 < text_.size())) {
+          pos_++;
+        }
+        token_ += text_[pos_++];
+      }
+      pos_++;
+    } else if (std::string("{}[]<>:,;").find(c) != std::string::npos) {
+      token_ = c;
+      is_punct_ = true;
+      pos_++;
+    } else {
+      while ((pos_ < text_.size()) &&
+             (isalnum(static_cast<unsigned char>(text_[pos_])) ||
+              (std::string("_.+-").find(text_[pos_]) != std::string::npos))) {
+        token_ += text_[pos_++];
+      }
+      if (token_.empty()) {
+        throw std::runtime_error(
+            std::string("unexpected character '") + c + "'");
+      }
+    }
+  }
+
+  const std::string& text_;
+  size_t pos_;
+  std::string token_;
+  bool is_punct_;
+  bool at_end_;
+};
+
+//==============================================================================
+/// Model description read from the model configuration.
+///
+struct TensorConfig {
+  std::string name_;
+  std::string data_type_;
+  std::vector<int64_t> dims_;
+  bool optional_;
+};
+
+struct ModelConfig {
+  std::string name_;
+  int64_t max_batch_size_;
+  std::vector<TensorConfig> inputs_;
+  std::vector<TensorConfig> outputs_;
+  // The names of the rate limiter resources used by the instance groups.
+  std::vector<std::string> rate_limiter_resources_;
+};
+
+// Map the data type in the model configuration to the 'DataType' enum.
+inline std::string
+ToDataType(const std::string& config_data_type)
+{
+  static const std::vector<std::pair<std::string, std::string>> data_types{
+      {"TYPE_BOOL", "BOOL"},     {"TYPE_UINT8", "UINT8"},
+      {"TYPE_UINT16", "UINT16"}, {"TYPE_UINT32", "UINT32"},
+      {"TYPE_UINT64", "UINT64"}, {"TYPE_INT8", "INT8"},
+      {"TYPE_INT16", "INT16"},   {"TYPE_INT32", "INT32"},
+      {"TYPE_INT64", "INT64"},   {"TYPE_FP16", "FP16"},
+      {"TYPE_FP32", "FP32"},     {"TYPE_FP64", "FP64"},
+      {"TYPE_STRING", "BYTES"},  {"TYPE_BF16", "BF16"}};
+  for (const auto& data_type : data_types) {
+    if (data_type.first == config_data_type) {
+      return data_type.second;
+    }
+  }
+  throw std::runtime_error("unsupported data type '" + config_data_type + "'");
+}
+
+inline std::vector<TensorConfig>
+ReadTensors(const ConfigNode& config, const std::string& field)
+{
+  std::vector<TensorConfig> tensors;
+  for (const auto& node : config.Fields(field)) {
+    TensorConfig tensor;
+    tensor.name_ = node->Scalar("name", "");
+    if (tensor.name_.empty()) {
+      throw std::runtime_error("'" + field + "' without name");
+    }
+    tensor.data_type_ = ToDataType(node->Scalar("data_type", ""));
+    for (const auto& dim : node->Fields("dims")) {
+      tensor.dims_.push_back(std::stoll(dim->scalar_));
+    }
+    tensor.optional_ = (node->Scalar("optional", "false") == "true");
+    tensors.push_back(std::move(tensor));
+  }
+  return tensors;
+}
+
+// Parse the model configuration in 'text'. 'default_name' is used if the
+// configuration doesn't specify the model name.
+inline ModelConfig
+ParseModelConfig(const std::string& text, const std::string& default_name)
+{
+  auto root = ConfigParser(text).Parse();
+
+  ModelConfig config;
+  config.name_ = root->Scalar("name", default_name);
+  if (config.name_.empty()) {
+    throw std::runtime_error("the model name is not specified");
+  }
+  config.max_batch_size_ = std::stoll(root->Scalar("max_batch_size", "0"));
+  config.inputs_ = ReadTensors(*root, "input");
+  config.outputs_ = ReadTensors(*root, "output");
+  for (const auto& group : root->Fields("instance_group")) {
+    for (const auto& rate_limiter : group->Fields("rate_limiter")) {
+      for (const auto& resource : rate_limiter->Fields("resources")) {
+        const std::string name = resource->Scalar("name", "");
+        if (!name.empty() &&
+            (std::find(
+                 config.rate_limiter_resources_.begin(),
+                 config.rate_limiter_resources_.end(),
+                 name) == config.rate_limiter_resources_.end())) {
+          config.rate_limiter_resources_.push_back(name);
+        }
+      }
+    }
+  }
+  return config;
+}
+
+// Read the model configuration from the file at 'path'.
+inline ModelConfig
+ReadModelConfig(const std::string& path)
+{
+  std::ifstream file(path);
+  if (!file) {
+    throw std::runtime_error("failed to open '" + path + "'");
+  }
+  std::stringstream ss;
+  ss << file.rdbuf();
+
+  // The name may be omitted in 'config.pbtxt', in which case the name of the
+  // model directory is used.
+  std::string dir = path.substr(0, path.find_last_of('/') + 1);
+  if (!dir.empty()) {
+    dir.pop_back();
+  }
+  return ParseModelConfig(ss.str(), dir.substr(dir.find_last_of('/') + 1));
+}
+
+}}}  // namespace triton::developer_tools::tools
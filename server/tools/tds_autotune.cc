@@ -0,0 +1,991 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Search for the 'ServerOptions' and the client concurrency that give the
+// highest throughput at a latency SLO for a model. For each candidate, a
+// server is started with the candidate options and a workload is replayed
+// against it with a fixed number of requests in flight. The search is a
+// coordinate descent: each setting is swept in turn while the others are kept
+// at their best known values, until a round doesn't improve the throughput.
+//
+// The workload is either synthesized from the model configuration or read
+// from a file in the input data format of 'perf_analyzer':
+//   {"data": [{"INPUT0": [1, 2, 3, 4], "INPUT1": {"content": [...],
+//              "shape": [2, 2]}}, ...]}
+// The requests of the workload are sent round-robin.
+//
+// Usage: tds_autotune --model-repository=<dir> --model=<name>
+//            [--workload=<file>] [--batch-size=<n>] [--latency-slo-ms=<ms>]
+//            [--percentile=<p>] [--measurement-secs=<secs>]
+//            [--max-rounds=<n>] [--format=json|cpp] [--output=<file>]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "model_config.h"
+#include "triton/developer_tools/server_wrapper.h"
+
+namespace {
+
+namespace tds = triton::developer_tools::server;
+using namespace triton::developer_tools::tools;
+
+//==============================================================================
+/// Command line settings.
+///
+struct Settings {
+  Settings()
+      : batch_size_(1), latency_slo_ms_(100), percentile_(99),
+        measurement_secs_(5), max_rounds_(3), format_("json")
+  {
+  }
+
+  std::string model_repository_;
+  std::string model_;
+  std::string workload_;
+  int64_t batch_size_;
+  double latency_slo_ms_;
+  double percentile_;
+  double measurement_secs_;
+  int max_rounds_;
+  std::string format_;
+  std::string output_;
+};
+
+//==============================================================================
+/// Workload replayed against each candidate.
+///
+struct WorkloadInput {
+  std::string name_;
+  tds::DataType data_type_;
+  std::vector<int64_t> shape_;
+  std::vector<char> data_;
+};
+
+using WorkloadRequest = std::vector<WorkloadInput>;
+
+// Map the data type name used by 'ModelConfig' to the 'DataType' enum and the
+// byte size of an element, which is 0 for BYTES.
+tds::DataType
+ParseDataType(const std::string& name, size_t* element_byte_size)
+{
+  static const std::vector<
+      std::pair<std::string, std::pair<tds::DataType, size_t>>>
+      data_types{{"BOOL", {tds::DataType::BOOL, 1}},
+                 {"UINT8", {tds::DataType::UINT8, 1}},
+                 {"UINT16", {tds::DataType::UINT16, 2}},
+                 {"UINT32", {tds::DataType::UINT32, 4}},
+                 {"UINT64", {tds::DataType::UINT64, 8}},
+                 {"INT8", {tds::DataType::INT8, 1}},
+                 {"INT16", {tds::DataType::INT16, 2}},
+                 {"INT32", {tds::DataType::INT32, 4}},
+                 {"INT64", {tds::DataType::INT64, 8}},
+                 {"FP16", {tds::DataType::FP16, 2}},
+                 {"FP32", {tds::DataType::FP32, 4}},
+                 {"FP64", {tds::DataType::FP64, 8}},
+                 {"BYTES", {tds::DataType::BYTES, 0}},
+                 {"BF16", {tds::DataType::BF16, 2}}};
+  for (const auto& data_type : data_types) {
+    if (data_type.first == name) {
+      *element_byte_size = data_type.second.second;
+      return data_type.second.first;
+    }
+  }
+  throw std::runtime_error("unsupported data type '" + name + "'");
+}
+
+int64_t
+ElementCount(const std::vector<int64_t>& shape)
+{
+  int64_t count = 1;
+  for (const auto dim : shape) {
+    count *= dim;
+  }
+  return count;
+}
+
+// Convert 'value' to the IEEE 754 half precision format, rounding to the
+// nearest even value. Values out of range become infinity.
+uint16_t
+ToHalf(const float value)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const uint16_t sign = (bits >> 16) & 0x8000;
+  const uint32_t abs_bits = bits & 0x7fffffff;
+  if (abs_bits > 0x7f800000) {
+    // NaN, keep it quiet.
+    return sign | 0x7e00;
+  }
+  if (abs_bits >= 0x477ff000) {
+    // 65520 and above round to infinity.
+    return sign | 0x7c00;
+  }
+  if (abs_bits < 0x38800000) {
+    // Below the smallest normal half, 2^-14. A subnormal half counts units of
+    // 2^-24, the scaling is exact and 'nearbyint' rounds to even.
+    float abs_value;
+    memcpy(&abs_value, &abs_bits, sizeof(abs_value));
+    return sign |
+           static_cast<uint16_t>(std::nearbyint(abs_value * 16777216.0f));
+  }
+  // Rebias the exponent from 127 to 15 and round off the lower 13 bits of the
+  // mantissa. A carry out of the mantissa correctly increments the exponent.
+  const uint32_t rounded = abs_bits + 0xfff + ((abs_bits >> 13) & 1);
+  return sign | static_cast<uint16_t>((rounded - (112u << 23)) >> 13);
+}
+
+// Append 'value' to 'data' as an element of 'data_type'. BF16 values are
+// truncated to the upper bits of the FP32 representation.
+void
+AppendElement(
+    const tds::DataType data_type, const std::string& value,
+    std::vector<char>* data)
+{
+  auto append = [data](const void* element, const size_t byte_size) {
+    const char* bytes = reinterpret_cast<const char*>(element);
+    data->insert(data->end(), bytes, bytes + byte_size);
+  };
+
+  switch (data_type) {
+    case tds::DataType::BYTES: {
+      const uint32_t len = value.size();
+      append(&len, sizeof(len));
+      data->insert(data->end(), value.begin(), value.end());
+      break;
+    }
+    case tds::DataType::BOOL: {
+      const bool element = (value == "true") || (value == "1");
+      append(&element, sizeof(element));
+      break;
+    }
+    case tds::DataType::UINT8:
+    case tds::DataType::INT8: {
+      const int8_t element = std::stoll(value);
+      append(&element, sizeof(element));
+      break;
+    }
+    case tds::DataType::UINT16:
+    case tds::DataType::INT16: {
+      const int16_t element = std::stoll(value);
+      append(&element, sizeof(element));
+      break;
+    }
+    case tds::DataType::UINT32:
+    case tds::DataType::INT32: {
+      const int32_t element = std::stoll(value);
+      append(&element, sizeof(element));
+      break;
+    }
+    case tds::DataType::UINT64: {
+      const uint64_t element = std::stoull(value);
+      append(&element, sizeof(element));
+      break;
+    }
+    case tds::DataType::INT64: {
+      const int64_t element = std::stoll(value);
+      append(&element, sizeof(element));
+      break;
+    }
+    case tds::DataType::FP32: {
+      const float element = std::stof(value);
+      append(&element, sizeof(element));
+      break;
+    }
+    case tds::DataType::FP64: {
+      const double element = std::stod(value);
+      append(&element, sizeof(element));
+      break;
+    }
+    case tds::DataType::FP16: {
+      const uint16_t element = ToHalf(std::stof(value));
+      append(&element, sizeof(element));
+      break;
+    }
+    case tds::DataType::BF16: {
+      const float fp32 = std::stof(value);
+      uint32_t bits;
+      memcpy(&bits, &fp32, sizeof(bits));
+      const uint16_t element = (bits >> 16);
+      append(&element, sizeof(element));
+      break;
+    }
+    default:
+      throw std::runtime_error("unsupported data type");
+  }
+}
+
+// Return the shape of 'tensor' in a request of 'batch_size', or throw if the
+// shape is not fully specified by the configuration.
+std::vector<int64_t>
+ConfigShape(
+    const ModelConfig& config, const TensorConfig& tensor,
+    const int64_t batch_size)
+{
+  std::vector<int64_t> shape;
+  if (config.max_batch_size_ > 0) {
+    shape.push_back(batch_size);
+  }
+  for (const auto dim : tensor.dims_) {
+    if (dim < 0) {
+      throw std::runtime_error(
+          "input '" + tensor.name_ +
+          "' has variable dimensions, use '--workload' to specify its shape");
+    }
+    shape.push_back(dim);
+  }
+  return shape;
+}
+
+// Synthesize a workload of random data from the model configuration.
+std::vector<WorkloadRequest>
+SyntheticWorkload(const ModelConfig& config, const int64_t batch_size)
+{
+  // A few distinct requests so that the data is not always cache resident.
+  constexpr size_t kRequestCount = 16;
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> ints(0, 99);
+  std::uniform_real_distribution<double> reals(0, 1);
+
+  std::vector<WorkloadRequest> workload(kRequestCount);
+  for (auto& request : workload) {
+    for (const auto& input : config.inputs_) {
+      if (input.optional_) {
+        continue;
+      }
+      WorkloadInput workload_input;
+      workload_input.name_ = input.name_;
+      size_t element_byte_size = 0;
+      workload_input.data_type_ =
+          ParseDataType(input.data_type_, &element_byte_size);
+      workload_input.shape_ = ConfigShape(config, input, batch_size);
+      const int64_t element_count = ElementCount(workload_input.shape_);
+      for (int64_t i = 0; i < element_count; ++i) {
+        std::string value;
+        switch (workload_input.data_type_) {
+          case tds::DataType::FP16:
+          case tds::DataType::BF16:
+          case tds::DataType::FP32:
+          case tds::DataType::FP64:
+            value = std::to_string(reals(rng));
+            break;
+          case tds::DataType::BOOL:
+            value = std::to_string(ints(rng) % 2);
+            break;
+          default:
+            value = std::to_string(ints(rng));
+            break;
+        }
+        AppendElement(workload_input.data_type_, value, &workload_input.data_);
+      }
+      request.push_back(std::move(workload_input));
+    }
+  }
+  return workload;
+}
+
+// Read a workload in the input data format of 'perf_analyzer'. The shape of
+// an input defaults to its shape in the configuration.
+std::vector<WorkloadRequest>
+ReadWorkload(
+    const std::string& path, const ModelConfig& config,
+    const int64_t batch_size)
+{
+  std::ifstream file(path);
+  if (!file) {
+    throw std::runtime_error("failed to open '" + path + "'");
+  }
+  std::stringstream ss;
+  ss << file.rdbuf();
+  const std::string text = ss.str();
+  auto root = ConfigParser(text).Parse();
+
+  std::vector<WorkloadRequest> workload;
+  for (const auto& entry : root->Fields("data")) {
+    WorkloadRequest request;
+    for (const auto& input : config.inputs_) {
+      const auto values = entry->Fields(input.name_);
+      if (values.empty()) {
+        if (input.optional_) {
+          continue;
+        }
+        throw std::runtime_error(
+            "input '" + input.name_ + "' is missing in '" + path + "'");
+      }
+
+      WorkloadInput workload_input;
+      workload_input.name_ = input.name_;
+      size_t element_byte_size = 0;
+      workload_input.data_type_ =
+          ParseDataType(input.data_type_, &element_byte_size);
+
+      // The content is either given directly or with its shape.
+      std::vector<std::shared_ptr<ConfigNode>> content = values;
+      if ((values.size() == 1) &&
+          (values[0]->kind_ == ConfigNode::Kind::MESSAGE)) {
+        content = values[0]->Fields("content");
+        for (const auto& dim : values[0]->Fields("shape")) {
+          workload_input.shape_.push_back(std::stoll(dim->scalar_));
+        }
+        if (!workload_input.shape_.empty() && (config.max_batch_size_ > 0)) {
+          workload_input.shape_.insert(
+              workload_input.shape_.begin(), batch_size);
+        }
+      }
+      if (workload_input.shape_.empty()) {
+        workload_input.shape_ = ConfigShape(config, input, batch_size);
+      }
+
+      // The content is of a single batch, repeat it for each batch.
+      const int64_t element_count = ElementCount(workload_input.shape_);
+      const int64_t batch_count =
+          (config.max_batch_size_ > 0) ? batch_size : 1;
+      if (int64_t(content.size()) * batch_count != element_count) {
+        throw std::runtime_error(
+            "input '" + input.name_ + "' in '" + path + "' has " +
+            std::to_string(content.size()) +
+            " elements, which doesn't match its shape");
+      }
+      for (int64_t b = 0; b < batch_count; ++b) {
+        for (const auto& value : content) {
+          AppendElement(
+              workload_input.data_type_, value->scalar_, &workload_input.data_);
+        }
+      }
+      request.push_back(std::move(workload_input));
+    }
+    workload.push_back(std::move(request));
+  }
+  if (workload.empty()) {
+    throw std::runtime_error("no request in '" + path + "'");
+  }
+  return workload;
+}
+
+//==============================================================================
+/// Search space.
+///
+struct Candidate {
+  Candidate()
+      : buffer_manager_thread_count_(0), model_load_thread_count_(2),
+        pinned_memory_pool_byte_size_(0), rate_limit_resource_count_(0),
+        concurrency_(1)
+  {
+  }
+
+  std::string Key() const
+  {
+    std::stringstream ss;
+    ss << buffer_manager_thread_count_ << "/" << model_load_thread_count_
+       << "/" << pinned_memory_pool_byte_size_ << "/"
+       << rate_limit_resource_count_ << "/" << concurrency_;
+    return ss.str();
+  }
+
+  int64_t buffer_manager_thread_count_;
+  int64_t model_load_thread_count_;
+  int64_t pinned_memory_pool_byte_size_;
+  // The count of each rate limiter resource of the model, 0 if rate limiting
+  // is off.
+  int64_t rate_limit_resource_count_;
+  // The number of requests kept in flight by the client.
+  int64_t concurrency_;
+};
+
+struct Dimension {
+  std::string name_;
+  std::vector<int64_t> values_;
+  int64_t Candidate::*member_;
+};
+
+std::vector<Dimension>
+SearchSpace(const ModelConfig& config, const tds::ContainerLimits& limits)
+{
+  const int64_t cpus = limits.effective_cpu_count_;
+  auto up_to = [](const std::vector<int64_t>& values, const int64_t max) {
+    std::vector<int64_t> bounded;
+    for (const auto value : values) {
+      if ((value <= max) || bounded.empty()) {
+        bounded.push_back(value);
+      }
+    }
+    return bounded;
+  };
+
+  std::vector<Dimension> dimensions;
+  dimensions.push_back(
+      {"concurrency", up_to({1, 2, 4, 8, 16, 32, 64}, 8 * cpus),
+       &Candidate::concurrency_});
+  dimensions.push_back(
+      {"buffer_manager_thread_count", up_to({0, 1, 2, 4, 8, 16}, cpus),
+       &Candidate::buffer_manager_thread_count_});
+  const int64_t memory_limit =
+      (limits.memory_limit_byte_size_ == 0)
+          ? INT64_MAX
+          : int64_t(limits.memory_limit_byte_size_ / 4);
+  dimensions.push_back(
+      {"pinned_memory_pool_byte_size",
+       up_to({0, 64 << 20, 256 << 20, 1 << 30}, memory_limit),
+       &Candidate::pinned_memory_pool_byte_size_});
+  if (!config.rate_limiter_resources_.empty()) {
+    dimensions.push_back(
+        {"rate_limit_resource_count", up_to({0, 1, 2, 4, 8}, cpus),
+         &Candidate::rate_limit_resource_count_});
+  }
+  // Model loading is not on the inference path, the load thread count is
+  // swept last and compared by the load time of the model.
+  dimensions.push_back(
+      {"model_load_thread_count", up_to({1, 2, 4, 8, 16, 32}, 2 * cpus),
+       &Candidate::model_load_thread_count_});
+  return dimensions;
+}
+
+//==============================================================================
+/// Measurement of a candidate.
+///
+struct Measurement {
+  Measurement()
+      : valid_(false), throughput_(0), latency_ms_(0), load_secs_(0),
+        meets_slo_(false)
+  {
+  }
+
+  bool valid_;
+  // Inferences per second, counting each batch element.
+  double throughput_;
+  // The latency at the requested percentile.
+  double latency_ms_;
+  // The time to create the server and load the model.
+  double load_secs_;
+  bool meets_slo_;
+  std::string error_;
+};
+
+tds::ServerOptions
+CandidateOptions(
+    const Settings& settings, const ModelConfig& config,
+    const Candidate& candidate)
+{
+  tds::ServerOptions options({settings.model_repository_});
+  options.logging_ = tds::LoggingOptions(
+      tds::LoggingOptions::VerboseLevel(0), false, true, true,
+      tds::LoggingOptions::LogFormat::DEFAULT, "");
+  options.model_control_mode_ = tds::ModelControlMode::EXPLICIT;
+  options.startup_models_.insert(settings.model_);
+  options.buffer_manager_thread_count_ = candidate.buffer_manager_thread_count_;
+  options.model_load_thread_count_ = candidate.model_load_thread_count_;
+  options.pinned_memory_pool_byte_size_ =
+      candidate.pinned_memory_pool_byte_size_;
+  if (candidate.rate_limit_resource_count_ > 0) {
+    for (const auto& resource : config.rate_limiter_resources_) {
+      options.rate_limit_resource_.emplace_back(
+          resource, candidate.rate_limit_resource_count_);
+    }
+  }
+  return options;
+}
+
+// Keep 'concurrency' requests of the workload in flight for 'duration_secs'
+// and return the completion latencies in milliseconds. On an error no more
+// requests are sent, and the error is thrown once all the requests in flight
+// have completed, as they refer to 'requests'.
+std::vector<double>
+RunLoad(
+    tds::TritonServer& server, const std::string& model,
+    std::vector<WorkloadRequest>& workload, const int64_t concurrency,
+    const double duration_secs)
+{
+  using Clock = std::chrono::steady_clock;
+  std::vector<std::unique_ptr<tds::InferRequest>> requests;
+  std::vector<std::future<std::unique_ptr<tds::InferResult>>> futures(
+      concurrency);
+  std::vector<Clock::time_point> start_times(concurrency);
+  size_t next = 0;
+  std::string error;
+
+  // Return whether the request in 'slot' is in flight.
+  auto submit = [&](const int64_t slot) {
+    try {
+      tds::InferRequest& request = *requests[slot];
+      request.Reset();
+      for (auto& input : workload[next]) {
+        request.AddInput(
+            input.name_,
+            tds::Tensor(
+                input.data_.data(), input.data_.size(), input.data_type_,
+                input.shape_, tds::MemoryType::CPU, 0));
+      }
+      next = (next + 1) % workload.size();
+      start_times[slot] = Clock::now();
+      futures[slot] = server.AsyncInfer(request);
+      return true;
+    }
+    catch (const std::exception& ex) {
+      error = ex.what();
+      return false;
+    }
+  };
+
+  int64_t pending = 0;
+  for (int64_t slot = 0; (slot < concurrency) && error.empty(); ++slot) {
+    requests.push_back(tds::InferRequest::Create(tds::InferOptions(model)));
+    if (submit(slot)) {
+      pending++;
+    }
+  }
+
+  std::vector<double> latencies;
+  const auto end_time =
+      Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                         std::chrono::duration<double>(duration_secs));
+  bool stopping = false;
+  for (int64_t slot = 0; pending > 0; slot = (slot + 1) % concurrency) {
+    if (!futures[slot].valid()) {
+      continue;
+    }
+    try {
+      std::unique_ptr<tds::InferResult> result = futures[slot].get();
+      if (result->HasError()) {
+        throw std::runtime_error(result->ErrorMsg());
+      }
+      latencies.push_back(std::chrono::duration<double, std::milli>(
+                              Clock::now() - start_times[slot])
+                              .count());
+    }
+    catch (const std::exception& ex) {
+      if (error.empty()) {
+        error = ex.what();
+      }
+    }
+    stopping = stopping || !error.empty() || (Clock::now() >= end_time);
+    if (stopping || !submit(slot)) {
+      pending--;
+    }
+  }
+
+  if (!error.empty()) {
+    throw std::runtime_error(error);
+  }
+  return latencies;
+}
+
+Measurement
+Measure(
+    const Settings& settings, const ModelConfig& config,
+    std::vector<WorkloadRequest>& workload, const Candidate& candidate)
+{
+  Measurement measurement;
+  try {
+    const auto load_start = std::chrono::steady_clock::now();
+    auto server = tds::TritonServer::Create(
+        CandidateOptions(settings, config, candidate));
+    measurement.load_secs_ = std::chrono::duration<double>(
+                                 std::chrono::steady_clock::now() - load_start)
+                                 .count();
+
+    // Warm up for a fifth of the measurement so that the lazily initialized
+    // resources of the model are not measured.
+    RunLoad(
+        *server, settings.model_, workload, candidate.concurrency_,
+        settings.measurement_secs_ / 5);
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<double> latencies = RunLoad(
+        *server, settings.model_, workload, candidate.concurrency_,
+        settings.measurement_secs_);
+    const double elapsed_secs = std::chrono::duration<double>(
+                                    std::chrono::steady_clock::now() - start)
+                                    .count();
+
+    const int64_t batch_size =
+        (config.max_batch_size_ > 0) ? settings.batch_size_ : 1;
+    measurement.throughput_ = latencies.size() * batch_size / elapsed_secs;
+    std::sort(latencies.begin(), latencies.end());
+    const size_t index = std::min<size_t>(
+        latencies.size() - 1,
+        size_t(std::ceil(settings.percentile_ / 100 * latencies.size())) - 1);
+    measurement.latency_ms_ = latencies[index];
+    measurement.meets_slo_ =
+        (measurement.latency_ms_ <= settings.latency_slo_ms_);
+    measurement.valid_ = true;
+  }
+  catch (const std::exception& ex) {
+    measurement.error_ = ex.what();
+  }
+  return measurement;
+}
+
+// Return whether 'lhs' is better than 'rhs' on dimension 'dimension'. The
+// throughput within the SLO decides. The model load thread count is also
+// judged by the load time, but only between candidates of the same
+// throughput. A throughput or load time must be better by at least
+// 'kMinImprovement' so that noise doesn't drive the search.
+bool
+IsBetter(
+    const Measurement& lhs, const Measurement& rhs,
+    const std::string& dimension)
+{
+  constexpr double kMinImprovement = 1.02;
+  if (lhs.valid_ != rhs.valid_) {
+    return lhs.valid_;
+  }
+  if (!lhs.valid_) {
+    return false;
+  }
+  if (lhs.meets_slo_ != rhs.meets_slo_) {
+    return lhs.meets_slo_;
+  }
+  if (!lhs.meets_slo_) {
+    // Neither meets the SLO, get closer to it.
+    return lhs.latency_ms_ * kMinImprovement < rhs.latency_ms_;
+  }
+  if ((dimension == "model_load_thread_count") &&
+      (rhs.throughput_ <= lhs.throughput_ * kMinImprovement)) {
+    return (lhs.throughput_ > rhs.throughput_ * kMinImprovement) ||
+           (lhs.load_secs_ * kMinImprovement < rhs.load_secs_);
+  }
+  return lhs.throughput_ > rhs.throughput_ * kMinImprovement;
+}
+
+//==============================================================================
+/// Reporting.
+///
+struct Evaluation {
+  Candidate candidate_;
+  Measurement measurement_;
+};
+
+// Order of the results table: the candidates within the SLO by throughput,
+// then the others by latency, then the failed ones.
+bool
+RanksBefore(const Evaluation& lhs, const Evaluation& rhs)
+{
+  const Measurement& l = lhs.measurement_;
+  const Measurement& r = rhs.measurement_;
+  if (l.valid_ != r.valid_) {
+    return l.valid_;
+  }
+  if (l.meets_slo_ != r.meets_slo_) {
+    return l.meets_slo_;
+  }
+  if (l.meets_slo_) {
+    return l.throughput_ > r.throughput_;
+  }
+  return l.latency_ms_ < r.latency_ms_;
+}
+
+void
+PrintTable(const std::vector<Evaluation>& evaluations, const Settings& settings)
+{
+  std::cout << std::endl
+            << std::setw(6) << "buffer" << std::setw(6) << "load"
+            << std::setw(12) << "pinned_MB" << std::setw(6) << "rate"
+            << std::setw(6) << "conc" << std::setw(12) << "infer/sec"
+            << std::setw(12)
+            << ("p" + std::to_string(int(settings.percentile_)) + "_ms")
+            << std::setw(10) << "load_s" << "  status" << std::endl;
+  for (const auto& evaluation : evaluations) {
+    const Candidate& c = evaluation.candidate_;
+    const Measurement& m = evaluation.measurement_;
+    std::cout << std::setw(6) << c.buffer_manager_thread_count_ << std::setw(6)
+              << c.model_load_thread_count_ << std::setw(12)
+              << (c.pinned_memory_pool_byte_size_ >> 20) << std::setw(6)
+              << c.rate_limit_resource_count_ << std::setw(6)
+              << c.concurrency_ << std::fixed << std::setprecision(1)
+              << std::setw(12) << m.throughput_ << std::setw(12)
+              << m.latency_ms_ << std::setprecision(2) << std::setw(10)
+              << m.load_secs_ << "  "
+              << (!m.valid_ ? "error: " + m.error_
+                            : (m.meets_slo_ ? "ok" : "over SLO"))
+              << std::endl;
+  }
+}
+
+void
+WriteJson(
+    const Candidate& best, const Measurement& measurement,
+    const ModelConfig& config, const Settings& settings, std::ostream& out)
+{
+  out << "{\n"
+      << "  \"model\": \"" << settings.model_ << "\",\n"
+      << "  \"server_options\": {\n"
+      << "    \"buffer_manager_thread_count\": "
+      << best.buffer_manager_thread_count_ << ",\n"
+      << "    \"model_load_thread_count\": " << best.model_load_thread_count_
+      << ",\n"
+      << "    \"pinned_memory_pool_byte_size\": "
+      << best.pinned_memory_pool_byte_size_ << ",\n"
+      << "    \"rate_limit_resource\": [";
+  if (best.rate_limit_resource_count_ > 0) {
+    for (size_t i = 0; i < config.rate_limiter_resources_.size(); ++i) {
+      out << (i == 0 ? "" : ", ") << "{\"name\": \""
+          << config.rate_limiter_resources_[i]
+          << "\", \"count\": " << best.rate_limit_resource_count_ << "}";
+    }
+  }
+  out << "]\n"
+      << "  },\n"
+      << "  \"concurrency\": " << best.concurrency_ << ",\n"
+      << std::fixed << std::setprecision(3)
+      << "  \"throughput_infer_per_sec\": " << measurement.throughput_ << ",\n"
+      << "  \"latency_ms\": " << measurement.latency_ms_ << ",\n"
+      << "  \"latency_percentile\": " << settings.percentile_ << ",\n"
+      << "  \"latency_slo_ms\": " << settings.latency_slo_ms_ << ",\n"
+      << "  \"meets_slo\": " << (measurement.meets_slo_ ? "true" : "false")
+      << "\n"
+      << "}\n";
+}
+
+void
+WriteCpp(
+    const Candidate& best, const Measurement& measurement,
+    const ModelConfig& config, const Settings& settings, std::ostream& out)
+{
+  out << std::fixed << std::setprecision(1)
+      << "// Generated by tds_autotune for model '" << settings.model_
+      << "': " << measurement.throughput_ << " infer/sec at p"
+      << std::defaultfloat << settings.percentile_ << std::fixed
+      << " latency " << measurement.latency_ms_
+      << " ms (SLO " << settings.latency_slo_ms_ << " ms).\n"
+      << "// Keep " << best.concurrency_
+      << " requests in flight to reach the throughput.\n"
+      << "options.buffer_manager_thread_count_ = "
+      << best.buffer_manager_thread_count_ << ";\n"
+      << "options.model_load_thread_count_ = " << best.model_load_thread_count_
+      << ";\n"
+      << "options.pinned_memory_pool_byte_size_ = "
+      << best.pinned_memory_pool_byte_size_ << ";\n";
+  if (best.rate_limit_resource_count_ > 0) {
+    out << "options.rate_limit_resource_ = {";
+    for (size_t i = 0; i < config.rate_limiter_resources_.size(); ++i) {
+      out << (i == 0 ? "" : ", ") << "{\"" << config.rate_limiter_resources_[i]
+          << "\", " << best.rate_limit_resource_count_ << "}";
+    }
+    out << "};\n";
+  }
+}
+
+void
+Usage(const char* program)
+{
+  std::cerr
+      << "Usage: " << program
+      << " --model-repository=<dir> --model=<name> [options]" << std::endl
+      << "  --workload=<file>         requests in the perf_analyzer input "
+         "data format,"
+      << std::endl
+      << "                            synthesized from the model "
+         "configuration if not set"
+      << std::endl
+      << "  --batch-size=<n>          batch size of each request, default 1"
+      << std::endl
+      << "  --latency-slo-ms=<ms>     latency SLO, default 100" << std::endl
+      << "  --percentile=<p>          latency percentile of the SLO, default "
+         "99"
+      << std::endl
+      << "  --measurement-secs=<s>    measurement time of each candidate, "
+         "default 5"
+      << std::endl
+      << "  --max-rounds=<n>          maximum rounds of coordinate descent, "
+         "default 3"
+      << std::endl
+      << "  --format=json|cpp         format of the best configuration, "
+         "default json"
+      << std::endl
+      << "  --output=<file>           file of the best configuration, "
+         "default stdout"
+      << std::endl;
+}
+
+bool
+ParseArgs(int argc, char** argv, Settings* settings)
+{
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const auto eq = arg.find('=');
+    if ((arg.compare(0, 2, "--") != 0) || (eq == std::string::npos)) {
+      return false;
+    }
+    const std::string name = arg.substr(2, eq - 2);
+    const std::string value = arg.substr(eq + 1);
+    if (name == "model-repository") {
+      settings->model_repository_ = value;
+    } else if (name == "model") {
+      settings->model_ = value;
+    } else if (name == "workload") {
+      settings->workload_ = value;
+    } else if (name == "batch-size") {
+      settings->batch_size_ = std::stoll(value);
+    } else if (name == "latency-slo-ms") {
+      settings->latency_slo_ms_ = std::stod(value);
+    } else if (name == "percentile") {
+      settings->percentile_ = std::stod(value);
+    } else if (name == "measurement-secs") {
+      settings->measurement_secs_ = std::stod(value);
+    } else if (name == "max-rounds") {
+      settings->max_rounds_ = std::stoi(value);
+    } else if (name == "format") {
+      settings->format_ = value;
+    } else if (name == "output") {
+      settings->output_ = value;
+    } else {
+      return false;
+    }
+  }
+  return !settings->model_repository_.empty() && !settings->model_.empty() &&
+         (settings->batch_size_ > 0) && (settings->percentile_ > 0) &&
+         (settings->percentile_ <= 100) && (settings->measurement_secs_ > 0) &&
+         ((settings->format_ == "json") || (settings->format_ == "cpp"));
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+  Settings settings;
+  try {
+    if (!ParseArgs(argc, argv, &settings)) {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  catch (...) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  try {
+    const tds::ContainerLimits limits = tds::DetectContainerLimits();
+
+    // Start from the defaults of 'ServerOptions'.
+    tds::ServerOptions defaults({settings.model_repository_});
+    Candidate current;
+    current.buffer_manager_thread_count_ =
+        defaults.buffer_manager_thread_count_;
+    current.model_load_thread_count_ = defaults.model_load_thread_count_;
+    current.pinned_memory_pool_byte_size_ =
+        defaults.pinned_memory_pool_byte_size_;
+
+    ModelConfig config;
+    {
+      auto server = tds::TritonServer::Create(
+          CandidateOptions(settings, config, current));
+      config = ParseModelConfig(
+          server->ModelConfig(settings.model_), settings.model_);
+    }
+    std::vector<WorkloadRequest> workload =
+        settings.workload_.empty()
+            ? SyntheticWorkload(config, settings.batch_size_)
+            : ReadWorkload(settings.workload_, config, settings.batch_size_);
+    if ((config.max_batch_size_ > 0) &&
+        (settings.batch_size_ > config.max_batch_size_)) {
+      throw std::runtime_error(
+          "the batch size exceeds the max batch size of the model");
+    }
+
+    std::vector<Evaluation> evaluations;
+    std::map<std::string, size_t> evaluated;
+    auto evaluate = [&](const Candidate& candidate) -> const Measurement& {
+      auto it = evaluated.find(candidate.Key());
+      if (it != evaluated.end()) {
+        return evaluations[it->second].measurement_;
+      }
+      std::cerr << "Measuring " << candidate.Key() << std::endl;
+      evaluations.push_back(
+          {candidate, Measure(settings, config, workload, candidate)});
+      evaluated[candidate.Key()] = evaluations.size() - 1;
+      return evaluations.back().measurement_;
+    };
+
+    Measurement best = evaluate(current);
+    const std::vector<Dimension> dimensions = SearchSpace(config, limits);
+    for (int round = 0; round < settings.max_rounds_; ++round) {
+      bool improved = false;
+      for (const auto& dimension : dimensions) {
+        for (const auto value : dimension.values_) {
+          Candidate candidate = current;
+          candidate.*dimension.member_ = value;
+          const Measurement measurement = evaluate(candidate);
+          if (IsBetter(measurement, best, dimension.name_)) {
+            current = candidate;
+            best = measurement;
+            improved = true;
+          }
+        }
+      }
+      if (!improved) {
+        break;
+      }
+    }
+
+    std::sort(evaluations.begin(), evaluations.end(), RanksBefore);
+    PrintTable(evaluations, settings);
+    if (!best.valid_) {
+      throw std::runtime_error("no candidate could be measured");
+    }
+    if (!best.meets_slo_) {
+      std::cerr << "warning: no candidate meets the latency SLO, reporting "
+                   "the lowest latency"
+                << std::endl;
+    }
+
+    std::ofstream file;
+    if (!settings.output_.empty()) {
+      file.open(settings.output_);
+      if (!file) {
+        throw std::runtime_error("failed to open '" + settings.output_ + "'");
+      }
+    }
+    std::ostream& out = settings.output_.empty() ? std::cout : file;
+    out << std::endl;
+    if (settings.format_ == "json") {
+      WriteJson(current, best, config, settings, out);
+    } else {
+      WriteCpp(current, best, config, settings, out);
+    }
+  }
+  catch (const std::exception& ex) {
+    std::cerr << "error: " << ex.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,103 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Generate a C++ header with strongly typed inputs and outputs for each model
+// configuration given on the command line. The configuration may be in the
+// protobuf text format ('config.pbtxt') or in the JSON format returned by
+// 'TritonServer::ModelConfig'.
+//
+// Usage: tds_codegen [--namespace=<namespace>] [--output-dir=<dir>]
+//            <config>...
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "codegen.h"
+
+namespace {
+
+using namespace triton::developer_tools::tools;
+
+void
+Usage(const char* program)
+{
+  std::cerr << "Usage: " << program
+            << " [--namespace=<namespace>] [--output-dir=<dir>] <config>..."
+            << std::endl
+            << "  <config> is a 'config.pbtxt' file or a model configuration "
+               "in JSON."
+            << std::endl;
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+  std::string ns = "tds_models";
+  std::string output_dir = ".";
+  std::vector<std::string> configs;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg.compare(0, 12, "--namespace=") == 0) {
+      ns = arg.substr(12);
+    } else if (arg.compare(0, 13, "--output-dir=") == 0) {
+      output_dir = arg.substr(13);
+    } else if (arg.compare(0, 2, "--") == 0) {
+      Usage(argv[0]);
+      return 1;
+    } else {
+      configs.push_back(arg);
+    }
+  }
+  if (configs.empty() || ns.empty()) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  for (const auto& path : configs) {
+    try {
+      const ModelConfig config = ReadModelConfig(path);
+      const std::string header =
+          output_dir + "/" + Identifier(config.name_) + ".h";
+      std::ofstream out(header);
+      if (!out) {
+        throw std::runtime_error("failed to open '" + header + "'");
+      }
+      GenerateHeader(config, ns, out);
+      std::cout << "Generated " << header << std::endl;
+    }
+    catch (const std::exception& ex) {
+      std::cerr << "error: " << path << ": " << ex.what() << std::endl;
+      return 1;
+    }
+  }
+
+  return 0;
+}
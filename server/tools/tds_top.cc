@@ -0,0 +1,267 @@
+// Copyright 2024, NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Show the live counters that a server publishes to its stats segment, see
+// 'stats_segment_name_' in 'ServerOptions', refreshed every interval. The
+// segment is mapped read-only, so watching a server costs it nothing.
+//
+// Usage: tds_top --segment=<name> [--interval-ms=<ms>] [--iterations=<n>]
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+
+#include "triton/developer_tools/stats_segment.h"
+
+namespace {
+
+using namespace triton::developer_tools::server;
+
+// Map the segment 'name' read-only, or return nullptr after printing why.
+const StatsSegment*
+MapSegment(const std::string& name)
+{
+  const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd == -1) {
+    std::cerr << "error: failed to open stats segment '" << name
+              << "': " << strerror(errno) << std::endl;
+    return nullptr;
+  }
+  struct stat st;
+  if ((fstat(fd, &st) != 0) ||
+      (static_cast<size_t>(st.st_size) < sizeof(StatsSegment))) {
+    std::cerr << "error: stats segment '" << name << "' is too small"
+              << std::endl;
+    close(fd);
+    return nullptr;
+  }
+  void* addr =
+      mmap(nullptr, sizeof(StatsSegment), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    std::cerr << "error: failed to map stats segment '" << name
+              << "': " << strerror(errno) << std::endl;
+    return nullptr;
+  }
+  const StatsSegment* segment = static_cast<const StatsSegment*>(addr);
+  if ((segment->magic_ != kStatsSegmentMagic) ||
+      (segment->version_ != kStatsSegmentVersion) ||
+      (segment->byte_size_ != sizeof(StatsSegment))) {
+    std::cerr << "error: '" << name
+              << "' is not a stats segment of version "
+              << kStatsSegmentVersion << std::endl;
+    munmap(addr, sizeof(StatsSegment));
+    return nullptr;
+  }
+  return segment;
+}
+
+// Return the upper bound in microseconds of the bucket that holds the
+// 'quantile' of the requests counted in 'buckets', or 0 if there is none.
+uint64_t
+BucketQuantile(const uint64_t* buckets, const double quantile)
+{
+  uint64_t total = 0;
+  for (size_t i = 0; i < kStatsSegmentLatencyBucketCount; ++i) {
+    total += buckets[i];
+  }
+  if (total == 0) {
+    return 0;
+  }
+  const double rank = quantile * total;
+  uint64_t count = 0;
+  for (size_t i = 0; i < kStatsSegmentLatencyBucketCount; ++i) {
+    count += buckets[i];
+    if (count >= rank) {
+      return uint64_t(1) << i;
+    }
+  }
+  return uint64_t(1) << (kStatsSegmentLatencyBucketCount - 1);
+}
+
+std::string
+ByteSizeString(const uint64_t byte_size)
+{
+  char str[32];
+  snprintf(str, sizeof(str), "%.1f MiB", byte_size / (1024.0 * 1024.0));
+  return str;
+}
+
+// Print the counters in 'current', with the rates since 'previous' taken
+// 'elapsed_s' earlier. 'previous' is nullptr on the first iteration.
+void
+Print(
+    const StatsSegment& segment, const StatsSegmentData& current,
+    const StatsSegmentData* previous, const double elapsed_s)
+{
+  const uint64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::system_clock::now()
+                                  .time_since_epoch())
+                              .count();
+  const double age_ms =
+      (now_ns > current.update_time_ns_)
+          ? (now_ns - current.update_time_ns_) / 1000000.0
+          : 0;
+  const bool stale = age_ms > 10.0 * segment.update_interval_ms_;
+
+  printf(
+      "pid %" PRIu64 "  updated %.0f ms ago%s  heap %s  pinned pool %s\n",
+      segment.pid_, age_ms, stale ? " (stale)" : "",
+      ByteSizeString(current.heap_in_use_byte_size_).c_str(),
+      ByteSizeString(current.pinned_memory_pool_byte_size_).c_str());
+  printf(
+      "dropped traces %" PRIu64 "  uncounted requests %" PRIu64 "\n\n",
+      current.dropped_trace_count_, current.dropped_model_request_count_);
+  printf(
+      "%-32s %9s %10s %10s %12s %10s %10s\n", "MODEL", "IN-FLIGHT", "REQ/S",
+      "ERR/S", "AVG (us)", "P50 (us)", "P99 (us)");
+
+  // Models are matched by name, the order in the segment is not stable.
+  std::map<std::string, const StatsSegmentModel*> previous_models;
+  if (previous != nullptr) {
+    for (uint64_t i = 0; i < previous->model_count_; ++i) {
+      previous_models[previous->models_[i].name_] = &previous->models_[i];
+    }
+  }
+  for (uint64_t i = 0; i < current.model_count_; ++i) {
+    const StatsSegmentModel& model = current.models_[i];
+    uint64_t buckets[kStatsSegmentLatencyBucketCount];
+    memcpy(buckets, model.latency_buckets_, sizeof(buckets));
+    uint64_t requests = model.request_count_;
+    uint64_t errors = model.error_count_;
+    uint64_t latency_sum_us = model.latency_sum_us_;
+    const auto it = previous_models.find(model.name_);
+    if (it != previous_models.end()) {
+      for (size_t b = 0; b < kStatsSegmentLatencyBucketCount; ++b) {
+        buckets[b] -= it->second->latency_buckets_[b];
+      }
+      requests -= it->second->request_count_;
+      errors -= it->second->error_count_;
+      latency_sum_us -= it->second->latency_sum_us_;
+    }
+    const bool has_rate = (previous != nullptr) && (elapsed_s > 0);
+    printf(
+        "%-32.32s %9" PRIu64 " %10.1f %10.1f %12.1f %10" PRIu64
+        " %10" PRIu64 "\n",
+        model.name_, model.in_flight_count_,
+        has_rate ? requests / elapsed_s : 0.0,
+        has_rate ? errors / elapsed_s : 0.0,
+        (requests != 0) ? double(latency_sum_us) / requests : 0.0,
+        BucketQuantile(buckets, 0.5), BucketQuantile(buckets, 0.99));
+  }
+  fflush(stdout);
+}
+
+void
+Usage(const char* program)
+{
+  std::cerr << "Usage: " << program
+            << " --segment=<name> [--interval-ms=<ms>] [--iterations=<n>]"
+            << std::endl
+            << "  <name> is the 'stats_segment_name_' of the server, for "
+               "example '/tds_stats'. 0 iterations runs until interrupted."
+            << std::endl;
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+  std::string name;
+  uint64_t interval_ms = 1000;
+  uint64_t iterations = 0;
+  try {
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg = argv[i];
+      if (arg.compare(0, 10, "--segment=") == 0) {
+        name = arg.substr(10);
+      } else if (arg.compare(0, 14, "--interval-ms=") == 0) {
+        interval_ms = std::stoull(arg.substr(14));
+      } else if (arg.compare(0, 13, "--iterations=") == 0) {
+        iterations = std::stoull(arg.substr(13));
+      } else {
+        Usage(argv[0]);
+        return 1;
+      }
+    }
+  }
+  catch (const std::exception& ex) {
+    Usage(argv[0]);
+    return 1;
+  }
+  if (name.empty() || (interval_ms == 0)) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  const StatsSegment* segment = MapSegment(name);
+  if (segment == nullptr) {
+    return 1;
+  }
+
+  const bool is_terminal = isatty(STDOUT_FILENO);
+  StatsSegmentData data[2];
+  const StatsSegmentData* previous = nullptr;
+  auto previous_time = std::chrono::steady_clock::now();
+  for (uint64_t iteration = 0; (iterations == 0) || (iteration < iterations);
+       ++iteration) {
+    if (iteration != 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+    }
+    StatsSegmentData& current = data[iteration % 2];
+    if (!ReadStatsSegment(*segment, &current)) {
+      std::cerr << "warning: stats segment is updated too often to be read"
+                << std::endl;
+      continue;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    const double elapsed_s =
+        std::chrono::duration<double>(now - previous_time).count();
+    if (is_terminal) {
+      // Clear the screen and move to the top-left corner.
+      printf("\033[2J\033[H");
+    } else if (iteration != 0) {
+      printf("\n");
+    }
+    Print(*segment, current, previous, elapsed_s);
+    previous = &current;
+    previous_time = now;
+  }
+
+  munmap(const_cast<StatsSegment*>(segment), sizeof(StatsSegment));
+  return 0;
+}